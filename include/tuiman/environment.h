@@ -0,0 +1,71 @@
+#ifndef TUIMAN_ENVIRONMENT_H
+#define TUIMAN_ENVIRONMENT_H
+
+#include <stddef.h>
+
+#include "tuiman/paths.h"
+#include "tuiman/request_store.h"
+#include "tuiman/template.h"
+
+#define TUIMAN_ENV_NAME_LEN 64
+
+typedef struct {
+  char *name;
+  char *value;
+  size_t value_len;
+} environment_var_t;
+
+/* A named variable set loaded from environments/<name>.env. Vars are sorted by name. */
+typedef struct {
+  char name[TUIMAN_ENV_NAME_LEN];
+  environment_var_t *vars;
+  size_t len;
+} environment_t;
+
+typedef struct {
+  char (*items)[TUIMAN_ENV_NAME_LEN];
+  size_t len;
+} environment_names_t;
+
+int environment_load(const app_paths_t *paths, const char *name, environment_t *out);
+void environment_free(environment_t *env);
+int environment_file_path(const app_paths_t *paths, const char *name, char *out, size_t out_len);
+int environment_list_names(const app_paths_t *paths, environment_names_t *out);
+void environment_names_free(environment_names_t *names);
+
+const char *environment_lookup(const environment_t *env, const char *name, size_t name_len, size_t *value_len);
+
+/* Adds or replaces one variable, keeping the table sorted. */
+int environment_set(environment_t *env, const char *name, const char *value, size_t value_len);
+
+/*
+ * Compiled templates of catalog requests, keyed by request id. The owner
+ * forgets an entry whenever that request changes (save, watch patch, delete),
+ * so a send finds its templates by id without re-reading the fields.
+ */
+typedef struct template_set template_set_t;
+
+template_set_t *template_set_new(void);
+void template_set_free(template_set_t *set);
+void template_set_clear(template_set_t *set);
+void template_set_forget(template_set_t *set, const char *request_id);
+
+/*
+ * Expands {{var}} / {{$generator}} placeholders in the templated fields of `req`
+ * into `out`. Names are looked up in `overlay` first, then `env`; either may be
+ * NULL. With `templates`, `req` must be the current revision of a catalog entry
+ * and is compiled once into the set; NULL compiles it on the spot. Returns -1
+ * if an expanded field does not fit.
+ */
+int environment_resolve_request(const environment_t *env, const environment_t *overlay, template_set_t *templates,
+                                const request_t *req, const template_iteration_t *it, request_t *out);
+/*
+ * "name=value" lines, one per distinct {{var}} that `req` references ("(unset)"
+ * when missing). Values from `overlay` and of names that look like credentials
+ * (token, secret, pass, key, auth, cookie, session, credential) read
+ * "(redacted)". Heap string or NULL.
+ */
+char *environment_describe_variables(const environment_t *env, const environment_t *overlay,
+                                     template_set_t *templates, const request_t *req);
+
+#endif
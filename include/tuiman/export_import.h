@@ -13,6 +13,6 @@ typedef struct {
 
 int export_requests(const app_paths_t *paths, const request_list_t *requests, const char *destination_dir,
                     export_report_t *report);
-int import_requests(const app_paths_t *paths, const char *source_dir, size_t *imported_count);
+int import_requests(request_store_t *store, const char *source_dir, size_t *imported_count);
 
 #endif
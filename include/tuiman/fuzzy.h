@@ -0,0 +1,35 @@
+#ifndef TUIMAN_FUZZY_H
+#define TUIMAN_FUZZY_H
+
+#include <limits.h>
+#include <stddef.h>
+
+#define FUZZY_NO_MATCH INT_MIN
+#define FUZZY_MAX_PATTERN 128
+
+/* Smart case: the match is case-sensitive only when the pattern has an uppercase letter. */
+typedef struct {
+  char text[FUZZY_MAX_PATTERN];
+  size_t len;
+  int case_sensitive;
+} fuzzy_pattern_t;
+
+typedef struct {
+  size_t item;
+  int score;
+  size_t length; /* tie-break: shorter text first */
+} fuzzy_hit_t;
+
+void fuzzy_pattern_init(fuzzy_pattern_t *pattern, const char *text);
+
+/*
+ * fzf-style subsequence score (higher is better), or FUZZY_NO_MATCH. Word
+ * boundaries, camelCase humps and consecutive runs earn bonuses; gaps cost.
+ * When `positions` is non-NULL it receives pattern->len matched byte offsets.
+ */
+int fuzzy_score(const fuzzy_pattern_t *pattern, const char *text, size_t *positions);
+
+/* Moves the best `k` hits to the front of `hits`, sorted best first; the rest stay unordered. */
+void fuzzy_top_k(fuzzy_hit_t *hits, size_t len, size_t k);
+
+#endif
@@ -0,0 +1,89 @@
+#ifndef TUIMAN_HIGHLIGHT_H
+#define TUIMAN_HIGHLIGHT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum {
+  HIGHLIGHT_NONE = 0,
+  HIGHLIGHT_JSON = 1,
+  HIGHLIGHT_XML = 2, /* also HTML */
+  HIGHLIGHT_FORM = 3, /* application/x-www-form-urlencoded */
+} highlight_lang_t;
+
+typedef enum {
+  HIGHLIGHT_PLAIN = 0,
+  HIGHLIGHT_KEY,     /* JSON member names, form keys */
+  HIGHLIGHT_STRING,  /* JSON strings, attribute values, form values */
+  HIGHLIGHT_NUMBER,
+  HIGHLIGHT_LITERAL, /* true/false/null, entities, %XX escapes */
+  HIGHLIGHT_PUNCT,
+  HIGHLIGHT_TAG,
+  HIGHLIGHT_ATTR,
+  HIGHLIGHT_COMMENT,
+} highlight_token_t;
+
+/* Lexer state between any two bytes; small enough to copy into every checkpoint. */
+typedef struct {
+  uint8_t region; /* 1-based index of the region being lexed, 0 outside them */
+  uint8_t mode;
+  uint8_t token;  /* of the string, word or construct in progress */
+  uint8_t skip;   /* bytes still to take as `token` without looking at them */
+  uint8_t dashes; /* XML: '-' just seen inside a comment, up to 2 */
+  uint8_t expect_key;
+  uint32_t depth;
+  uint64_t objects; /* JSON: bit n set when nesting level n is an object (the first 64 levels) */
+} highlight_state_t;
+
+typedef struct {
+  size_t offset;
+  highlight_state_t state;
+} highlight_mark_t;
+
+typedef struct {
+  size_t start;
+  size_t end;
+  highlight_lang_t lang;
+} highlight_region_t;
+
+#define HIGHLIGHT_MAX_REGIONS 2
+/* A checkpoint is kept every this many lines, or sooner on long lines. */
+#define HIGHLIGHT_MARK_LINES 256
+#define HIGHLIGHT_MARK_BYTES (16u * 1024u)
+/* New text lexed by one highlighter_seek; farther targets take several frames. */
+#define HIGHLIGHT_SEEK_BUDGET (1024u * 1024u)
+
+/*
+ * Highlighting of one text: the regions that have a language (the rest is
+ * plain) and checkpoints of the lexer state up to how far it has been run.
+ * Drawing seeks to the first visible byte, which lexes at most one checkpoint
+ * interval plus any new ground within the budget, and then lexes only what it
+ * draws.
+ */
+typedef struct {
+  const char *text; /* not owned */
+  size_t len;
+  highlight_region_t regions[HIGHLIGHT_MAX_REGIONS];
+  size_t regions_len;
+  highlight_mark_t *marks;
+  size_t marks_len;
+  size_t marks_cap;
+  size_t lexed; /* checkpoints cover [0, lexed) */
+  int behind;   /* the last seek ran out of budget */
+} highlighter_t;
+
+/* Guesses from the first bytes: '{' or '[' is JSON, '<' markup, "key=value" a form. */
+highlight_lang_t highlight_detect(const char *text, size_t len);
+
+void highlighter_init(highlighter_t *h, const char *text, size_t len);
+void highlighter_free(highlighter_t *h);
+/* Regions are added in order and must not overlap. */
+void highlighter_add_region(highlighter_t *h, size_t start, size_t end, highlight_lang_t lang);
+
+/* The state at `pos`; -1 when `pos` is past the budget for this call (`behind` is then set). */
+int highlighter_seek(highlighter_t *h, size_t pos, highlight_state_t *state);
+/* Lexes the run of one token starting at `pos` and returns its end (at most `end`). */
+size_t highlighter_next(const highlighter_t *h, highlight_state_t *state, size_t pos, size_t end,
+                        highlight_token_t *token);
+
+#endif
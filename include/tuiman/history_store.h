@@ -5,6 +5,8 @@
 
 #include <sqlite3.h>
 
+#include "tuiman/sha256.h"
+
 #define TUIMAN_HISTORY_TIME_LEN 40
 #define TUIMAN_HISTORY_ERR_LEN 256
 
@@ -18,20 +20,175 @@ typedef struct {
   long duration_ms;
   char error[TUIMAN_HISTORY_ERR_LEN];
   char created_at[TUIMAN_HISTORY_TIME_LEN];
+  /* SHA-256 of the response body; equal hashes mean byte-identical responses. Empty for none. */
+  char body_hash[TUIMAN_SHA256_HEX_LEN];
+  /* NULL in listed rows until history_store_load_bodies. */
   char *request_snapshot;
   char *response_body;
+  size_t response_body_len; /* bodies may hold NUL bytes; response_body is still NUL-terminated */
+  /*
+   * Submitted runs only: when set, response_body is borrowed from a buffer
+   * shared with the caller, and the writer calls this with `body_owner` once
+   * the run is committed instead of freeing the body.
+   */
+  void (*body_release)(void *owner);
+  void *body_owner;
 } run_entry_t;
 
 typedef struct {
   run_entry_t *items;
   size_t len;
+  size_t cap;
 } run_list_t;
 
-int history_store_open(const char *db_path, sqlite3 **out_db);
-void history_store_close(sqlite3 *db);
+/* Retention limits, enforced by the background writer; 0 (the default) turns a limit off. */
+typedef struct {
+  long long max_runs;
+  long long max_bytes;  /* live database pages */
+  int max_age_days;
+  int keep_per_request; /* newest N runs of each request */
+} history_retention_t;
+
+/* Connection tuning; zero fields keep the defaults below. */
+typedef struct {
+  long long mmap_size;   /* bytes; negative disables memory-mapped I/O */
+  int cache_size_kib;
+  int busy_timeout_ms;
+  history_retention_t retention;
+  int index_bodies;      /* also full-text index response bodies (first 64 KiB of each distinct body) */
+} history_store_options_t;
+
+#define TUIMAN_HISTORY_MMAP_SIZE_DEFAULT (64LL * 1024 * 1024)
+#define TUIMAN_HISTORY_CACHE_KIB_DEFAULT 8192
+#define TUIMAN_HISTORY_BUSY_TIMEOUT_DEFAULT 5000
+
+/* One connection (WAL, synchronous=NORMAL) with its statements prepared once at open. */
+typedef struct {
+  sqlite3 *db;
+  sqlite3_stmt *insert_stmt;
+  sqlite3_stmt *list_stmt;
+  sqlite3_stmt *body_find_stmt;
+  sqlite3_stmt *body_insert_stmt;
+  sqlite3_stmt *legacy_next_stmt;
+  sqlite3_stmt *legacy_update_stmt;
+  sqlite3_stmt *latency_stmt;
+  sqlite3_stmt *search_runs_stmt;
+  sqlite3_stmt *search_bodies_stmt;
+  /* Body index and writer maintenance. */
+  sqlite3_stmt *fts_add_stmt;
+  sqlite3_stmt *fts_remove_stmt;
+  sqlite3_stmt *fts_mark_stmt;
+  sqlite3_stmt *body_drop_stmt;
+  sqlite3_stmt *orphan_indexed_stmt;
+  sqlite3_stmt *delete_aged_stmt;
+  sqlite3_stmt *delete_oldest_stmt;
+  sqlite3_stmt *crowded_requests_stmt;
+  sqlite3_stmt *trim_request_stmt;
+  sqlite3_stmt *meta_add_stmt;
+  sqlite3_stmt *epoch_backfill_stmt;
+  sqlite3_stmt *fts_backfill_stmt;
+  int index_bodies;
+} history_store_t;
+
+/* `options` may be NULL. */
+int history_store_open(const char *db_path, const history_store_options_t *options, history_store_t *out);
+void history_store_close(history_store_t *store);
 
-int history_store_add_run(sqlite3 *db, const run_entry_t *run);
-int history_store_list_runs(sqlite3 *db, int limit, run_list_t *out);
+int history_store_add_run(history_store_t *store, const run_entry_t *run);
+/*
+ * Appends up to `limit` runs older than `before_id` (0 = newest first), newest
+ * first, metadata only. Returns how many were appended, or -1.
+ */
+int history_store_list_page(history_store_t *store, int before_id, int limit, run_list_t *out);
+/* Fills run->request_snapshot / response_body (replacing any previous ones) for run->id. */
+int history_store_load_bodies(history_store_t *store, run_entry_t *run);
+void run_entry_free_bodies(run_entry_t *run);
 void run_list_free(run_list_t *list);
 
+typedef struct {
+  long long runs;
+  long long bodies;
+  long long body_bytes;        /* uncompressed size of the distinct bodies */
+  long long body_stored_bytes; /* what they take on disk */
+  long long file_bytes;
+  long long free_bytes;        /* free pages not yet returned to the filesystem */
+  long long reclaimed_bytes;   /* returned by incremental vacuum, all time */
+  long long retention_deleted; /* runs removed by retention, all time */
+  int incremental_vacuum;
+} history_stats_t;
+
+int history_store_stats(history_store_t *store, history_stats_t *out);
+/*
+ * Rebuilds the file with auto_vacuum=INCREMENTAL (a full VACUUM). Holds the
+ * write lock until done, so the writer's next commit waits up to the busy
+ * timeout; only run on request.
+ */
+int history_store_vacuum(history_store_t *store);
+
+#define TUIMAN_LATENCY_SPARK_LEN 32
+
+/* Latency summary of one request's runs inside a time window. */
+typedef struct {
+  long long runs;
+  long long errors; /* transport errors and HTTP status >= 400 */
+  long p50_ms;
+  long p95_ms;
+  long p99_ms;
+  int spark_len;
+  long spark_ms[TUIMAN_LATENCY_SPARK_LEN]; /* most recent durations, oldest first */
+} history_latency_t;
+
+/* Runs of `request_id` created at or after `since_epoch` (unix seconds; 0 = all time). */
+int history_store_latency(history_store_t *store, const char *request_id, long long since_epoch,
+                          history_latency_t *out);
+
+#define TUIMAN_HISTORY_SNIPPET_LEN 160
+
+typedef struct {
+  run_entry_t run; /* metadata only, as in history_store_list_page */
+  char snippet[TUIMAN_HISTORY_SNIPPET_LEN]; /* matched text with the terms in [brackets] */
+  double rank;                              /* bm25 in its own index: lower is a better match */
+} history_hit_t;
+
+typedef struct {
+  history_hit_t *items;
+  size_t len;
+} history_hit_list_t;
+
+/*
+ * Full-text search over request name, URL and error text (and bodies when
+ * they are indexed). Each whitespace-separated word of `query` is a prefix
+ * term and all must match. Fills up to `limit` hits: metadata hits best
+ * first, then body hits best first.
+ */
+int history_store_search(history_store_t *store, const char *query, int limit, history_hit_list_t *out);
+void history_hit_list_free(history_hit_list_t *list);
+
+/*
+ * Background writer with its own connection: runs are queued without copying
+ * and committed by a worker thread, one transaction per batch of whatever
+ * queued up while the previous batch was being written.
+ */
+typedef struct history_writer history_writer_t;
+
+int history_writer_start(const char *db_path, const history_store_options_t *options, history_writer_t **out);
+/*
+ * Always takes ownership of run->request_snapshot and of run->response_body
+ * (heap or NULL), or of the hold on it when run->body_release is set.
+ */
+int history_writer_submit(history_writer_t *writer, run_entry_t *run);
+/*
+ * Readable after every committed batch, so a poll loop can refresh what it
+ * read from the database instead of flushing. Drain it with
+ * history_writer_committed.
+ */
+int history_writer_notify_fd(const history_writer_t *writer);
+/* Empties the notify descriptor; 1 when a batch was committed since the last call, else 0. */
+int history_writer_committed(history_writer_t *writer);
+/* Blocks until every run submitted so far is committed (or has failed). Not for the UI thread. */
+void history_writer_flush(history_writer_t *writer);
+unsigned long history_writer_failures(history_writer_t *writer);
+/* Flushes the queue, then joins the thread and closes its connection. */
+void history_writer_stop(history_writer_t *writer);
+
 #endif
@@ -3,6 +3,9 @@
 
 #include <stddef.h>
 
+/* Response bodies that grow past this many bytes are spilled to a temp file instead of the heap. */
+#define TUIMAN_HTTP_SPILL_BYTES (8u * 1024u * 1024u)
+
 #include "tuiman/request_store.h"
 
 typedef struct {
@@ -10,13 +13,37 @@ typedef struct {
   long duration_ms;
   char *body;
   size_t body_len;
+  /*
+   * A spilled body is an unlinked temp file (`body_fd`) mapped read-only at
+   * `body`, still NUL-terminated at body_len. http_response_free unmaps it.
+   */
+  int body_spilled;
+  int body_fd;
+  /* Raw header block of the final response (after redirects). */
+  char *headers;
+  size_t headers_len;
   char error[256];
 } http_response_t;
 
+/* Concurrent transfers on one curl multi handle, driven from the caller's thread. */
+typedef struct http_batch http_batch_t;
+
 int http_client_global_init(void);
 void http_client_global_cleanup(void);
 
+/* Header chains (without auth lines, which are read per send) are cached per request id until the request changes. */
 int http_send_request(const request_t *req, http_response_t *out);
+/* Drops the cached header chain of a deleted request. */
+void http_client_forget_request(const char *request_id);
 void http_response_free(http_response_t *response);
 
+http_batch_t *http_batch_new(void);
+/* Starts `req` (copied); `tag` is handed back with its response. */
+int http_batch_add(http_batch_t *batch, const request_t *req, void *tag);
+size_t http_batch_pending(const http_batch_t *batch);
+/* Waits up to timeout_ms. Returns 1 with one finished response, 0 if none finished, -1 on error. */
+int http_batch_next(http_batch_t *batch, long timeout_ms, http_response_t *out, void **tag);
+/* Aborts anything still in flight. */
+void http_batch_free(http_batch_t *batch);
+
 #endif
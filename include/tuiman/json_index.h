@@ -0,0 +1,30 @@
+#ifndef TUIMAN_JSON_INDEX_H
+#define TUIMAN_JSON_INDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Structural index of a JSON text: the offset of every { } [ ] : , outside
+ * strings, found 64 bytes at a time (string and escape state are carried as
+ * bit masks, as in simdjson's first stage), and the matching bracket of each
+ * container. Nothing is parsed; keys and scalars are read straight from the
+ * text between structurals. Offsets are 32-bit, so texts must be under 4 GiB.
+ */
+typedef struct {
+  const char *text; /* not owned */
+  size_t len;
+  uint32_t *pos;
+  uint32_t *match; /* for a bracket, the index of its partner; unused for ':' and ',' */
+  size_t count;
+} json_index_t;
+
+/*
+ * Also checks the structure: balanced brackets, ':' only in objects and
+ * every member keyed, nothing after the top-level value. Scalars are not
+ * validated.
+ */
+int json_index_build(const char *text, size_t len, json_index_t *out, char *error, size_t error_len);
+void json_index_free(json_index_t *index);
+
+#endif
@@ -0,0 +1,17 @@
+#ifndef TUIMAN_JSON_NORMALIZE_H
+#define TUIMAN_JSON_NORMALIZE_H
+
+#include <stddef.h>
+
+#define TUIMAN_JSON_MAX_DEPTH 512
+
+/*
+ * Re-indents a JSON document two spaces per level, one member or element per
+ * line, with object keys sorted bytewise (duplicates keep their order).
+ * Strings, numbers and literals are copied as written. Returns a heap string
+ * and its length, or NULL when `text` is not a single JSON value (or nests
+ * deeper than TUIMAN_JSON_MAX_DEPTH, or memory runs out).
+ */
+char *json_normalize(const char *text, size_t len, size_t *out_len);
+
+#endif
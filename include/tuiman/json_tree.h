@@ -0,0 +1,64 @@
+#ifndef TUIMAN_JSON_TREE_H
+#define TUIMAN_JSON_TREE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "tuiman/json_index.h"
+
+/* `sep` of the top-level value, which has no separator before it. */
+#define JSON_TREE_ROOT UINT32_MAX
+
+typedef enum {
+  JSON_NODE_OBJECT = 0,
+  JSON_NODE_ARRAY = 1,
+  JSON_NODE_STRING = 2,
+  JSON_NODE_NUMBER = 3,
+  JSON_NODE_LITERAL = 4, /* true, false, null */
+} json_node_kind_t;
+
+/*
+ * One visible row: a value with its key or array index. Rows are derived
+ * from the structural index when their parent is expanded and dropped again
+ * when it is collapsed; nothing else about the document is materialized.
+ */
+typedef struct {
+  uint32_t sep;      /* structural just before the value: ':' for members, '[' or ',' for elements */
+  uint32_t index;    /* position among its siblings */
+  uint32_t children; /* members or elements of a container */
+  uint32_t depth;
+  uint8_t kind;
+  uint8_t expanded;
+} json_row_t;
+
+typedef struct {
+  json_index_t index;
+  json_row_t *rows; /* in document order */
+  size_t rows_len;
+  size_t rows_cap;
+} json_tree_t;
+
+/* Indexes `text` (not copied; it must outlive the tree) and shows the root expanded. */
+int json_tree_open(json_tree_t *tree, const char *text, size_t len, char *error, size_t error_len);
+void json_tree_free(json_tree_t *tree);
+
+int json_tree_expand(json_tree_t *tree, size_t row);
+void json_tree_collapse(json_tree_t *tree, size_t row);
+/* SIZE_MAX for the root. */
+size_t json_tree_parent(const json_tree_t *tree, size_t row);
+
+/* The member name of a row inside an object, quotes included; -1 for array elements and the root. */
+int json_tree_key(const json_tree_t *tree, size_t row, size_t *start, size_t *len);
+/* The text of a scalar, or of a whole container from bracket to bracket. */
+void json_tree_value(const json_tree_t *tree, size_t row, size_t *start, size_t *len);
+
+/* "$.items[3].name"-style path of a row; keys that are not identifiers are written ["..."]. */
+void json_tree_path(const json_tree_t *tree, size_t row, char *out, size_t out_len);
+/*
+ * Expands down to `path` ("$.a[3].b", "a[3].b", ["key"] steps, or a JSON
+ * pointer "/a/3/b") and sets `*row` to it. Returns -1 with `*row` at the
+ * deepest step found when some step does not exist. Keys compare as written.
+ */
+int json_tree_find(json_tree_t *tree, const char *path, size_t *row);
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef TUIMAN_PAGER_H
+#define TUIMAN_PAGER_H
+
+#include <stddef.h>
+
+/* Bytes per row in hex mode. */
+#define PAGER_HEX_ROW 16
+/* Every this many lines one line start is remembered, so goto-line does not rescan from the top. */
+#define PAGER_MARK_LINES 65536
+/* Lines longer than this are shown as several rows (see pager_next_line). */
+#define PAGER_LONG_ROW (64u * 1024u)
+
+/*
+ * Navigation over a body the pager does not own or copy (typically a spilled
+ * response mapped read-only). Lines are found on demand with memchr; line
+ * numbers are tracked while moving and recovered from the marks after a
+ * jump, or shown as unknown when the jump lands past anything counted yet.
+ */
+typedef struct {
+  const char *data;
+  size_t len;
+  int hex;
+  size_t top;       /* first shown byte: a line start, or a multiple of PAGER_HEX_ROW in hex mode */
+  size_t top_line;  /* 0-based line of `top`, valid when `line_known` */
+  int line_known;
+  size_t column;    /* horizontal scroll of text mode, in terminal columns */
+  size_t last_start; /* start of the final line */
+
+  size_t *marks;    /* marks[i] is where line i * PAGER_MARK_LINES starts */
+  size_t marks_len;
+  size_t marks_cap;
+  size_t scanned;   /* newlines are counted up to this line start... */
+  size_t scanned_line; /* ...which is this line */
+  int scanned_all;
+} pager_t;
+
+/* Starts at the top, in hex mode when the body looks binary. */
+void pager_init(pager_t *pager, const char *data, size_t len);
+void pager_free(pager_t *pager);
+/* NUL bytes, or more than a few control characters or malformed UTF-8 in the first 8 KiB. */
+int pager_looks_binary(const char *data, size_t len);
+
+/* Switches modes keeping the byte at the top in view. */
+void pager_set_hex(pager_t *pager, int hex);
+/* Moves `rows` lines (text) or rows (hex) down, or up when negative. */
+void pager_scroll(pager_t *pager, long rows);
+/* 0-based. Returns -1 (and stops on the last line) when the body is shorter. */
+int pager_goto_line(pager_t *pager, size_t line);
+/* Shows the line (text) or row (hex) containing `offset`. */
+void pager_goto_offset(pager_t *pager, size_t offset);
+void pager_goto_percent(pager_t *pager, unsigned percent);
+/* The last `rows` lines or rows. */
+void pager_goto_end(pager_t *pager, int rows);
+/* Returns 0 with the total once newlines have been counted to the end. */
+int pager_line_count(const pager_t *pager, size_t *count);
+
+/*
+ * Start of the row after the one at `start` (`len` after the last). A row is
+ * a line, or a PAGER_LONG_ROW-aligned slice of a longer one, so finding a row
+ * start either way never scans far.
+ */
+size_t pager_next_line(const pager_t *pager, size_t start);
+/* End of the row at `start`, excluding "\n" or "\r\n". */
+size_t pager_line_end(const pager_t *pager, size_t start);
+/* First byte at or after `column` terminal columns into [start, end). */
+size_t pager_column_offset(const pager_t *pager, size_t start, size_t end, size_t column);
+/* Formats the hex row at `offset` as "offset  hex bytes  |ascii|" into `out`. */
+void pager_hex_row(const pager_t *pager, size_t offset, char *out, size_t out_len);
+
+/*
+ * Writes `len` bytes to a new file at `path`. With a `source_fd` holding the
+ * same bytes the copy stays in the kernel (copy_file_range, then sendfile, on
+ * Linux); otherwise, or if those are unsupported, it is written from `data`.
+ */
+int pager_save(const char *data, size_t len, int source_fd, const char *path, char *error, size_t error_len);
+
+#endif
@@ -8,9 +8,13 @@ typedef struct {
   char state_dir[PATH_MAX];
   char cache_dir[PATH_MAX];
   char requests_dir[PATH_MAX];
+  char requests_db[PATH_MAX];
+  char environments_dir[PATH_MAX];
+  char workflows_dir[PATH_MAX];
   char history_db[PATH_MAX];
 } app_paths_t;
 
 int paths_init(app_paths_t *out);
+int paths_ensure_dir(const char *path);
 
 #endif
@@ -0,0 +1,50 @@
+#ifndef TUIMAN_REQUEST_SNAPSHOT_H
+#define TUIMAN_REQUEST_SNAPSHOT_H
+
+#include <stddef.h>
+
+#include "tuiman/request_store.h"
+
+/* Fields of a recorded request, in their serialized order. */
+typedef enum {
+  SNAPSHOT_NAME = 0,
+  SNAPSHOT_METHOD,
+  SNAPSHOT_URL,
+  SNAPSHOT_ENVIRONMENT, /* active environment name at send time */
+  SNAPSHOT_VARIABLES,   /* "name=value" lines for each {{var}} the request referenced */
+  SNAPSHOT_HEADERS,     /* "Name: value" lines, as in request_t.headers */
+  SNAPSHOT_AUTH_TYPE,
+  SNAPSHOT_AUTH_SECRET_REF,
+  SNAPSHOT_AUTH_KEY_NAME,
+  SNAPSHOT_AUTH_LOCATION,
+  SNAPSHOT_AUTH_USERNAME,
+  SNAPSHOT_BODY,
+  SNAPSHOT_FIELD_COUNT,
+} snapshot_field_t;
+
+/* A view into the decoded text; not NUL-terminated. */
+typedef struct {
+  const char *ptr;
+  size_t len;
+} snapshot_value_t;
+
+typedef struct {
+  snapshot_value_t fields[SNAPSHOT_FIELD_COUNT];
+  /* Decoded from the older "key: value" text: headers are "header: Name: value" lines. */
+  int legacy;
+} request_snapshot_t;
+
+/*
+ * Serializes the request as it went on the wire: a version line, then one
+ * netstring ("<len>:<bytes>,") per field. `environment` and `variables` may
+ * be NULL. Returns a heap string, or NULL when out of memory.
+ */
+char *request_snapshot_encode(const request_t *req, const char *environment, const char *variables);
+
+/*
+ * One pass over `text`, filling views into it; fields it lacks stay empty.
+ * Snapshots recorded before the structured format are parsed as legacy text.
+ */
+void request_snapshot_decode(const char *text, request_snapshot_t *out);
+
+#endif
@@ -17,14 +17,16 @@
 #define TUIMAN_AUTH_USER_LEN 128
 #define TUIMAN_BODY_LEN 8192
 #define TUIMAN_UPDATED_AT_LEN 40
+#define TUIMAN_COLLECTION_LEN 256
+#define TUIMAN_HEADERS_LEN 4096
 
 typedef struct {
   char id[TUIMAN_ID_LEN];
   char name[TUIMAN_NAME_LEN];
   char method[TUIMAN_METHOD_LEN];
   char url[TUIMAN_URL_LEN];
-  char header_key[TUIMAN_HEADER_KEY_LEN];
-  char header_value[TUIMAN_HEADER_VAL_LEN];
+  /* Ordered "Name: value" lines separated by '\n'; stored as a JSON array. */
+  char headers[TUIMAN_HEADERS_LEN];
   char body[TUIMAN_BODY_LEN];
   char auth_type[TUIMAN_AUTH_TYPE_LEN];
   char auth_secret_ref[TUIMAN_SECRET_REF_LEN];
@@ -32,6 +34,10 @@ typedef struct {
   char auth_location[TUIMAN_AUTH_LOC_LEN];
   char auth_username[TUIMAN_AUTH_USER_LEN];
   char updated_at[TUIMAN_UPDATED_AT_LEN];
+  /* Folder path relative to the catalog root ("" = root). Derived from location, not stored in the file. */
+  char collection[TUIMAN_COLLECTION_LEN];
+  /* sqlite backend: the row version this copy was read at; 0 for a request not saved yet. */
+  long long version;
 } request_t;
 
 typedef struct {
@@ -39,17 +45,125 @@ typedef struct {
   size_t len;
 } request_list_t;
 
+typedef struct {
+  char path[TUIMAN_COLLECTION_LEN];
+  long count; /* requests directly inside, or -1 when unknown without scanning */
+} collection_info_t;
+
+typedef struct {
+  collection_info_t *items;
+  size_t len;
+} collection_list_t;
+
 void request_init_defaults(request_t *req);
+
+/* Header list helpers. `cursor` starts at req->headers; returns 0 once the list is exhausted. */
+int request_header_next(const char **cursor, char *name, size_t name_len, char *value, size_t value_len);
+size_t request_header_count(const request_t *req);
+int request_header_append(request_t *req, const char *name, const char *value);
+int request_header_has(const request_t *req, const char *name);
+/* Replaces the list from free-form text (one "Name: value" per line; blank/invalid lines dropped). */
+int request_headers_set_text(request_t *req, const char *text);
 void request_generate_id(char out[TUIMAN_ID_LEN]);
 void request_set_updated_now(request_t *req);
 
-int request_store_list(const app_paths_t *paths, request_list_t *out);
-int request_store_load_by_id(const app_paths_t *paths, const char *request_id, request_t *out);
-int request_store_save(const app_paths_t *paths, const request_t *req);
-int request_store_delete(const app_paths_t *paths, const char *request_id);
+typedef struct request_store request_store_t;
+
+/*
+ * Storage backend. `json` keeps one file per request under requests_dir
+ * (git-friendly); `sqlite` keeps the catalog in an indexed database for very
+ * large generated collections.
+ */
+typedef struct {
+  const char *name;
+  int (*list)(request_store_t *store, request_list_t *out);
+  int (*scan_collection)(request_store_t *store, const char *collection, request_list_t *requests_out,
+                         collection_list_t *children_out);
+  int (*load_by_id)(request_store_t *store, const char *collection, const char *request_id, request_t *out);
+  int (*save)(request_store_t *store, const request_t *req);
+  int (*save_many)(request_store_t *store, const request_t *reqs, size_t count, size_t *saved_count);
+  int (*remove)(request_store_t *store, const char *collection, const char *request_id);
+  void (*close)(request_store_t *store);
+} request_store_ops_t;
+
+struct request_store {
+  const request_store_ops_t *ops;
+  char location[PATH_MAX];
+  void *impl;
+};
+
+#define TUIMAN_STORE_JSON "json"
+#define TUIMAN_STORE_SQLITE "sqlite"
+
+int request_store_open_json(const char *requests_dir, request_store_t *out);
+int request_store_open_sqlite(const char *db_path, request_store_t *out);
+int request_store_open(const app_paths_t *paths, const char *backend, request_store_t *out);
+void request_store_close(request_store_t *store);
+int request_store_is_json(const request_store_t *store);
+
+/* Whole catalog, every collection (export, search). */
+int request_store_list(request_store_t *store, request_list_t *out);
+/* One collection only: its requests plus its immediate child collections. */
+int request_store_scan_collection(request_store_t *store, const char *collection, request_list_t *requests_out,
+                                  collection_list_t *children_out);
+/* `collection` may be NULL when unknown; backends then search for the id. */
+int request_store_load_by_id(request_store_t *store, const char *collection, const char *request_id,
+                             request_t *out);
+/* Returned by request_store_save when the stored request changed since `req` was read. */
+#define TUIMAN_STORE_CONFLICT (-2)
+
+/*
+ * New requests (empty id) get one. On sqlite, an existing request is only
+ * replaced at req->version; TUIMAN_STORE_CONFLICT means another instance saved
+ * it first and nothing was written.
+ */
+int request_store_save(request_store_t *store, const request_t *req);
+/* Stamps ids/updated_at in place, then writes the batch (one transaction on sqlite). */
+int request_store_save_many(request_store_t *store, request_t *reqs, size_t count, size_t *saved_count);
+int request_store_delete(request_store_t *store, const char *collection, const char *request_id);
 void request_list_free(request_list_t *list);
+void collection_list_free(collection_list_t *list);
+
+/* Component-wise path order, so "a/b" sorts directly after "a" and before "a-b". */
+int request_collection_compare(const char *a, const char *b);
+const char *request_collection_basename(const char *collection);
+int request_collection_depth(const char *collection);
+/* Catalog order: collection, then name. */
+int request_compare_key(const request_t *a, const request_t *b);
+
+/* In-place list patching; the list stays in catalog order. */
+int request_list_find(const request_list_t *list, const char *request_id, size_t *out_index);
+int request_list_insert_sorted(request_list_t *list, const request_t *req, size_t *out_index);
+/* Both lists must already be in catalog order. */
+int request_list_merge_sorted(request_list_t *list, const request_list_t *more);
+void request_list_remove_at(request_list_t *list, size_t index);
+
+typedef enum {
+  REQUEST_WRITE_PLAIN = 0,
+  /* fsync the file before the rename and its directory after it. */
+  REQUEST_WRITE_DURABLE = 1,
+} request_write_mode_t;
+
+/* Group commit for bulk saves: files are staged as temp files, then flushed and renamed together. */
+typedef struct {
+  char path[PATH_MAX];
+} request_write_batch_entry_t;
+
+typedef struct {
+  request_write_batch_entry_t *items;
+  size_t len;
+  size_t cap;
+  int durable;
+} request_write_batch_t;
 
 int request_store_read_file(const char *file_path, request_t *out);
-int request_store_write_file(const char *file_path, const request_t *req);
+/* Streams the JSON document to a temp file and renames it into place. */
+int request_store_write_file(const char *file_path, const request_t *req, request_write_mode_t mode);
+
+int request_write_batch_add(request_write_batch_t *batch, const char *file_path, const request_t *req);
+/* Makes every staged file visible; `committed` counts the ones renamed into place. */
+int request_write_batch_commit(request_write_batch_t *batch, size_t *committed);
+/* Drops anything still staged. */
+void request_write_batch_free(request_write_batch_t *batch);
 
 #endif
@@ -0,0 +1,74 @@
+#ifndef TUIMAN_REQUEST_WATCH_H
+#define TUIMAN_REQUEST_WATCH_H
+
+#include <limits.h>
+#include <stddef.h>
+#include <sys/types.h>
+#include <time.h>
+
+#include "tuiman/request_store.h"
+
+#define TUIMAN_WATCH_SELF_WRITES 32
+
+typedef enum {
+  REQUEST_WATCH_UPSERT = 0,
+  REQUEST_WATCH_REMOVE = 1,
+  REQUEST_WATCH_RESCAN = 2,
+} request_watch_kind_t;
+
+typedef struct {
+  request_watch_kind_t kind;
+  char collection[TUIMAN_COLLECTION_LEN];
+  char request_id[TUIMAN_ID_LEN];
+} request_watch_event_t;
+
+typedef struct {
+  char name[TUIMAN_ID_LEN + 8];
+  int exists;
+  int is_dir;
+  ino_t ino;
+  off_t size;
+  time_t mtime;
+} request_watch_stamp_t;
+
+typedef struct {
+  char collection[TUIMAN_COLLECTION_LEN];
+  char name[TUIMAN_ID_LEN + 8];
+  request_watch_stamp_t stamp;
+} request_watch_self_write_t;
+
+/* One watched collection directory (inotify wd, or kqueue dir fd). */
+typedef struct {
+  int wd;
+  char collection[TUIMAN_COLLECTION_LEN];
+  /* Directory snapshot used where the kernel only reports "something changed" (kqueue). */
+  request_watch_stamp_t *snapshot;
+  size_t snapshot_len;
+} request_watch_dir_t;
+
+typedef struct {
+  int fd;
+  char root[PATH_MAX];
+  request_watch_dir_t *dirs;
+  size_t dirs_len;
+  request_watch_self_write_t self_writes[TUIMAN_WATCH_SELF_WRITES];
+  size_t self_write_next;
+} request_watch_t;
+
+/* Opens the watch and adds the root collection. */
+int request_watch_open(const char *requests_dir, request_watch_t *out);
+void request_watch_close(request_watch_t *watch);
+
+/* Start watching a collection once it has been scanned. Adding twice is a no-op. */
+int request_watch_add_collection(request_watch_t *watch, const char *collection);
+
+/* Pollable descriptor, or -1 when watching is unavailable on this platform. */
+int request_watch_fd(const request_watch_t *watch);
+
+/* Record a write/delete made by tuiman itself so its change event is dropped. */
+void request_watch_note_self_write(request_watch_t *watch, const char *collection, const char *request_id);
+
+/* Non-blocking drain of pending changes. Returns the number of events written to `events`. */
+size_t request_watch_read(request_watch_t *watch, request_watch_event_t *events, size_t cap);
+
+#endif
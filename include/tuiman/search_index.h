@@ -0,0 +1,49 @@
+#ifndef TUIMAN_SEARCH_INDEX_H
+#define TUIMAN_SEARCH_INDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "tuiman/request_store.h"
+
+/*
+ * In-memory trigram index over request name, URL, headers and body
+ * (ASCII case-folded). Documents are keyed by request id and can be
+ * replaced or removed individually as the catalog changes.
+ */
+typedef struct search_index search_index_t;
+
+/* Candidate set from one query, as a bitmap over index document slots. */
+typedef struct {
+  uint64_t *bits;
+  size_t words;
+  size_t count;
+} search_candidates_t;
+
+search_index_t *search_index_new(void);
+void search_index_free(search_index_t *index);
+void search_index_clear(search_index_t *index);
+
+/* Adds the request, replacing any previous version with the same id. */
+int search_index_put(search_index_t *index, const request_t *req);
+void search_index_remove(search_index_t *index, const char *request_id);
+size_t search_index_len(const search_index_t *index);
+
+/*
+ * Returns 1 with the candidate set when `needle` is long enough to use the
+ * index (>= 3 bytes), 0 when every document is a candidate, -1 on error.
+ * Candidates are a superset: callers confirm with a substring check.
+ */
+int search_index_query(const search_index_t *index, const char *needle, search_candidates_t *out);
+int search_candidates_has(const search_index_t *index, const search_candidates_t *candidates, const char *request_id);
+/*
+ * The positions in `list` of the candidates, ascending, in a heap array.
+ * `list` must be the list the indexed requests were put from; the doc->row
+ * map is rebuilt only after a put or remove, so a query touches just the
+ * set bits.
+ */
+int search_candidates_rows(search_index_t *index, const request_list_t *list, const search_candidates_t *candidates,
+                           size_t **out_rows, size_t *out_len);
+void search_candidates_free(search_candidates_t *candidates);
+
+#endif
@@ -0,0 +1,13 @@
+#ifndef TUIMAN_SHA256_H
+#define TUIMAN_SHA256_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define TUIMAN_SHA256_HEX_LEN 65
+
+void sha256(const void *data, size_t len, uint8_t out[32]);
+/* Lowercase hex digest, NUL-terminated. */
+void sha256_hex(const void *data, size_t len, char out[TUIMAN_SHA256_HEX_LEN]);
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef TUIMAN_SQLITE_SETUP_H
+#define TUIMAN_SQLITE_SETUP_H
+
+#include <sqlite3.h>
+
+/*
+ * The setup every tuiman database connection shares: a busy timeout, WAL
+ * (readers never block the writer, and a second instance can share the file)
+ * and synchronous=NORMAL, which with WAL only syncs at checkpoints. That is
+ * safe against corruption; a power loss may drop the last few commits.
+ */
+int sqlite_setup_connection(sqlite3 *db, int busy_timeout_ms);
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef TUIMAN_TEMPLATE_H
+#define TUIMAN_TEMPLATE_H
+
+#include <stddef.h>
+#include <time.h>
+
+#include "tuiman/request_store.h"
+
+typedef enum {
+  TEMPLATE_SEGMENT_LITERAL = 0,
+  TEMPLATE_SEGMENT_VARIABLE = 1,
+  TEMPLATE_SEGMENT_GENERATOR = 2,
+} template_segment_kind_t;
+
+typedef enum {
+  TEMPLATE_GEN_COUNTER = 0,       /* {{$counter}} */
+  TEMPLATE_GEN_RANDOM_ID = 1,     /* {{$random_id}} */
+  TEMPLATE_GEN_TIMESTAMP = 2,     /* {{$timestamp}} (epoch seconds) */
+  TEMPLATE_GEN_ISO_TIMESTAMP = 3, /* {{$iso_timestamp}} */
+} template_generator_t;
+
+/* `text` points into the compiled source, which must outlive the template. */
+typedef struct {
+  template_segment_kind_t kind;
+  const char *text;
+  size_t len;
+  template_generator_t generator;
+} template_segment_t;
+
+typedef struct {
+  template_segment_t *segments;
+  size_t len;
+} template_t;
+
+/* Generator values for one send; every field of that send sees the same values. */
+typedef struct {
+  unsigned long counter;
+  time_t now;
+  char random_id[TUIMAN_ID_LEN];
+} template_iteration_t;
+
+typedef const char *(*template_lookup_fn)(void *ctx, const char *name, size_t name_len, size_t *value_len);
+
+int template_compile(const char *source, template_t *out);
+void template_free(template_t *tpl);
+void template_iteration_begin(template_iteration_t *it, unsigned long counter);
+/* The bare name inside a TEMPLATE_SEGMENT_VARIABLE span (not NUL-terminated). */
+const char *template_variable_name(const template_segment_t *seg, size_t *len);
+
+/* Unknown variables are kept verbatim. Returns -1 if the result does not fit. */
+int template_expand(const template_t *tpl, template_lookup_fn lookup, void *ctx, const template_iteration_t *it,
+                    char *out, size_t out_len);
+
+#endif
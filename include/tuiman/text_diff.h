@@ -0,0 +1,61 @@
+#ifndef TUIMAN_TEXT_DIFF_H
+#define TUIMAN_TEXT_DIFF_H
+
+#include <stddef.h>
+
+/*
+ * Line diff of two texts, computed on a background thread with linear-space
+ * Myers (divide and conquer on the middle snake). The result is a sequence of
+ * blocks alternating between unchanged and changed line ranges; blocks are
+ * published in order as the left half of each split is finished, so a caller
+ * can show the top of a long diff before the rest is known.
+ */
+
+typedef struct {
+  int changed;
+  size_t a_start;
+  size_t a_count;
+  size_t b_start;
+  size_t b_count;
+} text_diff_block_t;
+
+/* One input after preparation; line i is text[line_starts[i] .. line_starts[i + 1] - 1), no newline. */
+typedef struct {
+  char *text;
+  size_t len;
+  size_t *line_starts; /* line_count + 1 entries */
+  size_t line_count;
+  int json;            /* parsed as JSON and rewritten by json_normalize */
+} text_diff_side_t;
+
+/* The caller's copy of the progress so far; filled by text_diff_poll. */
+typedef struct {
+  const text_diff_side_t *a; /* NULL until both inputs are prepared */
+  const text_diff_side_t *b;
+  text_diff_block_t *blocks; /* the last block may still grow until `done` */
+  size_t blocks_len;
+  size_t blocks_cap;
+  size_t lines_added;
+  size_t lines_removed;
+  int permille;              /* share of `a` already diffed */
+  int done;
+  int failed;
+  int approximate;           /* a cost limit cut the search short somewhere; still a valid diff */
+  unsigned long generation;  /* worker state last copied */
+} text_diff_view_t;
+
+typedef struct text_diff text_diff_t;
+
+/*
+ * Takes ownership of `a` and `b` (heap, NUL-terminated at a_len / b_len). With
+ * `normalize_json`, each side that parses as JSON is first rewritten with
+ * sorted keys so formatting and key order do not show up as changes.
+ */
+int text_diff_start(char *a, size_t a_len, char *b, size_t b_len, int normalize_json, text_diff_t **out);
+/* Copies whatever the worker found since the last call; returns 1 when `view` changed. */
+int text_diff_poll(text_diff_t *diff, text_diff_view_t *view);
+/* Stops the worker (it checks between steps), joins it and frees everything it owns. */
+void text_diff_free(text_diff_t *diff);
+void text_diff_view_free(text_diff_view_t *view);
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef TUIMAN_TEXT_WIDTH_H
+#define TUIMAN_TEXT_WIDTH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* What text_decode yields for a malformed, overlong, surrogate or truncated sequence. */
+#define TEXT_CP_INVALID 0xFFFFFFFFu
+
+/* Length of the leading run of printable ASCII (0x20-0x7e); 16 bytes per step where SIMD is available. */
+size_t text_ascii_run(const char *s, size_t len);
+/* Decodes one strict UTF-8 sequence; invalid input consumes one byte. Returns bytes used (0 only when len is 0). */
+size_t text_decode(const char *s, size_t len, uint32_t *cp);
+/*
+ * Terminal columns of one code point: 0 for combining and other zero-width
+ * marks, 2 for East Asian wide/fullwidth and emoji, 1 otherwise. Control
+ * characters and TEXT_CP_INVALID count as 1 because they are drawn as a
+ * single substitute character.
+ */
+int text_codepoint_width(uint32_t cp);
+/* Length of the leading valid UTF-8 without control characters, i.e. what can be drawn as is. */
+size_t text_printable_prefix(const char *s, size_t len);
+
+#endif
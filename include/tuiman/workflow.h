@@ -0,0 +1,100 @@
+#ifndef TUIMAN_WORKFLOW_H
+#define TUIMAN_WORKFLOW_H
+
+#include <stddef.h>
+
+#include "tuiman/environment.h"
+#include "tuiman/http_client.h"
+#include "tuiman/paths.h"
+#include "tuiman/request_store.h"
+
+#define TUIMAN_WORKFLOW_NAME_LEN 64
+#define TUIMAN_WORKFLOW_STEP_LEN 64
+#define TUIMAN_WORKFLOW_MAX_DEPS 8
+#define TUIMAN_WORKFLOW_MAX_PARALLEL 8
+/* Room for the longest message: an extract's variable and path, or an unresolved request_ref. */
+#define TUIMAN_WORKFLOW_ERROR_LEN (TUIMAN_HEADER_KEY_LEN + TUIMAN_HEADER_VAL_LEN + 64)
+
+typedef enum {
+  WORKFLOW_EXTRACT_JSON = 0,   /* RFC 6901 pointer into the response body */
+  WORKFLOW_EXTRACT_HEADER = 1, /* response header, case-insensitive */
+  WORKFLOW_EXTRACT_STATUS = 2,
+} workflow_extract_kind_t;
+
+typedef struct {
+  char var[TUIMAN_HEADER_KEY_LEN];
+  workflow_extract_kind_t kind;
+  char path[TUIMAN_HEADER_VAL_LEN];
+} workflow_extract_t;
+
+typedef enum {
+  WORKFLOW_STEP_PENDING = 0,
+  WORKFLOW_STEP_RUNNING = 1,
+  WORKFLOW_STEP_WAITING = 2, /* polling: scheduled to retry */
+  WORKFLOW_STEP_DONE = 3,
+  WORKFLOW_STEP_FAILED = 4,
+  WORKFLOW_STEP_SKIPPED = 5, /* a dependency failed */
+} workflow_step_state_t;
+
+typedef struct {
+  char name[TUIMAN_WORKFLOW_STEP_LEN];
+  char request_ref[TUIMAN_COLLECTION_LEN + TUIMAN_NAME_LEN];
+  size_t deps[TUIMAN_WORKFLOW_MAX_DEPS];
+  size_t deps_len;
+  workflow_extract_t *extracts;
+  size_t extracts_len;
+  long until_status; /* 0 = single attempt */
+  int max_tries;
+  long retry_ms;
+
+  /* Run state. */
+  workflow_step_state_t state;
+  int tries;
+  long status;
+  long start_ms; /* relative to the run start */
+  long end_ms;
+  long retry_at_ms;
+  size_t critical_dep; /* dep that finished last, or SIZE_MAX */
+  request_t *sent;
+  char *variables; /* "name=value" lines the current attempt was resolved with */
+  char error[TUIMAN_WORKFLOW_ERROR_LEN];
+} workflow_step_t;
+
+/* Steps are in file order; dependencies always point at earlier steps, so the graph is acyclic. */
+typedef struct {
+  char name[TUIMAN_WORKFLOW_NAME_LEN];
+  workflow_step_t *steps;
+  size_t len;
+  environment_t vars;
+} workflow_t;
+
+typedef struct {
+  size_t ok;
+  size_t failed;
+  size_t skipped;
+  long wall_ms;
+  long busy_ms; /* sum of step durations; > wall_ms when branches overlapped */
+  size_t *critical;
+  size_t critical_len;
+} workflow_report_t;
+
+/*
+ * Called after every attempt (including poll retries) once the step has seen
+ * it; may take the body. `variables` are those the attempt was sent with, from
+ * before its own extracts (may be NULL).
+ */
+typedef void (*workflow_attempt_fn)(void *ctx, const workflow_step_t *step, const request_t *sent,
+                                    const char *variables, http_response_t *response);
+
+int workflow_file_path(const app_paths_t *paths, const char *name, char *out, size_t out_len);
+int workflow_load(const app_paths_t *paths, const char *name, workflow_t *out, char *error, size_t error_len);
+void workflow_free(workflow_t *wf);
+int workflow_list_names(const app_paths_t *paths, environment_names_t *out);
+
+int workflow_run(workflow_t *wf, const request_list_t *catalog, const environment_t *env, unsigned long *send_counter,
+                 workflow_attempt_fn on_attempt, void *ctx, workflow_report_t *report);
+void workflow_report_free(workflow_report_t *report);
+/* Plain-text summary: totals, critical path, then one line per step. */
+char *workflow_format_report(const workflow_t *wf, const workflow_report_t *report);
+
+#endif
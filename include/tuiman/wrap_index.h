@@ -0,0 +1,35 @@
+#ifndef TUIMAN_WRAP_INDEX_H
+#define TUIMAN_WRAP_INDEX_H
+
+#include <stddef.h>
+
+/* Texts at least this long are indexed on a background thread. */
+#define TUIMAN_WRAP_INDEX_BACKGROUND_BYTES (4u * 1024u * 1024u)
+
+/*
+ * The wrap rule shared by drawing and indexing: starting at `pos`, skips any
+ * '\r', takes whole UTF-8 characters up to `width` terminal columns (see
+ * text_width.h) before the next line break and consumes one "\n", "\r\n" or
+ * "\r" after them. Sets the visible span in bytes and returns where the next
+ * wrapped line starts (`len` once the text is used up).
+ */
+size_t wrap_line_next(const char *text, size_t len, size_t pos, int width, size_t *span_start, size_t *span_len);
+
+/*
+ * Start offset of every wrapped line of one text at one width. Small texts are
+ * indexed before wrap_index_start returns; large ones are copied and indexed
+ * on a worker thread, with lines published as they are found.
+ */
+typedef struct wrap_index wrap_index_t;
+
+int wrap_index_start(const char *text, size_t len, int width, wrap_index_t **out);
+/* Lines indexed so far; `*done` is set once that is all of them. Safe while the worker runs. */
+size_t wrap_index_count(const wrap_index_t *index, int *done);
+/* Offset of wrapped line `line` (< wrap_index_count). */
+size_t wrap_index_line_start(const wrap_index_t *index, size_t line);
+/* The indexed line containing byte `offset`, by binary search. */
+size_t wrap_index_line_at(const wrap_index_t *index, size_t offset);
+/* Stops the worker, if any, and frees the index. */
+void wrap_index_free(wrap_index_t *index);
+
+#endif
@@ -0,0 +1,579 @@
+#include "tuiman/environment.h"
+
+#include <ctype.h>
+#include <dirent.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ENV_FILE_MAX (256 * 1024)
+
+static int valid_env_name(const char *name) {
+  if (name == NULL || name[0] == '\0' || name[0] == '.' || strlen(name) >= TUIMAN_ENV_NAME_LEN) {
+    return 0;
+  }
+  for (const char *p = name; *p != '\0'; p++) {
+    if (!isalnum((unsigned char)*p) && *p != '_' && *p != '-' && *p != '.') {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+int environment_file_path(const app_paths_t *paths, const char *name, char *out, size_t out_len) {
+  if (!valid_env_name(name)) {
+    return -1;
+  }
+  int wrote = snprintf(out, out_len, "%s/%s.env", paths->environments_dir, name);
+  return wrote < 0 || (size_t)wrote >= out_len ? -1 : 0;
+}
+
+static char *trim(char *start, char *end) {
+  while (start < end && isspace((unsigned char)*start)) {
+    start++;
+  }
+  while (end > start && isspace((unsigned char)end[-1])) {
+    end--;
+  }
+  *end = '\0';
+  return start;
+}
+
+static int compare_vars(const void *a, const void *b) {
+  return strcmp(((const environment_var_t *)a)->name, ((const environment_var_t *)b)->name);
+}
+
+static int add_var(environment_t *env, size_t *cap, const char *name, const char *value) {
+  /* Later assignments win, as when a shell sources the file. */
+  for (size_t i = 0; i < env->len; i++) {
+    if (strcmp(env->vars[i].name, name) == 0) {
+      char *copy = strdup(value);
+      if (copy == NULL) {
+        return -1;
+      }
+      free(env->vars[i].value);
+      env->vars[i].value = copy;
+      env->vars[i].value_len = strlen(copy);
+      return 0;
+    }
+  }
+  if (env->len == *cap) {
+    size_t next = *cap == 0 ? 16 : *cap * 2;
+    environment_var_t *grown = realloc(env->vars, next * sizeof(*grown));
+    if (grown == NULL) {
+      return -1;
+    }
+    env->vars = grown;
+    *cap = next;
+  }
+  environment_var_t *var = &env->vars[env->len];
+  var->name = strdup(name);
+  var->value = strdup(value);
+  if (var->name == NULL || var->value == NULL) {
+    free(var->name);
+    free(var->value);
+    return -1;
+  }
+  var->value_len = strlen(value);
+  env->len++;
+  return 0;
+}
+
+/* dotenv subset: KEY=value per line, '#' comments, optional matching quotes around the value. */
+int environment_load(const app_paths_t *paths, const char *name, environment_t *out) {
+  memset(out, 0, sizeof(*out));
+
+  char path[PATH_MAX];
+  if (environment_file_path(paths, name, path, sizeof(path)) != 0) {
+    return -1;
+  }
+  FILE *fp = fopen(path, "rb");
+  if (fp == NULL) {
+    return -1;
+  }
+
+  char *text = malloc(ENV_FILE_MAX);
+  if (text == NULL) {
+    fclose(fp);
+    return -1;
+  }
+  size_t used = fread(text, 1, ENV_FILE_MAX - 1, fp);
+  text[used] = '\0';
+  fclose(fp);
+
+  snprintf(out->name, sizeof(out->name), "%s", name);
+  size_t cap = 0;
+  int rc = 0;
+  char *line = text;
+  while (line != NULL && *line != '\0') {
+    char *nl = strchr(line, '\n');
+    char *end = nl != NULL ? nl : line + strlen(line);
+    char *eq = memchr(line, '=', (size_t)(end - line));
+    char *key = trim(line, eq != NULL ? eq : end);
+
+    if (eq != NULL && key[0] != '\0' && key[0] != '#') {
+      char *value = trim(eq + 1, end);
+      size_t vlen = strlen(value);
+      if (vlen >= 2 && (value[0] == '"' || value[0] == '\'') && value[vlen - 1] == value[0]) {
+        value[vlen - 1] = '\0';
+        value++;
+      }
+      if (add_var(out, &cap, key, value) != 0) {
+        rc = -1;
+        break;
+      }
+    }
+    line = nl != NULL ? nl + 1 : NULL;
+  }
+  free(text);
+
+  if (rc != 0) {
+    environment_free(out);
+    return -1;
+  }
+
+  qsort(out->vars, out->len, sizeof(out->vars[0]), compare_vars);
+  return 0;
+}
+
+void environment_free(environment_t *env) {
+  for (size_t i = 0; i < env->len; i++) {
+    free(env->vars[i].name);
+    free(env->vars[i].value);
+  }
+  free(env->vars);
+  memset(env, 0, sizeof(*env));
+}
+
+static int compare_names(const void *a, const void *b) {
+  return strcmp((const char *)a, (const char *)b);
+}
+
+int environment_list_names(const app_paths_t *paths, environment_names_t *out) {
+  out->items = NULL;
+  out->len = 0;
+
+  DIR *dir = opendir(paths->environments_dir);
+  if (dir == NULL) {
+    return -1;
+  }
+
+  size_t cap = 0;
+  struct dirent *entry = NULL;
+  while ((entry = readdir(dir)) != NULL) {
+    size_t len = strlen(entry->d_name);
+    if (len <= 4 || strcmp(entry->d_name + len - 4, ".env") != 0 || len - 4 >= TUIMAN_ENV_NAME_LEN) {
+      continue;
+    }
+    if (out->len == cap) {
+      size_t next = cap == 0 ? 8 : cap * 2;
+      char(*grown)[TUIMAN_ENV_NAME_LEN] = realloc(out->items, next * sizeof(*grown));
+      if (grown == NULL) {
+        closedir(dir);
+        environment_names_free(out);
+        return -1;
+      }
+      out->items = grown;
+      cap = next;
+    }
+    memcpy(out->items[out->len], entry->d_name, len - 4);
+    out->items[out->len][len - 4] = '\0';
+    out->len++;
+  }
+  closedir(dir);
+
+  qsort(out->items, out->len, sizeof(out->items[0]), compare_names);
+  return 0;
+}
+
+void environment_names_free(environment_names_t *names) {
+  free(names->items);
+  names->items = NULL;
+  names->len = 0;
+}
+
+const char *environment_lookup(const environment_t *env, const char *name, size_t name_len, size_t *value_len) {
+  size_t lo = 0;
+  size_t hi = env->len;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    const char *candidate = env->vars[mid].name;
+    int cmp = strncmp(candidate, name, name_len);
+    if (cmp == 0 && candidate[name_len] != '\0') {
+      cmp = 1;
+    }
+    if (cmp == 0) {
+      *value_len = env->vars[mid].value_len;
+      return env->vars[mid].value;
+    }
+    if (cmp < 0) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return NULL;
+}
+
+int environment_set(environment_t *env, const char *name, const char *value, size_t value_len) {
+  char *copy = malloc(value_len + 1);
+  if (copy == NULL) {
+    return -1;
+  }
+  memcpy(copy, value, value_len);
+  copy[value_len] = '\0';
+
+  size_t lo = 0;
+  size_t hi = env->len;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    int cmp = strcmp(env->vars[mid].name, name);
+    if (cmp == 0) {
+      free(env->vars[mid].value);
+      env->vars[mid].value = copy;
+      env->vars[mid].value_len = value_len;
+      return 0;
+    }
+    if (cmp < 0) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+
+  /* Tables built at run time (workflow extracts) stay small; grow one slot at a time. */
+  environment_var_t *grown = realloc(env->vars, (env->len + 1) * sizeof(*grown));
+  char *name_copy = strdup(name);
+  if (grown == NULL || name_copy == NULL) {
+    if (grown != NULL) {
+      env->vars = grown;
+    }
+    free(name_copy);
+    free(copy);
+    return -1;
+  }
+  env->vars = grown;
+  memmove(&env->vars[lo + 1], &env->vars[lo], (env->len - lo) * sizeof(env->vars[0]));
+  env->vars[lo].name = name_copy;
+  env->vars[lo].value = copy;
+  env->vars[lo].value_len = value_len;
+  env->len++;
+  return 0;
+}
+
+typedef struct {
+  const environment_t *env;
+  const environment_t *overlay;
+} lookup_layers_t;
+
+static const char *lookup_cb(void *ctx, const char *name, size_t name_len, size_t *value_len) {
+  const lookup_layers_t *layers = (const lookup_layers_t *)ctx;
+  const char *value = NULL;
+  if (layers->overlay != NULL) {
+    value = environment_lookup(layers->overlay, name, name_len, value_len);
+  }
+  if (value == NULL && layers->env != NULL) {
+    value = environment_lookup(layers->env, name, name_len, value_len);
+  }
+  return value;
+}
+
+/* Fields that may carry placeholders, in resolve order. */
+#define TEMPLATE_FIELD_COUNT 6
+
+typedef struct {
+  size_t offset;
+  size_t size;
+} template_field_t;
+
+static const template_field_t TEMPLATE_FIELDS[TEMPLATE_FIELD_COUNT] = {
+    {offsetof(request_t, url), sizeof(((request_t *)0)->url)},
+    {offsetof(request_t, headers), sizeof(((request_t *)0)->headers)},
+    {offsetof(request_t, body), sizeof(((request_t *)0)->body)},
+    {offsetof(request_t, auth_secret_ref), sizeof(((request_t *)0)->auth_secret_ref)},
+    {offsetof(request_t, auth_key_name), sizeof(((request_t *)0)->auth_key_name)},
+    {offsetof(request_t, auth_username), sizeof(((request_t *)0)->auth_username)},
+};
+
+/* Compiled templates point into `source`, a private copy of the request revision they came from. */
+typedef struct template_entry {
+  struct template_entry *next;
+  request_t *source;
+  template_t fields[TEMPLATE_FIELD_COUNT];
+} template_entry_t;
+
+struct template_set {
+  template_entry_t **buckets;
+  size_t buckets_len; /* power of two, or 0 before the first entry */
+  size_t len;
+};
+
+static int compile_fields(const request_t *source, template_t fields[TEMPLATE_FIELD_COUNT]) {
+  for (size_t i = 0; i < TEMPLATE_FIELD_COUNT; i++) {
+    if (template_compile((const char *)source + TEMPLATE_FIELDS[i].offset, &fields[i]) != 0) {
+      for (size_t j = 0; j < i; j++) {
+        template_free(&fields[j]);
+      }
+      return -1;
+    }
+  }
+  return 0;
+}
+
+static void entry_free(template_entry_t *entry) {
+  for (size_t i = 0; i < TEMPLATE_FIELD_COUNT; i++) {
+    template_free(&entry->fields[i]);
+  }
+  free(entry->source);
+  free(entry);
+}
+
+static size_t bucket_of(const template_set_t *set, const char *request_id) {
+  size_t hash = 0;
+  for (const unsigned char *p = (const unsigned char *)request_id; *p != '\0'; p++) {
+    hash = hash * 31 + *p;
+  }
+  return hash & (set->buckets_len - 1);
+}
+
+template_set_t *template_set_new(void) {
+  return calloc(1, sizeof(template_set_t));
+}
+
+void template_set_clear(template_set_t *set) {
+  for (size_t i = 0; i < set->buckets_len; i++) {
+    while (set->buckets[i] != NULL) {
+      template_entry_t *entry = set->buckets[i];
+      set->buckets[i] = entry->next;
+      entry_free(entry);
+    }
+  }
+  set->len = 0;
+}
+
+void template_set_free(template_set_t *set) {
+  if (set == NULL) {
+    return;
+  }
+  template_set_clear(set);
+  free(set->buckets);
+  free(set);
+}
+
+void template_set_forget(template_set_t *set, const char *request_id) {
+  if (set == NULL || set->len == 0) {
+    return;
+  }
+  for (template_entry_t **link = &set->buckets[bucket_of(set, request_id)]; *link != NULL; link = &(*link)->next) {
+    if (strcmp((*link)->source->id, request_id) == 0) {
+      template_entry_t *entry = *link;
+      *link = entry->next;
+      entry_free(entry);
+      set->len--;
+      return;
+    }
+  }
+}
+
+static int set_grow(template_set_t *set) {
+  size_t next_len = set->buckets_len == 0 ? 64 : set->buckets_len * 2;
+  template_entry_t **next = calloc(next_len, sizeof(*next));
+  if (next == NULL) {
+    return -1;
+  }
+  template_set_t grown = {next, next_len, set->len};
+  for (size_t i = 0; i < set->buckets_len; i++) {
+    while (set->buckets[i] != NULL) {
+      template_entry_t *entry = set->buckets[i];
+      set->buckets[i] = entry->next;
+      size_t b = bucket_of(&grown, entry->source->id);
+      entry->next = next[b];
+      next[b] = entry;
+    }
+  }
+  free(set->buckets);
+  *set = grown;
+  return 0;
+}
+
+/* The compiled fields of `req`, compiling them on first use; NULL on allocation failure. */
+static const template_t *set_lookup(template_set_t *set, const request_t *req) {
+  if (set->buckets_len > 0) {
+    for (template_entry_t *e = set->buckets[bucket_of(set, req->id)]; e != NULL; e = e->next) {
+      if (strcmp(e->source->id, req->id) == 0) {
+        return e->fields;
+      }
+    }
+  }
+  if (set->len >= set->buckets_len && set_grow(set) != 0) {
+    return NULL;
+  }
+
+  template_entry_t *entry = calloc(1, sizeof(*entry));
+  if (entry == NULL) {
+    return NULL;
+  }
+  entry->source = malloc(sizeof(*entry->source));
+  if (entry->source == NULL) {
+    free(entry);
+    return NULL;
+  }
+  *entry->source = *req;
+  if (compile_fields(entry->source, entry->fields) != 0) {
+    free(entry->source);
+    free(entry);
+    return NULL;
+  }
+  size_t b = bucket_of(set, req->id);
+  entry->next = set->buckets[b];
+  set->buckets[b] = entry;
+  set->len++;
+  return entry->fields;
+}
+
+int environment_resolve_request(const environment_t *env, const environment_t *overlay, template_set_t *templates,
+                                const request_t *req, const template_iteration_t *it, request_t *out) {
+  *out = *req;
+
+  /* Unsaved drafts have no stable id; compile them on the spot. */
+  template_t scratch[TEMPLATE_FIELD_COUNT];
+  const template_t *fields = NULL;
+  if (templates != NULL && req->id[0] != '\0') {
+    fields = set_lookup(templates, req);
+  }
+  if (fields == NULL) {
+    if (compile_fields(req, scratch) != 0) {
+      return -1;
+    }
+    fields = scratch;
+  }
+
+  lookup_layers_t layers = {env, overlay};
+  int rc = 0;
+  for (size_t i = 0; i < TEMPLATE_FIELD_COUNT && rc == 0; i++) {
+    char *dest = (char *)out + TEMPLATE_FIELDS[i].offset;
+    if (template_expand(&fields[i], lookup_cb, &layers, it, dest, TEMPLATE_FIELDS[i].size) != 0) {
+      rc = -1;
+    }
+  }
+
+  if (fields == scratch) {
+    for (size_t i = 0; i < TEMPLATE_FIELD_COUNT; i++) {
+      template_free(&scratch[i]);
+    }
+  }
+  return rc;
+}
+
+static int variable_listed(const char *list, size_t list_len, const char *name, size_t name_len) {
+  const char *p = list;
+  while (p < list + list_len) {
+    const char *eq = memchr(p, '=', (size_t)(list + list_len - p));
+    if (eq == NULL) {
+      break;
+    }
+    if ((size_t)(eq - p) == name_len && memcmp(p, name, name_len) == 0) {
+      return 1;
+    }
+    const char *nl = memchr(eq, '\n', (size_t)(list + list_len - eq));
+    if (nl == NULL) {
+      break;
+    }
+    p = nl + 1;
+  }
+  return 0;
+}
+
+static int append_bytes(char **buf, size_t *len, size_t *cap, const char *bytes, size_t n) {
+  if (*len + n + 1 > *cap) {
+    size_t next_cap = *cap * 2 > *len + n + 1 ? *cap * 2 : *len + n + 1;
+    char *next = realloc(*buf, next_cap);
+    if (next == NULL) {
+      return -1;
+    }
+    *buf = next;
+    *cap = next_cap;
+  }
+  memcpy(*buf + *len, bytes, n);
+  *len += n;
+  (*buf)[*len] = '\0';
+  return 0;
+}
+
+/* Names that usually hold credentials; matched anywhere in the name, ignoring case. */
+static int secret_like_name(const char *name, size_t name_len) {
+  static const char *const WORDS[] = {"token", "secret", "pass", "key", "auth", "cookie", "session", "credential"};
+  for (size_t w = 0; w < sizeof(WORDS) / sizeof(WORDS[0]); w++) {
+    size_t word_len = strlen(WORDS[w]);
+    for (size_t i = 0; i + word_len <= name_len; i++) {
+      size_t j = 0;
+      while (j < word_len && tolower((unsigned char)name[i + j]) == WORDS[w][j]) {
+        j++;
+      }
+      if (j == word_len) {
+        return 1;
+      }
+    }
+  }
+  return 0;
+}
+
+char *environment_describe_variables(const environment_t *env, const environment_t *overlay,
+                                     template_set_t *templates, const request_t *req) {
+  template_t scratch[TEMPLATE_FIELD_COUNT];
+  const template_t *fields = NULL;
+  if (templates != NULL && req->id[0] != '\0') {
+    fields = set_lookup(templates, req);
+  }
+  if (fields == NULL) {
+    if (compile_fields(req, scratch) != 0) {
+      return NULL;
+    }
+    fields = scratch;
+  }
+
+  size_t cap = 128;
+  size_t len = 0;
+  char *out = malloc(cap);
+  if (out != NULL) {
+    out[0] = '\0';
+  }
+  lookup_layers_t layers = {env, overlay};
+  for (size_t i = 0; i < TEMPLATE_FIELD_COUNT && out != NULL; i++) {
+    for (size_t s = 0; s < fields[i].len && out != NULL; s++) {
+      const template_segment_t *seg = &fields[i].segments[s];
+      if (seg->kind != TEMPLATE_SEGMENT_VARIABLE) {
+        continue;
+      }
+      size_t name_len = 0;
+      const char *name = template_variable_name(seg, &name_len);
+      if (variable_listed(out, len, name, name_len)) {
+        continue;
+      }
+      size_t value_len = 0;
+      const char *value = lookup_cb(&layers, name, name_len, &value_len);
+      if (value == NULL) {
+        value = "(unset)";
+        value_len = strlen(value);
+      } else if ((overlay != NULL && environment_lookup(overlay, name, name_len, &value_len) != NULL) ||
+                 secret_like_name(name, name_len)) {
+        /* Overlay values are extracted from earlier responses, often tokens; neither kind is kept. */
+        value = "(redacted)";
+        value_len = strlen(value);
+      }
+      if (append_bytes(&out, &len, &cap, name, name_len) != 0 || append_bytes(&out, &len, &cap, "=", 1) != 0 ||
+          append_bytes(&out, &len, &cap, value, value_len) != 0 || append_bytes(&out, &len, &cap, "\n", 1) != 0) {
+        free(out);
+        out = NULL;
+      }
+    }
+  }
+
+  if (fields == scratch) {
+    for (size_t i = 0; i < TEMPLATE_FIELD_COUNT; i++) {
+      template_free(&scratch[i]);
+    }
+  }
+  return out;
+}
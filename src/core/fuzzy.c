@@ -0,0 +1,184 @@
+#include "tuiman/fuzzy.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SCORE_MATCH 16
+#define SCORE_GAP_START (-3)
+#define SCORE_GAP_EXTENSION (-1)
+#define BONUS_BOUNDARY 8
+#define BONUS_CAMEL 7
+#define BONUS_CONSECUTIVE 4
+#define BONUS_FIRST_MULTIPLIER 2
+
+static int is_upper(char c) {
+  return c >= 'A' && c <= 'Z';
+}
+
+static int is_lower(char c) {
+  return c >= 'a' && c <= 'z';
+}
+
+static int is_alnum(char c) {
+  return is_upper(c) || is_lower(c) || (c >= '0' && c <= '9');
+}
+
+static char fold(char c) {
+  return is_upper(c) ? (char)(c + ('a' - 'A')) : c;
+}
+
+void fuzzy_pattern_init(fuzzy_pattern_t *pattern, const char *text) {
+  snprintf(pattern->text, sizeof(pattern->text), "%s", text);
+  pattern->len = strlen(pattern->text);
+  pattern->case_sensitive = 0;
+  for (size_t i = 0; i < pattern->len; i++) {
+    if (is_upper(pattern->text[i])) {
+      pattern->case_sensitive = 1;
+      break;
+    }
+  }
+}
+
+static int bonus_at(const char *text, size_t i) {
+  if (i == 0) {
+    return BONUS_BOUNDARY;
+  }
+  char prev = text[i - 1];
+  char c = text[i];
+  if (!is_alnum(prev) && is_alnum(c)) {
+    return BONUS_BOUNDARY;
+  }
+  if (is_lower(prev) && is_upper(c)) {
+    return BONUS_CAMEL;
+  }
+  return 0;
+}
+
+int fuzzy_score(const fuzzy_pattern_t *pattern, const char *text, size_t *positions) {
+  size_t plen = pattern->len;
+  if (plen == 0) {
+    return 0;
+  }
+  const char *p = pattern->text;
+  int cs = pattern->case_sensitive;
+
+  /* Forward pass: earliest end of a full subsequence match, one strchr-style hop per pattern byte. */
+  const char *cursor = text;
+  for (size_t pi = 0; pi < plen; pi++) {
+    const char *hit = strchr(cursor, p[pi]);
+    if (!cs && is_lower(p[pi])) {
+      const char *upper = strchr(cursor, p[pi] - ('a' - 'A'));
+      if (upper != NULL && (hit == NULL || upper < hit)) {
+        hit = upper;
+      }
+    }
+    if (hit == NULL) {
+      return FUZZY_NO_MATCH;
+    }
+    cursor = hit + 1;
+  }
+  size_t end = (size_t)(cursor - text);
+
+  /* Backward pass from that end: the latest start, i.e. the tightest window. */
+  size_t start = end;
+  size_t pi = plen;
+  while (pi > 0) {
+    start--;
+    char c = cs ? text[start] : fold(text[start]);
+    if (c == p[pi - 1]) {
+      pi--;
+    }
+  }
+
+  int score = 0;
+  int in_gap = 0;
+  int run_bonus = 0;
+  size_t prev_match = (size_t)-1;
+  pi = 0;
+  for (size_t i = start; i < end && pi < plen; i++) {
+    char c = cs ? text[i] : fold(text[i]);
+    if (c != p[pi]) {
+      score += in_gap ? SCORE_GAP_EXTENSION : SCORE_GAP_START;
+      in_gap = 1;
+      run_bonus = 0;
+      continue;
+    }
+    int bonus = bonus_at(text, i);
+    if (prev_match != (size_t)-1 && prev_match + 1 == i) {
+      /* A run keeps the bonus of the boundary it started on. */
+      if (run_bonus < BONUS_CONSECUTIVE) {
+        run_bonus = BONUS_CONSECUTIVE;
+      }
+      if (bonus < run_bonus) {
+        bonus = run_bonus;
+      }
+    } else {
+      run_bonus = bonus;
+    }
+    if (pi == 0) {
+      bonus *= BONUS_FIRST_MULTIPLIER;
+    }
+    score += SCORE_MATCH + bonus;
+    if (positions != NULL) {
+      positions[pi] = i;
+    }
+    prev_match = i;
+    in_gap = 0;
+    pi++;
+  }
+  return score;
+}
+
+static int hit_better(const fuzzy_hit_t *a, const fuzzy_hit_t *b) {
+  if (a->score != b->score) {
+    return a->score > b->score;
+  }
+  if (a->length != b->length) {
+    return a->length < b->length;
+  }
+  return a->item < b->item;
+}
+
+static int compare_hits(const void *lhs, const void *rhs) {
+  const fuzzy_hit_t *a = lhs;
+  const fuzzy_hit_t *b = rhs;
+  return hit_better(a, b) ? -1 : (hit_better(b, a) ? 1 : 0);
+}
+
+static void swap_hits(fuzzy_hit_t *a, fuzzy_hit_t *b) {
+  fuzzy_hit_t tmp = *a;
+  *a = *b;
+  *b = tmp;
+}
+
+void fuzzy_top_k(fuzzy_hit_t *hits, size_t len, size_t k) {
+  if (k > len) {
+    k = len;
+  }
+  /* Quickselect the k best into [0, k), then sort only those. */
+  size_t lo = 0;
+  size_t hi = len;
+  while (k > 0 && k < len && hi - lo > 1) {
+    size_t mid = lo + (hi - lo) / 2;
+    swap_hits(&hits[mid], &hits[hi - 1]);
+    fuzzy_hit_t pivot = hits[hi - 1];
+    size_t store = lo;
+    for (size_t i = lo; i + 1 < hi; i++) {
+      if (hit_better(&hits[i], &pivot)) {
+        swap_hits(&hits[i], &hits[store]);
+        store++;
+      }
+    }
+    swap_hits(&hits[store], &hits[hi - 1]);
+    if (store == k || store + 1 == k) {
+      break;
+    }
+    if (store > k) {
+      hi = store;
+    } else {
+      lo = store + 1;
+    }
+  }
+  qsort(hits, k, sizeof(fuzzy_hit_t), compare_hits);
+}
@@ -0,0 +1,483 @@
+#include "tuiman/highlight.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+enum {
+  JSON_BETWEEN = 0,
+  JSON_STRING,
+  JSON_ESCAPE,
+  JSON_WORD,
+};
+
+enum {
+  XML_TEXT = 0,
+  XML_ENTITY,
+  XML_TAG_NAME,
+  XML_IN_TAG,
+  XML_VALUE_DQ,
+  XML_VALUE_SQ,
+  XML_COMMENT,
+};
+
+enum {
+  FORM_KEY = 0,
+  FORM_VALUE,
+};
+
+/* ASCII-only classes: bytes of UTF-8 sequences never start or continue a number, literal or entity. */
+static int is_space(unsigned char c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static int is_digit(unsigned char c) {
+  return c >= '0' && c <= '9';
+}
+
+static int is_alpha(unsigned char c) {
+  return (c | 0x20) >= 'a' && (c | 0x20) <= 'z';
+}
+
+static int is_alnum(unsigned char c) {
+  return is_digit(c) || is_alpha(c);
+}
+
+static int json_top_is_object(const highlight_state_t *s) {
+  if (s->depth == 0) {
+    return 0;
+  }
+  return s->depth > 64 || ((s->objects >> (s->depth - 1)) & 1) != 0;
+}
+
+static highlight_token_t json_step(highlight_state_t *s, unsigned char c) {
+  switch (s->mode) {
+  case JSON_STRING:
+    if (c == '\\') {
+      s->mode = JSON_ESCAPE;
+    } else if (c == '"') {
+      s->mode = JSON_BETWEEN;
+    }
+    return (highlight_token_t)s->token;
+  case JSON_ESCAPE:
+    s->mode = JSON_STRING;
+    return (highlight_token_t)s->token;
+  case JSON_WORD:
+    if (is_alnum(c) || c == '.' || c == '+' || c == '-') {
+      return (highlight_token_t)s->token;
+    }
+    s->mode = JSON_BETWEEN;
+    break;
+  default:
+    break;
+  }
+
+  if (c == '"') {
+    s->mode = JSON_STRING;
+    s->token = s->expect_key ? HIGHLIGHT_KEY : HIGHLIGHT_STRING;
+    s->expect_key = 0;
+    return (highlight_token_t)s->token;
+  }
+  if (c == '{' || c == '[') {
+    if (s->depth < 64) {
+      uint64_t bit = (uint64_t)1 << s->depth;
+      s->objects = c == '{' ? s->objects | bit : s->objects & ~bit;
+    }
+    s->depth++;
+    s->expect_key = c == '{';
+    return HIGHLIGHT_PUNCT;
+  }
+  if (c == '}' || c == ']') {
+    if (s->depth > 0) {
+      s->depth--;
+    }
+    s->expect_key = 0;
+    return HIGHLIGHT_PUNCT;
+  }
+  if (c == ':') {
+    s->expect_key = 0;
+    return HIGHLIGHT_PUNCT;
+  }
+  if (c == ',') {
+    s->expect_key = (uint8_t)json_top_is_object(s);
+    return HIGHLIGHT_PUNCT;
+  }
+  if (c == '-' || is_digit(c)) {
+    s->mode = JSON_WORD;
+    s->token = HIGHLIGHT_NUMBER;
+    return HIGHLIGHT_NUMBER;
+  }
+  if (is_alpha(c)) {
+    s->mode = JSON_WORD;
+    s->token = HIGHLIGHT_LITERAL;
+    return HIGHLIGHT_LITERAL;
+  }
+  return HIGHLIGHT_PLAIN;
+}
+
+/* The common case of checkpointing, with no per-byte language dispatch. */
+static void json_advance(highlight_state_t *s, const char *text, size_t pos, size_t stop) {
+  for (; pos < stop; pos++) {
+    if (s->mode == JSON_STRING) {
+      while (pos < stop && text[pos] != '"' && text[pos] != '\\') {
+        pos++;
+      }
+      if (pos == stop) {
+        break;
+      }
+    }
+    json_step(s, (unsigned char)text[pos]);
+  }
+}
+
+/* `pos` is the byte being lexed; lookahead stops at `limit`. */
+static highlight_token_t xml_step(highlight_state_t *s, const char *text, size_t pos, size_t limit) {
+  unsigned char c = (unsigned char)text[pos];
+  switch (s->mode) {
+  case XML_ENTITY:
+    if (c == ';') {
+      s->mode = XML_TEXT;
+      return HIGHLIGHT_LITERAL;
+    }
+    if (is_alnum(c) || c == '#') {
+      return HIGHLIGHT_LITERAL;
+    }
+    s->mode = XML_TEXT;
+    break;
+  case XML_TAG_NAME:
+    if (is_space(c)) {
+      s->mode = XML_IN_TAG;
+      return HIGHLIGHT_PLAIN;
+    }
+    if (c == '>') {
+      s->mode = XML_TEXT;
+    }
+    return HIGHLIGHT_TAG;
+  case XML_IN_TAG:
+    if (is_space(c)) {
+      return HIGHLIGHT_PLAIN;
+    }
+    if (c == '>') {
+      s->mode = XML_TEXT;
+      return HIGHLIGHT_TAG;
+    }
+    if (c == '/' || c == '?') {
+      return HIGHLIGHT_TAG;
+    }
+    if (c == '=') {
+      return HIGHLIGHT_PUNCT;
+    }
+    if (c == '"' || c == '\'') {
+      s->mode = c == '"' ? XML_VALUE_DQ : XML_VALUE_SQ;
+      return HIGHLIGHT_STRING;
+    }
+    return HIGHLIGHT_ATTR;
+  case XML_VALUE_DQ:
+  case XML_VALUE_SQ:
+    if (c == (s->mode == XML_VALUE_DQ ? '"' : '\'')) {
+      s->mode = XML_IN_TAG;
+    }
+    return HIGHLIGHT_STRING;
+  case XML_COMMENT:
+    if (c == '>' && s->dashes == 2) {
+      s->mode = XML_TEXT;
+    }
+    s->dashes = c == '-' ? (uint8_t)(s->dashes < 2 ? s->dashes + 1 : 2) : 0;
+    return HIGHLIGHT_COMMENT;
+  default:
+    break;
+  }
+
+  if (c == '<') {
+    if (limit - pos >= 4 && memcmp(text + pos + 1, "!--", 3) == 0) {
+      s->mode = XML_COMMENT;
+      s->token = HIGHLIGHT_COMMENT;
+      s->skip = 3;
+      s->dashes = 0;
+      return HIGHLIGHT_COMMENT;
+    }
+    s->mode = XML_TAG_NAME;
+    return HIGHLIGHT_TAG;
+  }
+  if (c == '&') {
+    s->mode = XML_ENTITY;
+    return HIGHLIGHT_LITERAL;
+  }
+  return HIGHLIGHT_PLAIN;
+}
+
+static highlight_token_t form_step(highlight_state_t *s, unsigned char c) {
+  if (c == '&' || c == '\n') {
+    s->mode = FORM_KEY;
+    return c == '&' ? HIGHLIGHT_PUNCT : HIGHLIGHT_PLAIN;
+  }
+  if (c == '=' && s->mode == FORM_KEY) {
+    s->mode = FORM_VALUE;
+    return HIGHLIGHT_PUNCT;
+  }
+  if (c == '%' || c == '+') {
+    s->token = HIGHLIGHT_LITERAL;
+    s->skip = c == '%' ? 2 : 0;
+    return HIGHLIGHT_LITERAL;
+  }
+  if (c == '\r') {
+    return HIGHLIGHT_PLAIN;
+  }
+  return s->mode == FORM_KEY ? HIGHLIGHT_KEY : HIGHLIGHT_STRING;
+}
+
+static highlight_token_t step(highlight_lang_t lang, highlight_state_t *s, const char *text, size_t pos,
+                              size_t limit) {
+  if (s->skip > 0) {
+    s->skip--;
+    return (highlight_token_t)s->token;
+  }
+  switch (lang) {
+  case HIGHLIGHT_JSON:
+    return json_step(s, (unsigned char)text[pos]);
+  case HIGHLIGHT_XML:
+    return xml_step(s, text, pos, limit);
+  case HIGHLIGHT_FORM:
+    return form_step(s, (unsigned char)text[pos]);
+  default:
+    return HIGHLIGHT_PLAIN;
+  }
+}
+
+/* The end of the bytes from `pos` that step() would give one token (`*token`) without changing the state. */
+static size_t quiet_run(highlight_lang_t lang, const highlight_state_t *s, const char *text, size_t pos, size_t stop,
+                        highlight_token_t *token) {
+  size_t end = pos;
+  if (s->skip > 0) {
+    return pos;
+  }
+  if (lang == HIGHLIGHT_JSON && s->mode == JSON_STRING) {
+    while (end < stop && text[end] != '"' && text[end] != '\\') {
+      end++;
+    }
+    *token = (highlight_token_t)s->token;
+  } else if (lang == HIGHLIGHT_XML && s->mode == XML_TEXT) {
+    while (end < stop && text[end] != '<' && text[end] != '&') {
+      end++;
+    }
+    *token = HIGHLIGHT_PLAIN;
+  } else if (lang == HIGHLIGHT_XML && (s->mode == XML_VALUE_DQ || s->mode == XML_VALUE_SQ)) {
+    char quote = s->mode == XML_VALUE_DQ ? '"' : '\'';
+    while (end < stop && text[end] != quote) {
+      end++;
+    }
+    *token = HIGHLIGHT_STRING;
+  } else if (lang == HIGHLIGHT_XML && s->mode == XML_TAG_NAME) {
+    while (end < stop && text[end] != '>' && !is_space((unsigned char)text[end])) {
+      end++;
+    }
+    *token = HIGHLIGHT_TAG;
+  } else if (lang == HIGHLIGHT_XML && s->mode == XML_COMMENT && s->dashes == 0) {
+    while (end < stop && text[end] != '-') {
+      end++;
+    }
+    *token = HIGHLIGHT_COMMENT;
+  } else if (lang == HIGHLIGHT_FORM) {
+    while (end < stop && text[end] != '&' && text[end] != '=' && text[end] != '%' && text[end] != '+' &&
+           text[end] != '\r' && text[end] != '\n') {
+      end++;
+    }
+    *token = s->mode == FORM_KEY ? HIGHLIGHT_KEY : HIGHLIGHT_STRING;
+  }
+  return end;
+}
+
+/* The region holding `pos` (its index in `*index`), or NULL. */
+static const highlight_region_t *region_at(const highlighter_t *h, size_t pos, size_t *index) {
+  for (size_t i = 0; i < h->regions_len; i++) {
+    if (pos >= h->regions[i].start && pos < h->regions[i].end) {
+      *index = i;
+      return &h->regions[i];
+    }
+  }
+  return NULL;
+}
+
+static size_t next_region_start(const highlighter_t *h, size_t pos, size_t end) {
+  for (size_t i = 0; i < h->regions_len; i++) {
+    if (h->regions[i].start > pos && h->regions[i].start < end) {
+      return h->regions[i].start;
+    }
+  }
+  return end;
+}
+
+/* Enters region `index` fresh the first time a state reaches it. */
+static const highlight_region_t *enter_region(const highlighter_t *h, highlight_state_t *s, size_t pos) {
+  size_t index = 0;
+  const highlight_region_t *region = region_at(h, pos, &index);
+  if (region == NULL) {
+    s->region = 0;
+  } else if (s->region != index + 1) {
+    memset(s, 0, sizeof(*s));
+    s->region = (uint8_t)(index + 1);
+  }
+  return region;
+}
+
+static void advance(const highlighter_t *h, highlight_state_t *s, size_t pos, size_t end) {
+  while (pos < end) {
+    const highlight_region_t *region = enter_region(h, s, pos);
+    if (region == NULL) {
+      pos = next_region_start(h, pos, end);
+      continue;
+    }
+    size_t stop = region->end < end ? region->end : end;
+    /* A local copy can live in registers; through `s` every store to the text's char type would reload it. */
+    highlight_state_t local = *s;
+    if (region->lang == HIGHLIGHT_JSON) {
+      json_advance(&local, h->text, pos, stop);
+      pos = stop;
+    }
+    while (pos < stop) {
+      highlight_token_t token = HIGHLIGHT_PLAIN;
+      pos = quiet_run(region->lang, &local, h->text, pos, stop, &token);
+      if (pos < stop) {
+        step(region->lang, &local, h->text, pos, region->end);
+        pos++;
+      }
+    }
+    *s = local;
+  }
+}
+
+highlight_lang_t highlight_detect(const char *text, size_t len) {
+  size_t i = 0;
+  if (len >= 3 && memcmp(text, "\xef\xbb\xbf", 3) == 0) {
+    i = 3;
+  }
+  while (i < len && is_space((unsigned char)text[i])) {
+    i++;
+  }
+  if (i == len) {
+    return HIGHLIGHT_NONE;
+  }
+  if (text[i] == '{' || text[i] == '[') {
+    return HIGHLIGHT_JSON;
+  }
+  if (text[i] == '<') {
+    return HIGHLIGHT_XML;
+  }
+  size_t j = i;
+  while (j < len && j - i < 256 &&
+         (is_alnum((unsigned char)text[j]) || (text[j] != '\0' && strchr("_.-~%+[]*", text[j]) != NULL))) {
+    j++;
+  }
+  return j > i && j < len && text[j] == '=' ? HIGHLIGHT_FORM : HIGHLIGHT_NONE;
+}
+
+void highlighter_init(highlighter_t *h, const char *text, size_t len) {
+  memset(h, 0, sizeof(*h));
+  h->text = text;
+  h->len = len;
+}
+
+void highlighter_free(highlighter_t *h) {
+  free(h->marks);
+  memset(h, 0, sizeof(*h));
+}
+
+void highlighter_add_region(highlighter_t *h, size_t start, size_t end, highlight_lang_t lang) {
+  if (h->regions_len == HIGHLIGHT_MAX_REGIONS || lang == HIGHLIGHT_NONE || start >= end || end > h->len) {
+    return;
+  }
+  h->regions[h->regions_len++] = (highlight_region_t){start, end, lang};
+}
+
+/* Lexes the next checkpoint interval past `lexed` and records the state at its end. */
+static int extend(highlighter_t *h) {
+  if (h->marks_len == h->marks_cap) {
+    size_t cap = h->marks_cap > 0 ? h->marks_cap * 2 : 16;
+    highlight_mark_t *grown = realloc(h->marks, cap * sizeof(*grown));
+    if (grown == NULL) {
+      return -1;
+    }
+    h->marks = grown;
+    h->marks_cap = cap;
+  }
+  size_t from = h->lexed;
+  size_t stop = h->len - from > HIGHLIGHT_MARK_BYTES ? from + HIGHLIGHT_MARK_BYTES : h->len;
+  size_t at = from;
+  for (int lines = 0; lines < HIGHLIGHT_MARK_LINES && at < stop; lines++) {
+    const char *nl = memchr(h->text + at, '\n', stop - at);
+    if (nl == NULL) {
+      at = stop;
+      break;
+    }
+    at = (size_t)(nl - h->text) + 1;
+  }
+  highlight_state_t state = h->marks[h->marks_len - 1].state;
+  advance(h, &state, from, at);
+  h->marks[h->marks_len++] = (highlight_mark_t){at, state};
+  h->lexed = at;
+  return 0;
+}
+
+int highlighter_seek(highlighter_t *h, size_t pos, highlight_state_t *state) {
+  h->behind = 0;
+  if (h->marks_len == 0) {
+    h->marks = malloc(16 * sizeof(*h->marks));
+    if (h->marks == NULL) {
+      return -1;
+    }
+    h->marks_cap = 16;
+    memset(&h->marks[0], 0, sizeof(h->marks[0]));
+    h->marks_len = 1;
+  }
+  size_t budget_end = h->lexed + HIGHLIGHT_SEEK_BUDGET;
+  while (h->lexed < pos && h->lexed < h->len && h->lexed < budget_end) {
+    if (extend(h) != 0) {
+      return -1;
+    }
+  }
+  if (pos > h->lexed && h->lexed < h->len) {
+    h->behind = 1;
+    return -1;
+  }
+
+  size_t lo = 0;
+  size_t hi = h->marks_len - 1;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo + 1) / 2;
+    if (h->marks[mid].offset <= pos) {
+      lo = mid;
+    } else {
+      hi = mid - 1;
+    }
+  }
+  *state = h->marks[lo].state;
+  advance(h, state, h->marks[lo].offset, pos);
+  return 0;
+}
+
+size_t highlighter_next(const highlighter_t *h, highlight_state_t *state, size_t pos, size_t end,
+                        highlight_token_t *token) {
+  const highlight_region_t *region = enter_region(h, state, pos);
+  if (region == NULL) {
+    *token = HIGHLIGHT_PLAIN;
+    return next_region_start(h, pos, end);
+  }
+  size_t stop = region->end < end ? region->end : end;
+  highlight_lang_t lang = region->lang;
+  *token = step(lang, state, h->text, pos, region->end);
+  for (pos++; pos < stop; pos++) {
+    highlight_token_t quiet = HIGHLIGHT_PLAIN;
+    size_t quiet_end = quiet_run(lang, state, h->text, pos, stop, &quiet);
+    if (quiet_end > pos && quiet == *token) {
+      pos = quiet_end;
+      if (pos == stop) {
+        break;
+      }
+    }
+    highlight_state_t before = *state;
+    if (step(lang, state, h->text, pos, region->end) != *token) {
+      *state = before;
+      break;
+    }
+  }
+  return pos;
+}
@@ -0,0 +1,241 @@
+#include "tuiman/json_index.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+#define BLOCK 64
+
+typedef struct {
+  uint64_t quote;
+  uint64_t backslash;
+  uint64_t structural;
+} block_masks_t;
+
+#if defined(__SSE2__)
+static uint64_t movemask16(__m128i v, int shift) {
+  return (uint64_t)(uint16_t)_mm_movemask_epi8(v) << shift;
+}
+
+static void classify(const char *p, block_masks_t *m) {
+  const __m128i quote = _mm_set1_epi8('"');
+  const __m128i backslash = _mm_set1_epi8('\\');
+  const __m128i case_bit = _mm_set1_epi8(0x20);
+  /* '[' | 0x20 == '{' and ']' | 0x20 == '}', so two compares find all four brackets. */
+  const __m128i open = _mm_set1_epi8('{');
+  const __m128i close = _mm_set1_epi8('}');
+  const __m128i colon = _mm_set1_epi8(':');
+  const __m128i comma = _mm_set1_epi8(',');
+  memset(m, 0, sizeof(*m));
+  for (int i = 0; i < BLOCK / 16; i++) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(p + 16 * i));
+    __m128i folded = _mm_or_si128(v, case_bit);
+    __m128i structural = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(folded, open), _mm_cmpeq_epi8(folded, close)),
+                                      _mm_or_si128(_mm_cmpeq_epi8(v, colon), _mm_cmpeq_epi8(v, comma)));
+    m->quote |= movemask16(_mm_cmpeq_epi8(v, quote), 16 * i);
+    m->backslash |= movemask16(_mm_cmpeq_epi8(v, backslash), 16 * i);
+    m->structural |= movemask16(structural, 16 * i);
+  }
+}
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+/* One bit per byte of four compare results; NEON has no movemask, so weight the lanes and add pairwise. */
+static uint64_t movemask64(uint8x16_t a, uint8x16_t b, uint8x16_t c, uint8x16_t d) {
+  static const uint8_t weights[16] = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+  const uint8x16_t bits = vld1q_u8(weights);
+  uint8x16_t ab = vpaddq_u8(vandq_u8(a, bits), vandq_u8(b, bits));
+  uint8x16_t cd = vpaddq_u8(vandq_u8(c, bits), vandq_u8(d, bits));
+  uint8x16_t sum = vpaddq_u8(ab, cd);
+  sum = vpaddq_u8(sum, sum);
+  return vgetq_lane_u64(vreinterpretq_u64_u8(sum), 0);
+}
+
+static void classify(const char *p, block_masks_t *m) {
+  uint8x16_t q[4];
+  uint8x16_t b[4];
+  uint8x16_t s[4];
+  for (int i = 0; i < 4; i++) {
+    uint8x16_t v = vld1q_u8((const uint8_t *)p + 16 * i);
+    uint8x16_t folded = vorrq_u8(v, vdupq_n_u8(0x20));
+    q[i] = vceqq_u8(v, vdupq_n_u8('"'));
+    b[i] = vceqq_u8(v, vdupq_n_u8('\\'));
+    s[i] = vorrq_u8(vorrq_u8(vceqq_u8(folded, vdupq_n_u8('{')), vceqq_u8(folded, vdupq_n_u8('}'))),
+                    vorrq_u8(vceqq_u8(v, vdupq_n_u8(':')), vceqq_u8(v, vdupq_n_u8(','))));
+  }
+  m->quote = movemask64(q[0], q[1], q[2], q[3]);
+  m->backslash = movemask64(b[0], b[1], b[2], b[3]);
+  m->structural = movemask64(s[0], s[1], s[2], s[3]);
+}
+#else
+static void classify(const char *p, block_masks_t *m) {
+  memset(m, 0, sizeof(*m));
+  for (int i = 0; i < BLOCK; i++) {
+    char c = p[i];
+    uint64_t bit = (uint64_t)1 << i;
+    if (c == '"') {
+      m->quote |= bit;
+    } else if (c == '\\') {
+      m->backslash |= bit;
+    } else if (c == '{' || c == '}' || c == '[' || c == ']' || c == ':' || c == ',') {
+      m->structural |= bit;
+    }
+  }
+}
+#endif
+
+/* Bit i set when byte i is preceded by an odd run of backslashes. `carry` is whether byte 0 of the next block is. */
+static uint64_t find_escaped(uint64_t backslash, uint64_t *carry) {
+  if (backslash == 0) {
+    uint64_t escaped = *carry;
+    *carry = 0;
+    return escaped;
+  }
+  const uint64_t even_bits = 0x5555555555555555ull;
+  backslash &= ~*carry;
+  uint64_t follows_escape = backslash << 1 | *carry;
+  uint64_t odd_starts = backslash & ~even_bits & ~follows_escape;
+  uint64_t even_ends = odd_starts + backslash;
+  *carry = even_ends < odd_starts;
+  uint64_t invert = even_ends << 1;
+  return (even_bits ^ invert) & follows_escape;
+}
+
+/* Bit i is the parity of the bits up to and including i: the quoted regions between unescaped quotes. */
+static uint64_t prefix_xor(uint64_t x) {
+  x ^= x << 1;
+  x ^= x << 2;
+  x ^= x << 4;
+  x ^= x << 8;
+  x ^= x << 16;
+  x ^= x << 32;
+  return x;
+}
+
+static int scan(json_index_t *index, char *error, size_t error_len) {
+  size_t cap = index->len / 8 + BLOCK;
+  index->pos = malloc(cap * sizeof(uint32_t));
+  if (index->pos == NULL) {
+    snprintf(error, error_len, "out of memory");
+    return -1;
+  }
+  uint64_t escape_carry = 0;
+  uint64_t in_string_carry = 0;
+  for (size_t base = 0; base < index->len; base += BLOCK) {
+    block_masks_t m;
+    if (index->len - base >= BLOCK) {
+      classify(index->text + base, &m);
+    } else {
+      char tail[BLOCK];
+      memset(tail, ' ', sizeof(tail));
+      memcpy(tail, index->text + base, index->len - base);
+      classify(tail, &m);
+    }
+    uint64_t quote = m.quote & ~find_escaped(m.backslash, &escape_carry);
+    uint64_t in_string = prefix_xor(quote) ^ in_string_carry;
+    in_string_carry = (uint64_t)((int64_t)in_string >> 63);
+    uint64_t structural = m.structural & ~in_string;
+
+    if (index->count + BLOCK > cap) {
+      cap *= 2;
+      uint32_t *grown = realloc(index->pos, cap * sizeof(uint32_t));
+      if (grown == NULL) {
+        snprintf(error, error_len, "out of memory");
+        return -1;
+      }
+      index->pos = grown;
+    }
+    while (structural != 0) {
+      index->pos[index->count++] = (uint32_t)(base + (size_t)__builtin_ctzll(structural));
+      structural &= structural - 1;
+    }
+  }
+  if (in_string_carry != 0) {
+    snprintf(error, error_len, "unterminated string");
+    return -1;
+  }
+  return 0;
+}
+
+static int fail_at(const json_index_t *index, size_t i, const char *what, char *error, size_t error_len) {
+  snprintf(error, error_len, "%s '%c' at byte %u", what, index->text[index->pos[i]], (unsigned)index->pos[i]);
+  return -1;
+}
+
+/* Pairs brackets and checks which structural may follow which. */
+static int pair(json_index_t *index, char *error, size_t error_len) {
+  index->match = malloc((index->count > 0 ? index->count : 1) * sizeof(uint32_t));
+  if (index->match == NULL) {
+    snprintf(error, error_len, "out of memory");
+    return -1;
+  }
+  uint32_t *stack = malloc((index->count > 0 ? index->count : 1) * sizeof(uint32_t));
+  if (stack == NULL) {
+    snprintf(error, error_len, "out of memory");
+    return -1;
+  }
+  size_t depth = 0;
+  int rc = 0;
+  for (size_t i = 0; i < index->count && rc == 0; i++) {
+    char c = index->text[index->pos[i]];
+    char container = depth > 0 ? index->text[index->pos[stack[depth - 1]]] : 0;
+    char prev = i > 0 ? index->text[index->pos[i - 1]] : 0;
+    if (depth == 0 && i > 0) {
+      rc = fail_at(index, i, "unexpected", error, error_len);
+    } else if (c == '{' || c == '[') {
+      /* A nested value follows a key's ':' in an object, or '[' / ',' in an array. */
+      if ((container == '{' && prev != ':') || (container == '[' && prev != '[' && prev != ',')) {
+        rc = fail_at(index, i, "unexpected", error, error_len);
+      } else {
+        stack[depth++] = (uint32_t)i;
+      }
+    } else if (c == '}' || c == ']') {
+      if (container != (c == '}' ? '{' : '[') || (c == '}' && prev == ',')) {
+        rc = fail_at(index, i, "unbalanced or misplaced", error, error_len);
+      } else {
+        uint32_t open = stack[--depth];
+        index->match[open] = (uint32_t)i;
+        index->match[i] = open;
+      }
+    } else if (c == ':') {
+      if (container != '{' || (prev != '{' && prev != ',')) {
+        rc = fail_at(index, i, "unexpected", error, error_len);
+      }
+    } else if (container == 0 || (container == '{' && (prev == '{' || prev == ','))) {
+      /* A ',' outside any container or after an object member with no ':'; in arrays scalars leave no trace. */
+      rc = fail_at(index, i, "unexpected", error, error_len);
+    }
+  }
+  if (rc == 0 && depth > 0) {
+    snprintf(error, error_len, "unclosed '%c' at byte %u", index->text[index->pos[stack[depth - 1]]],
+             (unsigned)index->pos[stack[depth - 1]]);
+    rc = -1;
+  }
+  free(stack);
+  return rc;
+}
+
+int json_index_build(const char *text, size_t len, json_index_t *out, char *error, size_t error_len) {
+  memset(out, 0, sizeof(*out));
+  if (len >= UINT32_MAX) {
+    snprintf(error, error_len, "too large to index (4 GiB limit)");
+    return -1;
+  }
+  out->text = text;
+  out->len = len;
+  if (scan(out, error, error_len) != 0 || pair(out, error, error_len) != 0) {
+    json_index_free(out);
+    return -1;
+  }
+  return 0;
+}
+
+void json_index_free(json_index_t *index) {
+  free(index->pos);
+  free(index->match);
+  memset(index, 0, sizeof(*index));
+}
@@ -0,0 +1,376 @@
+#include "tuiman/json_normalize.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* One `"key": value` of the object being written; offsets are into the output. */
+typedef struct {
+  const char *key;
+  size_t key_len;
+  size_t index;
+  size_t out_start;
+  size_t out_len;
+} member_t;
+
+typedef struct {
+  const char *p;
+  const char *end;
+  char *out;
+  size_t len;
+  size_t cap;
+  member_t *members; /* stack shared by the open objects */
+  size_t members_len;
+  size_t members_cap;
+  char *scratch;
+  size_t scratch_cap;
+  int failed;
+} normalizer_t;
+
+static int reserve(normalizer_t *n, size_t extra) {
+  if (n->len + extra + 1 <= n->cap) {
+    return 0;
+  }
+  size_t cap = n->cap > 0 ? n->cap : 256;
+  while (cap < n->len + extra + 1) {
+    cap *= 2;
+  }
+  char *grown = realloc(n->out, cap);
+  if (grown == NULL) {
+    n->failed = 1;
+    return -1;
+  }
+  n->out = grown;
+  n->cap = cap;
+  return 0;
+}
+
+static void emit(normalizer_t *n, const char *bytes, size_t len) {
+  if (n->failed || reserve(n, len) != 0) {
+    return;
+  }
+  memcpy(n->out + n->len, bytes, len);
+  n->len += len;
+}
+
+/* ",\n" (or "\n" for the first item) followed by the indentation of `depth`. */
+static void emit_break(normalizer_t *n, int first, int depth) {
+  size_t indent = (size_t)depth * 2;
+  if (n->failed || reserve(n, indent + 2) != 0) {
+    return;
+  }
+  if (!first) {
+    n->out[n->len++] = ',';
+  }
+  n->out[n->len++] = '\n';
+  memset(n->out + n->len, ' ', indent);
+  n->len += indent;
+}
+
+static void skip_ws(normalizer_t *n) {
+  while (n->p < n->end && (*n->p == ' ' || *n->p == '\t' || *n->p == '\n' || *n->p == '\r')) {
+    n->p++;
+  }
+}
+
+static int is_digit(char c) {
+  return c >= '0' && c <= '9';
+}
+
+static int is_hex(char c) {
+  return is_digit(c) || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+
+/* Validates the string at n->p and returns its span, quotes included. */
+static int scan_string(normalizer_t *n, const char **start, size_t *len) {
+  const char *p = n->p + 1;
+  while (p < n->end && *p != '"') {
+    unsigned char c = (unsigned char)*p;
+    if (c < 0x20) {
+      return -1;
+    }
+    if (c == '\\') {
+      if (p + 1 >= n->end) {
+        return -1;
+      }
+      char e = p[1];
+      if (e == 'u') {
+        if (n->end - p < 6 || !is_hex(p[2]) || !is_hex(p[3]) || !is_hex(p[4]) || !is_hex(p[5])) {
+          return -1;
+        }
+        p += 6;
+        continue;
+      }
+      if (strchr("\"\\/bfnrt", e) == NULL || e == '\0') {
+        return -1;
+      }
+      p += 2;
+      continue;
+    }
+    p++;
+  }
+  if (p >= n->end) {
+    return -1;
+  }
+  *start = n->p;
+  *len = (size_t)(p + 1 - n->p);
+  n->p = p + 1;
+  return 0;
+}
+
+static int scan_number(normalizer_t *n) {
+  const char *p = n->p;
+  if (p < n->end && *p == '-') {
+    p++;
+  }
+  if (p >= n->end || !is_digit(*p)) {
+    return -1;
+  }
+  if (*p == '0') {
+    p++;
+  } else {
+    while (p < n->end && is_digit(*p)) {
+      p++;
+    }
+  }
+  if (p < n->end && *p == '.') {
+    p++;
+    if (p >= n->end || !is_digit(*p)) {
+      return -1;
+    }
+    while (p < n->end && is_digit(*p)) {
+      p++;
+    }
+  }
+  if (p < n->end && (*p == 'e' || *p == 'E')) {
+    p++;
+    if (p < n->end && (*p == '+' || *p == '-')) {
+      p++;
+    }
+    if (p >= n->end || !is_digit(*p)) {
+      return -1;
+    }
+    while (p < n->end && is_digit(*p)) {
+      p++;
+    }
+  }
+  emit(n, n->p, (size_t)(p - n->p));
+  n->p = p;
+  return 0;
+}
+
+static int scan_literal(normalizer_t *n, const char *word) {
+  size_t len = strlen(word);
+  if ((size_t)(n->end - n->p) < len || memcmp(n->p, word, len) != 0) {
+    return -1;
+  }
+  emit(n, word, len);
+  n->p += len;
+  return 0;
+}
+
+static int compare_members(const void *lhs, const void *rhs) {
+  const member_t *a = lhs;
+  const member_t *b = rhs;
+  size_t common = a->key_len < b->key_len ? a->key_len : b->key_len;
+  int cmp = memcmp(a->key, b->key, common);
+  if (cmp != 0) {
+    return cmp;
+  }
+  if (a->key_len != b->key_len) {
+    return a->key_len < b->key_len ? -1 : 1;
+  }
+  return a->index < b->index ? -1 : (a->index > b->index ? 1 : 0);
+}
+
+static int push_member(normalizer_t *n, const member_t *member) {
+  if (n->members_len == n->members_cap) {
+    size_t cap = n->members_cap > 0 ? n->members_cap * 2 : 64;
+    member_t *grown = realloc(n->members, cap * sizeof(*grown));
+    if (grown == NULL) {
+      n->failed = 1;
+      return -1;
+    }
+    n->members = grown;
+    n->members_cap = cap;
+  }
+  n->members[n->members_len++] = *member;
+  return 0;
+}
+
+/* Rewrites the members written since `body_start` in key order. */
+static int sort_members(normalizer_t *n, size_t base, size_t body_start, int depth) {
+  member_t *members = n->members + base;
+  size_t count = n->members_len - base;
+  int sorted = 1;
+  for (size_t i = 1; i < count && sorted; i++) {
+    sorted = compare_members(&members[i - 1], &members[i]) < 0;
+  }
+  if (sorted) {
+    return 0;
+  }
+
+  size_t body_len = n->len - body_start;
+  if (body_len > n->scratch_cap) {
+    char *grown = realloc(n->scratch, body_len);
+    if (grown == NULL) {
+      n->failed = 1;
+      return -1;
+    }
+    n->scratch = grown;
+    n->scratch_cap = body_len;
+  }
+  memcpy(n->scratch, n->out + body_start, body_len);
+  qsort(members, count, sizeof(*members), compare_members);
+  n->len = body_start;
+  for (size_t i = 0; i < count; i++) {
+    emit_break(n, i == 0, depth);
+    emit(n, n->scratch + (members[i].out_start - body_start), members[i].out_len);
+  }
+  return n->failed ? -1 : 0;
+}
+
+static int normalize_value(normalizer_t *n, int depth);
+
+static int normalize_object(normalizer_t *n, int depth) {
+  n->p++;
+  skip_ws(n);
+  if (n->p < n->end && *n->p == '}') {
+    n->p++;
+    emit(n, "{}", 2);
+    return 0;
+  }
+
+  emit(n, "{", 1);
+  size_t base = n->members_len;
+  size_t body_start = n->len;
+  for (size_t index = 0;; index++) {
+    skip_ws(n);
+    member_t member = {0};
+    if (n->p >= n->end || *n->p != '"' || scan_string(n, &member.key, &member.key_len) != 0) {
+      return -1;
+    }
+    skip_ws(n);
+    if (n->p >= n->end || *n->p != ':') {
+      return -1;
+    }
+    n->p++;
+
+    emit_break(n, index == 0, depth + 1);
+    member.index = index;
+    member.out_start = n->len;
+    emit(n, member.key, member.key_len);
+    emit(n, ": ", 2);
+    if (normalize_value(n, depth + 1) != 0) {
+      return -1;
+    }
+    member.out_len = n->len - member.out_start;
+    if (push_member(n, &member) != 0) {
+      return -1;
+    }
+
+    skip_ws(n);
+    if (n->p < n->end && *n->p == ',') {
+      n->p++;
+      continue;
+    }
+    if (n->p < n->end && *n->p == '}') {
+      n->p++;
+      break;
+    }
+    return -1;
+  }
+
+  int rc = sort_members(n, base, body_start, depth + 1);
+  n->members_len = base;
+  emit_break(n, 1, depth);
+  emit(n, "}", 1);
+  return rc;
+}
+
+static int normalize_array(normalizer_t *n, int depth) {
+  n->p++;
+  skip_ws(n);
+  if (n->p < n->end && *n->p == ']') {
+    n->p++;
+    emit(n, "[]", 2);
+    return 0;
+  }
+
+  emit(n, "[", 1);
+  for (int first = 1;; first = 0) {
+    emit_break(n, first, depth + 1);
+    if (normalize_value(n, depth + 1) != 0) {
+      return -1;
+    }
+    skip_ws(n);
+    if (n->p < n->end && *n->p == ',') {
+      n->p++;
+      continue;
+    }
+    if (n->p < n->end && *n->p == ']') {
+      n->p++;
+      break;
+    }
+    return -1;
+  }
+  emit_break(n, 1, depth);
+  emit(n, "]", 1);
+  return 0;
+}
+
+static int normalize_value(normalizer_t *n, int depth) {
+  if (depth > TUIMAN_JSON_MAX_DEPTH || n->failed) {
+    return -1;
+  }
+  skip_ws(n);
+  if (n->p >= n->end) {
+    return -1;
+  }
+  switch (*n->p) {
+  case '{':
+    return normalize_object(n, depth);
+  case '[':
+    return normalize_array(n, depth);
+  case '"': {
+    const char *start = NULL;
+    size_t len = 0;
+    if (scan_string(n, &start, &len) != 0) {
+      return -1;
+    }
+    emit(n, start, len);
+    return 0;
+  }
+  case 't':
+    return scan_literal(n, "true");
+  case 'f':
+    return scan_literal(n, "false");
+  case 'n':
+    return scan_literal(n, "null");
+  default:
+    return scan_number(n);
+  }
+}
+
+char *json_normalize(const char *text, size_t len, size_t *out_len) {
+  if (text == NULL) {
+    return NULL;
+  }
+  normalizer_t n = {0};
+  n.p = text;
+  n.end = text + len;
+
+  int rc = normalize_value(&n, 0);
+  skip_ws(&n);
+  if (rc != 0 || n.failed || n.p != n.end || reserve(&n, 0) != 0) {
+    free(n.out);
+    n.out = NULL;
+  } else {
+    n.out[n.len] = '\0';
+    if (out_len != NULL) {
+      *out_len = n.len;
+    }
+  }
+  free(n.members);
+  free(n.scratch);
+  return n.out;
+}
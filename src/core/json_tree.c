@@ -0,0 +1,364 @@
+#include "tuiman/json_tree.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NONE UINT32_MAX
+
+static int is_ws(char c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static char structural_at(const json_index_t *ix, uint32_t i) {
+  return ix->text[ix->pos[i]];
+}
+
+static size_t value_start(const json_index_t *ix, uint32_t sep) {
+  size_t p = sep == JSON_TREE_ROOT ? 0 : (size_t)ix->pos[sep] + 1;
+  while (p < ix->len && is_ws(ix->text[p])) {
+    p++;
+  }
+  return p;
+}
+
+/* The structural that opens the value after `sep`, or NONE for a scalar. */
+static uint32_t value_open(const json_index_t *ix, uint32_t sep) {
+  size_t start = value_start(ix, sep);
+  if (start >= ix->len || (ix->text[start] != '{' && ix->text[start] != '[')) {
+    return NONE;
+  }
+  return sep == JSON_TREE_ROOT ? 0 : sep + 1;
+}
+
+/* The first structural after the value: ',' or the parent's closing bracket (`count` after a top-level scalar). */
+static uint32_t value_end(const json_index_t *ix, uint32_t sep) {
+  uint32_t open = value_open(ix, sep);
+  if (open != NONE) {
+    return ix->match[open] + 1;
+  }
+  return sep == JSON_TREE_ROOT ? (uint32_t)ix->count : sep + 1;
+}
+
+/* `sep` of the first member or element of the container opened at `open`, or NONE when it is empty. */
+static uint32_t first_child(const json_index_t *ix, uint32_t open) {
+  if (structural_at(ix, open) == '{') {
+    return structural_at(ix, open + 1) == ':' ? open + 1 : NONE;
+  }
+  size_t start = value_start(ix, open);
+  char next = structural_at(ix, open + 1);
+  return start < ix->pos[open + 1] || next == '{' || next == '[' ? open : NONE;
+}
+
+static uint32_t next_child(const json_index_t *ix, uint32_t open, uint32_t sep) {
+  uint32_t after = value_end(ix, sep);
+  if (structural_at(ix, after) != ',') {
+    return NONE;
+  }
+  /* In an object the value follows the ':' after the next key. */
+  return structural_at(ix, open) == '{' ? after + 1 : after;
+}
+
+static uint32_t count_children(const json_index_t *ix, uint32_t open) {
+  uint32_t n = 0;
+  for (uint32_t sep = first_child(ix, open); sep != NONE; sep = next_child(ix, open, sep)) {
+    n++;
+  }
+  return n;
+}
+
+static json_row_t make_row(const json_index_t *ix, uint32_t sep, uint32_t index, uint32_t depth) {
+  json_row_t row;
+  memset(&row, 0, sizeof(row));
+  row.sep = sep;
+  row.index = index;
+  row.depth = depth;
+  size_t start = value_start(ix, sep);
+  char c = start < ix->len ? ix->text[start] : '\0';
+  if (c == '{' || c == '[') {
+    row.kind = c == '{' ? JSON_NODE_OBJECT : JSON_NODE_ARRAY;
+    row.children = count_children(ix, value_open(ix, sep));
+  } else if (c == '"') {
+    row.kind = JSON_NODE_STRING;
+  } else if (c == '-' || (c >= '0' && c <= '9')) {
+    row.kind = JSON_NODE_NUMBER;
+  } else {
+    row.kind = JSON_NODE_LITERAL;
+  }
+  return row;
+}
+
+int json_tree_open(json_tree_t *tree, const char *text, size_t len, char *error, size_t error_len) {
+  memset(tree, 0, sizeof(*tree));
+  if (json_index_build(text, len, &tree->index, error, error_len) != 0) {
+    return -1;
+  }
+  size_t start = value_start(&tree->index, JSON_TREE_ROOT);
+  if (start >= len || (tree->index.count > 0 && tree->index.pos[0] != start)) {
+    snprintf(error, error_len, start >= len ? "empty body" : "unexpected text before '%c' at byte %u",
+             tree->index.count > 0 ? structural_at(&tree->index, 0) : ' ',
+             tree->index.count > 0 ? (unsigned)tree->index.pos[0] : 0u);
+    json_tree_free(tree);
+    return -1;
+  }
+  tree->rows = malloc(sizeof(json_row_t));
+  if (tree->rows == NULL) {
+    snprintf(error, error_len, "out of memory");
+    json_tree_free(tree);
+    return -1;
+  }
+  tree->rows_cap = 1;
+  tree->rows_len = 1;
+  tree->rows[0] = make_row(&tree->index, JSON_TREE_ROOT, 0, 0);
+  json_tree_expand(tree, 0);
+  return 0;
+}
+
+void json_tree_free(json_tree_t *tree) {
+  json_index_free(&tree->index);
+  free(tree->rows);
+  memset(tree, 0, sizeof(*tree));
+}
+
+int json_tree_expand(json_tree_t *tree, size_t row) {
+  json_row_t *r = &tree->rows[row];
+  if ((r->kind != JSON_NODE_OBJECT && r->kind != JSON_NODE_ARRAY) || r->expanded) {
+    return 0;
+  }
+  size_t n = r->children;
+  if (tree->rows_len + n > tree->rows_cap) {
+    size_t cap = tree->rows_cap * 2 > tree->rows_len + n ? tree->rows_cap * 2 : tree->rows_len + n;
+    json_row_t *grown = realloc(tree->rows, cap * sizeof(*grown));
+    if (grown == NULL) {
+      return -1;
+    }
+    tree->rows = grown;
+    tree->rows_cap = cap;
+    r = &tree->rows[row];
+  }
+  memmove(&tree->rows[row + 1 + n], &tree->rows[row + 1], (tree->rows_len - row - 1) * sizeof(json_row_t));
+  const json_index_t *ix = &tree->index;
+  uint32_t open = value_open(ix, r->sep);
+  uint32_t i = 0;
+  for (uint32_t sep = first_child(ix, open); sep != NONE && i < n; sep = next_child(ix, open, sep), i++) {
+    tree->rows[row + 1 + i] = make_row(ix, sep, i, r->depth + 1);
+  }
+  tree->rows_len += n;
+  r->expanded = 1;
+  return 0;
+}
+
+void json_tree_collapse(json_tree_t *tree, size_t row) {
+  json_row_t *r = &tree->rows[row];
+  if (!r->expanded) {
+    return;
+  }
+  size_t end = row + 1;
+  while (end < tree->rows_len && tree->rows[end].depth > r->depth) {
+    end++;
+  }
+  memmove(&tree->rows[row + 1], &tree->rows[end], (tree->rows_len - end) * sizeof(json_row_t));
+  tree->rows_len -= end - row - 1;
+  r->expanded = 0;
+}
+
+size_t json_tree_parent(const json_tree_t *tree, size_t row) {
+  uint32_t depth = tree->rows[row].depth;
+  if (depth == 0) {
+    return SIZE_MAX;
+  }
+  while (row > 0 && tree->rows[row].depth >= depth) {
+    row--;
+  }
+  return row;
+}
+
+int json_tree_key(const json_tree_t *tree, size_t row, size_t *start, size_t *len) {
+  const json_index_t *ix = &tree->index;
+  uint32_t sep = tree->rows[row].sep;
+  if (sep == JSON_TREE_ROOT || structural_at(ix, sep) != ':') {
+    return -1;
+  }
+  size_t from = (size_t)ix->pos[sep - 1] + 1;
+  size_t to = ix->pos[sep];
+  while (from < to && is_ws(ix->text[from])) {
+    from++;
+  }
+  while (to > from && is_ws(ix->text[to - 1])) {
+    to--;
+  }
+  *start = from;
+  *len = to - from;
+  return 0;
+}
+
+void json_tree_value(const json_tree_t *tree, size_t row, size_t *start, size_t *len) {
+  const json_index_t *ix = &tree->index;
+  uint32_t sep = tree->rows[row].sep;
+  size_t from = value_start(ix, sep);
+  uint32_t open = value_open(ix, sep);
+  size_t to = 0;
+  if (open != NONE) {
+    to = (size_t)ix->pos[ix->match[open]] + 1;
+  } else {
+    uint32_t end = value_end(ix, sep);
+    to = end < ix->count ? ix->pos[end] : ix->len;
+    while (to > from && is_ws(ix->text[to - 1])) {
+      to--;
+    }
+  }
+  *start = from;
+  *len = to - from;
+}
+
+static int is_identifier(const char *s, size_t len) {
+  if (len == 0 || (s[0] >= '0' && s[0] <= '9')) {
+    return 0;
+  }
+  for (size_t i = 0; i < len; i++) {
+    char c = s[i];
+    if (!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c == '$')) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+void json_tree_path(const json_tree_t *tree, size_t row, char *out, size_t out_len) {
+  if (out_len == 0) {
+    return;
+  }
+  size_t depth = tree->rows[row].depth;
+  size_t *chain = malloc((depth + 1) * sizeof(size_t));
+  if (chain == NULL) {
+    snprintf(out, out_len, "$");
+    return;
+  }
+  for (size_t i = depth + 1, r = row; i > 0; i--) {
+    chain[i - 1] = r;
+    r = json_tree_parent(tree, r);
+  }
+  size_t used = (size_t)snprintf(out, out_len, "$");
+  for (size_t i = 1; i <= depth && used < out_len; i++) {
+    size_t start = 0;
+    size_t len = 0;
+    if (json_tree_key(tree, chain[i], &start, &len) != 0) {
+      used += (size_t)snprintf(out + used, out_len - used, "[%u]", tree->rows[chain[i]].index);
+    } else if (len >= 2 && is_identifier(tree->index.text + start + 1, len - 2)) {
+      used += (size_t)snprintf(out + used, out_len - used, ".%.*s", (int)(len - 2), tree->index.text + start + 1);
+    } else {
+      used += (size_t)snprintf(out + used, out_len - used, "[%.*s]", (int)len, tree->index.text + start);
+    }
+  }
+  free(chain);
+}
+
+/* The child of `row` named `name` (raw, without quotes) or, when `name` is NULL, at `index`. */
+static int find_child(json_tree_t *tree, size_t row, const char *name, size_t name_len, size_t index, size_t *out) {
+  if (json_tree_expand(tree, row) != 0) {
+    return -1;
+  }
+  uint32_t depth = tree->rows[row].depth;
+  for (size_t r = row + 1; r < tree->rows_len && tree->rows[r].depth > depth; r++) {
+    if (tree->rows[r].depth != depth + 1) {
+      continue;
+    }
+    size_t start = 0;
+    size_t len = 0;
+    int keyed = json_tree_key(tree, r, &start, &len) == 0;
+    if (name == NULL ? !keyed && tree->rows[r].index == index
+                     : keyed && len == name_len + 2 && memcmp(tree->index.text + start + 1, name, name_len) == 0) {
+      *out = r;
+      return 0;
+    }
+  }
+  return -1;
+}
+
+/* One path step: a key, or an index when the current value is an array and `step` is all digits. */
+static int find_step(json_tree_t *tree, size_t row, const char *step, size_t len, int quoted, size_t *out) {
+  if (!quoted && tree->rows[row].kind == JSON_NODE_ARRAY) {
+    size_t index = 0;
+    for (size_t i = 0; i < len; i++) {
+      if (step[i] < '0' || step[i] > '9') {
+        return -1;
+      }
+      index = index * 10 + (size_t)(step[i] - '0');
+    }
+    return len > 0 ? find_child(tree, row, NULL, 0, index, out) : -1;
+  }
+  if (tree->rows[row].kind != JSON_NODE_OBJECT) {
+    return -1;
+  }
+  return find_child(tree, row, step, len, 0, out);
+}
+
+int json_tree_find(json_tree_t *tree, const char *path, size_t *row) {
+  *row = 0;
+  const char *p = path;
+  if (*p == '$') {
+    p++;
+  }
+  if (*p == '/') {
+    /* JSON pointer: "/"-separated tokens with ~1 for '/' and ~0 for '~'. */
+    while (*p == '/') {
+      p++;
+      char token[1024];
+      size_t len = 0;
+      while (*p != '\0' && *p != '/' && len < sizeof(token)) {
+        if (p[0] == '~' && (p[1] == '0' || p[1] == '1')) {
+          token[len++] = p[1] == '0' ? '~' : '/';
+          p += 2;
+        } else {
+          token[len++] = *p++;
+        }
+      }
+      if (find_step(tree, *row, token, len, 0, row) != 0) {
+        return -1;
+      }
+    }
+    return *p == '\0' ? 0 : -1;
+  }
+  while (*p != '\0') {
+    const char *step = p;
+    size_t len = 0;
+    int quoted = 0;
+    if (*p == '[' && p[1] == '"') {
+      step = p + 2;
+      const char *q = step;
+      while (*q != '\0' && *q != '"') {
+        q += q[0] == '\\' && q[1] != '\0' ? 2 : 1;
+      }
+      if (q[0] != '"' || q[1] != ']') {
+        return -1;
+      }
+      len = (size_t)(q - step);
+      quoted = 1;
+      p = q + 2;
+    } else if (*p == '[') {
+      step = p + 1;
+      const char *q = strchr(step, ']');
+      if (q == NULL) {
+        return -1;
+      }
+      len = (size_t)(q - step);
+      p = q + 1;
+    } else {
+      if (*p == '.') {
+        p++;
+      }
+      step = p;
+      while (*p != '\0' && *p != '.' && *p != '[') {
+        p++;
+      }
+      len = (size_t)(p - step);
+      if (len == 0) {
+        return -1;
+      }
+    }
+    if (find_step(tree, *row, step, len, quoted, row) != 0) {
+      return -1;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,407 @@
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE /* copy_file_range, memrchr */
+#endif
+
+#include "tuiman/pager.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <sys/sendfile.h>
+#endif
+
+#include "tuiman/text_width.h"
+
+#define BINARY_SAMPLE 8192
+/* A jump this close past the counted part is counted on the spot rather than shown with an unknown line. */
+#define SCAN_AHEAD_BYTES (16u * 1024u * 1024u)
+
+/* The last newline in [from, to), or NULL. */
+static const char *last_newline(const pager_t *pager, size_t from, size_t to) {
+#if defined(__linux__)
+  return memrchr(pager->data + from, '\n', to - from);
+#else
+  while (to > from) {
+    if (pager->data[--to] == '\n') {
+      return pager->data + to;
+    }
+  }
+  return NULL;
+#endif
+}
+
+/*
+ * Start of the row holding `pos`. Rows are lines, except that a line which
+ * has already run PAGER_LONG_ROW bytes also starts a row at every multiple of
+ * PAGER_LONG_ROW, so no row search looks more than two of those back.
+ */
+static size_t line_start_of(const pager_t *pager, size_t pos) {
+  size_t aligned = pos / PAGER_LONG_ROW * PAGER_LONG_ROW;
+  const char *nl = last_newline(pager, aligned, pos);
+  if (nl != NULL) {
+    return (size_t)(nl - pager->data) + 1;
+  }
+  if (aligned == 0) {
+    return 0;
+  }
+  nl = last_newline(pager, aligned - PAGER_LONG_ROW, aligned);
+  return nl != NULL ? (size_t)(nl - pager->data) + 1 : aligned;
+}
+
+static size_t last_hex_row(const pager_t *pager) {
+  return pager->len > 0 ? (pager->len - 1) / PAGER_HEX_ROW * PAGER_HEX_ROW : 0;
+}
+
+void pager_init(pager_t *pager, const char *data, size_t len) {
+  memset(pager, 0, sizeof(*pager));
+  pager->data = data;
+  pager->len = len;
+  pager->hex = pager_looks_binary(data, len);
+  pager->line_known = 1;
+  size_t end = len > 0 && data[len - 1] == '\n' ? len - 1 : len;
+  pager->last_start = line_start_of(pager, end);
+}
+
+void pager_free(pager_t *pager) {
+  free(pager->marks);
+  memset(pager, 0, sizeof(*pager));
+}
+
+int pager_looks_binary(const char *data, size_t len) {
+  size_t sample = len < BINARY_SAMPLE ? len : BINARY_SAMPLE;
+  size_t odd = 0;
+  size_t pos = 0;
+  while (pos < sample) {
+    unsigned char c = (unsigned char)data[pos];
+    if (c == 0) {
+      return 1;
+    }
+    if (c < 0x80) {
+      if ((c < 0x20 && c != '\t' && c != '\n' && c != '\r' && c != '\f' && c != 0x1b) || c == 0x7f) {
+        odd++;
+      }
+      pos++;
+      continue;
+    }
+    uint32_t cp = 0;
+    pos += text_decode(data + pos, sample - pos, &cp);
+    /* A sequence cut off by the sample boundary is not evidence of anything. */
+    if (cp == TEXT_CP_INVALID && pos < sample) {
+      odd++;
+    }
+  }
+  return odd * 32 > sample;
+}
+
+/* Counts newlines from the frontier until it reaches `line` or passes `offset`, marking as it goes. */
+static void scan(pager_t *pager, size_t offset, size_t line) {
+  if (pager->marks_len == 0) {
+    pager->marks = malloc(16 * sizeof(size_t));
+    if (pager->marks == NULL) {
+      return;
+    }
+    pager->marks_cap = 16;
+    pager->marks[0] = 0;
+    pager->marks_len = 1;
+  }
+  while (!pager->scanned_all && pager->scanned_line < line && pager->scanned < offset) {
+    const char *nl = memchr(pager->data + pager->scanned, '\n', pager->len - pager->scanned);
+    if (nl == NULL) {
+      pager->scanned_all = 1;
+      break;
+    }
+    if ((pager->scanned_line + 1) % PAGER_MARK_LINES == 0 && pager->marks_len == pager->marks_cap) {
+      size_t *next = realloc(pager->marks, pager->marks_cap * 2 * sizeof(size_t));
+      if (next == NULL) {
+        break;
+      }
+      pager->marks = next;
+      pager->marks_cap *= 2;
+    }
+    pager->scanned = (size_t)(nl - pager->data) + 1;
+    pager->scanned_line++;
+    if (pager->scanned_line % PAGER_MARK_LINES == 0) {
+      pager->marks[pager->marks_len++] = pager->scanned;
+    }
+    if (pager->scanned == pager->len) {
+      pager->scanned_all = 1;
+    }
+  }
+}
+
+/* The line number of line start `pos`, if newlines before it have been (or are cheaply) counted. */
+static int line_of(pager_t *pager, size_t pos, size_t *line) {
+  if (pos <= pager->scanned || pos - pager->scanned <= SCAN_AHEAD_BYTES) {
+    scan(pager, pos, SIZE_MAX);
+  }
+  if (pos > pager->scanned || pager->marks_len == 0) {
+    return -1;
+  }
+  size_t lo = 0;
+  size_t hi = pager->marks_len - 1;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo + 1) / 2;
+    if (pager->marks[mid] <= pos) {
+      lo = mid;
+    } else {
+      hi = mid - 1;
+    }
+  }
+  size_t at = pager->marks[lo];
+  size_t n = lo * PAGER_MARK_LINES;
+  while (at < pos) {
+    const char *nl = memchr(pager->data + at, '\n', pos - at);
+    if (nl == NULL) {
+      break;
+    }
+    at = (size_t)(nl - pager->data) + 1;
+    n++;
+  }
+  *line = n;
+  return 0;
+}
+
+/* Start of the line after `start`, ignoring rows; `len` after the last. */
+static size_t next_line_start(const pager_t *pager, size_t start) {
+  const char *nl = memchr(pager->data + start, '\n', pager->len - start);
+  return nl != NULL ? (size_t)(nl - pager->data) + 1 : pager->len;
+}
+
+size_t pager_next_line(const pager_t *pager, size_t start) {
+  size_t aligned = (start / PAGER_LONG_ROW + 1) * PAGER_LONG_ROW;
+  size_t limit = aligned < pager->len ? aligned : pager->len;
+  const char *nl = memchr(pager->data + start, '\n', limit - start);
+  if (nl != NULL) {
+    return (size_t)(nl - pager->data) + 1;
+  }
+  if (limit == pager->len) {
+    return pager->len;
+  }
+  /* `aligned` starts a row only if the line was already PAGER_LONG_ROW bytes long there. */
+  if (last_newline(pager, aligned - PAGER_LONG_ROW, start) == NULL) {
+    return aligned;
+  }
+  limit = aligned + PAGER_LONG_ROW < pager->len ? aligned + PAGER_LONG_ROW : pager->len;
+  nl = memchr(pager->data + aligned, '\n', limit - aligned);
+  return nl != NULL ? (size_t)(nl - pager->data) + 1 : limit;
+}
+
+size_t pager_line_end(const pager_t *pager, size_t start) {
+  size_t end = pager_next_line(pager, start);
+  if (end > start && pager->data[end - 1] == '\n') {
+    end--;
+    if (end > start && pager->data[end - 1] == '\r') {
+      end--;
+    }
+  }
+  return end;
+}
+
+size_t pager_column_offset(const pager_t *pager, size_t start, size_t end, size_t column) {
+  size_t pos = start;
+  size_t columns = 0;
+  while (pos < end && columns < column) {
+    size_t run = text_ascii_run(pager->data + pos, end - pos);
+    if (run > column - columns) {
+      run = column - columns;
+    }
+    pos += run;
+    columns += run;
+    if (pos >= end || columns >= column) {
+      break;
+    }
+    uint32_t cp = 0;
+    pos += text_decode(pager->data + pos, end - pos, &cp);
+    columns += (size_t)text_codepoint_width(cp);
+  }
+  /* Never start a row inside a character's combining marks. */
+  while (pos < end && (unsigned char)pager->data[pos] >= 0x80) {
+    uint32_t cp = 0;
+    size_t used = text_decode(pager->data + pos, end - pos, &cp);
+    if (text_codepoint_width(cp) != 0 || cp == TEXT_CP_INVALID) {
+      break;
+    }
+    pos += used;
+  }
+  return pos;
+}
+
+void pager_scroll(pager_t *pager, long rows) {
+  if (pager->hex) {
+    size_t step = (size_t)(rows < 0 ? -rows : rows) * PAGER_HEX_ROW;
+    if (rows < 0) {
+      pager->top = pager->top > step ? pager->top - step : 0;
+    } else {
+      size_t last = last_hex_row(pager);
+      pager->top = last - pager->top > step ? pager->top + step : last;
+    }
+    return;
+  }
+  /* top_line counts lines, so only rows that begin a line move it. */
+  for (; rows > 0 && pager->top < pager->last_start; rows--) {
+    pager->top = pager_next_line(pager, pager->top);
+    pager->top_line += pager->data[pager->top - 1] == '\n';
+  }
+  for (; rows < 0 && pager->top > 0; rows++) {
+    pager->top_line -= pager->data[pager->top - 1] == '\n';
+    pager->top = line_start_of(pager, pager->top - 1);
+  }
+  if (pager->top == 0) {
+    pager->top_line = 0;
+    pager->line_known = 1;
+  }
+}
+
+void pager_set_hex(pager_t *pager, int hex) {
+  size_t top = pager->top;
+  pager->hex = hex;
+  pager_goto_offset(pager, top);
+}
+
+int pager_goto_line(pager_t *pager, size_t line) {
+  scan(pager, SIZE_MAX, line);
+  size_t pos = 0;
+  size_t n = 0;
+  if (line >= pager->scanned_line) {
+    pos = pager->scanned;
+    n = pager->scanned_line;
+  } else if (pager->marks_len > 0) {
+    pos = pager->marks[line / PAGER_MARK_LINES];
+    n = line / PAGER_MARK_LINES * PAGER_MARK_LINES;
+  }
+  while (n < line && pos < pager->last_start) {
+    pos = next_line_start(pager, pos);
+    n++;
+  }
+  /* The empty "line" after a trailing newline is not shown. */
+  if (pos > pager->last_start) {
+    pos = pager->last_start;
+    n--;
+  }
+  pager->top = pager->hex ? pos / PAGER_HEX_ROW * PAGER_HEX_ROW : pos;
+  pager->top_line = n;
+  pager->line_known = 1;
+  return n == line ? 0 : -1;
+}
+
+void pager_goto_offset(pager_t *pager, size_t offset) {
+  if (offset >= pager->len) {
+    offset = pager->len > 0 ? pager->len - 1 : 0;
+  }
+  if (pager->hex) {
+    pager->top = offset / PAGER_HEX_ROW * PAGER_HEX_ROW;
+    return;
+  }
+  pager->top = offset > pager->last_start ? pager->last_start : line_start_of(pager, offset);
+  pager->line_known = line_of(pager, pager->top, &pager->top_line) == 0;
+}
+
+void pager_goto_percent(pager_t *pager, unsigned percent) {
+  if (percent > 100) {
+    percent = 100;
+  }
+  pager_goto_offset(pager, pager->len / 100 * percent + pager->len % 100 * percent / 100);
+}
+
+void pager_goto_end(pager_t *pager, int rows) {
+  if (pager->hex) {
+    pager->top = last_hex_row(pager);
+  } else {
+    pager->top = pager->last_start;
+    pager->line_known = line_of(pager, pager->top, &pager->top_line) == 0;
+  }
+  pager_scroll(pager, rows > 1 ? -(long)(rows - 1) : 0);
+}
+
+int pager_line_count(const pager_t *pager, size_t *count) {
+  if (!pager->scanned_all) {
+    return -1;
+  }
+  *count = pager->scanned == pager->len ? pager->scanned_line : pager->scanned_line + 1;
+  return 0;
+}
+
+void pager_hex_row(const pager_t *pager, size_t offset, char *out, size_t out_len) {
+  static const char digits[] = "0123456789abcdef";
+  int width = 8;
+  while (width < 16 && (pager->len >> (4 * width)) != 0) {
+    width++;
+  }
+  char line[160];
+  int used = snprintf(line, sizeof(line), "%0*zx  ", width, offset);
+  size_t n = pager->len - offset < PAGER_HEX_ROW ? pager->len - offset : PAGER_HEX_ROW;
+  char *hex = line + used;
+  for (size_t i = 0; i < PAGER_HEX_ROW; i++) {
+    unsigned char c = i < n ? (unsigned char)pager->data[offset + i] : 0;
+    *hex++ = i < n ? digits[c >> 4] : ' ';
+    *hex++ = i < n ? digits[c & 15] : ' ';
+    *hex++ = ' ';
+    if (i == PAGER_HEX_ROW / 2 - 1) {
+      *hex++ = ' ';
+    }
+  }
+  *hex++ = ' ';
+  *hex++ = '|';
+  for (size_t i = 0; i < n; i++) {
+    unsigned char c = (unsigned char)pager->data[offset + i];
+    *hex++ = c >= 0x20 && c < 0x7f ? (char)c : '.';
+  }
+  *hex++ = '|';
+  *hex = '\0';
+  snprintf(out, out_len, "%s", line);
+}
+
+int pager_save(const char *data, size_t len, int source_fd, const char *path, char *error, size_t error_len) {
+  int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    snprintf(error, error_len, "%s: %s", path, strerror(errno));
+    return -1;
+  }
+  size_t done = 0;
+#if defined(__linux__)
+  if (source_fd >= 0) {
+    loff_t in = 0;
+    while (done < len) {
+      ssize_t n = copy_file_range(source_fd, &in, fd, NULL, len - done, 0);
+      if (n <= 0) {
+        break;
+      }
+      done += (size_t)n;
+    }
+    /* Older kernels and some file systems refuse copy_file_range; sendfile handles file to file since 2.6.33. */
+    off_t offset = (off_t)done;
+    while (done < len) {
+      ssize_t n = sendfile(fd, source_fd, &offset, len - done);
+      if (n <= 0) {
+        break;
+      }
+      done += (size_t)n;
+    }
+  }
+#else
+  (void)source_fd;
+#endif
+  while (done < len) {
+    ssize_t n = write(fd, data + done, len - done);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      snprintf(error, error_len, "%s: %s", path, strerror(n < 0 ? errno : EIO));
+      close(fd);
+      return -1;
+    }
+    done += (size_t)n;
+  }
+  if (close(fd) != 0) {
+    snprintf(error, error_len, "%s: %s", path, strerror(errno));
+    return -1;
+  }
+  return 0;
+}
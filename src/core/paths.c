@@ -7,7 +7,7 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 
-static int ensure_dir(const char *path) {
+int paths_ensure_dir(const char *path) {
   char tmp[PATH_MAX];
   size_t len = strlen(path);
   if (len == 0 || len >= sizeof(tmp)) {
@@ -56,20 +56,35 @@ int paths_init(app_paths_t *out) {
   if (snprintf(out->requests_dir, sizeof(out->requests_dir), "%s/requests", out->config_dir) < 0) {
     return -1;
   }
+  if (snprintf(out->requests_db, sizeof(out->requests_db), "%s/requests.db", out->config_dir) < 0) {
+    return -1;
+  }
+  if (snprintf(out->environments_dir, sizeof(out->environments_dir), "%s/environments", out->config_dir) < 0) {
+    return -1;
+  }
+  if (snprintf(out->workflows_dir, sizeof(out->workflows_dir), "%s/workflows", out->config_dir) < 0) {
+    return -1;
+  }
   if (snprintf(out->history_db, sizeof(out->history_db), "%s/history.db", out->state_dir) < 0) {
     return -1;
   }
 
-  if (ensure_dir(out->config_dir) != 0) {
+  if (paths_ensure_dir(out->config_dir) != 0) {
+    return -1;
+  }
+  if (paths_ensure_dir(out->state_dir) != 0) {
+    return -1;
+  }
+  if (paths_ensure_dir(out->cache_dir) != 0) {
     return -1;
   }
-  if (ensure_dir(out->state_dir) != 0) {
+  if (paths_ensure_dir(out->requests_dir) != 0) {
     return -1;
   }
-  if (ensure_dir(out->cache_dir) != 0) {
+  if (paths_ensure_dir(out->environments_dir) != 0) {
     return -1;
   }
-  if (ensure_dir(out->requests_dir) != 0) {
+  if (paths_ensure_dir(out->workflows_dir) != 0) {
     return -1;
   }
 
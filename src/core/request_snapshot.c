@@ -0,0 +1,152 @@
+#include "tuiman/request_snapshot.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SNAPSHOT_MAGIC "tuiman-snapshot/1\n"
+
+static const char *field_value(const request_t *req, snapshot_field_t field, const char *environment,
+                               const char *variables) {
+  switch (field) {
+  case SNAPSHOT_NAME:
+    return req->name;
+  case SNAPSHOT_METHOD:
+    return req->method;
+  case SNAPSHOT_URL:
+    return req->url;
+  case SNAPSHOT_ENVIRONMENT:
+    return environment;
+  case SNAPSHOT_VARIABLES:
+    return variables;
+  case SNAPSHOT_HEADERS:
+    return req->headers;
+  case SNAPSHOT_AUTH_TYPE:
+    return req->auth_type;
+  case SNAPSHOT_AUTH_SECRET_REF:
+    return req->auth_secret_ref;
+  case SNAPSHOT_AUTH_KEY_NAME:
+    return req->auth_key_name;
+  case SNAPSHOT_AUTH_LOCATION:
+    return req->auth_location;
+  case SNAPSHOT_AUTH_USERNAME:
+    return req->auth_username;
+  case SNAPSHOT_BODY:
+    return req->body;
+  case SNAPSHOT_FIELD_COUNT:
+    break;
+  }
+  return NULL;
+}
+
+char *request_snapshot_encode(const request_t *req, const char *environment, const char *variables) {
+  size_t lens[SNAPSHOT_FIELD_COUNT];
+  size_t needed = strlen(SNAPSHOT_MAGIC) + 1;
+  for (int i = 0; i < SNAPSHOT_FIELD_COUNT; i++) {
+    const char *value = field_value(req, (snapshot_field_t)i, environment, variables);
+    lens[i] = value != NULL ? strlen(value) : 0;
+    needed += lens[i] + 24; /* length digits, ':' and ',' */
+  }
+
+  char *out = malloc(needed);
+  if (out == NULL) {
+    return NULL;
+  }
+  size_t off = (size_t)snprintf(out, needed, "%s", SNAPSHOT_MAGIC);
+  for (int i = 0; i < SNAPSHOT_FIELD_COUNT; i++) {
+    const char *value = field_value(req, (snapshot_field_t)i, environment, variables);
+    off += (size_t)snprintf(out + off, needed - off, "%zu:", lens[i]);
+    if (lens[i] > 0) {
+      memcpy(out + off, value, lens[i]);
+      off += lens[i];
+    }
+    out[off++] = ',';
+  }
+  out[off] = '\0';
+  return out;
+}
+
+static void decode_legacy(const char *text, request_snapshot_t *out) {
+  static const struct {
+    const char *prefix;
+    snapshot_field_t field;
+  } KEYS[] = {
+      {"name: ", SNAPSHOT_NAME},
+      {"method: ", SNAPSHOT_METHOD},
+      {"url: ", SNAPSHOT_URL},
+      {"auth: ", SNAPSHOT_AUTH_TYPE},
+      {"secret_ref: ", SNAPSHOT_AUTH_SECRET_REF},
+      {"auth_key_name: ", SNAPSHOT_AUTH_KEY_NAME},
+      {"auth_location: ", SNAPSHOT_AUTH_LOCATION},
+      {"auth_username: ", SNAPSHOT_AUTH_USERNAME},
+  };
+  out->legacy = 1;
+
+  const char *p = text;
+  while (*p != '\0') {
+    const char *line_end = p;
+    while (*line_end != '\0' && *line_end != '\n' && *line_end != '\r') {
+      line_end++;
+    }
+    size_t line_len = (size_t)(line_end - p);
+    const char *next = line_end;
+    while (*next == '\n' || *next == '\r') {
+      next++;
+    }
+
+    if (line_len == 5 && strncmp(p, "body:", 5) == 0) {
+      out->fields[SNAPSHOT_BODY].ptr = next;
+      out->fields[SNAPSHOT_BODY].len = strlen(next);
+      return;
+    }
+    if (line_len > 8 && strncmp(p, "header: ", 8) == 0) {
+      /* Header lines are consecutive; the view spans all of them, prefixes included. */
+      snapshot_value_t *headers = &out->fields[SNAPSHOT_HEADERS];
+      if (headers->ptr == NULL) {
+        headers->ptr = p;
+      }
+      headers->len = (size_t)(line_end - headers->ptr);
+    } else {
+      for (size_t i = 0; i < sizeof(KEYS) / sizeof(KEYS[0]); i++) {
+        size_t prefix_len = strlen(KEYS[i].prefix);
+        if (line_len >= prefix_len && strncmp(p, KEYS[i].prefix, prefix_len) == 0) {
+          out->fields[KEYS[i].field].ptr = p + prefix_len;
+          out->fields[KEYS[i].field].len = line_len - prefix_len;
+          break;
+        }
+      }
+    }
+    p = next;
+  }
+}
+
+void request_snapshot_decode(const char *text, request_snapshot_t *out) {
+  memset(out, 0, sizeof(*out));
+  if (text == NULL) {
+    return;
+  }
+  size_t magic_len = strlen(SNAPSHOT_MAGIC);
+  if (strncmp(text, SNAPSHOT_MAGIC, magic_len) != 0) {
+    decode_legacy(text, out);
+    return;
+  }
+
+  const char *end = text + strlen(text);
+  const char *p = text + magic_len;
+  for (int i = 0; i < SNAPSHOT_FIELD_COUNT && *p != '\0'; i++) {
+    char *colon = NULL;
+    unsigned long long len = strtoull(p, &colon, 10);
+    if (colon == p || *colon != ':' || len > (unsigned long long)(end - (colon + 1))) {
+      return;
+    }
+    out->fields[i].ptr = colon + 1;
+    out->fields[i].len = (size_t)len;
+    p = colon + 1 + len;
+    if (*p != ',') {
+      out->fields[i].ptr = NULL;
+      out->fields[i].len = 0;
+      return;
+    }
+    p++;
+  }
+}
@@ -0,0 +1,518 @@
+#include "tuiman/search_index.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NO_DOC UINT32_MAX
+
+typedef struct {
+  char id[TUIMAN_ID_LEN];
+  uint32_t *grams; /* sorted, unique; needed to unlink the document again */
+  uint32_t grams_len;
+  int live;
+  uint32_t row; /* position in the caller's list; see search_candidates_rows */
+} search_doc_t;
+
+/* Open-addressing slot of the trigram table; key 0 is free (trigrams never contain NUL). */
+typedef struct {
+  uint32_t key;
+  uint32_t len;
+  uint32_t cap;
+  uint32_t *docs; /* sorted ascending */
+} posting_t;
+
+struct search_index {
+  search_doc_t *docs;
+  uint32_t docs_len;
+  uint32_t docs_cap;
+  uint32_t *free_slots;
+  uint32_t free_len;
+  uint32_t live;
+  int rows_valid; /* cleared by every put and remove, since those reorder the caller's list */
+
+  /* id -> doc slot, linear probing with backward-shift deletion. */
+  uint32_t *ids;
+  uint32_t ids_cap;
+  uint32_t ids_used;
+
+  posting_t *postings;
+  uint32_t postings_cap;
+  uint32_t postings_used;
+};
+
+static uint32_t hash_id(const char *id) {
+  uint32_t hash = 2166136261u;
+  for (const unsigned char *p = (const unsigned char *)id; *p != '\0'; p++) {
+    hash ^= *p;
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+static uint32_t hash_gram(uint32_t gram) {
+  gram ^= gram >> 16;
+  gram *= 0x7feb352du;
+  gram ^= gram >> 15;
+  gram *= 0x846ca68bu;
+  gram ^= gram >> 16;
+  return gram;
+}
+
+static unsigned char fold(unsigned char c) {
+  return c >= 'A' && c <= 'Z' ? (unsigned char)(c + ('a' - 'A')) : c;
+}
+
+search_index_t *search_index_new(void) {
+  return calloc(1, sizeof(search_index_t));
+}
+
+void search_index_clear(search_index_t *index) {
+  for (uint32_t i = 0; i < index->docs_len; i++) {
+    free(index->docs[i].grams);
+  }
+  for (uint32_t i = 0; i < index->postings_cap; i++) {
+    free(index->postings[i].docs);
+  }
+  free(index->docs);
+  free(index->free_slots);
+  free(index->ids);
+  free(index->postings);
+  memset(index, 0, sizeof(*index));
+}
+
+void search_index_free(search_index_t *index) {
+  if (index == NULL) {
+    return;
+  }
+  search_index_clear(index);
+  free(index);
+}
+
+size_t search_index_len(const search_index_t *index) {
+  return index->live;
+}
+
+static uint32_t id_lookup(const search_index_t *index, const char *id, uint32_t *out_pos) {
+  if (index->ids_cap == 0) {
+    return NO_DOC;
+  }
+  uint32_t mask = index->ids_cap - 1;
+  for (uint32_t pos = hash_id(id) & mask;; pos = (pos + 1) & mask) {
+    uint32_t doc = index->ids[pos];
+    if (doc == NO_DOC) {
+      return NO_DOC;
+    }
+    if (strcmp(index->docs[doc].id, id) == 0) {
+      if (out_pos != NULL) {
+        *out_pos = pos;
+      }
+      return doc;
+    }
+  }
+}
+
+static void id_place(search_index_t *index, uint32_t doc) {
+  uint32_t mask = index->ids_cap - 1;
+  uint32_t pos = hash_id(index->docs[doc].id) & mask;
+  while (index->ids[pos] != NO_DOC) {
+    pos = (pos + 1) & mask;
+  }
+  index->ids[pos] = doc;
+}
+
+static int id_reserve(search_index_t *index) {
+  if ((index->ids_used + 1) * 4 < index->ids_cap * 3) {
+    return 0;
+  }
+  uint32_t cap = index->ids_cap == 0 ? 64 : index->ids_cap * 2;
+  uint32_t *grown = malloc(cap * sizeof(uint32_t));
+  if (grown == NULL) {
+    return -1;
+  }
+  memset(grown, 0xff, cap * sizeof(uint32_t));
+  uint32_t *old = index->ids;
+  uint32_t old_cap = index->ids_cap;
+  index->ids = grown;
+  index->ids_cap = cap;
+  for (uint32_t i = 0; i < old_cap; i++) {
+    if (old[i] != NO_DOC) {
+      id_place(index, old[i]);
+    }
+  }
+  free(old);
+  return 0;
+}
+
+static void id_delete(search_index_t *index, uint32_t pos) {
+  uint32_t mask = index->ids_cap - 1;
+  index->ids[pos] = NO_DOC;
+  index->ids_used--;
+  /* Backward shift: pull later entries of the same probe run into the hole. */
+  for (uint32_t next = (pos + 1) & mask; index->ids[next] != NO_DOC; next = (next + 1) & mask) {
+    uint32_t doc = index->ids[next];
+    uint32_t home = hash_id(index->docs[doc].id) & mask;
+    if (((next - home) & mask) >= ((next - pos) & mask)) {
+      index->ids[pos] = doc;
+      index->ids[next] = NO_DOC;
+      pos = next;
+    }
+  }
+}
+
+static posting_t *posting_find(const search_index_t *index, uint32_t gram) {
+  if (index->postings_cap == 0) {
+    return NULL;
+  }
+  uint32_t mask = index->postings_cap - 1;
+  for (uint32_t pos = hash_gram(gram) & mask;; pos = (pos + 1) & mask) {
+    posting_t *slot = &index->postings[pos];
+    if (slot->key == gram) {
+      return slot;
+    }
+    if (slot->key == 0) {
+      return NULL;
+    }
+  }
+}
+
+static int postings_reserve(search_index_t *index, uint32_t extra) {
+  if ((index->postings_used + extra) * 4 < index->postings_cap * 3) {
+    return 0;
+  }
+  uint32_t cap = index->postings_cap == 0 ? 1024 : index->postings_cap;
+  while ((index->postings_used + extra) * 4 >= cap * 3) {
+    cap *= 2;
+  }
+  posting_t *grown = calloc(cap, sizeof(posting_t));
+  if (grown == NULL) {
+    return -1;
+  }
+  uint32_t mask = cap - 1;
+  for (uint32_t i = 0; i < index->postings_cap; i++) {
+    posting_t *old = &index->postings[i];
+    if (old->key == 0) {
+      continue;
+    }
+    uint32_t pos = hash_gram(old->key) & mask;
+    while (grown[pos].key != 0) {
+      pos = (pos + 1) & mask;
+    }
+    grown[pos] = *old;
+  }
+  free(index->postings);
+  index->postings = grown;
+  index->postings_cap = cap;
+  return 0;
+}
+
+/* Posting lists are never deleted; an emptied list keeps its slot for the next document. */
+static posting_t *posting_get_or_add(search_index_t *index, uint32_t gram) {
+  uint32_t mask = index->postings_cap - 1;
+  uint32_t pos = hash_gram(gram) & mask;
+  while (index->postings[pos].key != 0 && index->postings[pos].key != gram) {
+    pos = (pos + 1) & mask;
+  }
+  posting_t *slot = &index->postings[pos];
+  if (slot->key == 0) {
+    slot->key = gram;
+    index->postings_used++;
+  }
+  return slot;
+}
+
+static size_t lower_bound(const uint32_t *docs, size_t len, uint32_t doc) {
+  size_t lo = 0;
+  size_t hi = len;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (docs[mid] < doc) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+static int posting_add(posting_t *posting, uint32_t doc) {
+  if (posting->len == posting->cap) {
+    uint32_t cap = posting->cap == 0 ? 4 : posting->cap * 2;
+    uint32_t *grown = realloc(posting->docs, cap * sizeof(uint32_t));
+    if (grown == NULL) {
+      return -1;
+    }
+    posting->docs = grown;
+    posting->cap = cap;
+  }
+  /* Fresh slots are the highest so far, so this is an append unless a freed slot was reused. */
+  size_t at = posting->len > 0 && posting->docs[posting->len - 1] > doc ? lower_bound(posting->docs, posting->len, doc)
+                                                                       : posting->len;
+  memmove(&posting->docs[at + 1], &posting->docs[at], (posting->len - at) * sizeof(uint32_t));
+  posting->docs[at] = doc;
+  posting->len++;
+  return 0;
+}
+
+static void posting_remove(posting_t *posting, uint32_t doc) {
+  size_t at = lower_bound(posting->docs, posting->len, doc);
+  if (at < posting->len && posting->docs[at] == doc) {
+    memmove(&posting->docs[at], &posting->docs[at + 1], (posting->len - at - 1) * sizeof(uint32_t));
+    posting->len--;
+  }
+}
+
+static int compare_u32(const void *a, const void *b) {
+  uint32_t x = *(const uint32_t *)a;
+  uint32_t y = *(const uint32_t *)b;
+  return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+static size_t collect_grams(const char *text, uint32_t *out, size_t used) {
+  const unsigned char *p = (const unsigned char *)text;
+  size_t len = strlen(text);
+  for (size_t i = 0; i + 2 < len; i++) {
+    out[used++] = ((uint32_t)fold(p[i]) << 16) | ((uint32_t)fold(p[i + 1]) << 8) | fold(p[i + 2]);
+  }
+  return used;
+}
+
+static size_t sort_unique(uint32_t *grams, size_t len) {
+  if (len == 0) {
+    return 0;
+  }
+  qsort(grams, len, sizeof(uint32_t), compare_u32);
+  size_t kept = 1;
+  for (size_t i = 1; i < len; i++) {
+    if (grams[i] != grams[kept - 1]) {
+      grams[kept++] = grams[i];
+    }
+  }
+  return kept;
+}
+
+static void unlink_doc(search_index_t *index, uint32_t doc) {
+  search_doc_t *d = &index->docs[doc];
+  for (uint32_t i = 0; i < d->grams_len; i++) {
+    posting_t *posting = posting_find(index, d->grams[i]);
+    if (posting != NULL) {
+      posting_remove(posting, doc);
+    }
+  }
+  free(d->grams);
+  d->grams = NULL;
+  d->grams_len = 0;
+}
+
+void search_index_remove(search_index_t *index, const char *request_id) {
+  uint32_t pos = 0;
+  uint32_t doc = id_lookup(index, request_id, &pos);
+  if (doc == NO_DOC) {
+    return;
+  }
+  index->rows_valid = 0;
+  unlink_doc(index, doc);
+  id_delete(index, pos);
+  index->docs[doc].live = 0;
+  index->live--;
+  /* free_slots was sized with docs, so this cannot overflow. */
+  index->free_slots[index->free_len++] = doc;
+}
+
+static uint32_t alloc_doc(search_index_t *index) {
+  if (index->free_len > 0) {
+    return index->free_slots[--index->free_len];
+  }
+  if (index->docs_len == index->docs_cap) {
+    uint32_t cap = index->docs_cap == 0 ? 256 : index->docs_cap * 2;
+    search_doc_t *grown = realloc(index->docs, cap * sizeof(search_doc_t));
+    if (grown == NULL) {
+      return NO_DOC;
+    }
+    index->docs = grown;
+    uint32_t *slots = realloc(index->free_slots, cap * sizeof(uint32_t));
+    if (slots == NULL) {
+      return NO_DOC;
+    }
+    index->free_slots = slots;
+    index->docs_cap = cap;
+  }
+  return index->docs_len++;
+}
+
+int search_index_put(search_index_t *index, const request_t *req) {
+  index->rows_valid = 0;
+  size_t max = strlen(req->name) + strlen(req->url) + strlen(req->headers) + strlen(req->body);
+  uint32_t *grams = malloc((max > 0 ? max : 1) * sizeof(uint32_t));
+  if (grams == NULL) {
+    return -1;
+  }
+  /* Per field, so no trigram spans two fields. */
+  size_t len = collect_grams(req->name, grams, 0);
+  len = collect_grams(req->url, grams, len);
+  len = collect_grams(req->headers, grams, len);
+  len = collect_grams(req->body, grams, len);
+  len = sort_unique(grams, len);
+
+  uint32_t doc = id_lookup(index, req->id, NULL);
+  if (doc != NO_DOC) {
+    unlink_doc(index, doc);
+  } else {
+    if (id_reserve(index) != 0 || (doc = alloc_doc(index)) == NO_DOC) {
+      free(grams);
+      return -1;
+    }
+    memset(&index->docs[doc], 0, sizeof(search_doc_t));
+    snprintf(index->docs[doc].id, sizeof(index->docs[doc].id), "%s", req->id);
+    index->docs[doc].live = 1;
+    id_place(index, doc);
+    index->ids_used++;
+    index->live++;
+  }
+
+  if (postings_reserve(index, (uint32_t)len) != 0) {
+    free(grams);
+    return -1;
+  }
+  for (size_t i = 0; i < len; i++) {
+    if (posting_add(posting_get_or_add(index, grams[i]), doc) != 0) {
+      /* Keep the prefix that made it in, so unlinking stays exact. */
+      len = i;
+      break;
+    }
+  }
+  index->docs[doc].grams = grams;
+  index->docs[doc].grams_len = (uint32_t)len;
+  return 0;
+}
+
+static int compare_posting_len(const void *a, const void *b) {
+  uint32_t x = (*(const posting_t *const *)a)->len;
+  uint32_t y = (*(const posting_t *const *)b)->len;
+  return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+int search_index_query(const search_index_t *index, const char *needle, search_candidates_t *out) {
+  memset(out, 0, sizeof(*out));
+  size_t needle_len = strlen(needle);
+  if (needle_len < 3) {
+    return 0;
+  }
+
+  out->words = ((size_t)index->docs_len + 63) / 64;
+  out->bits = calloc(out->words > 0 ? out->words : 1, sizeof(uint64_t));
+  uint32_t *grams = malloc(needle_len * sizeof(uint32_t));
+  const posting_t **lists = malloc(needle_len * sizeof(posting_t *));
+  if (out->bits == NULL || grams == NULL || lists == NULL) {
+    free(grams);
+    free(lists);
+    search_candidates_free(out);
+    return -1;
+  }
+
+  size_t len = sort_unique(grams, collect_grams(needle, grams, 0));
+  size_t lists_len = 0;
+  for (size_t i = 0; i < len; i++) {
+    const posting_t *posting = posting_find(index, grams[i]);
+    if (posting == NULL || posting->len == 0) {
+      free(grams);
+      free(lists);
+      return 1;
+    }
+    lists[lists_len++] = posting;
+  }
+  free(grams);
+
+  /*
+   * Intersect from the rarest trigram. Every list is walked with a forward
+   * cursor that gallops (doubling steps, then binary search), so the cost
+   * follows the rarest list rather than the longest.
+   */
+  qsort(lists, lists_len, sizeof(lists[0]), compare_posting_len);
+  size_t *cursor = calloc(lists_len, sizeof(size_t));
+  if (cursor == NULL) {
+    free(lists);
+    search_candidates_free(out);
+    return -1;
+  }
+  const posting_t *rarest = lists[0];
+  for (uint32_t i = 0; i < rarest->len; i++) {
+    uint32_t doc = rarest->docs[i];
+    int in_all = 1;
+    for (size_t l = 1; l < lists_len && in_all; l++) {
+      const posting_t *list = lists[l];
+      size_t lo = cursor[l];
+      size_t step = 1;
+      while (lo + step < list->len && list->docs[lo + step] < doc) {
+        lo += step;
+        step *= 2;
+      }
+      size_t hi = lo + step < list->len ? lo + step + 1 : list->len;
+      size_t at = lo + lower_bound(list->docs + lo, hi - lo, doc);
+      cursor[l] = at;
+      in_all = at < list->len && list->docs[at] == doc;
+    }
+    if (in_all) {
+      out->bits[doc / 64] |= (uint64_t)1 << (doc % 64);
+      out->count++;
+    }
+  }
+  free(cursor);
+  free(lists);
+  return 1;
+}
+
+int search_candidates_has(const search_index_t *index, const search_candidates_t *candidates, const char *request_id) {
+  uint32_t doc = id_lookup(index, request_id, NULL);
+  if (doc == NO_DOC || doc / 64 >= candidates->words) {
+    return 0;
+  }
+  return (candidates->bits[doc / 64] >> (doc % 64)) & 1;
+}
+
+static int compare_rows(const void *a, const void *b) {
+  size_t x = *(const size_t *)a;
+  size_t y = *(const size_t *)b;
+  return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+int search_candidates_rows(search_index_t *index, const request_list_t *list, const search_candidates_t *candidates,
+                           size_t **out_rows, size_t *out_len) {
+  *out_rows = NULL;
+  *out_len = 0;
+  if (!index->rows_valid) {
+    for (uint32_t doc = 0; doc < index->docs_len; doc++) {
+      index->docs[doc].row = NO_DOC;
+    }
+    for (size_t i = 0; i < list->len; i++) {
+      uint32_t doc = id_lookup(index, list->items[i].id, NULL);
+      if (doc != NO_DOC) {
+        index->docs[doc].row = (uint32_t)i;
+      }
+    }
+    index->rows_valid = 1;
+  }
+
+  size_t *rows = malloc((candidates->count > 0 ? candidates->count : 1) * sizeof(size_t));
+  if (rows == NULL) {
+    return -1;
+  }
+  size_t len = 0;
+  for (size_t w = 0; w < candidates->words; w++) {
+    for (uint64_t bits = candidates->bits[w]; bits != 0 && len < candidates->count; bits &= bits - 1) {
+      uint32_t doc = (uint32_t)(w * 64 + (size_t)__builtin_ctzll(bits));
+      if (doc < index->docs_len && index->docs[doc].live && index->docs[doc].row != NO_DOC) {
+        rows[len++] = index->docs[doc].row;
+      }
+    }
+  }
+  qsort(rows, len, sizeof(size_t), compare_rows);
+  *out_rows = rows;
+  *out_len = len;
+  return 0;
+}
+
+void search_candidates_free(search_candidates_t *candidates) {
+  free(candidates->bits);
+  memset(candidates, 0, sizeof(*candidates));
+}
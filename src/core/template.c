@@ -0,0 +1,190 @@
+#include "tuiman/template.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+  const char *name;
+  template_generator_t generator;
+} generator_name_t;
+
+static const generator_name_t GENERATORS[] = {
+    {"$counter", TEMPLATE_GEN_COUNTER},
+    {"$random_id", TEMPLATE_GEN_RANDOM_ID},
+    {"$timestamp", TEMPLATE_GEN_TIMESTAMP},
+    {"$iso_timestamp", TEMPLATE_GEN_ISO_TIMESTAMP},
+};
+
+static int push_segment(template_t *tpl, size_t *cap, template_segment_t seg) {
+  if (seg.kind == TEMPLATE_SEGMENT_LITERAL && seg.len == 0) {
+    return 0;
+  }
+  /* Adjacent literals (e.g. around an unterminated "{{") collapse into one. */
+  if (seg.kind == TEMPLATE_SEGMENT_LITERAL && tpl->len > 0) {
+    template_segment_t *last = &tpl->segments[tpl->len - 1];
+    if (last->kind == TEMPLATE_SEGMENT_LITERAL && last->text + last->len == seg.text) {
+      last->len += seg.len;
+      return 0;
+    }
+  }
+  if (tpl->len == *cap) {
+    size_t next = *cap == 0 ? 4 : *cap * 2;
+    template_segment_t *grown = realloc(tpl->segments, next * sizeof(*grown));
+    if (grown == NULL) {
+      return -1;
+    }
+    tpl->segments = grown;
+    *cap = next;
+  }
+  tpl->segments[tpl->len++] = seg;
+  return 0;
+}
+
+static int is_name_char(char c) {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c == '-' ||
+         c == '.' || c == '$';
+}
+
+int template_compile(const char *source, template_t *out) {
+  memset(out, 0, sizeof(*out));
+  size_t cap = 0;
+  const char *p = source;
+  const char *literal = source;
+
+  while ((p = strstr(p, "{{")) != NULL) {
+    const char *name = p + 2;
+    while (*name == ' ') {
+      name++;
+    }
+    const char *end = name;
+    while (is_name_char(*end)) {
+      end++;
+    }
+    const char *close = end;
+    while (*close == ' ') {
+      close++;
+    }
+    if (end == name || strncmp(close, "}}", 2) != 0) {
+      p += 2;
+      continue;
+    }
+
+    template_segment_t lit = {TEMPLATE_SEGMENT_LITERAL, literal, (size_t)(p - literal), TEMPLATE_GEN_COUNTER};
+    if (push_segment(out, &cap, lit) != 0) {
+      template_free(out);
+      return -1;
+    }
+
+    template_segment_t seg = {TEMPLATE_SEGMENT_VARIABLE, name, (size_t)(end - name), TEMPLATE_GEN_COUNTER};
+    if (*name == '$') {
+      for (size_t i = 0; i < sizeof(GENERATORS) / sizeof(GENERATORS[0]); i++) {
+        if (strlen(GENERATORS[i].name) == seg.len && strncmp(GENERATORS[i].name, name, seg.len) == 0) {
+          seg.kind = TEMPLATE_SEGMENT_GENERATOR;
+          seg.generator = GENERATORS[i].generator;
+          break;
+        }
+      }
+    }
+    /* Variables keep the whole "{{ name }}" span so an unresolved one is emitted verbatim. */
+    if (seg.kind == TEMPLATE_SEGMENT_VARIABLE) {
+      seg.text = p;
+      seg.len = (size_t)(close + 2 - p);
+    }
+    if (push_segment(out, &cap, seg) != 0) {
+      template_free(out);
+      return -1;
+    }
+
+    p = close + 2;
+    literal = p;
+  }
+
+  template_segment_t tail = {TEMPLATE_SEGMENT_LITERAL, literal, strlen(literal), TEMPLATE_GEN_COUNTER};
+  if (push_segment(out, &cap, tail) != 0) {
+    template_free(out);
+    return -1;
+  }
+  return 0;
+}
+
+void template_free(template_t *tpl) {
+  free(tpl->segments);
+  tpl->segments = NULL;
+  tpl->len = 0;
+}
+
+void template_iteration_begin(template_iteration_t *it, unsigned long counter) {
+  it->counter = counter;
+  it->now = time(NULL);
+  request_generate_id(it->random_id);
+}
+
+const char *template_variable_name(const template_segment_t *seg, size_t *len) {
+  const char *name = seg->text + 2;
+  while (*name == ' ') {
+    name++;
+  }
+  const char *end = name;
+  while (is_name_char(*end)) {
+    end++;
+  }
+  *len = (size_t)(end - name);
+  return name;
+}
+
+int template_expand(const template_t *tpl, template_lookup_fn lookup, void *ctx, const template_iteration_t *it,
+                    char *out, size_t out_len) {
+  if (out_len == 0) {
+    return -1;
+  }
+
+  size_t used = 0;
+  for (size_t i = 0; i < tpl->len; i++) {
+    const template_segment_t *seg = &tpl->segments[i];
+    const char *text = seg->text;
+    size_t len = seg->len;
+    char scratch[48];
+
+    if (seg->kind == TEMPLATE_SEGMENT_VARIABLE && lookup != NULL) {
+      size_t name_len = 0;
+      const char *name = template_variable_name(seg, &name_len);
+      size_t value_len = 0;
+      const char *value = lookup(ctx, name, name_len, &value_len);
+      if (value != NULL) {
+        text = value;
+        len = value_len;
+      }
+    } else if (seg->kind == TEMPLATE_SEGMENT_GENERATOR) {
+      text = scratch;
+      switch (seg->generator) {
+      case TEMPLATE_GEN_COUNTER:
+        len = (size_t)snprintf(scratch, sizeof(scratch), "%lu", it->counter);
+        break;
+      case TEMPLATE_GEN_RANDOM_ID:
+        text = it->random_id;
+        len = strlen(it->random_id);
+        break;
+      case TEMPLATE_GEN_TIMESTAMP:
+        len = (size_t)snprintf(scratch, sizeof(scratch), "%lld", (long long)it->now);
+        break;
+      case TEMPLATE_GEN_ISO_TIMESTAMP: {
+        struct tm tm_utc;
+        gmtime_r(&it->now, &tm_utc);
+        len = strftime(scratch, sizeof(scratch), "%Y-%m-%dT%H:%M:%SZ", &tm_utc);
+        break;
+      }
+      }
+    }
+
+    if (used + len >= out_len) {
+      out[used] = '\0';
+      return -1;
+    }
+    memcpy(out + used, text, len);
+    used += len;
+  }
+
+  out[used] = '\0';
+  return 0;
+}
@@ -0,0 +1,481 @@
+#include "tuiman/text_diff.h"
+
+#include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tuiman/json_normalize.h"
+
+/* Below this many edits the search is always exact; above it, sqrt(lines) (as in git's xdiff). */
+#define DIFF_MIN_COST 256
+
+struct text_diff {
+  pthread_t thread;
+  pthread_mutex_t lock;
+  atomic_int cancel;
+  int normalize_json;
+  text_diff_side_t sides[2];
+
+  /* Worker-only. */
+  int *ids[2];
+  long *forward;  /* furthest x per diagonal, indexed by diagonal + offset */
+  long *backward;
+  long offset;
+  long max_cost;
+
+  /* Shared, under `lock`. */
+  size_t a_pos; /* lines of each side emitted so far */
+  size_t b_pos;
+  text_diff_block_t *blocks;
+  size_t blocks_len;
+  size_t blocks_cap;
+  size_t lines_added;
+  size_t lines_removed;
+  unsigned long generation;
+  int prepared;
+  int done;
+  int failed;
+  int approximate;
+};
+
+typedef struct {
+  long a;
+  long b;
+  int min_lo;
+  int min_hi;
+} split_t;
+
+static int is_cancelled(text_diff_t *diff) {
+  return atomic_load_explicit(&diff->cancel, memory_order_relaxed) != 0;
+}
+
+static size_t line_length(const text_diff_side_t *side, size_t line) {
+  size_t len = side->line_starts[line + 1] - side->line_starts[line] - 1;
+  if (len > 0 && side->text[side->line_starts[line] + len - 1] == '\r') {
+    len--;
+  }
+  return len;
+}
+
+static int split_lines(text_diff_side_t *side) {
+  size_t count = 0;
+  for (const char *p = side->text; (p = memchr(p, '\n', side->len - (size_t)(p - side->text))) != NULL; p++) {
+    count++;
+  }
+  if (side->len > 0 && side->text[side->len - 1] != '\n') {
+    count++;
+  }
+
+  side->line_starts = malloc((count + 1) * sizeof(size_t));
+  if (side->line_starts == NULL) {
+    return -1;
+  }
+  size_t line = 0;
+  size_t start = 0;
+  while (line < count) {
+    side->line_starts[line++] = start;
+    const char *nl = memchr(side->text + start, '\n', side->len - start);
+    start = nl != NULL ? (size_t)(nl - side->text) + 1 : side->len + 1;
+  }
+  side->line_starts[count] = count > 0 ? start : 0;
+  side->line_count = count;
+  return 0;
+}
+
+static int prepare_side(text_diff_t *diff, text_diff_side_t *side) {
+  if (diff->normalize_json) {
+    size_t i = 0;
+    while (i < side->len && (side->text[i] == ' ' || side->text[i] == '\t' || side->text[i] == '\n' ||
+                             side->text[i] == '\r')) {
+      i++;
+    }
+    if (i < side->len && (side->text[i] == '{' || side->text[i] == '[')) {
+      size_t len = 0;
+      char *normalized = json_normalize(side->text, side->len, &len);
+      if (normalized != NULL) {
+        free(side->text);
+        side->text = normalized;
+        side->len = len;
+        side->json = 1;
+      }
+    }
+  }
+  return split_lines(side);
+}
+
+static uint64_t hash_line(const char *text, size_t len) {
+  uint64_t h = 1469598103934665603ULL;
+  for (size_t i = 0; i < len; i++) {
+    h ^= (unsigned char)text[i];
+    h *= 1099511628211ULL;
+  }
+  return h;
+}
+
+/* Replaces each line with a small integer, equal lines sharing one, so the search compares ints. */
+static int intern_lines(text_diff_t *diff) {
+  typedef struct {
+    uint64_t hash;
+    const char *text;
+    size_t len;
+    int id;
+  } slot_t;
+
+  size_t total = diff->sides[0].line_count + diff->sides[1].line_count;
+  size_t cap = 64;
+  while (cap < total * 2) {
+    cap *= 2;
+  }
+  slot_t *slots = calloc(cap, sizeof(*slots));
+  if (slots == NULL) {
+    return -1;
+  }
+
+  int next_id = 1;
+  for (int s = 0; s < 2; s++) {
+    const text_diff_side_t *side = &diff->sides[s];
+    diff->ids[s] = malloc((side->line_count + 1) * sizeof(int));
+    if (diff->ids[s] == NULL) {
+      free(slots);
+      return -1;
+    }
+    for (size_t line = 0; line < side->line_count; line++) {
+      const char *text = side->text + side->line_starts[line];
+      size_t len = line_length(side, line);
+      uint64_t hash = hash_line(text, len);
+      size_t at = (size_t)hash & (cap - 1);
+      while (slots[at].id != 0 &&
+             (slots[at].hash != hash || slots[at].len != len || memcmp(slots[at].text, text, len) != 0)) {
+        at = (at + 1) & (cap - 1);
+      }
+      if (slots[at].id == 0) {
+        slots[at].hash = hash;
+        slots[at].text = text;
+        slots[at].len = len;
+        slots[at].id = next_id++;
+      }
+      diff->ids[s][line] = slots[at].id;
+    }
+  }
+  free(slots);
+  return 0;
+}
+
+/* Appends `count` lines of one kind, extending the last block when it is of the same kind. */
+static void emit_lines(text_diff_t *diff, int changed, size_t a_count, size_t b_count) {
+  if (a_count == 0 && b_count == 0) {
+    return;
+  }
+  pthread_mutex_lock(&diff->lock);
+  text_diff_block_t *last = diff->blocks_len > 0 ? &diff->blocks[diff->blocks_len - 1] : NULL;
+  if (last == NULL || last->changed != changed) {
+    if (diff->blocks_len == diff->blocks_cap) {
+      size_t cap = diff->blocks_cap > 0 ? diff->blocks_cap * 2 : 64;
+      text_diff_block_t *grown = realloc(diff->blocks, cap * sizeof(*grown));
+      if (grown == NULL) {
+        diff->failed = 1;
+        pthread_mutex_unlock(&diff->lock);
+        atomic_store(&diff->cancel, 1);
+        return;
+      }
+      diff->blocks = grown;
+      diff->blocks_cap = cap;
+    }
+    last = &diff->blocks[diff->blocks_len++];
+    memset(last, 0, sizeof(*last));
+    last->changed = changed;
+    last->a_start = diff->a_pos;
+    last->b_start = diff->b_pos;
+  }
+  last->a_count += a_count;
+  last->b_count += b_count;
+  if (changed) {
+    diff->lines_removed += a_count;
+    diff->lines_added += b_count;
+  }
+  diff->a_pos += a_count;
+  diff->b_pos += b_count;
+  diff->generation++;
+  pthread_mutex_unlock(&diff->lock);
+}
+
+/*
+ * Finds where an optimal path through A[a0,a1) x B[b0,b1) crosses its middle,
+ * searching forward from the top-left and backward from the bottom-right at
+ * once. Past max_cost edits it settles for the furthest-reaching diagonal.
+ */
+static int middle_snake(text_diff_t *diff, long a0, long a1, long b0, long b1, int need_min, split_t *out) {
+  const int *A = diff->ids[0];
+  const int *B = diff->ids[1];
+  long *fwd = diff->forward + diff->offset;
+  long *bwd = diff->backward + diff->offset;
+  long dmin = a0 - b1;
+  long dmax = a1 - b0;
+  long fmid = a0 - b0;
+  long bmid = a1 - b1;
+  int odd = (int)((fmid - bmid) & 1);
+  long fmin = fmid, fmax = fmid;
+  long bmin = bmid, bmax = bmid;
+  fwd[fmid] = a0;
+  bwd[bmid] = a1;
+
+  for (long cost = 1;; cost++) {
+    if (is_cancelled(diff)) {
+      return -1;
+    }
+
+    if (fmin > dmin) {
+      fwd[--fmin - 1] = -1;
+    } else {
+      ++fmin;
+    }
+    if (fmax < dmax) {
+      fwd[++fmax + 1] = -1;
+    } else {
+      --fmax;
+    }
+    for (long d = fmax; d >= fmin; d -= 2) {
+      long x = fwd[d - 1] >= fwd[d + 1] ? fwd[d - 1] + 1 : fwd[d + 1];
+      long y = x - d;
+      while (x < a1 && y < b1 && A[x] == B[y]) {
+        x++;
+        y++;
+      }
+      fwd[d] = x;
+      if (odd && bmin <= d && d <= bmax && bwd[d] <= x) {
+        out->a = x;
+        out->b = y;
+        out->min_lo = out->min_hi = 1;
+        return 0;
+      }
+    }
+
+    if (bmin > dmin) {
+      bwd[--bmin - 1] = LONG_MAX;
+    } else {
+      ++bmin;
+    }
+    if (bmax < dmax) {
+      bwd[++bmax + 1] = LONG_MAX;
+    } else {
+      --bmax;
+    }
+    for (long d = bmax; d >= bmin; d -= 2) {
+      long x = bwd[d - 1] < bwd[d + 1] ? bwd[d - 1] : bwd[d + 1] - 1;
+      long y = x - d;
+      while (x > a0 && y > b0 && A[x - 1] == B[y - 1]) {
+        x--;
+        y--;
+      }
+      bwd[d] = x;
+      if (!odd && fmin <= d && d <= fmax && x <= fwd[d]) {
+        out->a = x;
+        out->b = y;
+        out->min_lo = out->min_hi = 1;
+        return 0;
+      }
+    }
+
+    if (!need_min && cost >= diff->max_cost) {
+      long fbest = -1, fbest_a = -1;
+      for (long d = fmax; d >= fmin; d -= 2) {
+        long x = fwd[d] < a1 ? fwd[d] : a1;
+        long y = x - d;
+        if (y > b1) {
+          x = b1 + d;
+          y = b1;
+        }
+        if (fbest < x + y) {
+          fbest = x + y;
+          fbest_a = x;
+        }
+      }
+      long bbest = LONG_MAX, bbest_a = LONG_MAX;
+      for (long d = bmax; d >= bmin; d -= 2) {
+        long x = bwd[d] > a0 ? bwd[d] : a0;
+        long y = x - d;
+        if (y < b0) {
+          x = b0 + d;
+          y = b0;
+        }
+        if (x + y < bbest) {
+          bbest = x + y;
+          bbest_a = x;
+        }
+      }
+      if ((a1 + b1) - bbest < fbest - (a0 + b0)) {
+        out->a = fbest_a;
+        out->b = fbest - fbest_a;
+        out->min_lo = 1;
+        out->min_hi = 0;
+      } else {
+        out->a = bbest_a;
+        out->b = bbest - bbest_a;
+        out->min_lo = 0;
+        out->min_hi = 1;
+      }
+      pthread_mutex_lock(&diff->lock);
+      diff->approximate = 1;
+      pthread_mutex_unlock(&diff->lock);
+      return 0;
+    }
+  }
+}
+
+/* Emits the edit script for A[a0,a1) x B[b0,b1) in order: common prefix, the two halves, common suffix. */
+static int diff_range(text_diff_t *diff, long a0, long a1, long b0, long b1, int need_min) {
+  const int *A = diff->ids[0];
+  const int *B = diff->ids[1];
+  long prefix = 0;
+  while (a0 + prefix < a1 && b0 + prefix < b1 && A[a0 + prefix] == B[b0 + prefix]) {
+    prefix++;
+  }
+  emit_lines(diff, 0, (size_t)prefix, (size_t)prefix);
+  a0 += prefix;
+  b0 += prefix;
+  long suffix = 0;
+  while (a1 - suffix > a0 && b1 - suffix > b0 && A[a1 - suffix - 1] == B[b1 - suffix - 1]) {
+    suffix++;
+  }
+  a1 -= suffix;
+  b1 -= suffix;
+
+  if (a0 == a1 || b0 == b1) {
+    emit_lines(diff, 1, (size_t)(a1 - a0), (size_t)(b1 - b0));
+  } else {
+    split_t split;
+    if (middle_snake(diff, a0, a1, b0, b1, need_min, &split) != 0 ||
+        diff_range(diff, a0, split.a, b0, split.b, split.min_lo) != 0 ||
+        diff_range(diff, split.a, a1, split.b, b1, split.min_hi) != 0) {
+      return -1;
+    }
+  }
+  emit_lines(diff, 0, (size_t)suffix, (size_t)suffix);
+  return is_cancelled(diff) ? -1 : 0;
+}
+
+static void *diff_main(void *arg) {
+  text_diff_t *diff = arg;
+  int rc = -1;
+  if (prepare_side(diff, &diff->sides[0]) == 0 && prepare_side(diff, &diff->sides[1]) == 0) {
+    pthread_mutex_lock(&diff->lock);
+    diff->prepared = 1;
+    diff->generation++;
+    pthread_mutex_unlock(&diff->lock);
+
+    long na = (long)diff->sides[0].line_count;
+    long nb = (long)diff->sides[1].line_count;
+    size_t diagonals = (size_t)(na + nb + 3);
+    diff->forward = malloc(diagonals * sizeof(long));
+    diff->backward = malloc(diagonals * sizeof(long));
+    diff->offset = nb + 1;
+    diff->max_cost = DIFF_MIN_COST;
+    while (diff->max_cost * diff->max_cost < na + nb) {
+      diff->max_cost *= 2;
+    }
+    if (diff->forward != NULL && diff->backward != NULL && intern_lines(diff) == 0) {
+      rc = diff_range(diff, 0, na, 0, nb, 0);
+    }
+  }
+
+  pthread_mutex_lock(&diff->lock);
+  diff->done = 1;
+  if (rc != 0 && !is_cancelled(diff)) {
+    diff->failed = 1;
+  }
+  diff->generation++;
+  pthread_mutex_unlock(&diff->lock);
+  return NULL;
+}
+
+int text_diff_start(char *a, size_t a_len, char *b, size_t b_len, int normalize_json, text_diff_t **out) {
+  *out = NULL;
+  text_diff_t *diff = calloc(1, sizeof(*diff));
+  if (diff == NULL) {
+    free(a);
+    free(b);
+    return -1;
+  }
+  diff->sides[0].text = a;
+  diff->sides[0].len = a_len;
+  diff->sides[1].text = b;
+  diff->sides[1].len = b_len;
+  diff->normalize_json = normalize_json;
+  atomic_init(&diff->cancel, 0);
+  pthread_mutex_init(&diff->lock, NULL);
+  if (pthread_create(&diff->thread, NULL, diff_main, diff) != 0) {
+    pthread_mutex_destroy(&diff->lock);
+    free(a);
+    free(b);
+    free(diff);
+    return -1;
+  }
+  *out = diff;
+  return 0;
+}
+
+int text_diff_poll(text_diff_t *diff, text_diff_view_t *view) {
+  if (diff == NULL) {
+    return 0;
+  }
+  pthread_mutex_lock(&diff->lock);
+  if (diff->generation == view->generation) {
+    pthread_mutex_unlock(&diff->lock);
+    return 0;
+  }
+  if (diff->blocks_len > view->blocks_cap) {
+    text_diff_block_t *grown = realloc(view->blocks, diff->blocks_cap * sizeof(*grown));
+    if (grown == NULL) {
+      pthread_mutex_unlock(&diff->lock);
+      return 0;
+    }
+    view->blocks = grown;
+    view->blocks_cap = diff->blocks_cap;
+  }
+  /* Blocks before the last one never change again. */
+  size_t from = view->blocks_len > 0 ? view->blocks_len - 1 : 0;
+  if (diff->blocks_len > from) {
+    memcpy(view->blocks + from, diff->blocks + from, (diff->blocks_len - from) * sizeof(*view->blocks));
+  }
+  view->blocks_len = diff->blocks_len;
+  if (diff->prepared) {
+    view->a = &diff->sides[0];
+    view->b = &diff->sides[1];
+  }
+  view->lines_added = diff->lines_added;
+  view->lines_removed = diff->lines_removed;
+  size_t total = diff->sides[0].line_count;
+  view->permille = diff->done ? 1000 : (total > 0 && diff->prepared ? (int)(diff->a_pos * 1000 / total) : 0);
+  view->done = diff->done;
+  view->failed = diff->failed;
+  view->approximate = diff->approximate;
+  view->generation = diff->generation;
+  pthread_mutex_unlock(&diff->lock);
+  return 1;
+}
+
+void text_diff_free(text_diff_t *diff) {
+  if (diff == NULL) {
+    return;
+  }
+  atomic_store(&diff->cancel, 1);
+  pthread_join(diff->thread, NULL);
+  pthread_mutex_destroy(&diff->lock);
+  for (int s = 0; s < 2; s++) {
+    free(diff->sides[s].text);
+    free(diff->sides[s].line_starts);
+    free(diff->ids[s]);
+  }
+  free(diff->forward);
+  free(diff->backward);
+  free(diff->blocks);
+  free(diff);
+}
+
+void text_diff_view_free(text_diff_view_t *view) {
+  free(view->blocks);
+  memset(view, 0, sizeof(*view));
+}
@@ -0,0 +1,252 @@
+#include "tuiman/text_width.h"
+
+#include <pthread.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+typedef struct {
+  uint32_t first;
+  uint32_t last;
+} cp_range_t;
+
+/* Nonspacing, enclosing and format characters (general categories Mn, Me, Cf) plus Hangul medial/final jamo. */
+static const cp_range_t ZERO_WIDTH[] = {
+    {0x0300, 0x036F},   {0x0483, 0x0489},   {0x0591, 0x05BD},   {0x05BF, 0x05BF},   {0x05C1, 0x05C2},
+    {0x05C4, 0x05C5},   {0x05C7, 0x05C7},   {0x0610, 0x061A},   {0x061C, 0x061C},   {0x064B, 0x065F},
+    {0x0670, 0x0670},   {0x06D6, 0x06DC},   {0x06DF, 0x06E4},   {0x06E7, 0x06E8},   {0x06EA, 0x06ED},
+    {0x0711, 0x0711},   {0x0730, 0x074A},   {0x07A6, 0x07B0},   {0x07EB, 0x07F3},   {0x0816, 0x0819},
+    {0x081B, 0x0823},   {0x0825, 0x0827},   {0x0829, 0x082D},   {0x0859, 0x085B},   {0x08D3, 0x08E1},
+    {0x08E3, 0x0902},   {0x093A, 0x093A},   {0x093C, 0x093C},   {0x0941, 0x0948},   {0x094D, 0x094D},
+    {0x0951, 0x0957},   {0x0962, 0x0963},   {0x0981, 0x0981},   {0x09BC, 0x09BC},   {0x09C1, 0x09C4},
+    {0x09CD, 0x09CD},   {0x09E2, 0x09E3},   {0x0A01, 0x0A02},   {0x0A3C, 0x0A3C},   {0x0A41, 0x0A51},
+    {0x0A70, 0x0A71},   {0x0A75, 0x0A75},   {0x0A81, 0x0A82},   {0x0ABC, 0x0ABC},   {0x0AC1, 0x0AC8},
+    {0x0ACD, 0x0ACD},   {0x0AE2, 0x0AE3},   {0x0B01, 0x0B01},   {0x0B3C, 0x0B3C},   {0x0B3F, 0x0B3F},
+    {0x0B41, 0x0B44},   {0x0B4D, 0x0B4D},   {0x0B56, 0x0B56},   {0x0B82, 0x0B82},   {0x0BC0, 0x0BC0},
+    {0x0BCD, 0x0BCD},   {0x0C00, 0x0C00},   {0x0C3E, 0x0C40},   {0x0C46, 0x0C56},   {0x0CBC, 0x0CBC},
+    {0x0CCC, 0x0CCD},   {0x0D41, 0x0D44},   {0x0D4D, 0x0D4D},   {0x0DCA, 0x0DCA},   {0x0DD2, 0x0DD6},
+    {0x0E31, 0x0E31},   {0x0E34, 0x0E3A},   {0x0E47, 0x0E4E},   {0x0EB1, 0x0EB1},   {0x0EB4, 0x0EBC},
+    {0x0EC8, 0x0ECD},   {0x0F18, 0x0F19},   {0x0F35, 0x0F35},   {0x0F37, 0x0F37},   {0x0F39, 0x0F39},
+    {0x0F71, 0x0F7E},   {0x0F80, 0x0F84},   {0x0F86, 0x0F87},   {0x0F8D, 0x0FBC},   {0x0FC6, 0x0FC6},
+    {0x102D, 0x1030},   {0x1032, 0x1037},   {0x1039, 0x103A},   {0x103D, 0x103E},   {0x1058, 0x1059},
+    {0x105E, 0x1060},   {0x1071, 0x1074},   {0x1082, 0x1082},   {0x1085, 0x1086},   {0x108D, 0x108D},
+    {0x109D, 0x109D},   {0x1160, 0x11FF},   {0x135D, 0x135F},   {0x1712, 0x1714},   {0x1732, 0x1733},
+    {0x1752, 0x1753},   {0x1772, 0x1773},   {0x17B4, 0x17B5},   {0x17B7, 0x17BD},   {0x17C6, 0x17C6},
+    {0x17C9, 0x17D3},   {0x17DD, 0x17DD},   {0x180B, 0x180E},   {0x18A9, 0x18A9},   {0x1920, 0x1922},
+    {0x1927, 0x1928},   {0x1932, 0x1932},   {0x1939, 0x193B},   {0x1A17, 0x1A18},   {0x1A56, 0x1A56},
+    {0x1A58, 0x1A60},   {0x1A65, 0x1A6C},   {0x1A73, 0x1A7F},   {0x1AB0, 0x1AFF},   {0x1B00, 0x1B03},
+    {0x1B34, 0x1B34},   {0x1B36, 0x1B3A},   {0x1B6B, 0x1B73},   {0x1B80, 0x1B81},   {0x1BA2, 0x1BA5},
+    {0x1BA8, 0x1BA9},   {0x1BAB, 0x1BAD},   {0x1C2C, 0x1C33},   {0x1C36, 0x1C37},   {0x1CD0, 0x1CD2},
+    {0x1CD4, 0x1CE0},   {0x1CE2, 0x1CE8},   {0x1CED, 0x1CED},   {0x1CF4, 0x1CF4},   {0x1DC0, 0x1DFF},
+    {0x200B, 0x200F},   {0x202A, 0x202E},   {0x2060, 0x2064},   {0x2066, 0x206F},   {0x20D0, 0x20F0},
+    {0x2CEF, 0x2CF1},   {0x2D7F, 0x2D7F},   {0x2DE0, 0x2DFF},   {0x302A, 0x302D},   {0x3099, 0x309A},
+    {0xA66F, 0xA672},   {0xA674, 0xA67D},   {0xA69E, 0xA69F},   {0xA6F0, 0xA6F1},   {0xA802, 0xA802},
+    {0xA806, 0xA806},   {0xA80B, 0xA80B},   {0xA825, 0xA826},   {0xA8C4, 0xA8C5},   {0xA8E0, 0xA8F1},
+    {0xA926, 0xA92D},   {0xA947, 0xA951},   {0xA980, 0xA982},   {0xA9B3, 0xA9B3},   {0xA9B6, 0xA9B9},
+    {0xA9BC, 0xA9BD},   {0xAA29, 0xAA2E},   {0xAA31, 0xAA32},   {0xAA35, 0xAA36},   {0xAA43, 0xAA43},
+    {0xAA4C, 0xAA4C},   {0xAAB0, 0xAAB0},   {0xAAB2, 0xAAB4},   {0xAAB7, 0xAAB8},   {0xAABE, 0xAABF},
+    {0xAAC1, 0xAAC1},   {0xAAEC, 0xAAED},   {0xAAF6, 0xAAF6},   {0xABE5, 0xABE5},   {0xABE8, 0xABE8},
+    {0xABED, 0xABED},   {0xD7B0, 0xD7FF},   {0xFB1E, 0xFB1E},   {0xFE00, 0xFE0F},   {0xFE20, 0xFE2F},
+    {0xFEFF, 0xFEFF},   {0xFFF9, 0xFFFB},   {0x101FD, 0x101FD}, {0x10A01, 0x10A0F}, {0x10A38, 0x10A3F},
+    {0x11001, 0x11001}, {0x11038, 0x11046}, {0x1107F, 0x11081}, {0x110B3, 0x110B6}, {0x110B9, 0x110BA},
+    {0x11100, 0x11102}, {0x11127, 0x1112B}, {0x1112D, 0x11134}, {0x16F8F, 0x16F92}, {0x1BC9D, 0x1BC9E},
+    {0x1BCA0, 0x1BCA3}, {0x1D167, 0x1D169}, {0x1D173, 0x1D182}, {0x1D185, 0x1D18B}, {0x1D1AA, 0x1D1AD},
+    {0x1D242, 0x1D244}, {0x1E000, 0x1E02A}, {0x1E8D0, 0x1E8D6}, {0x1E944, 0x1E94A}, {0xE0001, 0xE0001},
+    {0xE0020, 0xE007F}, {0xE0100, 0xE01EF},
+};
+
+/* East Asian Wide and Fullwidth, plus characters with default emoji presentation. */
+static const cp_range_t DOUBLE_WIDTH[] = {
+    {0x1100, 0x115F},   {0x231A, 0x231B},   {0x2329, 0x232A},   {0x23E9, 0x23EC},   {0x23F0, 0x23F0},
+    {0x23F3, 0x23F3},   {0x25FD, 0x25FE},   {0x2614, 0x2615},   {0x2648, 0x2653},   {0x267F, 0x267F},
+    {0x2693, 0x2693},   {0x26A1, 0x26A1},   {0x26AA, 0x26AB},   {0x26BD, 0x26BE},   {0x26C4, 0x26C5},
+    {0x26CE, 0x26CE},   {0x26D4, 0x26D4},   {0x26EA, 0x26EA},   {0x26F2, 0x26F3},   {0x26F5, 0x26F5},
+    {0x26FA, 0x26FA},   {0x26FD, 0x26FD},   {0x2705, 0x2705},   {0x270A, 0x270B},   {0x2728, 0x2728},
+    {0x274C, 0x274C},   {0x274E, 0x274E},   {0x2753, 0x2755},   {0x2757, 0x2757},   {0x2795, 0x2797},
+    {0x27B0, 0x27B0},   {0x27BF, 0x27BF},   {0x2B1B, 0x2B1C},   {0x2B50, 0x2B50},   {0x2B55, 0x2B55},
+    {0x2E80, 0x303E},   {0x3041, 0xA4CF},   {0xA960, 0xA97F},   {0xAC00, 0xD7A3},   {0xF900, 0xFAFF},
+    {0xFE10, 0xFE19},   {0xFE30, 0xFE6F},   {0xFF00, 0xFF60},   {0xFFE0, 0xFFE6},   {0x16FE0, 0x16FE3},
+    {0x16FF0, 0x16FF1}, {0x17000, 0x18D08}, {0x1AFF0, 0x1B2FF}, {0x1F004, 0x1F004}, {0x1F0CF, 0x1F0CF},
+    {0x1F18E, 0x1F18E}, {0x1F191, 0x1F19A}, {0x1F200, 0x1F202}, {0x1F210, 0x1F23B}, {0x1F240, 0x1F248},
+    {0x1F250, 0x1F251}, {0x1F260, 0x1F265}, {0x1F300, 0x1F320}, {0x1F32D, 0x1F335}, {0x1F337, 0x1F37C},
+    {0x1F37E, 0x1F393}, {0x1F3A0, 0x1F3CA}, {0x1F3CF, 0x1F3D3}, {0x1F3E0, 0x1F3F0}, {0x1F3F4, 0x1F3F4},
+    {0x1F3F8, 0x1F43E}, {0x1F440, 0x1F440}, {0x1F442, 0x1F4FC}, {0x1F4FF, 0x1F53D}, {0x1F54B, 0x1F54E},
+    {0x1F550, 0x1F567}, {0x1F57A, 0x1F57A}, {0x1F595, 0x1F596}, {0x1F5A4, 0x1F5A4}, {0x1F5FB, 0x1F64F},
+    {0x1F680, 0x1F6C5}, {0x1F6CC, 0x1F6CC}, {0x1F6D0, 0x1F6D2}, {0x1F6D5, 0x1F6D7}, {0x1F6DD, 0x1F6DF},
+    {0x1F6EB, 0x1F6EC}, {0x1F6F4, 0x1F6FC}, {0x1F7E0, 0x1F7EB}, {0x1F7F0, 0x1F7F0}, {0x1F90C, 0x1F93A},
+    {0x1F93C, 0x1F945}, {0x1F947, 0x1F9FF}, {0x1FA70, 0x1FAFF}, {0x20000, 0x2FFFD}, {0x30000, 0x3FFFD},
+};
+
+static int in_ranges(uint32_t cp, const cp_range_t *ranges, size_t count) {
+  if (cp < ranges[0].first || cp > ranges[count - 1].last) {
+    return 0;
+  }
+  size_t lo = 0;
+  size_t hi = count;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (cp > ranges[mid].last) {
+      lo = mid + 1;
+    } else if (cp < ranges[mid].first) {
+      hi = mid;
+    } else {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/* Widths of the Basic Multilingual Plane, two bits per code point, filled from the tables on first use. */
+static uint8_t bmp_widths[0x10000 / 4];
+static pthread_once_t bmp_widths_once = PTHREAD_ONCE_INIT;
+
+static void set_bmp_width(uint32_t first, uint32_t last, int width) {
+  for (uint32_t cp = first; cp <= last && cp < 0x10000; cp++) {
+    uint8_t shift = (uint8_t)((cp & 3) * 2);
+    bmp_widths[cp >> 2] = (uint8_t)((bmp_widths[cp >> 2] & ~(3 << shift)) | (width << shift));
+  }
+}
+
+static void fill_bmp_widths(void) {
+  memset(bmp_widths, 0x55, sizeof(bmp_widths)); /* 1 everywhere */
+  for (size_t i = 0; i < sizeof(DOUBLE_WIDTH) / sizeof(DOUBLE_WIDTH[0]); i++) {
+    set_bmp_width(DOUBLE_WIDTH[i].first, DOUBLE_WIDTH[i].last, 2);
+  }
+  for (size_t i = 0; i < sizeof(ZERO_WIDTH) / sizeof(ZERO_WIDTH[0]); i++) {
+    set_bmp_width(ZERO_WIDTH[i].first, ZERO_WIDTH[i].last, 0);
+  }
+}
+
+static int is_printable_ascii(unsigned char c) {
+  return c >= 0x20 && c < 0x7f;
+}
+
+size_t text_ascii_run(const char *s, size_t len) {
+  size_t i = 0;
+#if defined(__SSE2__)
+  /* Signed compare: bytes >= 0x80 are negative, so one test covers them and the C0 controls. */
+  const __m128i space = _mm_set1_epi8(0x20);
+  const __m128i del = _mm_set1_epi8(0x7f);
+  for (; i + 16 <= len; i += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(s + i));
+    int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmplt_epi8(v, space), _mm_cmpeq_epi8(v, del)));
+    if (mask != 0) {
+      return i + (size_t)__builtin_ctz((unsigned)mask);
+    }
+  }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+  const uint8x16_t space = vdupq_n_u8(0x20);
+  const uint8x16_t del = vdupq_n_u8(0x7f);
+  for (; i + 16 <= len; i += 16) {
+    uint8x16_t v = vld1q_u8((const uint8_t *)(s + i));
+    uint8x16_t bad = vorrq_u8(vcltq_u8(v, space), vcgeq_u8(v, del));
+    /* Narrow each byte to a nibble so the first hit is a count of trailing zeros. */
+    uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(bad), 4)), 0);
+    if (mask != 0) {
+      return i + (size_t)(__builtin_ctzll(mask) >> 2);
+    }
+  }
+#else
+  const uint64_t ones = 0x0101010101010101ull;
+  const uint64_t highs = 0x8080808080808080ull;
+  for (; i + 8 <= len; i += 8) {
+    uint64_t word = 0;
+    memcpy(&word, s + i, sizeof(word));
+    uint64_t below_space = (word - ones * 0x20) & ~word;
+    uint64_t is_del = ((word ^ (ones * 0x7f)) - ones) & ~(word ^ (ones * 0x7f));
+    if (((word | below_space | is_del) & highs) != 0) {
+      break;
+    }
+  }
+#endif
+  while (i < len && is_printable_ascii((unsigned char)s[i])) {
+    i++;
+  }
+  return i;
+}
+
+size_t text_decode(const char *s, size_t len, uint32_t *cp) {
+  if (len == 0) {
+    *cp = TEXT_CP_INVALID;
+    return 0;
+  }
+  const unsigned char *p = (const unsigned char *)s;
+  if (p[0] < 0x80) {
+    *cp = p[0];
+    return 1;
+  }
+
+  size_t need = 0;
+  unsigned char lo = 0x80;
+  unsigned char hi = 0xBF;
+  uint32_t value = 0;
+  if (p[0] >= 0xC2 && p[0] <= 0xDF) {
+    need = 1;
+    value = p[0] & 0x1F;
+  } else if (p[0] >= 0xE0 && p[0] <= 0xEF) {
+    need = 2;
+    value = p[0] & 0x0F;
+    lo = p[0] == 0xE0 ? 0xA0 : 0x80; /* overlong */
+    hi = p[0] == 0xED ? 0x9F : 0xBF; /* surrogates */
+  } else if (p[0] >= 0xF0 && p[0] <= 0xF4) {
+    need = 3;
+    value = p[0] & 0x07;
+    lo = p[0] == 0xF0 ? 0x90 : 0x80; /* overlong */
+    hi = p[0] == 0xF4 ? 0x8F : 0xBF; /* above U+10FFFF */
+  } else {
+    *cp = TEXT_CP_INVALID;
+    return 1;
+  }
+
+  if (len <= need || p[1] < lo || p[1] > hi) {
+    *cp = TEXT_CP_INVALID;
+    return 1;
+  }
+  for (size_t i = 1; i <= need; i++) {
+    if (i > 1 && (p[i] & 0xC0) != 0x80) {
+      *cp = TEXT_CP_INVALID;
+      return 1;
+    }
+    value = (value << 6) | (p[i] & 0x3F);
+  }
+  *cp = value;
+  return need + 1;
+}
+
+int text_codepoint_width(uint32_t cp) {
+  if (cp < 0x300 || cp == TEXT_CP_INVALID) {
+    return 1;
+  }
+  if (cp < 0x10000) {
+    pthread_once(&bmp_widths_once, fill_bmp_widths);
+    return (bmp_widths[cp >> 2] >> ((cp & 3) * 2)) & 3;
+  }
+  if (in_ranges(cp, ZERO_WIDTH, sizeof(ZERO_WIDTH) / sizeof(ZERO_WIDTH[0]))) {
+    return 0;
+  }
+  if (in_ranges(cp, DOUBLE_WIDTH, sizeof(DOUBLE_WIDTH) / sizeof(DOUBLE_WIDTH[0]))) {
+    return 2;
+  }
+  return 1;
+}
+
+size_t text_printable_prefix(const char *s, size_t len) {
+  size_t i = 0;
+  while (i < len) {
+    i += text_ascii_run(s + i, len - i);
+    if (i >= len || (unsigned char)s[i] < 0x80) {
+      break;
+    }
+    uint32_t cp = 0;
+    size_t used = text_decode(s + i, len - i, &cp);
+    if (cp == TEXT_CP_INVALID || cp < 0xA0) {
+      break;
+    }
+    i += used;
+  }
+  return i;
+}
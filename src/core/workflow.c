@@ -0,0 +1,927 @@
+#include "tuiman/workflow.h"
+
+#include <ctype.h>
+#include <dirent.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+
+#define WORKFLOW_FILE_MAX (64 * 1024)
+#define WORKFLOW_POLL_MS 100
+#define NO_STEP SIZE_MAX
+
+static int valid_workflow_name(const char *name) {
+  if (name == NULL || name[0] == '\0' || name[0] == '.' || strlen(name) >= TUIMAN_WORKFLOW_NAME_LEN) {
+    return 0;
+  }
+  for (const char *p = name; *p != '\0'; p++) {
+    if (!isalnum((unsigned char)*p) && *p != '_' && *p != '-' && *p != '.') {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+int workflow_file_path(const app_paths_t *paths, const char *name, char *out, size_t out_len) {
+  if (!valid_workflow_name(name)) {
+    return -1;
+  }
+  int wrote = snprintf(out, out_len, "%s/%s.flow", paths->workflows_dir, name);
+  return wrote < 0 || (size_t)wrote >= out_len ? -1 : 0;
+}
+
+static int compare_names(const void *a, const void *b) {
+  return strcmp((const char *)a, (const char *)b);
+}
+
+int workflow_list_names(const app_paths_t *paths, environment_names_t *out) {
+  out->items = NULL;
+  out->len = 0;
+
+  DIR *dir = opendir(paths->workflows_dir);
+  if (dir == NULL) {
+    return -1;
+  }
+
+  size_t cap = 0;
+  struct dirent *entry = NULL;
+  while ((entry = readdir(dir)) != NULL) {
+    size_t len = strlen(entry->d_name);
+    if (len <= 5 || strcmp(entry->d_name + len - 5, ".flow") != 0 || len - 5 >= TUIMAN_ENV_NAME_LEN) {
+      continue;
+    }
+    if (out->len == cap) {
+      size_t next = cap == 0 ? 8 : cap * 2;
+      char(*grown)[TUIMAN_ENV_NAME_LEN] = realloc(out->items, next * sizeof(*grown));
+      if (grown == NULL) {
+        closedir(dir);
+        environment_names_free(out);
+        return -1;
+      }
+      out->items = grown;
+      cap = next;
+    }
+    memcpy(out->items[out->len], entry->d_name, len - 5);
+    out->items[out->len][len - 5] = '\0';
+    out->len++;
+  }
+  closedir(dir);
+
+  qsort(out->items, out->len, sizeof(out->items[0]), compare_names);
+  return 0;
+}
+
+/* Next whitespace-separated token; double quotes group words. Returns 0 at end of line. */
+static int next_token(const char **cursor, char *out, size_t out_len) {
+  const char *p = *cursor;
+  while (*p == ' ' || *p == '\t') {
+    p++;
+  }
+  if (*p == '\0') {
+    *cursor = p;
+    return 0;
+  }
+
+  size_t used = 0;
+  if (*p == '"') {
+    p++;
+    while (*p != '\0' && *p != '"') {
+      if (used + 1 < out_len) {
+        out[used++] = *p;
+      }
+      p++;
+    }
+    if (*p == '"') {
+      p++;
+    }
+  } else {
+    while (*p != '\0' && *p != ' ' && *p != '\t') {
+      if (used + 1 < out_len) {
+        out[used++] = *p;
+      }
+      p++;
+    }
+  }
+  out[used] = '\0';
+  *cursor = p;
+  return 1;
+}
+
+static size_t find_step(const workflow_t *wf, const char *name) {
+  for (size_t i = 0; i < wf->len; i++) {
+    if (strcmp(wf->steps[i].name, name) == 0) {
+      return i;
+    }
+  }
+  return NO_STEP;
+}
+
+static int parse_step(workflow_t *wf, size_t *cap, const char *rest, char *error, size_t error_len) {
+  char name[TUIMAN_WORKFLOW_STEP_LEN];
+  char ref[TUIMAN_COLLECTION_LEN + TUIMAN_NAME_LEN];
+  if (!next_token(&rest, name, sizeof(name)) || !next_token(&rest, ref, sizeof(ref))) {
+    snprintf(error, error_len, "usage: step NAME REQUEST [after STEP,...]");
+    return -1;
+  }
+  if (find_step(wf, name) != NO_STEP) {
+    snprintf(error, error_len, "duplicate step '%s'", name);
+    return -1;
+  }
+
+  if (wf->len == *cap) {
+    size_t next = *cap == 0 ? 8 : *cap * 2;
+    workflow_step_t *grown = realloc(wf->steps, next * sizeof(*grown));
+    if (grown == NULL) {
+      snprintf(error, error_len, "out of memory");
+      return -1;
+    }
+    wf->steps = grown;
+    *cap = next;
+  }
+  workflow_step_t *step = &wf->steps[wf->len];
+  memset(step, 0, sizeof(*step));
+  snprintf(step->name, sizeof(step->name), "%s", name);
+  snprintf(step->request_ref, sizeof(step->request_ref), "%s", ref);
+  step->max_tries = 1;
+
+  char word[TUIMAN_WORKFLOW_STEP_LEN * TUIMAN_WORKFLOW_MAX_DEPS];
+  if (!next_token(&rest, word, sizeof(word))) {
+    /* No "after": a plain list of steps runs in order. */
+    if (wf->len > 0) {
+      step->deps[step->deps_len++] = wf->len - 1;
+    }
+    wf->len++;
+    return 0;
+  }
+  char deps[sizeof(word)];
+  if (strcmp(word, "after") != 0 || !next_token(&rest, deps, sizeof(deps))) {
+    snprintf(error, error_len, "step '%s': expected 'after STEP,...'", name);
+    return -1;
+  }
+  if (strcmp(deps, "-") != 0) {
+    char *save = NULL;
+    for (char *dep = strtok_r(deps, ",", &save); dep != NULL; dep = strtok_r(NULL, ",", &save)) {
+      size_t index = find_step(wf, dep);
+      if (index == NO_STEP) {
+        snprintf(error, error_len, "step '%s': unknown or later step '%s'", name, dep);
+        return -1;
+      }
+      if (step->deps_len == TUIMAN_WORKFLOW_MAX_DEPS) {
+        snprintf(error, error_len, "step '%s': too many dependencies", name);
+        return -1;
+      }
+      step->deps[step->deps_len++] = index;
+    }
+  }
+  wf->len++;
+  return 0;
+}
+
+static int parse_extract(workflow_step_t *step, const char *rest, char *error, size_t error_len) {
+  workflow_extract_t ex;
+  memset(&ex, 0, sizeof(ex));
+  char eq[8];
+  char kind[16];
+  if (!next_token(&rest, ex.var, sizeof(ex.var)) || !next_token(&rest, eq, sizeof(eq)) || strcmp(eq, "=") != 0 ||
+      !next_token(&rest, kind, sizeof(kind))) {
+    snprintf(error, error_len, "usage: extract VAR = json /pointer | header Name | status");
+    return -1;
+  }
+  if (strcmp(kind, "json") == 0) {
+    ex.kind = WORKFLOW_EXTRACT_JSON;
+  } else if (strcmp(kind, "header") == 0) {
+    ex.kind = WORKFLOW_EXTRACT_HEADER;
+  } else if (strcmp(kind, "status") == 0) {
+    ex.kind = WORKFLOW_EXTRACT_STATUS;
+  } else {
+    snprintf(error, error_len, "extract %s: unknown source '%s'", ex.var, kind);
+    return -1;
+  }
+  if (ex.kind != WORKFLOW_EXTRACT_STATUS && !next_token(&rest, ex.path, sizeof(ex.path))) {
+    snprintf(error, error_len, "extract %s: missing %s", ex.var, ex.kind == WORKFLOW_EXTRACT_JSON ? "pointer" : "name");
+    return -1;
+  }
+
+  workflow_extract_t *grown = realloc(step->extracts, (step->extracts_len + 1) * sizeof(*grown));
+  if (grown == NULL) {
+    snprintf(error, error_len, "out of memory");
+    return -1;
+  }
+  step->extracts = grown;
+  step->extracts[step->extracts_len++] = ex;
+  return 0;
+}
+
+/* until status CODE [tries N] [every MS] */
+static int parse_until(workflow_step_t *step, const char *rest, char *error, size_t error_len) {
+  char word[32];
+  char value[32];
+  if (!next_token(&rest, word, sizeof(word)) || strcmp(word, "status") != 0 ||
+      !next_token(&rest, value, sizeof(value))) {
+    snprintf(error, error_len, "usage: until status CODE [tries N] [every MS]");
+    return -1;
+  }
+  step->until_status = strtol(value, NULL, 10);
+  step->max_tries = 10;
+  step->retry_ms = 1000;
+  while (next_token(&rest, word, sizeof(word))) {
+    if (!next_token(&rest, value, sizeof(value))) {
+      snprintf(error, error_len, "until: '%s' needs a value", word);
+      return -1;
+    }
+    if (strcmp(word, "tries") == 0) {
+      step->max_tries = (int)strtol(value, NULL, 10);
+    } else if (strcmp(word, "every") == 0) {
+      step->retry_ms = strtol(value, NULL, 10);
+    } else {
+      snprintf(error, error_len, "until: unknown option '%s'", word);
+      return -1;
+    }
+  }
+  if (step->until_status <= 0 || step->max_tries < 1 || step->retry_ms < 0) {
+    snprintf(error, error_len, "until: invalid status, tries or delay");
+    return -1;
+  }
+  return 0;
+}
+
+int workflow_load(const app_paths_t *paths, const char *name, workflow_t *out, char *error, size_t error_len) {
+  memset(out, 0, sizeof(*out));
+  error[0] = '\0';
+
+  char path[PATH_MAX];
+  if (workflow_file_path(paths, name, path, sizeof(path)) != 0) {
+    snprintf(error, error_len, "invalid workflow name");
+    return -1;
+  }
+  FILE *fp = fopen(path, "rb");
+  if (fp == NULL) {
+    snprintf(error, error_len, "workflow not found: %s", name);
+    return -1;
+  }
+  char *text = malloc(WORKFLOW_FILE_MAX);
+  if (text == NULL) {
+    fclose(fp);
+    snprintf(error, error_len, "out of memory");
+    return -1;
+  }
+  size_t used = fread(text, 1, WORKFLOW_FILE_MAX - 1, fp);
+  text[used] = '\0';
+  /* A filled buffer with more to come would hand the parser a cut-off step. */
+  bool too_large = used == WORKFLOW_FILE_MAX - 1 && fgetc(fp) != EOF;
+  fclose(fp);
+  if (too_large) {
+    free(text);
+    snprintf(error, error_len, "workflow file too large (max %d KiB)", WORKFLOW_FILE_MAX / 1024);
+    return -1;
+  }
+
+  snprintf(out->name, sizeof(out->name), "%s", name);
+  size_t cap = 0;
+  int rc = 0;
+  int line_no = 0;
+  char *save = NULL;
+  for (char *line = strtok_r(text, "\n", &save); line != NULL && rc == 0; line = strtok_r(NULL, "\n", &save)) {
+    line_no++;
+    size_t len = strlen(line);
+    if (len > 0 && line[len - 1] == '\r') {
+      line[len - 1] = '\0';
+    }
+    const char *rest = line;
+    char keyword[16];
+    if (!next_token(&rest, keyword, sizeof(keyword)) || keyword[0] == '#') {
+      continue;
+    }
+
+    char detail[200];
+    detail[0] = '\0';
+    if (strcmp(keyword, "step") == 0) {
+      rc = parse_step(out, &cap, rest, detail, sizeof(detail));
+    } else if (out->len == 0) {
+      snprintf(detail, sizeof(detail), "'%s' before the first step", keyword);
+      rc = -1;
+    } else if (strcmp(keyword, "extract") == 0) {
+      rc = parse_extract(&out->steps[out->len - 1], rest, detail, sizeof(detail));
+    } else if (strcmp(keyword, "until") == 0) {
+      rc = parse_until(&out->steps[out->len - 1], rest, detail, sizeof(detail));
+    } else {
+      snprintf(detail, sizeof(detail), "unknown keyword '%s'", keyword);
+      rc = -1;
+    }
+    if (rc != 0) {
+      snprintf(error, error_len, "%s.flow:%d: %s", name, line_no, detail);
+    }
+  }
+  free(text);
+
+  if (rc == 0 && out->len == 0) {
+    snprintf(error, error_len, "%s.flow has no steps", name);
+    rc = -1;
+  }
+  if (rc != 0) {
+    workflow_free(out);
+    return -1;
+  }
+  return 0;
+}
+
+void workflow_free(workflow_t *wf) {
+  for (size_t i = 0; i < wf->len; i++) {
+    free(wf->steps[i].extracts);
+    free(wf->steps[i].sent);
+    free(wf->steps[i].variables);
+  }
+  free(wf->steps);
+  environment_free(&wf->vars);
+  memset(wf, 0, sizeof(*wf));
+}
+
+/* Minimal JSON walking for pointer extraction; no tree is built. */
+
+static const char *json_ws(const char *p) {
+  while (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r') {
+    p++;
+  }
+  return p;
+}
+
+static const char *json_skip_string(const char *p) {
+  for (p++; *p != '\0' && *p != '"'; p++) {
+    if (*p == '\\' && p[1] != '\0') {
+      p++;
+    }
+  }
+  return *p == '"' ? p + 1 : NULL;
+}
+
+static const char *json_skip_value(const char *p) {
+  p = json_ws(p);
+  if (*p == '"') {
+    return json_skip_string(p);
+  }
+  if (*p == '{' || *p == '[') {
+    int depth = 0;
+    while (*p != '\0') {
+      if (*p == '"') {
+        p = json_skip_string(p);
+        if (p == NULL) {
+          return NULL;
+        }
+        continue;
+      }
+      if (*p == '{' || *p == '[') {
+        depth++;
+      } else if (*p == '}' || *p == ']') {
+        if (--depth == 0) {
+          return p + 1;
+        }
+      }
+      p++;
+    }
+    return NULL;
+  }
+  while (*p != '\0' && *p != ',' && *p != '}' && *p != ']' && !isspace((unsigned char)*p)) {
+    p++;
+  }
+  return p;
+}
+
+/* Compares a raw JSON string (at the opening quote) with a pointer token. Escapes other than \" and \\ never match. */
+static int json_key_equals(const char *p, const char *token, size_t token_len) {
+  p++;
+  size_t i = 0;
+  while (*p != '"' && *p != '\0') {
+    char c = *p;
+    if (c == '\\') {
+      p++;
+      if (*p != '"' && *p != '\\' && *p != '/') {
+        return 0;
+      }
+      c = *p;
+    }
+    if (i >= token_len || token[i] != c) {
+      return 0;
+    }
+    i++;
+    p++;
+  }
+  return i == token_len;
+}
+
+static const char *json_pointer_step(const char *p, const char *token, size_t token_len) {
+  p = json_ws(p);
+  if (*p == '{') {
+    p = json_ws(p + 1);
+    while (*p == '"') {
+      int match = json_key_equals(p, token, token_len);
+      p = json_skip_string(p);
+      if (p == NULL) {
+        return NULL;
+      }
+      p = json_ws(p);
+      if (*p != ':') {
+        return NULL;
+      }
+      p = json_ws(p + 1);
+      if (match) {
+        return p;
+      }
+      p = json_skip_value(p);
+      if (p == NULL) {
+        return NULL;
+      }
+      p = json_ws(p);
+      if (*p == ',') {
+        p = json_ws(p + 1);
+      }
+    }
+    return NULL;
+  }
+  if (*p == '[') {
+    char digits[24];
+    if (token_len == 0 || token_len >= sizeof(digits)) {
+      return NULL;
+    }
+    memcpy(digits, token, token_len);
+    digits[token_len] = '\0';
+    char *end = NULL;
+    unsigned long index = strtoul(digits, &end, 10);
+    if (*end != '\0') {
+      return NULL;
+    }
+    p = json_ws(p + 1);
+    for (unsigned long i = 0; i < index; i++) {
+      p = json_skip_value(p);
+      if (p == NULL) {
+        return NULL;
+      }
+      p = json_ws(p);
+      if (*p != ',') {
+        return NULL;
+      }
+      p = json_ws(p + 1);
+    }
+    return *p == ']' ? NULL : p;
+  }
+  return NULL;
+}
+
+static void utf8_append(char *out, size_t out_len, size_t *used, unsigned long cp) {
+  char buf[4];
+  size_t n = 0;
+  if (cp < 0x80) {
+    buf[n++] = (char)cp;
+  } else if (cp < 0x800) {
+    buf[n++] = (char)(0xC0 | (cp >> 6));
+    buf[n++] = (char)(0x80 | (cp & 0x3F));
+  } else {
+    buf[n++] = (char)(0xE0 | (cp >> 12));
+    buf[n++] = (char)(0x80 | ((cp >> 6) & 0x3F));
+    buf[n++] = (char)(0x80 | (cp & 0x3F));
+  }
+  if (*used + n < out_len) {
+    memcpy(out + *used, buf, n);
+    *used += n;
+  }
+}
+
+/* Strings are unescaped; numbers, literals, objects and arrays are copied as raw JSON. */
+static int json_copy_value(const char *p, char *out, size_t out_len) {
+  p = json_ws(p);
+  const char *end = json_skip_value(p);
+  if (end == NULL || end == p) {
+    return -1;
+  }
+  size_t used = 0;
+  if (*p != '"') {
+    size_t len = (size_t)(end - p);
+    if (len >= out_len) {
+      return -1;
+    }
+    memcpy(out, p, len);
+    out[len] = '\0';
+    return 0;
+  }
+
+  for (p++; p < end - 1; p++) {
+    char c = *p;
+    if (c == '\\') {
+      p++;
+      switch (*p) {
+      case 'n': c = '\n'; break;
+      case 't': c = '\t'; break;
+      case 'r': c = '\r'; break;
+      case 'b': c = '\b'; break;
+      case 'f': c = '\f'; break;
+      case 'u': {
+        char hex[5] = {0};
+        for (int i = 0; i < 4 && isxdigit((unsigned char)p[1]); i++) {
+          hex[i] = *++p;
+        }
+        utf8_append(out, out_len, &used, strtoul(hex, NULL, 16));
+        continue;
+      }
+      default: c = *p; break;
+      }
+    }
+    if (used + 1 >= out_len) {
+      return -1;
+    }
+    out[used++] = c;
+  }
+  out[used] = '\0';
+  return 0;
+}
+
+static int json_pointer_get(const char *json, const char *pointer, char *out, size_t out_len) {
+  const char *p = json;
+  if (pointer[0] != '\0' && pointer[0] != '/') {
+    return -1;
+  }
+  const char *cursor = pointer;
+  while (*cursor == '/') {
+    cursor++;
+    char token[TUIMAN_HEADER_VAL_LEN];
+    size_t len = 0;
+    while (*cursor != '\0' && *cursor != '/' && len + 1 < sizeof(token)) {
+      if (cursor[0] == '~' && (cursor[1] == '0' || cursor[1] == '1')) {
+        token[len++] = cursor[1] == '0' ? '~' : '/';
+        cursor += 2;
+        continue;
+      }
+      token[len++] = *cursor++;
+    }
+    p = json_pointer_step(p, token, len);
+    if (p == NULL) {
+      return -1;
+    }
+  }
+  return json_copy_value(p, out, out_len);
+}
+
+static int header_get(const char *block, const char *name, char *out, size_t out_len) {
+  size_t name_len = strlen(name);
+  for (const char *line = block; line != NULL && *line != '\0';) {
+    const char *nl = strchr(line, '\n');
+    size_t len = nl != NULL ? (size_t)(nl - line) : strlen(line);
+    if (len > name_len && line[name_len] == ':' && strncasecmp(line, name, name_len) == 0) {
+      const char *value = line + name_len + 1;
+      const char *end = line + len;
+      while (value < end && (*value == ' ' || *value == '\t')) {
+        value++;
+      }
+      while (end > value && (end[-1] == '\r' || end[-1] == ' ')) {
+        end--;
+      }
+      int wrote = snprintf(out, out_len, "%.*s", (int)(end - value), value);
+      return wrote < 0 || (size_t)wrote >= out_len ? -1 : 0;
+    }
+    line = nl != NULL ? nl + 1 : NULL;
+  }
+  return -1;
+}
+
+static int apply_extracts(workflow_t *wf, workflow_step_t *step, const http_response_t *response) {
+  char value[TUIMAN_BODY_LEN];
+  for (size_t i = 0; i < step->extracts_len; i++) {
+    const workflow_extract_t *ex = &step->extracts[i];
+    int rc = -1;
+    if (ex->kind == WORKFLOW_EXTRACT_JSON) {
+      rc = response->body != NULL ? json_pointer_get(response->body, ex->path, value, sizeof(value)) : -1;
+    } else if (ex->kind == WORKFLOW_EXTRACT_HEADER) {
+      rc = response->headers != NULL ? header_get(response->headers, ex->path, value, sizeof(value)) : -1;
+    } else {
+      snprintf(value, sizeof(value), "%ld", response->status_code);
+      rc = 0;
+    }
+    if (rc != 0) {
+      snprintf(step->error, sizeof(step->error), "extract %s: %s%s not found", ex->var,
+               ex->kind == WORKFLOW_EXTRACT_HEADER ? "header " : "", ex->path);
+      return -1;
+    }
+    if (environment_set(&wf->vars, ex->var, value, strlen(value)) != 0) {
+      snprintf(step->error, sizeof(step->error), "extract %s: out of memory", ex->var);
+      return -1;
+    }
+  }
+  return 0;
+}
+
+/* Catalog lookup by id, name, or "collection/name". */
+static const request_t *find_request(const request_list_t *catalog, const char *ref) {
+  for (size_t i = 0; i < catalog->len; i++) {
+    if (strcmp(catalog->items[i].id, ref) == 0) {
+      return &catalog->items[i];
+    }
+  }
+  for (size_t i = 0; i < catalog->len; i++) {
+    const request_t *req = &catalog->items[i];
+    size_t clen = strlen(req->collection);
+    if (strcmp(req->name, ref) == 0 ||
+        (clen > 0 && strncmp(ref, req->collection, clen) == 0 && ref[clen] == '/' && strcmp(ref + clen + 1, req->name) == 0)) {
+      return req;
+    }
+  }
+  return NULL;
+}
+
+static long elapsed_ms(const struct timespec *start) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (long)(now.tv_sec - start->tv_sec) * 1000L + (long)((now.tv_nsec - start->tv_nsec) / 1000000L);
+}
+
+static void step_finish(workflow_step_t *step, workflow_step_state_t state, long now_ms) {
+  step->state = state;
+  step->end_ms = now_ms;
+}
+
+/* Marks dependents of failed/skipped steps; returns 1 if the step may start now. */
+static int step_ready(workflow_t *wf, workflow_step_t *step, long now_ms) {
+  if (step->state == WORKFLOW_STEP_WAITING) {
+    return step->retry_at_ms <= now_ms;
+  }
+  if (step->state != WORKFLOW_STEP_PENDING) {
+    return 0;
+  }
+  long last_end = -1;
+  for (size_t d = 0; d < step->deps_len; d++) {
+    const workflow_step_t *dep = &wf->steps[step->deps[d]];
+    if (dep->state == WORKFLOW_STEP_FAILED || dep->state == WORKFLOW_STEP_SKIPPED) {
+      snprintf(step->error, sizeof(step->error), "skipped: %s did not succeed", dep->name);
+      step->start_ms = now_ms;
+      step_finish(step, WORKFLOW_STEP_SKIPPED, now_ms);
+      return 0;
+    }
+    if (dep->state != WORKFLOW_STEP_DONE) {
+      return 0;
+    }
+    if (dep->end_ms > last_end) {
+      last_end = dep->end_ms;
+      step->critical_dep = step->deps[d];
+    }
+  }
+  return 1;
+}
+
+static int step_start(workflow_t *wf, workflow_step_t *step, const request_list_t *catalog, const environment_t *env,
+                      template_set_t *templates, unsigned long *send_counter, http_batch_t *batch, long now_ms) {
+  if (step->state == WORKFLOW_STEP_PENDING) {
+    step->start_ms = now_ms;
+  }
+  const request_t *stored = find_request(catalog, step->request_ref);
+  if (stored == NULL) {
+    snprintf(step->error, sizeof(step->error), "request not found: %s", step->request_ref);
+    return -1;
+  }
+  if (step->sent == NULL) {
+    step->sent = malloc(sizeof(*step->sent));
+    if (step->sent == NULL) {
+      snprintf(step->error, sizeof(step->error), "out of memory");
+      return -1;
+    }
+  }
+
+  /* Re-resolved on every attempt so polls pick up fresh generator values. */
+  template_iteration_t iteration;
+  template_iteration_begin(&iteration, ++*send_counter);
+  if (environment_resolve_request(env, &wf->vars, templates, stored, &iteration, step->sent) != 0) {
+    snprintf(step->error, sizeof(step->error), "request too large after {{var}} expansion");
+    return -1;
+  }
+  free(step->variables);
+  step->variables = environment_describe_variables(env, &wf->vars, templates, stored);
+  if (http_batch_add(batch, step->sent, step) != 0) {
+    snprintf(step->error, sizeof(step->error), "failed to start transfer");
+    return -1;
+  }
+  step->tries++;
+  step->state = WORKFLOW_STEP_RUNNING;
+  return 0;
+}
+
+static void step_complete(workflow_t *wf, workflow_step_t *step, const http_response_t *response, int rc,
+                          long now_ms) {
+  step->status = response->status_code;
+  if (rc != 0) {
+    snprintf(step->error, sizeof(step->error), "%s", response->error[0] ? response->error : "transfer failed");
+    step_finish(step, WORKFLOW_STEP_FAILED, now_ms);
+    return;
+  }
+  if (step->until_status > 0 && response->status_code != step->until_status) {
+    if (step->tries < step->max_tries) {
+      step->state = WORKFLOW_STEP_WAITING;
+      step->retry_at_ms = now_ms + step->retry_ms;
+      return;
+    }
+    snprintf(step->error, sizeof(step->error), "status %ld after %d tries (wanted %ld)", response->status_code,
+             step->tries, step->until_status);
+    step_finish(step, WORKFLOW_STEP_FAILED, now_ms);
+    return;
+  }
+  if (response->status_code >= 400) {
+    snprintf(step->error, sizeof(step->error), "HTTP %ld", response->status_code);
+    step_finish(step, WORKFLOW_STEP_FAILED, now_ms);
+    return;
+  }
+  step_finish(step, apply_extracts(wf, step, response) == 0 ? WORKFLOW_STEP_DONE : WORKFLOW_STEP_FAILED, now_ms);
+}
+
+static void build_report(const workflow_t *wf, long wall_ms, workflow_report_t *report) {
+  memset(report, 0, sizeof(*report));
+  report->wall_ms = wall_ms;
+
+  size_t last = NO_STEP;
+  for (size_t i = 0; i < wf->len; i++) {
+    const workflow_step_t *step = &wf->steps[i];
+    if (step->state == WORKFLOW_STEP_DONE) {
+      report->ok++;
+    } else if (step->state == WORKFLOW_STEP_SKIPPED) {
+      report->skipped++;
+      continue;
+    } else {
+      report->failed++;
+    }
+    report->busy_ms += step->end_ms - step->start_ms;
+    if (last == NO_STEP || step->end_ms > wf->steps[last].end_ms) {
+      last = i;
+    }
+  }
+
+  /* Critical path: from the step that finished last, follow the dependency that released it. */
+  report->critical = malloc((wf->len > 0 ? wf->len : 1) * sizeof(size_t));
+  if (report->critical == NULL) {
+    return;
+  }
+  for (size_t i = last; i != NO_STEP; i = wf->steps[i].critical_dep) {
+    report->critical[report->critical_len++] = i;
+  }
+  for (size_t i = 0; i < report->critical_len / 2; i++) {
+    size_t tmp = report->critical[i];
+    report->critical[i] = report->critical[report->critical_len - 1 - i];
+    report->critical[report->critical_len - 1 - i] = tmp;
+  }
+}
+
+int workflow_run(workflow_t *wf, const request_list_t *catalog, const environment_t *env, unsigned long *send_counter,
+                 workflow_attempt_fn on_attempt, void *ctx, workflow_report_t *report) {
+  http_batch_t *batch = http_batch_new();
+  /* The catalog is fixed for the run, so every poll of a step reuses its first compile. */
+  template_set_t *templates = template_set_new();
+  if (batch == NULL || templates == NULL) {
+    http_batch_free(batch);
+    template_set_free(templates);
+    return -1;
+  }
+  for (size_t i = 0; i < wf->len; i++) {
+    workflow_step_t *step = &wf->steps[i];
+    step->state = WORKFLOW_STEP_PENDING;
+    step->tries = 0;
+    step->status = 0;
+    step->error[0] = '\0';
+    step->critical_dep = NO_STEP;
+  }
+
+  struct timespec started;
+  clock_gettime(CLOCK_MONOTONIC, &started);
+
+  for (;;) {
+    long now_ms = elapsed_ms(&started);
+    size_t waiting = 0;
+    long next_retry = -1;
+    for (size_t i = 0; i < wf->len; i++) {
+      workflow_step_t *step = &wf->steps[i];
+      if (http_batch_pending(batch) < TUIMAN_WORKFLOW_MAX_PARALLEL && step_ready(wf, step, now_ms)) {
+        if (step_start(wf, step, catalog, env, templates, send_counter, batch, now_ms) != 0) {
+          step_finish(step, WORKFLOW_STEP_FAILED, now_ms);
+        }
+      }
+      if (step->state == WORKFLOW_STEP_WAITING || step->state == WORKFLOW_STEP_PENDING) {
+        waiting++;
+        if (step->state == WORKFLOW_STEP_WAITING && (next_retry < 0 || step->retry_at_ms < next_retry)) {
+          next_retry = step->retry_at_ms;
+        }
+      }
+    }
+
+    if (http_batch_pending(batch) == 0) {
+      if (waiting == 0) {
+        break;
+      }
+      if (next_retry < 0) {
+        /* Pending steps whose dependencies can no longer finish; the next pass skips them. */
+        continue;
+      }
+      long delay = next_retry - elapsed_ms(&started);
+      if (delay > 0) {
+        struct timespec ts = {delay / 1000, (delay % 1000) * 1000000L};
+        nanosleep(&ts, NULL);
+      }
+      continue;
+    }
+
+    long timeout = WORKFLOW_POLL_MS;
+    if (next_retry >= 0 && next_retry - now_ms < timeout) {
+      timeout = next_retry > now_ms ? next_retry - now_ms : 0;
+    }
+    http_response_t response;
+    void *tag = NULL;
+    int got = http_batch_next(batch, timeout, &response, &tag);
+    if (got < 0) {
+      break;
+    }
+    if (got == 0) {
+      continue;
+    }
+    workflow_step_t *step = (workflow_step_t *)tag;
+    int rc = response.error[0] != '\0' ? -1 : 0;
+    step_complete(wf, step, &response, rc, elapsed_ms(&started));
+    if (on_attempt != NULL) {
+      on_attempt(ctx, step, step->sent, step->variables, &response);
+    }
+    http_response_free(&response);
+  }
+
+  http_batch_free(batch);
+  template_set_free(templates);
+  build_report(wf, elapsed_ms(&started), report);
+  return report->failed == 0 && report->skipped == 0 ? 0 : -1;
+}
+
+void workflow_report_free(workflow_report_t *report) {
+  free(report->critical);
+  report->critical = NULL;
+  report->critical_len = 0;
+}
+
+static const char *state_label(workflow_step_state_t state) {
+  switch (state) {
+  case WORKFLOW_STEP_DONE:
+    return "ok";
+  case WORKFLOW_STEP_FAILED:
+    return "FAILED";
+  case WORKFLOW_STEP_SKIPPED:
+    return "skipped";
+  default:
+    return "pending";
+  }
+}
+
+char *workflow_format_report(const workflow_t *wf, const workflow_report_t *report) {
+  size_t cap = 1024 + wf->len * (TUIMAN_URL_LEN + 512) + wf->vars.len * TUIMAN_HEADER_KEY_LEN;
+  char *out = malloc(cap);
+  if (out == NULL) {
+    return NULL;
+  }
+  size_t used = 0;
+#define REPORT_APPEND(...)                                                            \
+  do {                                                                                \
+    int n_ = snprintf(out + used, cap - used, __VA_ARGS__);                           \
+    if (n_ > 0) {                                                                     \
+      used = (size_t)n_ < cap - used ? used + (size_t)n_ : cap - 1;                   \
+    }                                                                                 \
+  } while (0)
+
+  REPORT_APPEND("workflow %s: %zu ok, %zu failed, %zu skipped\n", wf->name, report->ok, report->failed,
+                report->skipped);
+  REPORT_APPEND("wall %ld ms, step time %ld ms\n", report->wall_ms, report->busy_ms);
+  REPORT_APPEND("critical path:");
+  for (size_t i = 0; i < report->critical_len; i++) {
+    const workflow_step_t *step = &wf->steps[report->critical[i]];
+    REPORT_APPEND("%s %s (%ld ms)", i == 0 ? "" : " ->", step->name, step->end_ms - step->start_ms);
+  }
+  REPORT_APPEND("\n\n");
+
+  for (size_t i = 0; i < wf->len; i++) {
+    const workflow_step_t *step = &wf->steps[i];
+    REPORT_APPEND("%-16s %-7s", step->name, state_label(step->state));
+    if (step->state != WORKFLOW_STEP_SKIPPED) {
+      REPORT_APPEND(" %3ld  +%ld..%ld ms", step->status, step->start_ms, step->end_ms);
+      if (step->tries > 1) {
+        REPORT_APPEND("  %d tries", step->tries);
+      }
+      if (step->sent != NULL) {
+        REPORT_APPEND("  %s %s", step->sent->method, step->sent->url);
+      }
+    }
+    if (step->error[0] != '\0') {
+      REPORT_APPEND("\n    %s", step->error);
+    }
+    REPORT_APPEND("\n");
+  }
+
+  /* Names only: extracted values are often tokens. */
+  if (wf->vars.len > 0) {
+    REPORT_APPEND("\nextracted:");
+    for (size_t i = 0; i < wf->vars.len; i++) {
+      REPORT_APPEND(" %s", wf->vars.vars[i].name);
+    }
+    REPORT_APPEND("\n");
+  }
+#undef REPORT_APPEND
+  return out;
+}
@@ -0,0 +1,205 @@
+#include "tuiman/wrap_index.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tuiman/text_width.h"
+
+/* Offsets live in fixed chunks so published entries never move while the worker appends. */
+#define CHUNK_SHIFT 16
+#define CHUNK_LINES ((size_t)1 << CHUNK_SHIFT)
+
+struct wrap_index {
+  pthread_t thread;
+  int threaded;
+  atomic_int cancel;
+  char *owned; /* the worker's copy of the text */
+  const char *text;
+  size_t len;
+  int width;
+
+  size_t **chunks; /* enough slots for one line per byte */
+  size_t chunks_cap;
+  atomic_size_t count;
+  atomic_int done;
+};
+
+size_t wrap_line_next(const char *text, size_t len, size_t pos, int width, size_t *span_start, size_t *span_len) {
+  while (pos < len && text[pos] == '\r') {
+    pos++;
+  }
+  size_t start = pos;
+  size_t columns = 0;
+  while (pos < len && columns < (size_t)width) {
+    size_t room = (size_t)width - columns;
+    size_t run = text_ascii_run(text + pos, len - pos < room ? len - pos : room);
+    pos += run;
+    columns += run;
+    if (pos >= len || columns >= (size_t)width) {
+      break;
+    }
+    char c = text[pos];
+    if (c == '\n' || c == '\r' || c == '\0') {
+      break;
+    }
+    uint32_t cp = 0;
+    size_t used = text_decode(text + pos, len - pos, &cp);
+    int cp_width = text_codepoint_width(cp);
+    /* A wide character that does not fit starts the next line (unless the line would be empty). */
+    if (columns + (size_t)cp_width > (size_t)width && pos > start) {
+      break;
+    }
+    pos += used;
+    columns += (size_t)cp_width;
+  }
+  /* Combining marks belong to the character before them, even at the end of a full line. */
+  while (pos < len && (unsigned char)text[pos] >= 0x80) {
+    uint32_t cp = 0;
+    size_t used = text_decode(text + pos, len - pos, &cp);
+    if (text_codepoint_width(cp) != 0 || cp == TEXT_CP_INVALID) {
+      break;
+    }
+    pos += used;
+  }
+  if (span_start != NULL) {
+    *span_start = start;
+  }
+  if (span_len != NULL) {
+    *span_len = pos - start;
+  }
+  if (pos < len && text[pos] == '\r') {
+    pos++;
+    if (pos < len && text[pos] == '\n') {
+      pos++;
+    }
+  } else if (pos < len && text[pos] == '\n') {
+    pos++;
+  }
+  return pos;
+}
+
+static void build(wrap_index_t *index) {
+  size_t line = 0;
+  size_t pos = 0;
+  while (pos < index->len && index->text[pos] != '\0') {
+    size_t slot = line >> CHUNK_SHIFT;
+    if ((line & (CHUNK_LINES - 1)) == 0) {
+      if (atomic_load_explicit(&index->cancel, memory_order_relaxed) || slot >= index->chunks_cap) {
+        break;
+      }
+      index->chunks[slot] = malloc(CHUNK_LINES * sizeof(size_t));
+      if (index->chunks[slot] == NULL) {
+        break;
+      }
+    }
+    index->chunks[slot][line & (CHUNK_LINES - 1)] = pos;
+    line++;
+    if ((line & 1023) == 0) {
+      atomic_store_explicit(&index->count, line, memory_order_release);
+    }
+    pos = wrap_line_next(index->text, index->len, pos, index->width, NULL, NULL);
+  }
+  atomic_store_explicit(&index->count, line, memory_order_release);
+  atomic_store_explicit(&index->done, 1, memory_order_release);
+}
+
+static void *build_thread(void *arg) {
+  build(arg);
+  return NULL;
+}
+
+int wrap_index_start(const char *text, size_t len, int width, wrap_index_t **out) {
+  if (text == NULL || width <= 0 || out == NULL) {
+    return -1;
+  }
+  wrap_index_t *index = calloc(1, sizeof(*index));
+  if (index == NULL) {
+    return -1;
+  }
+  index->len = len;
+  index->width = width;
+  index->chunks_cap = (len >> CHUNK_SHIFT) + 1;
+  index->chunks = calloc(index->chunks_cap, sizeof(*index->chunks));
+  if (index->chunks == NULL) {
+    free(index);
+    return -1;
+  }
+
+  if (len < TUIMAN_WRAP_INDEX_BACKGROUND_BYTES) {
+    index->text = text;
+    build(index);
+    index->text = NULL;
+    *out = index;
+    return 0;
+  }
+
+  index->owned = malloc(len);
+  if (index->owned == NULL) {
+    wrap_index_free(index);
+    return -1;
+  }
+  memcpy(index->owned, text, len);
+  index->text = index->owned;
+  if (pthread_create(&index->thread, NULL, build_thread, index) != 0) {
+    wrap_index_free(index);
+    return -1;
+  }
+  index->threaded = 1;
+  *out = index;
+  return 0;
+}
+
+size_t wrap_index_count(const wrap_index_t *index, int *done) {
+  if (index == NULL) {
+    if (done != NULL) {
+      *done = 1;
+    }
+    return 0;
+  }
+  /* Read `done` first so a finished index never reports a stale count. */
+  int finished = atomic_load_explicit(&((wrap_index_t *)index)->done, memory_order_acquire);
+  if (done != NULL) {
+    *done = finished;
+  }
+  return atomic_load_explicit(&((wrap_index_t *)index)->count, memory_order_acquire);
+}
+
+size_t wrap_index_line_start(const wrap_index_t *index, size_t line) {
+  return index->chunks[line >> CHUNK_SHIFT][line & (CHUNK_LINES - 1)];
+}
+
+size_t wrap_index_line_at(const wrap_index_t *index, size_t offset) {
+  size_t count = wrap_index_count(index, NULL);
+  if (count == 0) {
+    return 0;
+  }
+  size_t lo = 0;
+  size_t hi = count - 1;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo + 1) / 2;
+    if (wrap_index_line_start(index, mid) <= offset) {
+      lo = mid;
+    } else {
+      hi = mid - 1;
+    }
+  }
+  return lo;
+}
+
+void wrap_index_free(wrap_index_t *index) {
+  if (index == NULL) {
+    return;
+  }
+  if (index->threaded) {
+    atomic_store(&index->cancel, 1);
+    pthread_join(index->thread, NULL);
+  }
+  for (size_t i = 0; i < index->chunks_cap && index->chunks[i] != NULL; i++) {
+    free(index->chunks[i]);
+  }
+  free(index->chunks);
+  free(index->owned);
+  free(index);
+}
@@ -1,21 +1,39 @@
 #include <ctype.h>
+#include <errno.h>
+#include <locale.h>
 #include <ncurses.h>
+#include <poll.h>
 #include <sqlite3.h>
+#include <stdatomic.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <unistd.h>
 
 #include "tuiman/editor.h"
+#include "tuiman/environment.h"
 #include "tuiman/export_import.h"
+#include "tuiman/fuzzy.h"
 #include "tuiman/history_store.h"
+#include "tuiman/highlight.h"
 #include "tuiman/http_client.h"
 #include "tuiman/json_body.h"
+#include "tuiman/json_tree.h"
 #include "tuiman/keychain_macos.h"
+#include "tuiman/pager.h"
 #include "tuiman/paths.h"
+#include "tuiman/request_snapshot.h"
 #include "tuiman/request_store.h"
+#include "tuiman/request_watch.h"
+#include "tuiman/search_index.h"
+#include "tuiman/text_diff.h"
+#include "tuiman/text_width.h"
+#include "tuiman/workflow.h"
+#include "tuiman/wrap_index.h"
 
 #ifndef TUIMAN_VERSION
 #define TUIMAN_VERSION "dev"
@@ -23,6 +41,19 @@
 
 #define CMDLINE_MAX 256
 #define STATUS_MAX 512
+#define FUZZY_TOP_K 1000
+#define HISTORY_PAGE 200
+#define HISTORY_PREFETCH 50
+#define HISTORY_SEARCH_LIMIT 200
+#define LATENCY_CACHE_LEN 64
+/* Windows slide with the clock; cached summaries older than this are recomputed. */
+#define LATENCY_CACHE_TTL 30
+#define LATENCY_WINDOW_DEFAULT 2
+/* Unchanged lines kept around each change; longer unchanged runs fold into one row. */
+#define DIFF_CONTEXT 3
+#define DIFF_HSCROLL_STEP 8
+/* How much of a spilled response the preview pane shows; `P` pages through the rest. */
+#define SPILL_PREVIEW_BYTES (64 * 1024)
 #define DEFAULT_MAIN_STATUS \
   "j/k move | / search | : command | Enter actions | E edit | d delete | ZZ/ZQ quit | { } req body | [ ] resp body | drag"
 
@@ -34,11 +65,19 @@
 #define EDITOR_MIN_LEFT_W 42
 #define EDITOR_MIN_RIGHT_W 30
 
+#define FRAME_MS 16
+#define JOB_POLL_MS 50
+#define INPUT_BURST_MAX 512
+#define WATCH_EVENT_BATCH 64
+
 typedef enum {
   SCREEN_MAIN = 0,
   SCREEN_NEW = 1,
   SCREEN_HISTORY = 2,
   SCREEN_HELP = 3,
+  SCREEN_DIFF = 4,
+  SCREEN_PAGER = 5,
+  SCREEN_TREE = 6,
 } screen_t;
 
 typedef enum {
@@ -109,23 +148,216 @@ typedef struct {
   int right_w;
 } history_layout_t;
 
+typedef enum {
+  PANE_MAIN_LIST = 0,
+  PANE_MAIN_PREVIEW,
+  PANE_MAIN_RESPONSE,
+  PANE_EDITOR_FORM,
+  PANE_EDITOR_PREVIEW,
+  PANE_HISTORY_LIST,
+  PANE_HISTORY_DETAIL,
+  PANE_COUNT,
+} pane_id_t;
+
+/* A window kept across frames; it is recreated only when its geometry changes. */
+typedef struct {
+  WINDOW *win;
+  int h;
+  int w;
+  int y;
+  int x;
+  bool dirty;
+  /* List panes: what the last paint showed, so a selection move repaints just two rows. */
+  size_t drawn_selected;
+  size_t drawn_scroll;
+} pane_t;
+
+/* Wrapped-line index and highlighting of the body a pane shows; the owner resets it when it replaces the body. */
+typedef struct {
+  wrap_index_t *index;
+  highlighter_t highlight; /* kept across width changes; set up on first draw unless the owner set regions */
+  const char *text;
+  size_t len;
+  int width;
+  size_t anchor;      /* byte offset to scroll back to once the rebuilt index reaches it; 0 if none */
+  size_t drawn_count; /* what the pane last showed, to notice background progress */
+  int drawn_done;
+} wrap_cache_t;
+
+typedef enum {
+  LIST_ROW_REQUEST = 0,
+  LIST_ROW_COLLECTION = 1,
+} list_row_kind_t;
+
+/* A left-pane row: an index into app->requests or app->collections. */
+typedef struct {
+  list_row_kind_t kind;
+  size_t index;
+} list_row_t;
+
+typedef struct {
+  char path[TUIMAN_COLLECTION_LEN];
+  long count; /* direct requests; -1 until scanned when the backend cannot count cheaply */
+  bool expanded;
+  bool scanned;
+} collection_node_t;
+
+/* Ranked `?` results; `matches` keeps every hit for `query` so a longer query rescans only those. */
+typedef struct {
+  char query[CMDLINE_MAX];
+  size_t *matches;
+  size_t matches_len;
+  bool valid; /* cleared whenever request indices shift */
+  char saved_filter[CMDLINE_MAX];
+  bool saved_fuzzy;
+} fuzzy_state_t;
+
+/* History `/` search; while `active` the list shows ranked hits instead of the paged runs. */
+typedef struct {
+  bool prompt;
+  bool active;
+  char query[CMDLINE_MAX];
+  history_hit_list_t hits;
+  size_t selected;
+  size_t scroll;
+} history_search_t;
+
+typedef enum {
+  DIFF_ROW_SAME = 0,
+  DIFF_ROW_REMOVED = 1,
+  DIFF_ROW_ADDED = 2,
+  DIFF_ROW_CHANGED = 3, /* side by side: `a` and/or `b` */
+  DIFF_ROW_FOLD = 4,    /* `a` unchanged lines hidden */
+} diff_row_kind_t;
+
+/* A screen row of the diff; `a` / `b` are line numbers into each side, -1 for none. */
+typedef struct {
+  diff_row_kind_t kind;
+  long a;
+  long b;
+} diff_row_t;
+
+/* The `D` diff screen. Rows are appended as the worker publishes blocks; all but the last block's are final. */
+typedef struct {
+  text_diff_t *job;
+  text_diff_view_t view;
+  char title_a[160];
+  char title_b[160];
+  bool side_by_side;
+  diff_row_t *rows;
+  size_t rows_len;
+  size_t rows_cap;
+  size_t rows_blocks;
+  size_t rows_final_len;
+  size_t scroll;
+  size_t hscroll;
+} diff_screen_t;
+
+/*
+ * One response body (heap, or a spilled mapping), shared by the last-response
+ * view and the run queued on the history writer; the last holder frees it.
+ */
+typedef struct {
+  atomic_int holders;
+  http_response_t response; /* only the body fields are used */
+} response_body_t;
+
+/* The `P` pager. `pager` reads in place: the mapped last response, or `owned` (a history run's body, a report). */
+typedef struct {
+  pager_t pager;
+  char *owned;
+  int source_fd; /* a file holding the same bytes, for saving without a copy; -1 if none */
+  char title[160];
+  screen_t back;
+  char prompt; /* ':' goto, 's' save path, 0 none; the input is `cmdline` */
+  char message[STATUS_MAX];
+} pager_screen_t;
+
+/* The `T` JSON tree over a body read in place, owned the same way as the pager's. */
+typedef struct {
+  json_tree_t tree;
+  char *owned;
+  char title[160];
+  screen_t back;
+  size_t cursor;
+  size_t scroll;
+  bool prompt; /* `:` path input in `cmdline` */
+  char message[STATUS_MAX];
+} tree_screen_t;
+
+/* Preview latency windows, cycled with `w`; 0 seconds means all time. */
+static const struct {
+  const char *label;
+  long seconds;
+} LATENCY_WINDOWS[] = {
+    {"1h", 3600L}, {"24h", 86400L}, {"7d", 7L * 86400L}, {"30d", 30L * 86400L}, {"all", 0},
+};
+
+/* Per-request latency summary; an empty request_id marks a free slot. */
+typedef struct {
+  char request_id[TUIMAN_ID_LEN];
+  int window;
+  time_t computed_at;
+  history_latency_t stats;
+} latency_cache_entry_t;
+
 typedef struct {
   app_paths_t paths;
-  sqlite3 *db;
+  history_store_t history;
+  /* Runs are recorded off the UI thread; NULL falls back to inserting inline. */
+  history_writer_t *history_writer;
+  request_store_t store;
+  request_watch_t watch;
+  /* Active variable set for {{var}} expansion; empty (no name) when none is selected. */
+  environment_t env;
+  unsigned long send_counter;
 
   request_list_t requests;
-  size_t *visible_indices;
+  /* Trigram index over exactly the requests in `requests`. */
+  search_index_t *search;
+  /* Compiled {{var}} templates of the requests in `requests` that have been sent. */
+  template_set_t *templates;
+  collection_node_t *collections;
+  size_t collections_len;
+  list_row_t *visible_rows;
   size_t visible_len;
   size_t selected_visible;
   size_t scroll;
   char filter[CMDLINE_MAX];
+  /* `filter` is a fuzzy query: rows are the top-ranked requests rather than catalog order. */
+  bool filter_fuzzy;
+  fuzzy_state_t fuzzy;
 
   run_list_t runs;
+  /* Metadata of the runs paged in so far; only the selected run holds its bodies. */
   size_t history_selected;
   size_t history_scroll;
+  size_t history_bodies_index; /* SIZE_MAX when no run has its bodies loaded */
+  bool history_exhausted;
   size_t history_detail_scroll;
+  history_search_t history_search;
+  /* Detail text of the run with this id; rebuilt only when another run is shown. */
+  char *history_detail_text;
+  int history_detail_run_id;
+  wrap_cache_t history_wrap;
+  /* Base run for `D` (metadata only); id 0 when nothing is marked. */
+  run_entry_t history_mark;
+  diff_screen_t diff;
+  pager_screen_t pager;
+  tree_screen_t tree;
+
+  /* Moving the selection only hits this cache; writer commits (or direct writes) invalidate it. */
+  latency_cache_entry_t latency_cache[LATENCY_CACHE_LEN];
+  size_t latency_cache_next;
+  int latency_window;
 
   screen_t screen;
+  /* Damage tracking: panes repaint only when dirty; stdscr (dividers) only when `chrome_dirty`. */
+  pane_t panes[PANE_COUNT];
+  screen_t drawn_screen;
+  bool chrome_dirty;
+  bool damage_known; /* the last key handler marked exactly the panes it changed */
+  bool frame_pending; /* state changed since the last frame was drawn */
   main_mode_t main_mode;
   new_mode_t new_mode;
   drag_mode_t drag_mode;
@@ -144,8 +376,10 @@ typedef struct {
   size_t request_body_scroll;
   size_t response_body_scroll;
   size_t editor_body_scroll;
+  wrap_cache_t response_wrap;
 
   char delete_confirm_id[TUIMAN_ID_LEN];
+  char delete_confirm_collection[TUIMAN_COLLECTION_LEN];
   char delete_confirm_name[TUIMAN_NAME_LEN];
 
   request_t draft;
@@ -164,8 +398,12 @@ typedef struct {
   long last_response_status;
   long last_response_ms;
   char last_response_error[256];
-  char *last_response_body;
+  /* What the response pane shows: the shared body itself, or `last_response_preview`. */
+  const char *last_response_body;
   size_t last_response_body_len;
+  response_body_t *last_response_shared;
+  /* Head of a spilled body plus a note; the whole body stays mapped in `last_response_shared`. */
+  char *last_response_preview;
 } app_t;
 
 enum {
@@ -180,23 +418,31 @@ enum {
   COLOR_STATUS_5XX = 9,
   COLOR_LABEL = 10,
   COLOR_SECTION = 11,
+  COLOR_DIFF_ADDED = 12,
+  COLOR_DIFF_REMOVED = 13,
+  COLOR_SYNTAX_KEY = 14,
+  COLOR_SYNTAX_STRING = 15,
+  COLOR_SYNTAX_NUMBER = 16,
+  COLOR_SYNTAX_LITERAL = 17,
+  COLOR_SYNTAX_TAG = 18,
+  COLOR_SYNTAX_COMMENT = 19,
 };
 
 enum {
   DRAFT_FIELD_NAME = 0,
   DRAFT_FIELD_METHOD = 1,
   DRAFT_FIELD_URL = 2,
-  DRAFT_FIELD_HEADER_KEY = 3,
-  DRAFT_FIELD_HEADER_VALUE = 4,
-  DRAFT_FIELD_AUTH_TYPE = 5,
-  DRAFT_FIELD_AUTH_SECRET_REF = 6,
-  DRAFT_FIELD_AUTH_KEY_NAME = 7,
-  DRAFT_FIELD_AUTH_LOCATION = 8,
-  DRAFT_FIELD_AUTH_USERNAME = 9,
-  DRAFT_FIELD_COUNT = 10,
+  DRAFT_FIELD_HEADERS = 3,
+  DRAFT_FIELD_AUTH_TYPE = 4,
+  DRAFT_FIELD_AUTH_SECRET_REF = 5,
+  DRAFT_FIELD_AUTH_KEY_NAME = 6,
+  DRAFT_FIELD_AUTH_LOCATION = 7,
+  DRAFT_FIELD_AUTH_USERNAME = 8,
+  DRAFT_FIELD_COUNT = 9,
 };
 
 static int method_color_pair(const char *method);
+static void open_pager(app_t *app, const char *data, size_t len, char *owned, int source_fd, const char *title);
 
 static void set_status(app_t *app, const char *message) {
   snprintf(app->status, sizeof(app->status), "%s", message);
@@ -347,6 +593,80 @@ static void set_resize_status(app_t *app, const main_layout_t *layout) {
   set_status(app, msg);
 }
 
+static void invalidate_panes(app_t *app) {
+  for (int i = 0; i < PANE_COUNT; i++) {
+    app->panes[i].dirty = true;
+  }
+  app->chrome_dirty = true;
+}
+
+/* For key handlers that know exactly which pane they changed; after any other event every pane repaints. */
+static void damage_pane(app_t *app, pane_id_t id) {
+  app->panes[id].dirty = true;
+  app->damage_known = true;
+}
+
+static WINDOW *pane_place(app_t *app, pane_id_t id, int h, int w, int y, int x) {
+  pane_t *pane = &app->panes[id];
+  if (pane->win != NULL && pane->h == h && pane->w == w && pane->y == y && pane->x == x) {
+    return pane->win;
+  }
+  if (pane->win != NULL) {
+    delwin(pane->win);
+  }
+  pane->win = newwin(h, w, y, x);
+  pane->h = h;
+  pane->w = w;
+  pane->y = y;
+  pane->x = x;
+  pane->dirty = true;
+  app->chrome_dirty = true;
+  return pane->win;
+}
+
+static void pane_drop(app_t *app, pane_id_t id) {
+  pane_t *pane = &app->panes[id];
+  if (pane->win != NULL) {
+    delwin(pane->win);
+    pane->win = NULL;
+    app->chrome_dirty = true;
+  }
+}
+
+/*
+ * Called once the screen's panes are placed. Returns true when stdscr was
+ * cleared (new screen, new geometry, or an event without known damage), in
+ * which case every pane repaints and the caller redraws its dividers.
+ */
+static bool frame_needs_chrome(app_t *app, screen_t screen) {
+  if (app->drawn_screen != screen) {
+    app->drawn_screen = screen;
+    app->chrome_dirty = true;
+  }
+  if (!app->chrome_dirty) {
+    return false;
+  }
+  erase();
+  for (int i = 0; i < PANE_COUNT; i++) {
+    app->panes[i].dirty = true;
+  }
+  app->chrome_dirty = false;
+  return true;
+}
+
+/* Queues the panes after stdscr; stdscr goes last again only to place the cursor. */
+static void flush_panes(app_t *app, const pane_id_t *ids, int count) {
+  wnoutrefresh(stdscr);
+  for (int i = 0; i < count; i++) {
+    pane_t *pane = &app->panes[ids[i]];
+    if (pane->win != NULL) {
+      wnoutrefresh(pane->win);
+    }
+    pane->dirty = false;
+  }
+  wnoutrefresh(stdscr);
+}
+
 static void enable_extended_mouse_tracking(void) {
   /*
    * ncurses often enables click-only tracking (1000). Force drag-capable
@@ -399,6 +719,151 @@ static void now_iso(char out[40]) {
   strftime(out, 40, "%Y-%m-%dT%H:%M:%SZ", &tm_utc);
 }
 
+static void wrap_cache_reset(wrap_cache_t *cache) {
+  wrap_index_free(cache->index);
+  highlighter_free(&cache->highlight);
+  memset(cache, 0, sizeof(*cache));
+}
+
+/*
+ * The index of `text` at `width`, rebuilt only when either changed. A width
+ * change keeps the top line's byte offset and finds it again in the new index.
+ */
+static wrap_index_t *wrap_cache_sync(wrap_cache_t *cache, const char *text, int width, size_t *scroll) {
+  if (cache->index != NULL && (cache->text != text || cache->width != width)) {
+    size_t anchor = cache->anchor;
+    if (cache->text == text && anchor == 0 && *scroll > 0 && *scroll < wrap_index_count(cache->index, NULL)) {
+      anchor = wrap_index_line_start(cache->index, *scroll);
+    }
+    bool same_text = cache->text == text;
+    size_t len = cache->len;
+    highlighter_t highlight = cache->highlight;
+    memset(&cache->highlight, 0, sizeof(cache->highlight));
+    wrap_cache_reset(cache);
+    if (same_text) {
+      cache->text = text;
+      cache->len = len;
+      cache->anchor = anchor;
+      cache->highlight = highlight;
+    } else {
+      highlighter_free(&highlight);
+    }
+  }
+  if (cache->index == NULL) {
+    if (cache->text != text) {
+      cache->len = strlen(text);
+    }
+    cache->text = text;
+    cache->width = width;
+    if (wrap_index_start(text, cache->len, width, &cache->index) != 0) {
+      cache->index = NULL;
+      return NULL;
+    }
+  }
+
+  if (cache->anchor > 0) {
+    int done = 0;
+    size_t count = wrap_index_count(cache->index, &done);
+    if (done || (count > 0 && wrap_index_line_start(cache->index, count - 1) >= cache->anchor)) {
+      *scroll = wrap_index_line_at(cache->index, cache->anchor);
+      cache->anchor = 0;
+    }
+  }
+  return cache->index;
+}
+
+/* True when a background build found lines the pane has not shown yet, or highlighting has not caught up. */
+static bool wrap_cache_progressed(const wrap_cache_t *cache) {
+  if (cache->highlight.behind) {
+    return true;
+  }
+  if (cache->index == NULL || cache->drawn_done) {
+    return false;
+  }
+  int done = 0;
+  size_t count = wrap_index_count(cache->index, &done);
+  return done || count != cache->drawn_count;
+}
+
+/* Takes the body out of `response` with one hold for the caller; NULL when out of memory (the body stays). */
+static response_body_t *response_body_take(http_response_t *response) {
+  response_body_t *body = calloc(1, sizeof(*body));
+  if (body == NULL) {
+    return NULL;
+  }
+  atomic_init(&body->holders, 1);
+  body->response.body = response->body;
+  body->response.body_len = response->body_len;
+  body->response.body_spilled = response->body_spilled;
+  body->response.body_fd = response->body_fd;
+  response->body = NULL;
+  response->body_len = 0;
+  response->body_spilled = 0;
+  response->body_fd = -1;
+  return body;
+}
+
+static response_body_t *response_body_hold(response_body_t *body) {
+  atomic_fetch_add(&body->holders, 1);
+  return body;
+}
+
+/* Also the history writer's body_release, so it may run on the writer thread. */
+static void response_body_release(void *owner) {
+  response_body_t *body = owner;
+  if (body != NULL && atomic_fetch_sub(&body->holders, 1) == 1) {
+    http_response_free(&body->response);
+    free(body);
+  }
+}
+
+/*
+ * Shows `body` as the last response, taking over the caller's hold (NULL
+ * clears it). A spilled body is previewed by its head, cut at a line break.
+ */
+static void set_last_response(app_t *app, response_body_t *body) {
+  static const char unavailable[] = "(response body unavailable: out of memory)";
+  wrap_cache_reset(&app->response_wrap);
+  app->response_body_scroll = 0;
+  response_body_release(app->last_response_shared);
+  free(app->last_response_preview);
+  app->last_response_shared = body;
+  app->last_response_preview = NULL;
+  app->last_response_body = unavailable;
+  app->last_response_body_len = sizeof(unavailable) - 1;
+  if (body == NULL) {
+    return;
+  }
+
+  const http_response_t *response = &body->response;
+  if (!response->body_spilled) {
+    app->last_response_body = response->body != NULL ? response->body : "";
+    app->last_response_body_len = response->body != NULL ? response->body_len : 0;
+    return;
+  }
+  size_t head = response->body_len < SPILL_PREVIEW_BYTES ? response->body_len : SPILL_PREVIEW_BYTES;
+  size_t cut = head;
+  while (cut > 0 && response->body[cut - 1] != '\n') {
+    cut--;
+  }
+  if (cut == 0) {
+    cut = head;
+    while (cut > 0 && ((unsigned char)response->body[cut] & 0xc0) == 0x80) {
+      cut--;
+    }
+  }
+  char note[128];
+  int note_len = snprintf(note, sizeof(note), "\n... %zu bytes in all; P pages through the whole body", response->body_len);
+  char *preview = malloc(cut + (size_t)note_len + 1);
+  if (preview != NULL) {
+    memcpy(preview, response->body, cut);
+    memcpy(preview + cut, note, (size_t)note_len + 1);
+    app->last_response_preview = preview;
+    app->last_response_body = preview;
+    app->last_response_body_len = cut + (size_t)note_len;
+  }
+}
+
 static void clear_last_response(app_t *app) {
   app->last_response_request_id[0] = '\0';
   app->last_response_request_name[0] = '\0';
@@ -408,12 +873,21 @@ static void clear_last_response(app_t *app) {
   app->last_response_status = 0;
   app->last_response_ms = 0;
   app->last_response_error[0] = '\0';
-  app->response_body_scroll = 0;
-  free(app->last_response_body);
+  set_last_response(app, NULL);
   app->last_response_body = NULL;
   app->last_response_body_len = 0;
 }
 
+/* The whole last response body, which is more than the preview when it was spilled. */
+static const char *last_response_full(const app_t *app, size_t *len) {
+  if (app->last_response_shared != NULL && app->last_response_shared->response.body_spilled) {
+    *len = app->last_response_shared->response.body_len;
+    return app->last_response_shared->response.body;
+  }
+  *len = app->last_response_body_len;
+  return app->last_response_body;
+}
+
 static char *dup_text_n(const char *text, size_t len) {
   const char *src = text != NULL ? text : "";
   char *out = malloc(len + 1);
@@ -425,63 +899,6 @@ static char *dup_text_n(const char *text, size_t len) {
   return out;
 }
 
-static char *build_request_snapshot(const request_t *req) {
-  if (req == NULL) {
-    return NULL;
-  }
-
-  int has_header = req->header_key[0] != '\0' || req->header_value[0] != '\0';
-  const char *name = req->name[0] != '\0' ? req->name : "(unnamed)";
-  const char *auth_type = req->auth_type[0] != '\0' ? req->auth_type : "none";
-  const char *secret_ref = req->auth_secret_ref[0] != '\0' ? req->auth_secret_ref : "(none)";
-  const char *auth_key_name = req->auth_key_name[0] != '\0' ? req->auth_key_name : "(none)";
-  const char *auth_location = req->auth_location[0] != '\0' ? req->auth_location : "(none)";
-  const char *auth_username = req->auth_username[0] != '\0' ? req->auth_username : "(none)";
-  const char *body = req->body[0] != '\0' ? req->body : "(empty)";
-
-  size_t needed = strlen(name) + strlen(req->method) + strlen(req->url) + strlen(auth_type) + strlen(secret_ref) +
-                  strlen(auth_key_name) + strlen(auth_location) + strlen(auth_username) + strlen(body) +
-                  strlen(req->header_key) + strlen(req->header_value) + 512;
-
-  char *snapshot = malloc(needed);
-  if (snapshot == NULL) {
-    return NULL;
-  }
-
-  if (has_header) {
-    snprintf(snapshot, needed,
-             "name: %s\n"
-             "method: %s\n"
-             "url: %s\n"
-             "auth: %s\n"
-             "secret_ref: %s\n"
-             "auth_key_name: %s\n"
-             "auth_location: %s\n"
-             "auth_username: %s\n"
-             "header: %s: %s\n"
-             "body:\n"
-             "%s",
-             name, req->method, req->url, auth_type, secret_ref, auth_key_name, auth_location, auth_username,
-             req->header_key, req->header_value, body);
-  } else {
-    snprintf(snapshot, needed,
-             "name: %s\n"
-             "method: %s\n"
-             "url: %s\n"
-             "auth: %s\n"
-             "secret_ref: %s\n"
-             "auth_key_name: %s\n"
-             "auth_location: %s\n"
-             "auth_username: %s\n"
-             "header: none\n"
-             "body:\n"
-             "%s",
-             name, req->method, req->url, auth_type, secret_ref, auth_key_name, auth_location, auth_username, body);
-  }
-
-  return snapshot;
-}
-
 static void append_fmt(char *buf, size_t cap, size_t *offset, const char *fmt, ...) {
   if (buf == NULL || offset == NULL || fmt == NULL || *offset >= cap) {
     return;
@@ -504,137 +921,74 @@ static void append_fmt(char *buf, size_t cap, size_t *offset, const char *fmt, .
   }
 }
 
-static int snapshot_extract_line_value(const char *snapshot, const char *prefix, char *out, size_t out_len) {
-  if (out == NULL || out_len == 0) {
+static int view_is_meaningful(snapshot_value_t value) {
+  if (value.len == 0) {
     return 0;
   }
-  out[0] = '\0';
-
-  if (snapshot == NULL || snapshot[0] == '\0' || prefix == NULL) {
+  if ((value.len == 4 && memcmp(value.ptr, "none", 4) == 0) || (value.len == 6 && memcmp(value.ptr, "(none)", 6) == 0)) {
     return 0;
   }
-
-  size_t prefix_len = strlen(prefix);
-  const char *p = snapshot;
-  while (*p != '\0') {
-    const char *line_end = p;
-    while (*line_end != '\0' && *line_end != '\n' && *line_end != '\r') {
-      line_end++;
-    }
-
-    size_t line_len = (size_t)(line_end - p);
-    if (line_len == 5 && strncmp(p, "body:", 5) == 0) {
-      break;
-    }
-
-    if (line_len >= prefix_len && strncmp(p, prefix, prefix_len) == 0) {
-      size_t value_len = line_len - prefix_len;
-      if (value_len >= out_len) {
-        value_len = out_len - 1;
-      }
-      memcpy(out, p + prefix_len, value_len);
-      out[value_len] = '\0';
-      return 1;
-    }
-
-    p = line_end;
-    while (*p == '\n' || *p == '\r') {
-      p++;
-    }
-  }
-
-  return 0;
+  return 1;
 }
 
-static const char *snapshot_body_start(const char *snapshot) {
-  if (snapshot == NULL || snapshot[0] == '\0') {
-    return NULL;
-  }
-
-  const char *p = snapshot;
-  while (*p != '\0') {
-    const char *line_end = p;
-    while (*line_end != '\0' && *line_end != '\n' && *line_end != '\r') {
-      line_end++;
-    }
-
-    size_t line_len = (size_t)(line_end - p);
-    if (line_len == 5 && strncmp(p, "body:", 5) == 0) {
-      p = line_end;
-      while (*p == '\n' || *p == '\r') {
-        p++;
-      }
-      return p;
-    }
-
-    p = line_end;
-    while (*p == '\n' || *p == '\r') {
-      p++;
-    }
-  }
-
-  return NULL;
+static void append_view_line(char *buf, size_t cap, size_t *offset, const char *label, snapshot_value_t value) {
+  append_fmt(buf, cap, offset, "%s%.*s\n", label, (int)value.len, value.ptr != NULL ? value.ptr : "");
 }
 
-static int has_meaningful_value(const char *value) {
-  if (value == NULL || value[0] == '\0') {
-    return 0;
-  }
-  if (strcmp(value, "none") == 0 || strcmp(value, "(none)") == 0) {
-    return 0;
+/* Appends each line of `lines` under `label`, dropping `strip` from the start of a line when present. */
+static void append_view_lines(char *buf, size_t cap, size_t *offset, const char *label, snapshot_value_t lines,
+                              const char *strip) {
+  size_t strip_len = strip != NULL ? strlen(strip) : 0;
+  const char *p = lines.ptr;
+  const char *end = lines.ptr + lines.len;
+  while (p != NULL && p < end) {
+    const char *nl = memchr(p, '\n', (size_t)(end - p));
+    const char *line_end = nl != NULL ? nl : end;
+    snapshot_value_t line = {p, (size_t)(line_end - p)};
+    if (strip_len > 0 && line.len >= strip_len && memcmp(line.ptr, strip, strip_len) == 0) {
+      line.ptr += strip_len;
+      line.len -= strip_len;
+    }
+    if (view_is_meaningful(line)) {
+      append_view_line(buf, cap, offset, label, line);
+    }
+    p = line_end + 1;
   }
-  return 1;
 }
 
-static char *build_history_detail_text(const run_entry_t *run) {
+/* Rendered once per selected run (see history_detail_text), never per frame; `highlight` covers the two bodies. */
+static char *build_history_detail_text(const run_entry_t *run, highlighter_t *highlight) {
   if (run == NULL) {
     return NULL;
   }
 
-  char method[64];
-  char url[768];
-  char auth[128];
-  char secret_ref[160];
-  char auth_key_name[160];
-  char auth_location[96];
-  char auth_username[160];
-  char header[512];
-
-  snprintf(method, sizeof(method), "%s", run->method);
-  snprintf(url, sizeof(url), "%s", run->url);
-  auth[0] = '\0';
-  secret_ref[0] = '\0';
-  auth_key_name[0] = '\0';
-  auth_location[0] = '\0';
-  auth_username[0] = '\0';
-  header[0] = '\0';
-
-  const char *request_body = "(request snapshot unavailable for this run)";
-  if (run->request_snapshot != NULL && run->request_snapshot[0] != '\0') {
-    (void)snapshot_extract_line_value(run->request_snapshot, "method: ", method, sizeof(method));
-    (void)snapshot_extract_line_value(run->request_snapshot, "url: ", url, sizeof(url));
-    (void)snapshot_extract_line_value(run->request_snapshot, "auth: ", auth, sizeof(auth));
-    (void)snapshot_extract_line_value(run->request_snapshot, "secret_ref: ", secret_ref, sizeof(secret_ref));
-    (void)snapshot_extract_line_value(run->request_snapshot, "auth_key_name: ", auth_key_name, sizeof(auth_key_name));
-    (void)snapshot_extract_line_value(run->request_snapshot, "auth_location: ", auth_location, sizeof(auth_location));
-    (void)snapshot_extract_line_value(run->request_snapshot, "auth_username: ", auth_username, sizeof(auth_username));
-    (void)snapshot_extract_line_value(run->request_snapshot, "header: ", header, sizeof(header));
-
-    const char *body = snapshot_body_start(run->request_snapshot);
-    if (body != NULL) {
-      request_body = body[0] != '\0' ? body : "(empty)";
-    } else {
-      request_body = "(request body unavailable for this run)";
-    }
+  request_snapshot_t snapshot;
+  request_snapshot_decode(run->request_snapshot, &snapshot);
+  snapshot_value_t *fields = snapshot.fields;
+  if (fields[SNAPSHOT_METHOD].len == 0) {
+    fields[SNAPSHOT_METHOD] = (snapshot_value_t){run->method, strlen(run->method)};
+  }
+  if (fields[SNAPSHOT_URL].len == 0) {
+    fields[SNAPSHOT_URL] = (snapshot_value_t){run->url, strlen(run->url)};
+  }
+  snapshot_value_t request_body = fields[SNAPSHOT_BODY];
+  if (run->request_snapshot == NULL || run->request_snapshot[0] == '\0') {
+    const char *missing = "(request snapshot unavailable for this run)";
+    request_body = (snapshot_value_t){missing, strlen(missing)};
+  } else if (request_body.len == 0) {
+    request_body = (snapshot_value_t){"(empty)", 7};
   }
 
-  const char *response_body =
-      (run->response_body != NULL && run->response_body[0] != '\0') ? run->response_body : "(empty)";
+  bool has_body = run->response_body != NULL && run->response_body_len > 0;
+  const char *response_body = has_body ? run->response_body : "(empty)";
+  size_t response_len = has_body ? run->response_body_len : strlen(response_body);
   const char *error_text = run->error[0] != '\0' ? run->error : "none";
 
-  size_t needed = strlen(method) + strlen(url) + strlen(auth) + strlen(secret_ref) + strlen(auth_key_name) +
-                  strlen(auth_location) + strlen(auth_username) + strlen(header) + strlen(request_body) +
-                  strlen(response_body) + strlen(error_text) + 1024;
+  size_t needed = response_len + strlen(error_text) + 1024;
+  for (int i = 0; i < SNAPSHOT_FIELD_COUNT; i++) {
+    /* Room for a label on every line of the multi-line fields. */
+    needed += fields[i].len * 2 + 32;
+  }
   char *text = malloc(needed);
   if (text == NULL) {
     return NULL;
@@ -642,32 +996,56 @@ static char *build_history_detail_text(const run_entry_t *run) {
 
   size_t off = 0;
   append_fmt(text, needed, &off, "Request\n");
-  append_fmt(text, needed, &off, "method: %s\n", method[0] != '\0' ? method : run->method);
-  append_fmt(text, needed, &off, "url: %s\n", url[0] != '\0' ? url : run->url);
-  if (has_meaningful_value(auth)) {
-    append_fmt(text, needed, &off, "auth: %s\n", auth);
-  }
-  if (has_meaningful_value(secret_ref)) {
-    append_fmt(text, needed, &off, "secret_ref: %s\n", secret_ref);
-  }
-  if (has_meaningful_value(auth_key_name)) {
-    append_fmt(text, needed, &off, "auth_key_name: %s\n", auth_key_name);
-  }
-  if (has_meaningful_value(auth_location)) {
-    append_fmt(text, needed, &off, "auth_location: %s\n", auth_location);
-  }
-  if (has_meaningful_value(auth_username)) {
-    append_fmt(text, needed, &off, "auth_username: %s\n", auth_username);
-  }
-  if (has_meaningful_value(header)) {
-    append_fmt(text, needed, &off, "header: %s\n", header);
-  }
-  append_fmt(text, needed, &off, "body:\n%s\n\n", request_body);
+  append_view_line(text, needed, &off, "method: ", fields[SNAPSHOT_METHOD]);
+  append_view_line(text, needed, &off, "url: ", fields[SNAPSHOT_URL]);
+  if (fields[SNAPSHOT_ENVIRONMENT].len > 0) {
+    append_view_line(text, needed, &off, "environment: ", fields[SNAPSHOT_ENVIRONMENT]);
+  }
+  static const struct {
+    snapshot_field_t field;
+    const char *label;
+  } AUTH_FIELDS[] = {
+      {SNAPSHOT_AUTH_TYPE, "auth: "},
+      {SNAPSHOT_AUTH_SECRET_REF, "secret_ref: "},
+      {SNAPSHOT_AUTH_KEY_NAME, "auth_key_name: "},
+      {SNAPSHOT_AUTH_LOCATION, "auth_location: "},
+      {SNAPSHOT_AUTH_USERNAME, "auth_username: "},
+  };
+  for (size_t i = 0; i < sizeof(AUTH_FIELDS) / sizeof(AUTH_FIELDS[0]); i++) {
+    if (view_is_meaningful(fields[AUTH_FIELDS[i].field])) {
+      append_view_line(text, needed, &off, AUTH_FIELDS[i].label, fields[AUTH_FIELDS[i].field]);
+    }
+  }
+  append_view_lines(text, needed, &off, "header: ", fields[SNAPSHOT_HEADERS], snapshot.legacy ? "header: " : NULL);
+  append_view_lines(text, needed, &off, "var: ", fields[SNAPSHOT_VARIABLES], NULL);
+  append_fmt(text, needed, &off, "body:\n");
+  size_t request_at = off;
+  append_fmt(text, needed, &off, "%.*s\n\n", (int)request_body.len, request_body.ptr);
 
   append_fmt(text, needed, &off, "Response\n");
   append_fmt(text, needed, &off, "error: %s\n", error_text);
-  append_fmt(text, needed, &off, "body:\n%s", response_body);
+  append_fmt(text, needed, &off, "body:\n");
+  size_t response_at = off;
+  /* The pane draws a C string, so NUL bytes show as '.'; P pages the exact bytes. */
+  if (off + response_len < needed) {
+    memcpy(text + off, response_body, response_len);
+    for (size_t i = 0; i < response_len; i++) {
+      if (text[off + i] == '\0') {
+        text[off + i] = '.';
+      }
+    }
+    off += response_len;
+    text[off] = '\0';
+  }
 
+  highlighter_init(highlight, text, off);
+  if (fields[SNAPSHOT_BODY].len > 0) {
+    highlighter_add_region(highlight, request_at, request_at + request_body.len,
+                           highlight_detect(request_body.ptr, request_body.len));
+  }
+  if (has_body) {
+    highlighter_add_region(highlight, response_at, off, highlight_detect(text + response_at, off - response_at));
+  }
   return text;
 }
 
@@ -710,11 +1088,9 @@ static void line_backspace_word(char *buf, size_t *len) {
   buf[*len] = '\0';
 }
 
+/* stdin is non-blocking for the whole session; the main loop waits in poll(). */
 static int read_next_key_nowait(void) {
-  nodelay(stdscr, TRUE);
-  int next = getch();
-  nodelay(stdscr, FALSE);
-  return next;
+  return getch();
 }
 
 static int launch_editor_and_restore_tui(const char *initial_text, char *out, size_t out_len, const char *suffix) {
@@ -808,6 +1184,19 @@ static void win_printf_text(WINDOW *win, int y, int x, const char *fmt, ...) {
   win_add_text(win, y, x, buffer);
 }
 
+/* Re-draws the matched bytes of `text` (drawn at x) emphasised, clipped to `width` columns. */
+static void win_highlight_chars(WINDOW *win, int y, int x, int width, const char *text, const size_t *positions,
+                                size_t len) {
+  wattron(win, A_BOLD | A_UNDERLINE);
+  for (size_t i = 0; i < len; i++) {
+    if ((int)positions[i] < width) {
+      char one[2] = {text[positions[i]], '\0'};
+      win_add_text(win, y, x + (int)positions[i], one);
+    }
+  }
+  wattroff(win, A_BOLD | A_UNDERLINE);
+}
+
 static void win_add_labeled_text(WINDOW *win, int y, int x, const char *label, const char *value) {
   if (win == NULL || label == NULL || value == NULL) {
     return;
@@ -875,38 +1264,86 @@ static size_t wrapped_total_line_count(const char *text, int width) {
     return 0;
   }
 
+  size_t len = strlen(text);
   size_t lines = 0;
-  const char *p = text;
-  while (*p != '\0') {
-    while (*p == '\r') {
-      p++;
-    }
+  for (size_t pos = 0; pos < len; lines++) {
+    pos = wrap_line_next(text, len, pos, width, NULL, NULL);
+  }
+  return lines;
+}
 
-    int len = 0;
-    while (p[len] != '\0' && p[len] != '\n' && p[len] != '\r' && len < width) {
-      len++;
+/* Draws bytes as UTF-8; tabs become a space, other control characters and malformed bytes a '?'. */
+static void win_add_display_span(WINDOW *win, int y, int x, const char *text, size_t len) {
+  wmove(win, y, x);
+  while (len > 0) {
+    size_t printable = text_printable_prefix(text, len);
+    if (printable > 0) {
+      waddnstr(win, text, (int)printable);
+      text += printable;
+      len -= printable;
+      continue;
     }
+    uint32_t cp = 0;
+    size_t used = text_decode(text, len, &cp);
+    waddch(win, cp == '\t' ? ' ' : '?');
+    text += used;
+    len -= used;
+  }
+}
 
-    lines++;
-    p += len;
+static attr_t highlight_attr(highlight_token_t token) {
+  switch (token) {
+  case HIGHLIGHT_KEY:
+  case HIGHLIGHT_ATTR:
+    return COLOR_PAIR(COLOR_SYNTAX_KEY);
+  case HIGHLIGHT_STRING:
+    return COLOR_PAIR(COLOR_SYNTAX_STRING);
+  case HIGHLIGHT_NUMBER:
+    return COLOR_PAIR(COLOR_SYNTAX_NUMBER);
+  case HIGHLIGHT_LITERAL:
+    return COLOR_PAIR(COLOR_SYNTAX_LITERAL);
+  case HIGHLIGHT_TAG:
+    return COLOR_PAIR(COLOR_SYNTAX_TAG) | A_BOLD;
+  case HIGHLIGHT_COMMENT:
+    return COLOR_PAIR(COLOR_SYNTAX_COMMENT) | A_DIM;
+  default:
+    return 0;
+  }
+}
 
-    if (*p == '\r') {
-      p++;
-      if (*p == '\n') {
-        p++;
-      }
-    } else if (*p == '\n') {
-      p++;
+/* Draws one wrapped line in token colors; `*lexed` and `*state` carry the lexer from the previous line. */
+static void win_add_highlighted_span(WINDOW *win, int y, int x, const highlighter_t *highlight,
+                                     highlight_state_t *state, size_t *lexed, size_t start, size_t len) {
+  highlight_token_t token = HIGHLIGHT_PLAIN;
+  /* Line breaks and '\r' between wrapped lines still move the lexer. */
+  while (*lexed < start) {
+    *lexed = highlighter_next(highlight, state, *lexed, start, &token);
+  }
+  wmove(win, y, x);
+  while (*lexed < start + len) {
+    size_t from = *lexed;
+    *lexed = highlighter_next(highlight, state, from, start + len, &token);
+    attr_t attr = highlight_attr(token);
+    getyx(win, y, x);
+    if (attr != 0) {
+      wattron(win, attr);
+    }
+    win_add_display_span(win, y, x, highlight->text + from, *lexed - from);
+    if (attr != 0) {
+      wattroff(win, attr);
     }
   }
-
-  return lines;
 }
 
-static size_t win_draw_wrapped_text_view(WINDOW *win, int start_y, int start_x, int max_lines, int max_width,
-                                         const char *text, size_t start_line) {
+/*
+ * Draws up to `max_lines` wrapped lines of `text`, the first one starting at
+ * byte `pos`. With `highlight` (over the same text) only these lines are
+ * lexed, from the nearest checkpoint before `pos`.
+ */
+static void win_draw_wrapped_span(WINDOW *win, int start_y, int start_x, int max_lines, int max_width,
+                                  const char *text, size_t len, size_t pos, highlighter_t *highlight) {
   if (win == NULL || text == NULL || max_lines <= 0 || max_width <= 0) {
-    return 0;
+    return;
   }
 
   int wh = 0;
@@ -916,7 +1353,7 @@ static size_t win_draw_wrapped_text_view(WINDOW *win, int start_y, int start_x,
     start_x = 0;
   }
   if (start_x >= ww || start_y >= wh) {
-    return 0;
+    return;
   }
 
   int width = max_width;
@@ -924,53 +1361,33 @@ static size_t win_draw_wrapped_text_view(WINDOW *win, int start_y, int start_x,
     width = ww - start_x;
   }
   if (width <= 0) {
-    return 0;
+    return;
   }
 
-  const char *p = text;
-  size_t line_index = 0;
-  int drawn = 0;
-  while (*p != '\0') {
+  highlight_state_t state;
+  size_t lexed = pos;
+  bool colored = highlight != NULL && highlight->regions_len > 0 && has_colors() &&
+                 highlighter_seek(highlight, pos, &state) == 0;
+  for (int drawn = 0; drawn < max_lines && pos < len && text[pos] != '\0'; drawn++) {
+    size_t span_start = 0;
+    size_t span_len = 0;
+    pos = wrap_line_next(text, len, pos, width, &span_start, &span_len);
     int y = start_y + drawn;
-    if (drawn >= max_lines || y < 0 || y >= wh) {
-      y = -1;
-    }
-
-    while (*p == '\r') {
-      p++;
-    }
-
-    int len = 0;
-    while (p[len] != '\0' && p[len] != '\n' && p[len] != '\r' && len < width) {
-      len++;
-    }
-
-    if (line_index >= start_line && drawn < max_lines && y >= 0 && len > 0) {
-      mvwaddnstr(win, y, start_x, p, len);
-      drawn++;
-    } else if (line_index >= start_line && drawn < max_lines && y >= 0) {
-      drawn++;
-    }
-
-    line_index++;
-    p += len;
-
-    if (*p == '\r') {
-      p++;
-      if (*p == '\n') {
-        p++;
+    if (y >= 0 && y < wh && span_len > 0) {
+      if (colored) {
+        win_add_highlighted_span(win, y, start_x, highlight, &state, &lexed, span_start, span_len);
+      } else {
+        win_add_display_span(win, y, start_x, text + span_start, span_len);
       }
-    } else if (*p == '\n') {
-      p++;
     }
   }
-
-  return line_index;
 }
 
 static void win_draw_wrapped_text(WINDOW *win, int start_y, int start_x, int max_lines, int max_width,
                                   const char *text) {
-  (void)win_draw_wrapped_text_view(win, start_y, start_x, max_lines, max_width, text, 0);
+  if (text != NULL) {
+    win_draw_wrapped_span(win, start_y, start_x, max_lines, max_width, text, strlen(text), 0, NULL);
+  }
 }
 
 static int wrapped_line_count(const char *text, int width, int max_lines) {
@@ -978,27 +1395,11 @@ static int wrapped_line_count(const char *text, int width, int max_lines) {
     return 0;
   }
 
+  size_t len = strlen(text);
   int lines = 0;
-  const char *p = text;
-  while (*p != '\0' && lines < max_lines) {
-    int used = 0;
-    while (p[used] != '\0' && p[used] != '\n' && p[used] != '\r' && used < width) {
-      used++;
-    }
-
-    lines++;
-    p += used;
-
-    if (*p == '\r') {
-      p++;
-      if (*p == '\n') {
-        p++;
-      }
-    } else if (*p == '\n') {
-      p++;
-    }
+  for (size_t pos = 0; pos < len && lines < max_lines; lines++) {
+    pos = wrap_line_next(text, len, pos, width, NULL, NULL);
   }
-
   return lines;
 }
 
@@ -1017,8 +1418,13 @@ static size_t clamp_scroll_offset(size_t scroll, size_t total_lines, int view_li
   return scroll;
 }
 
+/*
+ * `cache` may be NULL for bodies small enough to re-walk every frame (request
+ * bodies). `highlight` may be NULL for plain text; one not yet over `text` is
+ * set up with the language highlight_detect finds.
+ */
 static void win_draw_wrapped_body_preview(WINDOW *win, int start_y, int max_lines, int width, const char *text,
-                                          size_t *scroll_offset) {
+                                          size_t *scroll_offset, wrap_cache_t *cache, highlighter_t *highlight) {
   if (win == NULL || max_lines <= 0 || width <= 0) {
     return;
   }
@@ -1031,11 +1437,26 @@ static void win_draw_wrapped_body_preview(WINDOW *win, int start_y, int max_line
     return;
   }
 
-  size_t total_lines = wrapped_total_line_count(text, width);
+  /* The index has to wrap exactly where drawing will. */
+  if (width > getmaxx(win)) {
+    width = getmaxx(win);
+  }
   size_t scroll = scroll_offset != NULL ? *scroll_offset : 0;
+  wrap_index_t *index = cache != NULL ? wrap_cache_sync(cache, text, width, &scroll) : NULL;
+  size_t len = index != NULL ? cache->len : strlen(text);
+  int building = 0;
+  size_t total_lines = 0;
+  if (index != NULL) {
+    total_lines = wrap_index_count(index, &building);
+    building = !building;
+    cache->drawn_count = total_lines;
+    cache->drawn_done = !building;
+  } else {
+    total_lines = wrapped_total_line_count(text, width);
+  }
 
   int content_lines = max_lines;
-  int show_hint = (total_lines > (size_t)max_lines || scroll > 0) ? 1 : 0;
+  int show_hint = (total_lines > (size_t)max_lines || scroll > 0 || building) ? 1 : 0;
   if (show_hint && max_lines >= 2) {
     content_lines = max_lines - 1;
   }
@@ -1048,7 +1469,20 @@ static void win_draw_wrapped_body_preview(WINDOW *win, int start_y, int max_line
     *scroll_offset = scroll;
   }
 
-  (void)win_draw_wrapped_text_view(win, start_y, 0, content_lines, width, text, scroll);
+  size_t pos = 0;
+  if (index != NULL) {
+    pos = scroll < total_lines ? wrap_index_line_start(index, scroll) : len;
+  } else {
+    for (size_t line = 0; line < scroll && pos < len; line++) {
+      pos = wrap_line_next(text, len, pos, width, NULL, NULL);
+    }
+  }
+  if (highlight != NULL && highlight->text != text) {
+    highlighter_free(highlight);
+    highlighter_init(highlight, text, len);
+    highlighter_add_region(highlight, 0, len, highlight_detect(text, len));
+  }
+  win_draw_wrapped_span(win, start_y, 0, content_lines, width, text, len, pos, highlight);
 
   if (show_hint && max_lines >= 2) {
     size_t shown = 0;
@@ -1061,9 +1495,9 @@ static void win_draw_wrapped_body_preview(WINDOW *win, int start_y, int max_line
 
     char hint[128];
     int up = scroll > 0;
-    int down = (scroll + shown) < total_lines;
-    snprintf(hint, sizeof(hint), "%c body %zu-%zu/%zu %c", up ? '^' : ' ', scroll + 1, scroll + shown, total_lines,
-             down ? 'v' : ' ');
+    int down = (scroll + shown) < total_lines || building;
+    snprintf(hint, sizeof(hint), "%c body %zu-%zu/%zu%s %c", up ? '^' : ' ', scroll + 1, scroll + shown, total_lines,
+             building ? "+" : "", down ? 'v' : ' ');
 
     if (has_colors()) {
       wattron(win, COLOR_PAIR(COLOR_LABEL));
@@ -1173,1392 +1607,3495 @@ static int contains_case_insensitive(const char *haystack, const char *needle) {
   return 0;
 }
 
-static request_t *selected_request(app_t *app) {
+static const list_row_t *selected_row(const app_t *app) {
   if (app->visible_len == 0 || app->selected_visible >= app->visible_len) {
     return NULL;
   }
-  size_t index = app->visible_indices[app->selected_visible];
-  if (index >= app->requests.len) {
+  return &app->visible_rows[app->selected_visible];
+}
+
+static request_t *selected_request(app_t *app) {
+  const list_row_t *row = selected_row(app);
+  if (row == NULL || row->kind != LIST_ROW_REQUEST || row->index >= app->requests.len) {
     return NULL;
   }
-  return &app->requests.items[index];
+  return &app->requests.items[row->index];
 }
 
-static void apply_filter(app_t *app, const char *select_id) {
-  free(app->visible_indices);
-  app->visible_indices = NULL;
-  app->visible_len = 0;
-  app->request_body_scroll = 0;
+static collection_node_t *selected_collection(app_t *app) {
+  const list_row_t *row = selected_row(app);
+  if (row == NULL || row->kind != LIST_ROW_COLLECTION || row->index >= app->collections_len) {
+    return NULL;
+  }
+  return &app->collections[row->index];
+}
 
-  for (size_t i = 0; i < app->requests.len; i++) {
-    request_t *req = &app->requests.items[i];
-    if (!contains_case_insensitive(req->name, app->filter) && !contains_case_insensitive(req->url, app->filter)) {
-      continue;
-    }
+/* Collection the selection lives in, for `:new` and friends. */
+static const char *selected_collection_path(app_t *app) {
+  request_t *req = selected_request(app);
+  if (req != NULL) {
+    return req->collection;
+  }
+  collection_node_t *node = selected_collection(app);
+  return node != NULL ? node->path : "";
+}
 
-    size_t *next = realloc(app->visible_indices, (app->visible_len + 1) * sizeof(size_t));
-    if (next == NULL) {
-      break;
+static int request_matches_filter(const request_t *req, const char *filter) {
+  return contains_case_insensitive(req->name, filter) || contains_case_insensitive(req->url, filter) ||
+         contains_case_insensitive(req->headers, filter) || contains_case_insensitive(req->body, filter);
+}
+
+static int collection_find(const app_t *app, const char *path, size_t *out_index) {
+  size_t lo = 0;
+  size_t hi = app->collections_len;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    int cmp = request_collection_compare(app->collections[mid].path, path);
+    if (cmp == 0) {
+      *out_index = mid;
+      return 0;
+    }
+    if (cmp < 0) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
     }
-    app->visible_indices = next;
-    app->visible_indices[app->visible_len] = i;
-    app->visible_len++;
   }
+  *out_index = lo;
+  return -1;
+}
 
-  if (app->visible_len == 0) {
-    app->selected_visible = 0;
-    app->scroll = 0;
-    return;
-  }
+static collection_node_t *collection_lookup(app_t *app, const char *path) {
+  size_t index = 0;
+  return collection_find(app, path, &index) == 0 ? &app->collections[index] : NULL;
+}
 
-  app->selected_visible = 0;
-  if (select_id != NULL && select_id[0] != '\0') {
-    for (size_t i = 0; i < app->visible_len; i++) {
-      size_t idx = app->visible_indices[i];
-      if (strcmp(app->requests.items[idx].id, select_id) == 0) {
-        app->selected_visible = i;
-        break;
-      }
+static collection_node_t *collection_add(app_t *app, const char *path, long count) {
+  size_t index = 0;
+  if (collection_find(app, path, &index) == 0) {
+    collection_node_t *node = &app->collections[index];
+    if (!node->scanned && count >= 0) {
+      node->count = count;
     }
+    return node;
   }
 
-  app->scroll = 0;
+  collection_node_t *next = realloc(app->collections, (app->collections_len + 1) * sizeof(collection_node_t));
+  if (next == NULL) {
+    return NULL;
+  }
+  app->collections = next;
+  memmove(&app->collections[index + 1], &app->collections[index],
+          (app->collections_len - index) * sizeof(collection_node_t));
+  collection_node_t *node = &app->collections[index];
+  memset(node, 0, sizeof(*node));
+  snprintf(node->path, sizeof(node->path), "%s", path);
+  node->count = count;
+  app->collections_len++;
+  return node;
 }
 
-static int load_requests(app_t *app, const char *select_id) {
-  request_list_free(&app->requests);
-  if (request_store_list(&app->paths, &app->requests) != 0) {
-    set_status(app, "Failed to load requests");
-    return -1;
+static void collection_adjust_count(app_t *app, const char *path, long delta) {
+  collection_node_t *node = collection_lookup(app, path);
+  if (node != NULL && node->count >= 0) {
+    node->count += delta;
   }
-  apply_filter(app, select_id);
-  return 0;
 }
 
-static int method_color_pair(const char *method) {
-  if (strcmp(method, "GET") == 0) {
-    return COLOR_GET;
-  }
-  if (strcmp(method, "POST") == 0) {
-    return COLOR_POST;
-  }
-  if (strcmp(method, "PUT") == 0) {
-    return COLOR_PUT;
-  }
-  if (strcmp(method, "PATCH") == 0) {
-    return COLOR_PATCH;
-  }
-  if (strcmp(method, "DELETE") == 0) {
-    return COLOR_DELETE;
+static void collection_parent(const char *path, char out[TUIMAN_COLLECTION_LEN]) {
+  snprintf(out, TUIMAN_COLLECTION_LEN, "%s", path);
+  char *slash = strrchr(out, '/');
+  if (slash != NULL) {
+    *slash = '\0';
+  } else {
+    out[0] = '\0';
   }
-  return 0;
 }
 
-static int status_color_pair(long status_code) {
-  if (status_code >= 200 && status_code < 300) {
-    return COLOR_STATUS_2XX;
-  }
-  if (status_code >= 300 && status_code < 400) {
-    return COLOR_STATUS_3XX;
-  }
-  if (status_code >= 400 && status_code < 500) {
-    return COLOR_STATUS_4XX;
-  }
-  if (status_code >= 500) {
-    return COLOR_STATUS_5XX;
+/* True when the collection and every ancestor are expanded (the root always is). */
+static int collection_is_open(app_t *app, const char *path) {
+  char cursor[TUIMAN_COLLECTION_LEN];
+  snprintf(cursor, sizeof(cursor), "%s", path);
+  while (cursor[0] != '\0') {
+    collection_node_t *node = collection_lookup(app, cursor);
+    if (node == NULL || !node->expanded) {
+      return 0;
+    }
+    collection_parent(cursor, cursor);
   }
-  return 0;
+  return 1;
 }
 
-static void draw_main(app_t *app) {
-  int h = 0;
-  int w = 0;
-  getmaxyx(stdscr, h, w);
-
-  main_layout_t layout;
-  compute_main_layout(app, h, w, &layout);
-  if (!layout.valid) {
-    erase();
-    mvprintw(h - 1, 0, "Window too small");
-    refresh();
-    return;
+static int request_row_visible(app_t *app, const request_t *req) {
+  if (app->filter[0] != '\0') {
+    return request_matches_filter(req, app->filter);
   }
+  return collection_is_open(app, req->collection);
+}
 
-  erase();
+static int collection_row_visible(app_t *app, const collection_node_t *node) {
+  if (app->filter[0] != '\0' || node->path[0] == '\0') {
+    return 0;
+  }
+  char parent[TUIMAN_COLLECTION_LEN];
+  collection_parent(node->path, parent);
+  return collection_is_open(app, parent);
+}
 
-  WINDOW *left_win = newwin(layout.top_h, layout.left_w, 0, 0);
-  WINDOW *right_win = NULL;
-  if (layout.show_right) {
-    right_win = newwin(layout.top_h, layout.right_w, 0, layout.right_x);
+/*
+ * One readdir (or one indexed query) for a single collection. Only scanned
+ * collections have their requests in app->requests; the rest of the tree is
+ * known by name (and, where the backend can tell cheaply, by count).
+ */
+static int scan_collection(app_t *app, const char *path) {
+  collection_node_t *node = collection_lookup(app, path);
+  if (node == NULL) {
+    return -1;
   }
-  WINDOW *response_win = NULL;
-  if (layout.response_h > 0) {
-    response_win = newwin(layout.response_h, w, layout.response_y, 0);
+  if (node->scanned) {
+    return 0;
   }
 
-  if (left_win == NULL) {
-    mvprintw(h - 1, 0, "Failed to create list pane");
-    refresh();
-    return;
+  char scan_path[TUIMAN_COLLECTION_LEN];
+  snprintf(scan_path, sizeof(scan_path), "%s", path);
+  request_list_t found = {0};
+  collection_list_t children = {0};
+  if (request_store_scan_collection(&app->store, scan_path, &found, &children) != 0) {
+    return -1;
   }
 
-  werase(left_win);
-  if (right_win != NULL) {
-    werase(right_win);
+  int rc = request_list_merge_sorted(&app->requests, &found);
+  app->fuzzy.valid = false;
+  for (size_t i = 0; rc == 0 && i < found.len; i++) {
+    search_index_put(app->search, &found.items[i]);
   }
-  if (response_win != NULL) {
-    werase(response_win);
+  for (size_t i = 0; rc == 0 && i < children.len; i++) {
+    if (collection_add(app, children.items[i].path, children.items[i].count) == NULL) {
+      rc = -1;
+    }
   }
 
-  int method_x = layout.left_w / 2;
-  if (method_x < 8) {
-    method_x = 8;
+  node = collection_lookup(app, scan_path);
+  if (rc == 0 && node != NULL) {
+    node->scanned = true;
+    node->count = (long)found.len;
+    request_watch_add_collection(&app->watch, scan_path);
   }
-  int url_x = method_x + 8;
-
-  win_add_text(left_win, 0, 1, "Name");
-  win_add_text(left_win, 0, method_x, "Type");
-  win_add_text(left_win, 0, url_x, "URL");
+  request_list_free(&found);
+  collection_list_free(&children);
+  return rc;
+}
 
-  int view_rows = layout.top_h - 1;
-  if (view_rows < 1) {
-    view_rows = 1;
+static void scan_all_collections(app_t *app) {
+  /* Children always sort after their parent, so newly added nodes land ahead of `i`. */
+  for (size_t i = 0; i < app->collections_len; i++) {
+    if (!app->collections[i].scanned) {
+      char path[TUIMAN_COLLECTION_LEN];
+      snprintf(path, sizeof(path), "%s", app->collections[i].path);
+      scan_collection(app, path);
+    }
   }
+}
 
-  if (app->selected_visible < app->scroll) {
-    app->scroll = app->selected_visible;
+static const char *list_row_collection(const app_t *app, const list_row_t *row) {
+  return row->kind == LIST_ROW_COLLECTION ? app->collections[row->index].path
+                                          : app->requests.items[row->index].collection;
+}
+
+static void select_collection_row(app_t *app, const char *path) {
+  for (size_t i = 0; i < app->visible_len; i++) {
+    if (app->visible_rows[i].kind == LIST_ROW_COLLECTION &&
+        strcmp(app->collections[app->visible_rows[i].index].path, path) == 0) {
+      app->selected_visible = i;
+      return;
+    }
   }
-  if (app->selected_visible >= app->scroll + (size_t)view_rows) {
-    app->scroll = app->selected_visible - (size_t)view_rows + 1;
+}
+
+static void request_path_label(const request_t *req, char *out, size_t out_len) {
+  if (req->collection[0] != '\0') {
+    snprintf(out, out_len, "%s/%s", req->collection, req->name);
+  } else {
+    snprintf(out, out_len, "%s", req->name);
   }
+}
 
-  for (int row = 0; row < view_rows; row++) {
-    size_t visible_index = app->scroll + (size_t)row;
-    if (visible_index >= app->visible_len) {
-      break;
-    }
+/* Best of "collection/name" and URL; `positions` (optional) index whichever won, flagged by `in_url`. */
+static int fuzzy_request_score(const fuzzy_pattern_t *pattern, const request_t *req, size_t *positions,
+                               bool *in_url, size_t *length) {
+  char label[TUIMAN_COLLECTION_LEN + TUIMAN_NAME_LEN + 2];
+  request_path_label(req, label, sizeof(label));
+  size_t url_positions[FUZZY_MAX_PATTERN];
+  int best = fuzzy_score(pattern, label, positions);
+  int url = fuzzy_score(pattern, req->url, positions != NULL ? url_positions : NULL);
+  *in_url = url > best;
+  if (*in_url) {
+    best = url;
+    if (positions != NULL) {
+      memcpy(positions, url_positions, pattern->len * sizeof(size_t));
+    }
+  }
+  if (length != NULL) {
+    *length = strlen(*in_url ? req->url : label);
+  }
+  return best;
+}
 
-    size_t req_index = app->visible_indices[visible_index];
-    request_t *req = &app->requests.items[req_index];
-    int y = row + 1;
+static void apply_fuzzy_filter(app_t *app, const char *select_id) {
+  scan_all_collections(app);
+  fuzzy_state_t *fuzzy = &app->fuzzy;
+  fuzzy_pattern_t pattern;
+  fuzzy_pattern_init(&pattern, app->filter);
+
+  /* Typing only narrows: a query that extends the last one can only match a subset of its hits. */
+  size_t prev_len = strlen(fuzzy->query);
+  bool narrow = fuzzy->valid && prev_len > 0 && strncmp(app->filter, fuzzy->query, prev_len) == 0;
+  size_t pool = narrow ? fuzzy->matches_len : app->requests.len;
+
+  fuzzy_hit_t *hits = malloc((pool > 0 ? pool : 1) * sizeof(fuzzy_hit_t));
+  size_t *matches = malloc((pool > 0 ? pool : 1) * sizeof(size_t));
+  if (hits == NULL || matches == NULL) {
+    free(hits);
+    free(matches);
+    fuzzy->valid = false;
+    app->selected_visible = 0;
+    app->scroll = 0;
+    return;
+  }
 
-    if (visible_index == app->selected_visible) {
-      wattron(left_win, A_REVERSE);
-      mvwhline(left_win, y, 0, ' ', layout.left_w);
+  size_t len = 0;
+  for (size_t i = 0; i < pool; i++) {
+    size_t index = narrow ? fuzzy->matches[i] : i;
+    bool in_url = false;
+    size_t length = 0;
+    int score = fuzzy_request_score(&pattern, &app->requests.items[index], NULL, &in_url, &length);
+    if (score == FUZZY_NO_MATCH) {
+      continue;
     }
+    hits[len].item = index;
+    hits[len].score = score;
+    hits[len].length = length;
+    matches[len] = index;
+    len++;
+  }
 
-    win_printf_text(left_win, y, 1, "%-28.28s", req->name);
-    int pair = method_color_pair(req->method);
-    if (pair != 0 && has_colors()) {
-      wattron(left_win, COLOR_PAIR(pair));
-    }
-    win_printf_text(left_win, y, method_x, "%-6.6s", req->method);
-    if (pair != 0 && has_colors()) {
-      wattroff(left_win, COLOR_PAIR(pair));
-    }
+  free(fuzzy->matches);
+  fuzzy->matches = matches;
+  fuzzy->matches_len = len;
+  snprintf(fuzzy->query, sizeof(fuzzy->query), "%s", app->filter);
+  fuzzy->valid = true;
 
-    int url_space = layout.left_w - (url_x + 1);
-    if (url_space > 0) {
-      win_printf_text(left_win, y, url_x, "%-*.*s", url_space, url_space, req->url);
+  /* Only the rows anyone will look at get sorted. */
+  size_t shown = len < FUZZY_TOP_K ? len : FUZZY_TOP_K;
+  fuzzy_top_k(hits, len, shown);
+  app->visible_rows = malloc((shown > 0 ? shown : 1) * sizeof(list_row_t));
+  if (app->visible_rows != NULL) {
+    for (size_t i = 0; i < shown; i++) {
+      app->visible_rows[i].kind = LIST_ROW_REQUEST;
+      app->visible_rows[i].index = hits[i].item;
     }
+    app->visible_len = shown;
+  }
+  free(hits);
 
-    if (visible_index == app->selected_visible) {
-      wattroff(left_win, A_REVERSE);
+  app->selected_visible = 0;
+  app->scroll = 0;
+  for (size_t i = 0; select_id != NULL && select_id[0] != '\0' && i < app->visible_len; i++) {
+    if (strcmp(app->requests.items[app->visible_rows[i].index].id, select_id) == 0) {
+      app->selected_visible = i;
+      break;
     }
   }
+}
 
-  if (app->visible_len == 0) {
-    win_add_text(left_win, 1, 1, "(empty)");
-    win_add_text(left_win, 2, 1, "Use :new [METHOD] [URL]");
-  }
+static bool fuzzy_filter_active(const app_t *app) {
+  return app->filter_fuzzy && app->filter[0] != '\0';
+}
 
-  if (right_win != NULL) {
-    request_t *selected = selected_request(app);
-    win_add_section_title(right_win, 0, 0, "Request");
-    if (has_colors()) {
-      wattron(right_win, COLOR_PAIR(COLOR_SECTION));
-    }
-    mvwhline(right_win, 1, 0, ACS_HLINE, layout.right_w);
-    if (has_colors()) {
-      wattroff(right_win, COLOR_PAIR(COLOR_SECTION));
-    }
+static void apply_filter(app_t *app, const char *select_id) {
+  free(app->visible_rows);
+  app->visible_rows = NULL;
+  app->visible_len = 0;
+  app->request_body_scroll = 0;
 
-    if (selected == NULL) {
-      app->request_body_scroll = 0;
-      win_draw_wrapped_text(right_win, 2, 0, layout.top_h - 2, layout.right_w, "No requests. Use :new to create one.");
-    } else {
-      int row = 2;
+  if (fuzzy_filter_active(app)) {
+    apply_fuzzy_filter(app, select_id);
+    return;
+  }
 
-      if (selected->name[0] == '\0') {
-        win_add_labeled_text(right_win, row, 0, "name: ", "(unnamed)");
-      } else {
-        win_add_labeled_text(right_win, row, 0, "name: ", selected->name);
-      }
-      row++;
+  search_candidates_t candidates = {0};
+  int indexed = 0;
+  if (app->filter[0] != '\0') {
+    scan_all_collections(app);
+    indexed = search_index_query(app->search, app->filter, &candidates) == 1;
+  }
 
-      wmove(right_win, row, 0);
-      if (has_colors()) {
-        wattron(right_win, COLOR_PAIR(COLOR_LABEL));
-      }
-      wattron(right_win, A_BOLD);
-      waddstr(right_win, "method: ");
-      wattroff(right_win, A_BOLD);
-      if (has_colors()) {
-        wattroff(right_win, COLOR_PAIR(COLOR_LABEL));
-      }
-      int method_pair = method_color_pair(selected->method);
-      if (method_pair != 0 && has_colors()) {
-        wattron(right_win, COLOR_PAIR(method_pair));
-      }
-      waddstr(right_win, selected->method);
-      if (method_pair != 0 && has_colors()) {
-        wattroff(right_win, COLOR_PAIR(method_pair));
-      }
-      row++;
+  /* Sized for the worst case up front, instead of growing once per matching row. */
+  size_t cap = app->collections_len + app->requests.len;
+  app->visible_rows = malloc((cap > 0 ? cap : 1) * sizeof(list_row_t));
+  if (app->visible_rows == NULL) {
+    search_candidates_free(&candidates);
+    app->selected_visible = 0;
+    app->scroll = 0;
+    return;
+  }
 
-      int reserve = 2; /* body title + 1 body line */
-      int has_auth = selected->auth_type[0] != '\0';
-      int has_header = selected->header_key[0] != '\0' || selected->header_value[0] != '\0';
-      if (has_auth || has_header) {
-        reserve += 1; /* config title */
-        if (has_auth) {
-          reserve += 1;
+  if (indexed) {
+    /* Only the candidate rows are visited; folder rows are hidden while filtering anyway. */
+    size_t *rows = NULL;
+    size_t rows_len = 0;
+    if (search_candidates_rows(app->search, &app->requests, &candidates, &rows, &rows_len) == 0) {
+      for (size_t i = 0; i < rows_len; i++) {
+        /* The index only narrows; candidates are confirmed by the substring check. */
+        if (request_row_visible(app, &app->requests.items[rows[i]])) {
+          app->visible_rows[app->visible_len].kind = LIST_ROW_REQUEST;
+          app->visible_rows[app->visible_len].index = rows[i];
+          app->visible_len++;
         }
-        if (has_header) {
-          reserve += 1;
-        }
-      }
-
-      const int url_label_w = 5;
-      if (row < layout.top_h) {
-        win_add_labeled_text(right_win, row, 0, "url: ", "");
-      }
-      int url_width = layout.right_w - url_label_w;
-      if (url_width < 1) {
-        url_width = 1;
-      }
-      int url_lines_max = layout.top_h - row - reserve;
-      if (url_lines_max < 1) {
-        url_lines_max = 1;
-      }
-      if (url_lines_max > 5) {
-        url_lines_max = 5;
       }
-      if (row < layout.top_h) {
-        win_draw_wrapped_text(right_win, row, url_label_w, url_lines_max, url_width, selected->url);
+    }
+    free(rows);
+  } else {
+    /* Merge folders into the catalog: a folder row sorts just before its own requests. */
+    size_t ci = 0;
+    size_t ri = 0;
+    while (ci < app->collections_len || ri < app->requests.len) {
+      list_row_t row;
+      int visible = 0;
+      if (ri >= app->requests.len ||
+          (ci < app->collections_len &&
+           request_collection_compare(app->collections[ci].path, app->requests.items[ri].collection) <= 0)) {
+        row.kind = LIST_ROW_COLLECTION;
+        row.index = ci;
+        visible = collection_row_visible(app, &app->collections[ci]);
+        ci++;
+      } else {
+        row.kind = LIST_ROW_REQUEST;
+        row.index = ri;
+        visible = request_row_visible(app, &app->requests.items[ri]);
+        ri++;
       }
-      int url_lines = wrapped_line_count(selected->url, url_width, url_lines_max);
-      if (url_lines < 1) {
-        url_lines = 1;
+      if (visible) {
+        app->visible_rows[app->visible_len++] = row;
       }
-      row += url_lines;
+    }
+  }
+  search_candidates_free(&candidates);
 
-      if ((has_auth || has_header) && row < layout.top_h) {
-        win_add_section_title(right_win, row, 0, "Config");
-        row++;
-      }
-      if (has_auth && row < layout.top_h) {
-        win_add_labeled_text(right_win, row, 0, "auth: ", selected->auth_type);
-        row++;
-      }
-      if (has_header && row < layout.top_h) {
-        char header_line[384];
-        snprintf(header_line, sizeof(header_line), "%s: %s", selected->header_key, selected->header_value);
-        win_add_labeled_text(right_win, row, 0, "header: ", header_line);
-        row++;
-      }
+  if (app->visible_len == 0) {
+    app->selected_visible = 0;
+    app->scroll = 0;
+    return;
+  }
 
-      if (row < layout.top_h) {
-        win_add_section_title(right_win, row, 0, "Body");
-        row++;
-      }
-      int body_lines = layout.top_h - row;
-      if (body_lines > 0) {
-        win_draw_wrapped_body_preview(right_win, row, body_lines, layout.right_w, selected->body,
-                                      &app->request_body_scroll);
+  app->selected_visible = 0;
+  if (select_id != NULL && select_id[0] != '\0') {
+    for (size_t i = 0; i < app->visible_len; i++) {
+      const list_row_t *row = &app->visible_rows[i];
+      if (row->kind == LIST_ROW_REQUEST && strcmp(app->requests.items[row->index].id, select_id) == 0) {
+        app->selected_visible = i;
+        break;
       }
     }
-  } else {
-    win_add_text(left_win, 1, 1, "Preview hidden (window too narrow)");
-    win_add_text(left_win, 2, 1, "Widen terminal to restore split-pane view.");
   }
 
-  if (layout.show_right) {
-    if (app->drag_mode == DRAG_VERTICAL) {
-      attron(A_REVERSE);
-    }
-    for (int y = 0; y < layout.top_h; y++) {
-      mvaddch(y, layout.separator_x, ACS_VLINE);
-    }
-    if (app->drag_mode == DRAG_VERTICAL) {
-      attroff(A_REVERSE);
-    }
-  }
+  app->scroll = 0;
+}
 
-  if (response_win != NULL) {
-    win_add_section_title(response_win, 0, 0, "Response");
-    if (has_colors()) {
-      wattron(response_win, COLOR_PAIR(COLOR_SECTION));
+static int load_requests(app_t *app, const char *select_id) {
+  /* Re-scan what was scanned before so a reload (rescan, import) keeps the tree open. */
+  collection_node_t *previous = app->collections;
+  size_t previous_len = app->collections_len;
+  app->collections = NULL;
+  app->collections_len = 0;
+  request_list_free(&app->requests);
+  search_index_clear(app->search);
+  template_set_clear(app->templates);
+  app->fuzzy.valid = false;
+
+  collection_node_t *root = collection_add(app, "", -1);
+  int rc = -1;
+  if (root != NULL) {
+    root->expanded = true;
+    rc = scan_collection(app, "");
+  }
+  for (size_t i = 0; rc == 0 && i < previous_len; i++) {
+    if (previous[i].path[0] == '\0' || !previous[i].scanned) {
+      continue;
     }
-    mvwhline(response_win, 1, 0, ACS_HLINE, w);
-    if (has_colors()) {
-      wattroff(response_win, COLOR_PAIR(COLOR_SECTION));
+    if (collection_lookup(app, previous[i].path) != NULL && scan_collection(app, previous[i].path) == 0) {
+      collection_lookup(app, previous[i].path)->expanded = previous[i].expanded;
     }
+  }
+  free(previous);
 
-    if (app->last_response_at[0] == '\0') {
-      app->response_body_scroll = 0;
-      win_add_text(response_win, 2, 0, "No response yet.");
-      win_add_text(response_win, 3, 0, "Select a request, press Enter, then y.");
-    } else {
-      int row = 2;
-
-      wmove(response_win, row, 0);
-      if (has_colors()) {
-        wattron(response_win, COLOR_PAIR(COLOR_LABEL));
-      }
-      wattron(response_win, A_BOLD);
-      waddstr(response_win, "status: ");
-      wattroff(response_win, A_BOLD);
-      if (has_colors()) {
-        wattroff(response_win, COLOR_PAIR(COLOR_LABEL));
-      }
-
-      int s_pair = status_color_pair(app->last_response_status);
-      if (s_pair != 0 && has_colors()) {
-        wattron(response_win, COLOR_PAIR(s_pair));
-      }
-      wprintw(response_win, "%ld", app->last_response_status);
-      if (s_pair != 0 && has_colors()) {
-        wattroff(response_win, COLOR_PAIR(s_pair));
-      }
-      wprintw(response_win, "  duration=%ldms", app->last_response_ms);
-      row++;
-
-      win_add_labeled_text(response_win, row, 0, "at: ", app->last_response_at);
-      row++;
-
-      char request_line[640];
-      snprintf(request_line, sizeof(request_line), "%s %s", app->last_response_method, app->last_response_url);
-      win_add_labeled_text(response_win, row, 0, "request: ", "");
-      int request_label_w = 9;
-      int request_width = w - request_label_w;
-      if (request_width < 1) {
-        request_width = 1;
-      }
-      int request_lines_max = 2;
-      if (app->last_response_error[0] != '\0') {
-        request_lines_max = 1;
-      }
-      if (layout.response_h - row < 5) {
-        request_lines_max = 1;
-      }
-      win_draw_wrapped_text(response_win, row, request_label_w, request_lines_max, request_width, request_line);
-      int request_lines = wrapped_line_count(request_line, request_width, request_lines_max);
-      if (request_lines < 1) {
-        request_lines = 1;
-      }
-      row += request_lines;
+  apply_filter(app, select_id);
+  if (rc != 0) {
+    set_status(app, "Failed to load requests");
+    return -1;
+  }
+  return 0;
+}
 
-      if (app->last_response_request_name[0] != '\0' && row < layout.response_h) {
-        win_add_labeled_text(response_win, row, 0, "name: ", app->last_response_request_name);
-        row++;
-      }
+static void set_collection_expanded(app_t *app, const char *path, bool expanded) {
+  char target[TUIMAN_COLLECTION_LEN];
+  snprintf(target, sizeof(target), "%s", path);
+  collection_node_t *node = collection_lookup(app, target);
+  if (node == NULL || node->expanded == expanded) {
+    return;
+  }
+  if (expanded && scan_collection(app, target) != 0) {
+    set_status_error(app, "Failed to scan collection");
+    return;
+  }
 
-      if (app->last_response_error[0] != '\0' && row < layout.response_h) {
-        if (has_colors()) {
-          wattron(response_win, COLOR_PAIR(COLOR_LABEL));
-        }
-        wattron(response_win, A_BOLD);
-        win_add_text(response_win, row, 0, "error: ");
-        wattroff(response_win, A_BOLD);
-        if (has_colors()) {
-          wattroff(response_win, COLOR_PAIR(COLOR_LABEL));
-        }
-        if (has_colors()) {
-          wattron(response_win, COLOR_PAIR(COLOR_STATUS_5XX));
-        }
-        win_draw_wrapped_text(response_win, row, 7, 2, w - 7, app->last_response_error);
-        if (has_colors()) {
-          wattroff(response_win, COLOR_PAIR(COLOR_STATUS_5XX));
-        }
-        int err_lines = wrapped_line_count(app->last_response_error, w - 7, 2);
-        if (err_lines < 1) {
-          err_lines = 1;
-        }
-        row += err_lines;
-      }
+  collection_lookup(app, target)->expanded = expanded;
+  size_t scroll = app->scroll;
+  apply_filter(app, NULL);
+  select_collection_row(app, target);
+  app->scroll = scroll;
+}
 
-      if (row < layout.response_h) {
-        win_add_section_title(response_win, row, 0, "Body");
-        row++;
+static void visible_remove_request_index(app_t *app, size_t index) {
+  size_t out = 0;
+  for (size_t i = 0; i < app->visible_len; i++) {
+    list_row_t row = app->visible_rows[i];
+    if (row.kind == LIST_ROW_REQUEST) {
+      if (row.index == index) {
+        continue;
       }
-      if (row < layout.response_h) {
-        int lines = layout.response_h - row;
-        win_draw_wrapped_body_preview(response_win, row, lines, w, app->last_response_body, &app->response_body_scroll);
+      if (row.index > index) {
+        row.index--;
       }
     }
+    app->visible_rows[out++] = row;
   }
+  app->visible_len = out;
+}
 
-  if (layout.horizontal_sep_y >= 0) {
-    if (app->drag_mode == DRAG_HORIZONTAL) {
-      attron(A_REVERSE);
-    }
-    mvhline(layout.horizontal_sep_y, 0, ACS_HLINE, w);
-    if (layout.show_right && layout.separator_x >= 0 && layout.separator_x < w) {
-      mvaddch(layout.horizontal_sep_y, layout.separator_x, ACS_PLUS);
-    }
-    if (app->drag_mode == DRAG_HORIZONTAL) {
-      attroff(A_REVERSE);
+static void visible_insert_request_index(app_t *app, size_t index) {
+  for (size_t i = 0; i < app->visible_len; i++) {
+    if (app->visible_rows[i].kind == LIST_ROW_REQUEST && app->visible_rows[i].index >= index) {
+      app->visible_rows[i].index++;
     }
   }
 
-  move(h - 1, 0);
-  clrtoeol();
-  curs_set(0);
-  if (app->main_mode == MAIN_MODE_SEARCH) {
-    mvprintw(h - 1, 0, "/%s", app->cmdline);
-    move(h - 1, (int)app->cmdline_len + 1);
-    curs_set(1);
-  } else if (app->main_mode == MAIN_MODE_REVERSE) {
-    mvprintw(h - 1, 0, "?%s", app->cmdline);
-    move(h - 1, (int)app->cmdline_len + 1);
-    curs_set(1);
-  } else if (app->main_mode == MAIN_MODE_COMMAND) {
-    mvprintw(h - 1, 0, ":%s", app->cmdline);
-    move(h - 1, (int)app->cmdline_len + 1);
-    curs_set(1);
-  } else if (app->main_mode == MAIN_MODE_ACTION) {
-    mvprintw(h - 1, 0, "[esc/n] cancel   [y] send request   [e] edit body   [a] edit auth");
-  } else if (app->main_mode == MAIN_MODE_DELETE_CONFIRM) {
-    int prompt_w = w - 1;
-    if (prompt_w < 20) {
-      prompt_w = 20;
-    }
-    int name_w = prompt_w - 30;
-    if (name_w < 4) {
-      name_w = 4;
-    }
-    mvprintw(h - 1, 0, "Delete '%.*s'? [y] yes  [n/Esc] cancel", name_w, app->delete_confirm_name);
-  } else {
-    mvprintw(h - 1, 0, "%.*s", w - 1, app->status);
+  const request_t *req = &app->requests.items[index];
+  if (!request_row_visible(app, req)) {
+    return;
   }
 
-  wnoutrefresh(stdscr);
-  wnoutrefresh(left_win);
-  if (right_win != NULL) {
-    wnoutrefresh(right_win);
-  }
-  if (response_win != NULL) {
-    wnoutrefresh(response_win);
+  /* First row that sorts after the new request: a later request, or a folder past its collection. */
+  size_t lo = 0;
+  size_t hi = app->visible_len;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    const list_row_t *row = &app->visible_rows[mid];
+    int after = row->kind == LIST_ROW_REQUEST
+                    ? row->index > index
+                    : request_collection_compare(list_row_collection(app, row), req->collection) > 0;
+    if (after) {
+      hi = mid;
+    } else {
+      lo = mid + 1;
+    }
   }
 
-  doupdate();
-
-  delwin(left_win);
-  if (right_win != NULL) {
-    delwin(right_win);
-  }
-  if (response_win != NULL) {
-    delwin(response_win);
+  list_row_t *next = realloc(app->visible_rows, (app->visible_len + 1) * sizeof(list_row_t));
+  if (next == NULL) {
+    return;
   }
+  app->visible_rows = next;
+  memmove(&app->visible_rows[lo + 1], &app->visible_rows[lo], (app->visible_len - lo) * sizeof(list_row_t));
+  app->visible_rows[lo].kind = LIST_ROW_REQUEST;
+  app->visible_rows[lo].index = index;
+  app->visible_len++;
 }
 
-static void apply_vertical_resize_from_x(app_t *app, int mouse_x, const main_layout_t *layout) {
-  if (!layout->show_right || layout->term_w < (MAIN_MIN_LEFT_W + MAIN_MIN_RIGHT_W + 1)) {
-    return;
+static void reselect_after_patch(app_t *app, const char *select_id, const char *select_collection,
+                                 size_t old_selected) {
+  if (app->visible_len == 0) {
+    app->selected_visible = 0;
+    app->scroll = 0;
+    return;
   }
 
-  int min_left = MAIN_MIN_LEFT_W;
-  int max_left = layout->term_w - MAIN_MIN_RIGHT_W - 1;
-  int left = clamp_int(mouse_x, min_left, max_left);
-  app->split_ratio = (double)left / (double)layout->term_w;
-  set_resize_status(app, layout);
-}
-
-static void apply_horizontal_resize_from_y(app_t *app, int mouse_y, const main_layout_t *layout) {
-  if (layout->available_h < (MAIN_MIN_TOP_H + MAIN_MIN_RESPONSE_H + 1)) {
-    return;
+  size_t found = old_selected < app->visible_len ? old_selected : app->visible_len - 1;
+  for (size_t i = 0; i < app->visible_len; i++) {
+    const list_row_t *row = &app->visible_rows[i];
+    if (row->kind == LIST_ROW_REQUEST && select_id != NULL && select_id[0] != '\0' &&
+        strcmp(app->requests.items[row->index].id, select_id) == 0) {
+      found = i;
+      break;
+    }
+    if (row->kind == LIST_ROW_COLLECTION && select_collection != NULL && select_collection[0] != '\0' &&
+        strcmp(app->collections[row->index].path, select_collection) == 0) {
+      found = i;
+      break;
+    }
   }
 
-  int min_sep = MAIN_MIN_TOP_H;
-  int max_sep = layout->available_h - MAIN_MIN_RESPONSE_H - 1;
-  int sep = clamp_int(mouse_y, min_sep, max_sep);
-  int response_h = layout->available_h - sep - 1;
-  app->response_ratio = (double)response_h / (double)layout->available_h;
-  set_resize_status(app, layout);
+  /* Shift scroll by the same amount so the selected row keeps its screen position. */
+  if (found >= old_selected) {
+    app->scroll += found - old_selected;
+  } else {
+    size_t delta = old_selected - found;
+    app->scroll = app->scroll > delta ? app->scroll - delta : 0;
+  }
+  app->selected_visible = found;
 }
 
-static void handle_main_mouse(app_t *app) {
-  MEVENT ev;
-  if (getmouse(&ev) != OK) {
+static void remember_selected_id(app_t *app, const char *select_id, char out[TUIMAN_ID_LEN]) {
+  out[0] = '\0';
+  if (select_id != NULL && select_id[0] != '\0') {
+    snprintf(out, TUIMAN_ID_LEN, "%s", select_id);
     return;
   }
+  request_t *selected = selected_request(app);
+  if (selected != NULL) {
+    snprintf(out, TUIMAN_ID_LEN, "%s", selected->id);
+  }
+}
 
-  int h = 0;
-  int w = 0;
-  getmaxyx(stdscr, h, w);
+static void remember_selected_collection(app_t *app, char out[TUIMAN_COLLECTION_LEN]) {
+  collection_node_t *node = selected_collection(app);
+  snprintf(out, TUIMAN_COLLECTION_LEN, "%s", node != NULL ? node->path : "");
+}
 
-  main_layout_t layout;
-  compute_main_layout(app, h, w, &layout);
-  if (!layout.valid) {
-    app->drag_mode = DRAG_NONE;
-    return;
+static int patch_request_upsert(app_t *app, const request_t *req, const char *select_id) {
+  request_t copy = *req;
+  template_set_forget(app->templates, copy.id);
+  /* Requests in collections nobody has opened yet are picked up on first scan. */
+  collection_node_t *target = collection_lookup(app, copy.collection);
+  if (target == NULL || !target->scanned) {
+    return 0;
   }
 
-  int on_vertical = layout.show_right && ev.y >= 0 && ev.y < layout.top_h && abs(ev.x - layout.separator_x) <= 2;
-  int on_horizontal = layout.response_h > 0 && abs(ev.y - layout.horizontal_sep_y) <= 2;
+  char keep_id[TUIMAN_ID_LEN];
+  char keep_collection[TUIMAN_COLLECTION_LEN];
+  remember_selected_id(app, select_id, keep_id);
+  remember_selected_collection(app, keep_collection);
+  size_t old_selected = app->selected_visible;
 
-  mmask_t release_mask = BUTTON1_RELEASED;
-  mmask_t press_mask = BUTTON1_PRESSED;
-  mmask_t click_mask = BUTTON1_CLICKED;
+  size_t index = 0;
+  if (request_list_find(&app->requests, copy.id, &index) == 0) {
+    collection_adjust_count(app, app->requests.items[index].collection, -1);
+    request_list_remove_at(&app->requests, index);
+    visible_remove_request_index(app, index);
+    app->fuzzy.valid = false;
+  }
+  if (request_list_insert_sorted(&app->requests, &copy, &index) != 0) {
+    search_index_remove(app->search, copy.id);
+    reselect_after_patch(app, keep_id, keep_collection, old_selected);
+    return -1;
+  }
+  search_index_put(app->search, &copy);
+  collection_adjust_count(app, copy.collection, +1);
+  app->fuzzy.valid = false;
+  if (fuzzy_filter_active(app)) {
+    /* Ranked rows have no catalog position to insert into; re-rank instead. */
+    apply_filter(app, keep_id);
+    return 0;
+  }
+  visible_insert_request_index(app, index);
+  reselect_after_patch(app, keep_id, keep_collection, old_selected);
+  return 0;
+}
 
-  mmask_t drag_mask = REPORT_MOUSE_POSITION;
-#ifdef BUTTON1_DRAGGED
-  drag_mask |= BUTTON1_DRAGGED;
-#endif
-#ifdef BUTTON1_MOVED
-  drag_mask |= BUTTON1_MOVED;
-#endif
+static void patch_request_remove(app_t *app, const char *collection, const char *request_id, const char *select_id) {
+  char keep_id[TUIMAN_ID_LEN];
+  char keep_collection[TUIMAN_COLLECTION_LEN];
+  remember_selected_id(app, select_id, keep_id);
+  remember_selected_collection(app, keep_collection);
+  size_t old_selected = app->selected_visible;
 
-  if (ev.bstate & release_mask) {
-    app->drag_mode = DRAG_NONE;
+  size_t index = 0;
+  if (request_list_find(&app->requests, request_id, &index) != 0) {
+    return;
+  }
+  /* A move between collections arrives as upsert + remove; keep the upserted copy. */
+  if (collection != NULL && strcmp(app->requests.items[index].collection, collection) != 0) {
     return;
   }
+  collection_adjust_count(app, app->requests.items[index].collection, -1);
+  request_list_remove_at(&app->requests, index);
+  search_index_remove(app->search, request_id);
+  template_set_forget(app->templates, request_id);
+  visible_remove_request_index(app, index);
+  app->fuzzy.valid = false;
+  reselect_after_patch(app, keep_id, keep_collection, old_selected);
+}
 
-  if (app->drag_mode != DRAG_NONE && (ev.bstate & (press_mask | click_mask | drag_mask))) {
-    if (app->drag_mode == DRAG_VERTICAL) {
-      apply_vertical_resize_from_x(app, ev.x, &layout);
-      return;
-    }
-    if (app->drag_mode == DRAG_HORIZONTAL) {
-      apply_horizontal_resize_from_y(app, ev.y, &layout);
-      return;
-    }
+/* `req` may point into app->requests, which patching reorders, so its keys are copied first. */
+static int store_request_and_patch(app_t *app, const request_t *req) {
+  char id[TUIMAN_ID_LEN];
+  char collection[TUIMAN_COLLECTION_LEN];
+  snprintf(id, sizeof(id), "%s", req->id);
+  snprintf(collection, sizeof(collection), "%s", req->collection);
+  int rc = request_store_save(&app->store, req);
+  if (rc != 0) {
+    return rc;
   }
+  request_watch_note_self_write(&app->watch, collection, id);
 
-  if (ev.bstate & (press_mask | click_mask)) {
-    if (on_vertical) {
-      app->drag_mode = DRAG_VERTICAL;
-      apply_vertical_resize_from_x(app, ev.x, &layout);
-      if (ev.bstate & click_mask) {
-        app->drag_mode = DRAG_NONE;
-      }
-      return;
+  request_t saved;
+  if (request_store_load_by_id(&app->store, collection, id, &saved) != 0 || patch_request_upsert(app, &saved, id) != 0) {
+    load_requests(app, id);
+  }
+  return 0;
+}
+
+static int sync_request_changes(app_t *app) {
+  request_watch_event_t events[WATCH_EVENT_BATCH];
+  size_t count = request_watch_read(&app->watch, events, WATCH_EVENT_BATCH);
+
+  for (size_t i = 0; i < count; i++) {
+    if (events[i].kind == REQUEST_WATCH_RESCAN) {
+      char keep_id[TUIMAN_ID_LEN];
+      remember_selected_id(app, NULL, keep_id);
+      load_requests(app, keep_id);
+      return (int)count;
     }
-    if (on_horizontal) {
-      app->drag_mode = DRAG_HORIZONTAL;
-      apply_horizontal_resize_from_y(app, ev.y, &layout);
-      if (ev.bstate & click_mask) {
-        app->drag_mode = DRAG_NONE;
-      }
-      return;
+
+    request_t req;
+    if (events[i].kind == REQUEST_WATCH_UPSERT &&
+        request_store_load_by_id(&app->store, events[i].collection, events[i].request_id, &req) == 0) {
+      patch_request_upsert(app, &req, NULL);
+    } else {
+      patch_request_remove(app, events[i].collection, events[i].request_id, NULL);
     }
-    app->drag_mode = DRAG_NONE;
-    return;
   }
+
+  return (int)count;
 }
 
+static void discard_request_changes(app_t *app) {
+  request_watch_event_t events[WATCH_EVENT_BATCH];
+  while (request_watch_read(&app->watch, events, WATCH_EVENT_BATCH) > 0) {
+  }
+}
 
-static void draw_help(void) {
-  int h = 0;
-  int w = 0;
-  getmaxyx(stdscr, h, w);
-  erase();
+static int method_color_pair(const char *method) {
+  if (strcmp(method, "GET") == 0) {
+    return COLOR_GET;
+  }
+  if (strcmp(method, "POST") == 0) {
+    return COLOR_POST;
+  }
+  if (strcmp(method, "PUT") == 0) {
+    return COLOR_PUT;
+  }
+  if (strcmp(method, "PATCH") == 0) {
+    return COLOR_PATCH;
+  }
+  if (strcmp(method, "DELETE") == 0) {
+    return COLOR_DELETE;
+  }
+  return 0;
+}
 
-  mvprintw(1, 2, "tuiman help");
-  mvprintw(3, 2, "Main: j/k gg G / ? : Enter E d Esc n N H/L K/J resize ZZ/ZQ quit { } req body [ ] resp body");
-  mvprintw(4, 2, "Actions: y send, e edit body, a edit auth");
-  mvprintw(5, 2, "Commands: :new [METHOD] [URL], :edit, :history, :export [DIR], :import [DIR], :help, :q");
-  mvprintw(6, 2, "Request editor: j/k move, i edit (except Method), h/l method, { } body scroll, e body, :w/:q");
-  mvprintw(7, 2, "History: j/k move, r replay, H/L resize, { } details scroll");
-  mvprintw(8, 2, "Mouse: drag main/editor/history vertical divider and main horizontal divider");
-  mvprintw(h - 1, 0, "Press Esc to return");
-  refresh();
+static int status_color_pair(long status_code) {
+  if (status_code >= 200 && status_code < 300) {
+    return COLOR_STATUS_2XX;
+  }
+  if (status_code >= 300 && status_code < 400) {
+    return COLOR_STATUS_3XX;
+  }
+  if (status_code >= 400 && status_code < 500) {
+    return COLOR_STATUS_4XX;
+  }
+  if (status_code >= 500) {
+    return COLOR_STATUS_5XX;
+  }
+  return 0;
 }
 
-static const char *guess_name(const char *method, const char *url, char *out, size_t out_len) {
-  if (url == NULL || url[0] == '\0') {
-    snprintf(out, out_len, "%s request", method);
-    return out;
+static const history_latency_t *request_latency(app_t *app, const char *request_id) {
+  time_t now = time(NULL);
+  latency_cache_entry_t *slot = NULL;
+  for (size_t i = 0; i < LATENCY_CACHE_LEN; i++) {
+    latency_cache_entry_t *entry = &app->latency_cache[i];
+    if (entry->request_id[0] != '\0' && entry->window == app->latency_window &&
+        strcmp(entry->request_id, request_id) == 0) {
+      if (now - entry->computed_at < LATENCY_CACHE_TTL) {
+        return &entry->stats;
+      }
+      slot = entry;
+      break;
+    }
   }
-  snprintf(out, out_len, "%s %s", method, url);
-  return out;
+  if (slot == NULL) {
+    slot = &app->latency_cache[app->latency_cache_next];
+    app->latency_cache_next = (app->latency_cache_next + 1) % LATENCY_CACHE_LEN;
+  }
+
+  /* Committed runs only; a queued run is counted when the writer reports its commit. */
+  long seconds = LATENCY_WINDOWS[app->latency_window].seconds;
+  if (history_store_latency(&app->history, request_id, seconds > 0 ? (long long)(now - seconds) : 0,
+                            &slot->stats) != 0) {
+    slot->request_id[0] = '\0';
+    return NULL;
+  }
+  snprintf(slot->request_id, sizeof(slot->request_id), "%s", request_id);
+  slot->window = app->latency_window;
+  slot->computed_at = now;
+  return &slot->stats;
 }
 
-static const char *draft_field_label(int field) {
-  switch (field) {
-  case DRAFT_FIELD_NAME:
-    return "Name";
-  case DRAFT_FIELD_METHOD:
-    return "Method";
-  case DRAFT_FIELD_URL:
-    return "URL";
-  case DRAFT_FIELD_HEADER_KEY:
-    return "Header Key";
-  case DRAFT_FIELD_HEADER_VALUE:
-    return "Header Value";
-  case DRAFT_FIELD_AUTH_TYPE:
-    return "Auth Type";
-  case DRAFT_FIELD_AUTH_SECRET_REF:
-    return "Secret Ref";
-  case DRAFT_FIELD_AUTH_KEY_NAME:
-    return "Auth Key Name";
-  case DRAFT_FIELD_AUTH_LOCATION:
-    return "Auth Location";
-  case DRAFT_FIELD_AUTH_USERNAME:
-    return "Auth Username";
-  default:
-    return "";
+/* NULL drops every request's summary. */
+static void invalidate_request_latency(app_t *app, const char *request_id) {
+  for (size_t i = 0; i < LATENCY_CACHE_LEN; i++) {
+    if (request_id == NULL || strcmp(app->latency_cache[i].request_id, request_id) == 0) {
+      app->latency_cache[i].request_id[0] = '\0';
+    }
   }
 }
 
-static const char *draft_field_value(const app_t *app, int field) {
-  switch (field) {
-  case DRAFT_FIELD_NAME:
-    return app->draft.name;
-  case DRAFT_FIELD_METHOD:
-    return app->draft.method;
-  case DRAFT_FIELD_URL:
-    return app->draft.url;
-  case DRAFT_FIELD_HEADER_KEY:
-    return app->draft.header_key;
-  case DRAFT_FIELD_HEADER_VALUE:
-    return app->draft.header_value;
-  case DRAFT_FIELD_AUTH_TYPE:
-    return app->draft.auth_type;
-  case DRAFT_FIELD_AUTH_SECRET_REF:
-    return app->draft.auth_secret_ref;
-  case DRAFT_FIELD_AUTH_KEY_NAME:
-    return app->draft.auth_key_name;
-  case DRAFT_FIELD_AUTH_LOCATION:
-    return app->draft.auth_location;
-  case DRAFT_FIELD_AUTH_USERNAME:
-    return app->draft.auth_username;
-  default:
-    return "";
+/* ASCII sparkline scaled between the fastest and slowest of the recent runs. */
+static void format_sparkline(const history_latency_t *stats, char *out, size_t out_len) {
+  static const char LEVELS[] = "_.:-=+*#";
+  long lo = 0;
+  long hi = 0;
+  for (int i = 0; i < stats->spark_len; i++) {
+    if (i == 0 || stats->spark_ms[i] < lo) {
+      lo = stats->spark_ms[i];
+    }
+    if (i == 0 || stats->spark_ms[i] > hi) {
+      hi = stats->spark_ms[i];
+    }
   }
+  size_t len = 0;
+  for (int i = 0; i < stats->spark_len && len + 1 < out_len; i++) {
+    int level = hi > lo ? (int)((stats->spark_ms[i] - lo) * (long)(sizeof(LEVELS) - 2) / (hi - lo)) : 0;
+    out[len++] = LEVELS[level];
+  }
+  out[len] = '\0';
 }
 
-static void uppercase_copy(char *dst, size_t dst_len, const char *src) {
-  size_t i = 0;
-  for (; src[i] != '\0' && i + 1 < dst_len; i++) {
-    dst[i] = (char)toupper((unsigned char)src[i]);
+/* Two preview rows: percentiles, then run count, error rate and the sparkline. Returns rows used. */
+static int win_draw_latency_summary(app_t *app, WINDOW *win, int y, int max_rows, const request_t *req) {
+  if (max_rows <= 0) {
+    return 0;
   }
-  dst[i] = '\0';
+  const history_latency_t *stats = request_latency(app, req->id);
+  char label[32];
+  snprintf(label, sizeof(label), "latency %s: ", LATENCY_WINDOWS[app->latency_window].label);
+  if (stats == NULL || stats->runs == 0) {
+    win_add_labeled_text(win, y, 0, label, stats == NULL ? "(unavailable)" : "no runs (w: window)");
+    return 1;
+  }
+
+  char line[128];
+  snprintf(line, sizeof(line), "p50 %ldms  p95 %ldms  p99 %ldms", stats->p50_ms, stats->p95_ms, stats->p99_ms);
+  win_add_labeled_text(win, y, 0, label, line);
+  if (max_rows < 2) {
+    return 1;
+  }
+  char spark[TUIMAN_LATENCY_SPARK_LEN + 1];
+  format_sparkline(stats, spark, sizeof(spark));
+  snprintf(line, sizeof(line), "%lld  errors %.1f%%  %s", stats->runs, 100.0 * (double)stats->errors / (double)stats->runs,
+           spark);
+  win_add_labeled_text(win, y + 1, 0, "runs: ", line);
+  return 2;
 }
 
-static void draft_set_field_value(app_t *app, int field, const char *value) {
-  switch (field) {
-  case DRAFT_FIELD_NAME:
-    snprintf(app->draft.name, sizeof(app->draft.name), "%s", value);
-    break;
-  case DRAFT_FIELD_METHOD:
-    uppercase_copy(app->draft.method, sizeof(app->draft.method), value);
-    break;
-  case DRAFT_FIELD_URL:
-    snprintf(app->draft.url, sizeof(app->draft.url), "%s", value);
-    break;
-  case DRAFT_FIELD_HEADER_KEY:
-    snprintf(app->draft.header_key, sizeof(app->draft.header_key), "%s", value);
-    break;
-  case DRAFT_FIELD_HEADER_VALUE:
-    snprintf(app->draft.header_value, sizeof(app->draft.header_value), "%s", value);
-    break;
-  case DRAFT_FIELD_AUTH_TYPE:
-    snprintf(app->draft.auth_type, sizeof(app->draft.auth_type), "%s", value);
-    break;
-  case DRAFT_FIELD_AUTH_SECRET_REF:
-    snprintf(app->draft.auth_secret_ref, sizeof(app->draft.auth_secret_ref), "%s", value);
-    break;
-  case DRAFT_FIELD_AUTH_KEY_NAME:
-    snprintf(app->draft.auth_key_name, sizeof(app->draft.auth_key_name), "%s", value);
-    break;
-  case DRAFT_FIELD_AUTH_LOCATION:
-    snprintf(app->draft.auth_location, sizeof(app->draft.auth_location), "%s", value);
-    break;
-  case DRAFT_FIELD_AUTH_USERNAME:
-    snprintf(app->draft.auth_username, sizeof(app->draft.auth_username), "%s", value);
-    break;
-  default:
-    break;
+static void main_list_columns(const main_layout_t *layout, int *method_x, int *url_x) {
+  *method_x = layout->left_w / 2;
+  if (*method_x < 8) {
+    *method_x = 8;
   }
+  *url_x = *method_x + 8;
 }
 
-static void cycle_method(request_t *req, int delta) {
-  static const char *methods[] = {"GET", "POST", "PUT", "PATCH", "DELETE"};
-  int index = 0;
-  for (int i = 0; i < 5; i++) {
-    if (strcmp(req->method, methods[i]) == 0) {
-      index = i;
-      break;
-    }
+static void draw_main_list_row(app_t *app, WINDOW *win, const main_layout_t *layout, const fuzzy_pattern_t *pattern,
+                               size_t visible_index, int y) {
+  int method_x = 0;
+  int url_x = 0;
+  main_list_columns(layout, &method_x, &url_x);
+
+  const list_row_t *list_row = &app->visible_rows[visible_index];
+  if (visible_index == app->selected_visible) {
+    wattron(win, A_REVERSE);
+    mvwhline(win, y, 0, ' ', layout->left_w);
+  }
+
+  int url_space = layout->left_w - (url_x + 1);
+  if (list_row->kind == LIST_ROW_COLLECTION) {
+    const collection_node_t *node = &app->collections[list_row->index];
+    int indent = (request_collection_depth(node->path) - 1) * 2;
+    win_printf_text(win, y, 1, "%*s%c %-*.*s", indent, "", node->expanded ? '-' : '+',
+                    26 - indent > 0 ? 26 - indent : 0, 26 - indent > 0 ? 26 - indent : 0,
+                    request_collection_basename(node->path));
+    if (url_space > 0) {
+      char count[32];
+      if (node->count >= 0) {
+        snprintf(count, sizeof(count), "%ld request%s", node->count, node->count == 1 ? "" : "s");
+      } else {
+        snprintf(count, sizeof(count), "...");
+      }
+      win_printf_text(win, y, url_x, "%-*.*s", url_space, url_space, count);
+    }
+  } else {
+    request_t *req = &app->requests.items[list_row->index];
+    char label[TUIMAN_COLLECTION_LEN + TUIMAN_NAME_LEN + 2];
+    request_path_label(req, label, sizeof(label));
+    if (app->filter[0] != '\0' && req->collection[0] != '\0') {
+      win_printf_text(win, y, 1, "%-28.28s", label);
+    } else {
+      int indent = request_collection_depth(req->collection) * 2;
+      win_printf_text(win, y, 1, "%*s%-*.*s", indent, "", 28 - indent > 0 ? 28 - indent : 0,
+                      28 - indent > 0 ? 28 - indent : 0, req->name);
+    }
+    int pair = method_color_pair(req->method);
+    if (pair != 0 && has_colors()) {
+      wattron(win, COLOR_PAIR(pair));
+    }
+    win_printf_text(win, y, method_x, "%-6.6s", req->method);
+    if (pair != 0 && has_colors()) {
+      wattroff(win, COLOR_PAIR(pair));
+    }
+
+    if (url_space > 0) {
+      win_printf_text(win, y, url_x, "%-*.*s", url_space, url_space, req->url);
+    }
+    if (fuzzy_filter_active(app)) {
+      /* Positions are recomputed only for drawn rows, never during ranking. */
+      size_t positions[FUZZY_MAX_PATTERN];
+      bool in_url = false;
+      if (fuzzy_request_score(pattern, req, positions, &in_url, NULL) != FUZZY_NO_MATCH) {
+        if (in_url) {
+          win_highlight_chars(win, y, url_x, url_space, req->url, positions, pattern->len);
+        } else {
+          win_highlight_chars(win, y, 1, method_x - 1 < 28 ? method_x - 1 : 28, label, positions,
+                              pattern->len);
+        }
+      }
+    }
+  }
+
+  if (visible_index == app->selected_visible) {
+    wattroff(win, A_REVERSE);
+  }
+}
+
+/* Repaints the whole list when dirty or scrolled; a bare selection move repaints only the old and new rows. */
+static void draw_main_list(app_t *app, WINDOW *win, const main_layout_t *layout) {
+  pane_t *pane = &app->panes[PANE_MAIN_LIST];
+  int view_rows = layout->top_h - 1;
+  if (view_rows < 1) {
+    view_rows = 1;
+  }
+
+  if (app->selected_visible < app->scroll) {
+    app->scroll = app->selected_visible;
+  }
+  if (app->selected_visible >= app->scroll + (size_t)view_rows) {
+    app->scroll = app->selected_visible - (size_t)view_rows + 1;
+  }
+
+  fuzzy_pattern_t pattern;
+  fuzzy_pattern_init(&pattern, app->filter);
+  if (!pane->dirty && layout->show_right && pane->drawn_scroll == app->scroll) {
+    if (pane->drawn_selected != app->selected_visible) {
+      size_t rows[2] = {pane->drawn_selected, app->selected_visible};
+      for (int i = 0; i < 2; i++) {
+        if (rows[i] < app->visible_len && rows[i] - app->scroll < (size_t)view_rows) {
+          int y = (int)(rows[i] - app->scroll) + 1;
+          wmove(win, y, 0);
+          wclrtoeol(win);
+          draw_main_list_row(app, win, layout, &pattern, rows[i], y);
+        }
+      }
+    }
+  } else {
+    int method_x = 0;
+    int url_x = 0;
+    main_list_columns(layout, &method_x, &url_x);
+    werase(win);
+    win_add_text(win, 0, 1, "Name");
+    win_add_text(win, 0, method_x, "Type");
+    win_add_text(win, 0, url_x, "URL");
+    for (int row = 0; row < view_rows && app->scroll + (size_t)row < app->visible_len; row++) {
+      draw_main_list_row(app, win, layout, &pattern, app->scroll + (size_t)row, row + 1);
+    }
+    if (app->visible_len == 0) {
+      win_add_text(win, 1, 1, "(empty)");
+      win_add_text(win, 2, 1, "Use :new [METHOD] [URL]");
+    }
+    if (!layout->show_right) {
+      win_add_text(win, 1, 1, "Preview hidden (window too narrow)");
+      win_add_text(win, 2, 1, "Widen terminal to restore split-pane view.");
+    }
+  }
+  pane->drawn_scroll = app->scroll;
+  pane->drawn_selected = app->selected_visible;
+}
+
+static void draw_main_preview(app_t *app, WINDOW *win, const main_layout_t *layout) {
+  werase(win);
+  request_t *selected = selected_request(app);
+  collection_node_t *selected_node = selected_collection(app);
+  win_add_section_title(win, 0, 0, selected_node != NULL ? "Collection" : "Request");
+  if (has_colors()) {
+    wattron(win, COLOR_PAIR(COLOR_SECTION));
+  }
+  mvwhline(win, 1, 0, ACS_HLINE, layout->right_w);
+  if (has_colors()) {
+    wattroff(win, COLOR_PAIR(COLOR_SECTION));
+  }
+
+  if (selected_node != NULL) {
+    app->request_body_scroll = 0;
+    char count[64];
+    if (selected_node->count >= 0) {
+      snprintf(count, sizeof(count), "%ld", selected_node->count);
+    } else {
+      snprintf(count, sizeof(count), "(not scanned yet)");
+    }
+    win_add_labeled_text(win, 2, 0, "path: ", selected_node->path);
+    win_add_labeled_text(win, 3, 0, "requests: ", count);
+    win_draw_wrapped_text(win, 5, 0, layout->top_h - 5, layout->right_w,
+                          selected_node->expanded ? "Enter/h collapses." : "Enter/l expands.");
+  } else if (selected == NULL) {
+    app->request_body_scroll = 0;
+    win_draw_wrapped_text(win, 2, 0, layout->top_h - 2, layout->right_w, "No requests. Use :new to create one.");
+  } else {
+    int row = 2;
+
+    if (selected->name[0] == '\0') {
+      win_add_labeled_text(win, row, 0, "name: ", "(unnamed)");
+    } else {
+      win_add_labeled_text(win, row, 0, "name: ", selected->name);
+    }
+    row++;
+
+    if (selected->collection[0] != '\0' && row < layout->top_h) {
+      win_add_labeled_text(win, row, 0, "collection: ", selected->collection);
+      row++;
+    }
+
+    wmove(win, row, 0);
+    if (has_colors()) {
+      wattron(win, COLOR_PAIR(COLOR_LABEL));
+    }
+    wattron(win, A_BOLD);
+    waddstr(win, "method: ");
+    wattroff(win, A_BOLD);
+    if (has_colors()) {
+      wattroff(win, COLOR_PAIR(COLOR_LABEL));
+    }
+    int method_pair = method_color_pair(selected->method);
+    if (method_pair != 0 && has_colors()) {
+      wattron(win, COLOR_PAIR(method_pair));
+    }
+    waddstr(win, selected->method);
+    if (method_pair != 0 && has_colors()) {
+      wattroff(win, COLOR_PAIR(method_pair));
+    }
+    row++;
+
+    int reserve = 2; /* body title + 1 body line */
+    int has_auth = selected->auth_type[0] != '\0';
+    int header_count = (int)request_header_count(selected);
+    int has_header = header_count > 0;
+    if (has_auth || has_header) {
+      reserve += 1; /* config title */
+      if (has_auth) {
+        reserve += 1;
+      }
+      reserve += header_count;
+    }
+
+    const int url_label_w = 5;
+    if (row < layout->top_h) {
+      win_add_labeled_text(win, row, 0, "url: ", "");
+    }
+    int url_width = layout->right_w - url_label_w;
+    if (url_width < 1) {
+      url_width = 1;
+    }
+    int url_lines_max = layout->top_h - row - reserve;
+    if (url_lines_max < 1) {
+      url_lines_max = 1;
+    }
+    if (url_lines_max > 5) {
+      url_lines_max = 5;
+    }
+    if (row < layout->top_h) {
+      win_draw_wrapped_text(win, row, url_label_w, url_lines_max, url_width, selected->url);
+    }
+    int url_lines = wrapped_line_count(selected->url, url_width, url_lines_max);
+    if (url_lines < 1) {
+      url_lines = 1;
+    }
+    row += url_lines;
+    row += win_draw_latency_summary(app, win, row, layout->top_h - row - reserve, selected);
+
+    if ((has_auth || has_header) && row < layout->top_h) {
+      win_add_section_title(win, row, 0, "Config");
+      row++;
+    }
+    if (has_auth && row < layout->top_h) {
+      win_add_labeled_text(win, row, 0, "auth: ", selected->auth_type);
+      row++;
+    }
+    const char *header_cursor = selected->headers;
+    char header_name[TUIMAN_HEADER_KEY_LEN];
+    char header_value[TUIMAN_HEADER_VAL_LEN];
+    while (row < layout->top_h && request_header_next(&header_cursor, header_name, sizeof(header_name), header_value,
+                                                     sizeof(header_value))) {
+      char header_line[TUIMAN_HEADER_KEY_LEN + TUIMAN_HEADER_VAL_LEN + 4];
+      snprintf(header_line, sizeof(header_line), "%s: %s", header_name, header_value);
+      win_add_labeled_text(win, row, 0, "header: ", header_line);
+      row++;
+    }
+
+    if (row < layout->top_h) {
+      win_add_section_title(win, row, 0, "Body");
+      row++;
+    }
+    int body_lines = layout->top_h - row;
+    if (body_lines > 0) {
+      /* Request bodies are at most TUIMAN_BODY_LEN and edited in place, so they are lexed afresh each frame. */
+      highlighter_t highlight;
+      memset(&highlight, 0, sizeof(highlight));
+      win_draw_wrapped_body_preview(win, row, body_lines, layout->right_w, selected->body,
+                                    &app->request_body_scroll, NULL, &highlight);
+      highlighter_free(&highlight);
+    }
+  }
+}
+
+static void draw_main_response(app_t *app, WINDOW *win, const main_layout_t *layout) {
+  int w = layout->term_w;
+  werase(win);
+  win_add_section_title(win, 0, 0, "Response");
+  if (has_colors()) {
+    wattron(win, COLOR_PAIR(COLOR_SECTION));
+  }
+  mvwhline(win, 1, 0, ACS_HLINE, w);
+  if (has_colors()) {
+    wattroff(win, COLOR_PAIR(COLOR_SECTION));
+  }
+
+  if (app->last_response_at[0] == '\0') {
+    app->response_body_scroll = 0;
+    win_add_text(win, 2, 0, "No response yet.");
+    win_add_text(win, 3, 0, "Select a request, press Enter, then y.");
+  } else {
+    int row = 2;
+
+    wmove(win, row, 0);
+    if (has_colors()) {
+      wattron(win, COLOR_PAIR(COLOR_LABEL));
+    }
+    wattron(win, A_BOLD);
+    waddstr(win, "status: ");
+    wattroff(win, A_BOLD);
+    if (has_colors()) {
+      wattroff(win, COLOR_PAIR(COLOR_LABEL));
+    }
+
+    int s_pair = status_color_pair(app->last_response_status);
+    if (s_pair != 0 && has_colors()) {
+      wattron(win, COLOR_PAIR(s_pair));
+    }
+    wprintw(win, "%ld", app->last_response_status);
+    if (s_pair != 0 && has_colors()) {
+      wattroff(win, COLOR_PAIR(s_pair));
+    }
+    wprintw(win, "  duration=%ldms", app->last_response_ms);
+    row++;
+
+    win_add_labeled_text(win, row, 0, "at: ", app->last_response_at);
+    row++;
+
+    char request_line[640];
+    snprintf(request_line, sizeof(request_line), "%s %s", app->last_response_method, app->last_response_url);
+    win_add_labeled_text(win, row, 0, "request: ", "");
+    int request_label_w = 9;
+    int request_width = w - request_label_w;
+    if (request_width < 1) {
+      request_width = 1;
+    }
+    int request_lines_max = 2;
+    if (app->last_response_error[0] != '\0') {
+      request_lines_max = 1;
+    }
+    if (layout->response_h - row < 5) {
+      request_lines_max = 1;
+    }
+    win_draw_wrapped_text(win, row, request_label_w, request_lines_max, request_width, request_line);
+    int request_lines = wrapped_line_count(request_line, request_width, request_lines_max);
+    if (request_lines < 1) {
+      request_lines = 1;
+    }
+    row += request_lines;
+
+    if (app->last_response_request_name[0] != '\0' && row < layout->response_h) {
+      win_add_labeled_text(win, row, 0, "name: ", app->last_response_request_name);
+      row++;
+    }
+
+    if (app->last_response_error[0] != '\0' && row < layout->response_h) {
+      if (has_colors()) {
+        wattron(win, COLOR_PAIR(COLOR_LABEL));
+      }
+      wattron(win, A_BOLD);
+      win_add_text(win, row, 0, "error: ");
+      wattroff(win, A_BOLD);
+      if (has_colors()) {
+        wattroff(win, COLOR_PAIR(COLOR_LABEL));
+      }
+      if (has_colors()) {
+        wattron(win, COLOR_PAIR(COLOR_STATUS_5XX));
+      }
+      win_draw_wrapped_text(win, row, 7, 2, w - 7, app->last_response_error);
+      if (has_colors()) {
+        wattroff(win, COLOR_PAIR(COLOR_STATUS_5XX));
+      }
+      int err_lines = wrapped_line_count(app->last_response_error, w - 7, 2);
+      if (err_lines < 1) {
+        err_lines = 1;
+      }
+      row += err_lines;
+    }
+
+    if (row < layout->response_h) {
+      win_add_section_title(win, row, 0, "Body");
+      row++;
+    }
+    if (row < layout->response_h) {
+      int lines = layout->response_h - row;
+      win_draw_wrapped_body_preview(win, row, lines, w, app->last_response_body, &app->response_body_scroll,
+                                    &app->response_wrap, &app->response_wrap.highlight);
+    }
+  }
+}
+
+static void draw_main(app_t *app) {
+  int h = 0;
+  int w = 0;
+  getmaxyx(stdscr, h, w);
+
+  main_layout_t layout;
+  compute_main_layout(app, h, w, &layout);
+  if (!layout.valid) {
+    erase();
+    mvprintw(h - 1, 0, "Window too small");
+    refresh();
+    app->chrome_dirty = true;
+    return;
+  }
+
+  WINDOW *left_win = pane_place(app, PANE_MAIN_LIST, layout.top_h, layout.left_w, 0, 0);
+  WINDOW *right_win = NULL;
+  if (layout.show_right) {
+    right_win = pane_place(app, PANE_MAIN_PREVIEW, layout.top_h, layout.right_w, 0, layout.right_x);
+  } else {
+    pane_drop(app, PANE_MAIN_PREVIEW);
+  }
+  WINDOW *response_win = NULL;
+  if (layout.response_h > 0) {
+    response_win = pane_place(app, PANE_MAIN_RESPONSE, layout.response_h, w, layout.response_y, 0);
+  } else {
+    pane_drop(app, PANE_MAIN_RESPONSE);
+  }
+
+  if (left_win == NULL) {
+    erase();
+    mvprintw(h - 1, 0, "Failed to create list pane");
+    refresh();
+    app->chrome_dirty = true;
+    return;
+  }
+
+  if (frame_needs_chrome(app, SCREEN_MAIN)) {
+    if (layout.show_right) {
+      if (app->drag_mode == DRAG_VERTICAL) {
+        attron(A_REVERSE);
+      }
+      for (int y = 0; y < layout.top_h; y++) {
+        mvaddch(y, layout.separator_x, ACS_VLINE);
+      }
+      if (app->drag_mode == DRAG_VERTICAL) {
+        attroff(A_REVERSE);
+      }
+    }
+    if (layout.horizontal_sep_y >= 0) {
+      if (app->drag_mode == DRAG_HORIZONTAL) {
+        attron(A_REVERSE);
+      }
+      mvhline(layout.horizontal_sep_y, 0, ACS_HLINE, w);
+      if (layout.show_right && layout.separator_x >= 0 && layout.separator_x < w) {
+        mvaddch(layout.horizontal_sep_y, layout.separator_x, ACS_PLUS);
+      }
+      if (app->drag_mode == DRAG_HORIZONTAL) {
+        attroff(A_REVERSE);
+      }
+    }
+  }
+
+  draw_main_list(app, left_win, &layout);
+  if (right_win != NULL && app->panes[PANE_MAIN_PREVIEW].dirty) {
+    draw_main_preview(app, right_win, &layout);
+  }
+  if (response_win != NULL && app->panes[PANE_MAIN_RESPONSE].dirty) {
+    draw_main_response(app, response_win, &layout);
+  }
+
+  move(h - 1, 0);
+  clrtoeol();
+  curs_set(0);
+  if (app->main_mode == MAIN_MODE_SEARCH) {
+    mvprintw(h - 1, 0, "/%s", app->cmdline);
+    move(h - 1, (int)app->cmdline_len + 1);
+    curs_set(1);
+  } else if (app->main_mode == MAIN_MODE_REVERSE) {
+    mvprintw(h - 1, 0, "?%s", app->cmdline);
+    move(h - 1, (int)app->cmdline_len + 1);
+    curs_set(1);
+  } else if (app->main_mode == MAIN_MODE_COMMAND) {
+    mvprintw(h - 1, 0, ":%s", app->cmdline);
+    move(h - 1, (int)app->cmdline_len + 1);
+    curs_set(1);
+  } else if (app->main_mode == MAIN_MODE_ACTION) {
+    mvprintw(h - 1, 0, "[esc/n] cancel   [y] send request   [e] edit body   [a] edit auth");
+  } else if (app->main_mode == MAIN_MODE_DELETE_CONFIRM) {
+    int prompt_w = w - 1;
+    if (prompt_w < 20) {
+      prompt_w = 20;
+    }
+    int name_w = prompt_w - 30;
+    if (name_w < 4) {
+      name_w = 4;
+    }
+    mvprintw(h - 1, 0, "Delete '%.*s'? [y] yes  [n/Esc] cancel", name_w, app->delete_confirm_name);
+  } else {
+    mvprintw(h - 1, 0, "%.*s", w - 1, app->status);
+    if (app->env.name[0] != '\0') {
+      char badge[TUIMAN_ENV_NAME_LEN + 8];
+      int badge_w = snprintf(badge, sizeof(badge), " env:%s ", app->env.name);
+      if (badge_w > 0 && badge_w < w - 1) {
+        attron(A_REVERSE);
+        mvprintw(h - 1, w - 1 - badge_w, "%s", badge);
+        attroff(A_REVERSE);
+      }
+    }
+  }
+
+  static const pane_id_t panes[] = {PANE_MAIN_LIST, PANE_MAIN_PREVIEW, PANE_MAIN_RESPONSE};
+  flush_panes(app, panes, 3);
+  doupdate();
+}
+
+static void apply_vertical_resize_from_x(app_t *app, int mouse_x, const main_layout_t *layout) {
+  if (!layout->show_right || layout->term_w < (MAIN_MIN_LEFT_W + MAIN_MIN_RIGHT_W + 1)) {
+    return;
+  }
+
+  int min_left = MAIN_MIN_LEFT_W;
+  int max_left = layout->term_w - MAIN_MIN_RIGHT_W - 1;
+  int left = clamp_int(mouse_x, min_left, max_left);
+  app->split_ratio = (double)left / (double)layout->term_w;
+  set_resize_status(app, layout);
+}
+
+static void apply_horizontal_resize_from_y(app_t *app, int mouse_y, const main_layout_t *layout) {
+  if (layout->available_h < (MAIN_MIN_TOP_H + MAIN_MIN_RESPONSE_H + 1)) {
+    return;
+  }
+
+  int min_sep = MAIN_MIN_TOP_H;
+  int max_sep = layout->available_h - MAIN_MIN_RESPONSE_H - 1;
+  int sep = clamp_int(mouse_y, min_sep, max_sep);
+  int response_h = layout->available_h - sep - 1;
+  app->response_ratio = (double)response_h / (double)layout->available_h;
+  set_resize_status(app, layout);
+}
+
+static void handle_main_mouse(app_t *app) {
+  MEVENT ev;
+  if (getmouse(&ev) != OK) {
+    return;
+  }
+
+  int h = 0;
+  int w = 0;
+  getmaxyx(stdscr, h, w);
+
+  main_layout_t layout;
+  compute_main_layout(app, h, w, &layout);
+  if (!layout.valid) {
+    app->drag_mode = DRAG_NONE;
+    return;
+  }
+
+  int on_vertical = layout.show_right && ev.y >= 0 && ev.y < layout.top_h && abs(ev.x - layout.separator_x) <= 2;
+  int on_horizontal = layout.response_h > 0 && abs(ev.y - layout.horizontal_sep_y) <= 2;
+
+  mmask_t release_mask = BUTTON1_RELEASED;
+  mmask_t press_mask = BUTTON1_PRESSED;
+  mmask_t click_mask = BUTTON1_CLICKED;
+
+  mmask_t drag_mask = REPORT_MOUSE_POSITION;
+#ifdef BUTTON1_DRAGGED
+  drag_mask |= BUTTON1_DRAGGED;
+#endif
+#ifdef BUTTON1_MOVED
+  drag_mask |= BUTTON1_MOVED;
+#endif
+
+  if (ev.bstate & release_mask) {
+    app->drag_mode = DRAG_NONE;
+    return;
+  }
+
+  if (app->drag_mode != DRAG_NONE && (ev.bstate & (press_mask | click_mask | drag_mask))) {
+    if (app->drag_mode == DRAG_VERTICAL) {
+      apply_vertical_resize_from_x(app, ev.x, &layout);
+      return;
+    }
+    if (app->drag_mode == DRAG_HORIZONTAL) {
+      apply_horizontal_resize_from_y(app, ev.y, &layout);
+      return;
+    }
+  }
+
+  if (ev.bstate & (press_mask | click_mask)) {
+    if (on_vertical) {
+      app->drag_mode = DRAG_VERTICAL;
+      apply_vertical_resize_from_x(app, ev.x, &layout);
+      if (ev.bstate & click_mask) {
+        app->drag_mode = DRAG_NONE;
+      }
+      return;
+    }
+    if (on_horizontal) {
+      app->drag_mode = DRAG_HORIZONTAL;
+      apply_horizontal_resize_from_y(app, ev.y, &layout);
+      if (ev.bstate & click_mask) {
+        app->drag_mode = DRAG_NONE;
+      }
+      return;
+    }
+    app->drag_mode = DRAG_NONE;
+    return;
+  }
+}
+
+
+static void draw_help(void) {
+  int h = 0;
+  int w = 0;
+  getmaxyx(stdscr, h, w);
+  erase();
+
+  mvprintw(1, 2, "tuiman help");
+  mvprintw(3, 2, "Main: j/k gg G / ? : Enter E d Esc n N H/L K/J resize ZZ/ZQ quit { } req body [ ] resp body w window P pager T JSON tree");
+  mvprintw(4, 2, "Actions: y send, e edit body, a edit auth");
+  mvprintw(5, 2, "Commands: :new [METHOD] [URL], :edit, :history, :export [DIR], :import [DIR], :env [NAME|none|edit NAME], :workflow [NAME|edit NAME], :help, :q");
+  mvprintw(6, 2, "Request editor: j/k move, i edit (except Method), h/l method, { } body scroll, e body, :w/:q");
+  mvprintw(7, 2, "History: j/k move, r replay, H/L resize, { } details scroll, m mark, D diff (n/N changes, s side by side), P pager, T JSON tree");
+  mvprintw(8, 2, "Pager: j/k space/b g/G, :N line, :N%% percent (:OFFSET in hex), h/l pan, x hex/text, s save to file, q back");
+  mvprintw(9, 2, "JSON tree: j/k move, l/h expand/collapse (h on a leaf: parent), Enter toggle, :PATH go to $.a[3].b or /a/3/b");
+  mvprintw(10, 2, "Mouse: drag main/editor/history vertical divider and main horizontal divider");
+  mvprintw(h - 1, 0, "Press Esc to return");
+  refresh();
+}
+
+static const char *guess_name(const char *method, const char *url, char *out, size_t out_len) {
+  if (url == NULL || url[0] == '\0') {
+    snprintf(out, out_len, "%s request", method);
+    return out;
+  }
+  snprintf(out, out_len, "%s %s", method, url);
+  return out;
+}
+
+static const char *draft_field_label(int field) {
+  switch (field) {
+  case DRAFT_FIELD_NAME:
+    return "Name";
+  case DRAFT_FIELD_METHOD:
+    return "Method";
+  case DRAFT_FIELD_URL:
+    return "URL";
+  case DRAFT_FIELD_HEADERS:
+    return "Headers";
+  case DRAFT_FIELD_AUTH_TYPE:
+    return "Auth Type";
+  case DRAFT_FIELD_AUTH_SECRET_REF:
+    return "Secret Ref";
+  case DRAFT_FIELD_AUTH_KEY_NAME:
+    return "Auth Key Name";
+  case DRAFT_FIELD_AUTH_LOCATION:
+    return "Auth Location";
+  case DRAFT_FIELD_AUTH_USERNAME:
+    return "Auth Username";
+  default:
+    return "";
+  }
+}
+
+static const char *draft_field_value(const app_t *app, int field) {
+  switch (field) {
+  case DRAFT_FIELD_NAME:
+    return app->draft.name;
+  case DRAFT_FIELD_METHOD:
+    return app->draft.method;
+  case DRAFT_FIELD_URL:
+    return app->draft.url;
+  case DRAFT_FIELD_HEADERS:
+    return app->draft.headers;
+  case DRAFT_FIELD_AUTH_TYPE:
+    return app->draft.auth_type;
+  case DRAFT_FIELD_AUTH_SECRET_REF:
+    return app->draft.auth_secret_ref;
+  case DRAFT_FIELD_AUTH_KEY_NAME:
+    return app->draft.auth_key_name;
+  case DRAFT_FIELD_AUTH_LOCATION:
+    return app->draft.auth_location;
+  case DRAFT_FIELD_AUTH_USERNAME:
+    return app->draft.auth_username;
+  default:
+    return "";
+  }
+}
+
+static void uppercase_copy(char *dst, size_t dst_len, const char *src) {
+  size_t i = 0;
+  for (; src[i] != '\0' && i + 1 < dst_len; i++) {
+    dst[i] = (char)toupper((unsigned char)src[i]);
+  }
+  dst[i] = '\0';
+}
+
+static void draft_set_field_value(app_t *app, int field, const char *value) {
+  switch (field) {
+  case DRAFT_FIELD_NAME:
+    snprintf(app->draft.name, sizeof(app->draft.name), "%s", value);
+    break;
+  case DRAFT_FIELD_METHOD:
+    uppercase_copy(app->draft.method, sizeof(app->draft.method), value);
+    break;
+  case DRAFT_FIELD_URL:
+    snprintf(app->draft.url, sizeof(app->draft.url), "%s", value);
+    break;
+  case DRAFT_FIELD_HEADERS:
+    request_headers_set_text(&app->draft, value);
+    break;
+  case DRAFT_FIELD_AUTH_TYPE:
+    snprintf(app->draft.auth_type, sizeof(app->draft.auth_type), "%s", value);
+    break;
+  case DRAFT_FIELD_AUTH_SECRET_REF:
+    snprintf(app->draft.auth_secret_ref, sizeof(app->draft.auth_secret_ref), "%s", value);
+    break;
+  case DRAFT_FIELD_AUTH_KEY_NAME:
+    snprintf(app->draft.auth_key_name, sizeof(app->draft.auth_key_name), "%s", value);
+    break;
+  case DRAFT_FIELD_AUTH_LOCATION:
+    snprintf(app->draft.auth_location, sizeof(app->draft.auth_location), "%s", value);
+    break;
+  case DRAFT_FIELD_AUTH_USERNAME:
+    snprintf(app->draft.auth_username, sizeof(app->draft.auth_username), "%s", value);
+    break;
+  default:
+    break;
+  }
+}
+
+static void cycle_method(request_t *req, int delta) {
+  static const char *methods[] = {"GET", "POST", "PUT", "PATCH", "DELETE"};
+  int index = 0;
+  for (int i = 0; i < 5; i++) {
+    if (strcmp(req->method, methods[i]) == 0) {
+      index = i;
+      break;
+    }
+  }
+  index = (index + delta + 5) % 5;
+  snprintf(req->method, sizeof(req->method), "%s", methods[index]);
+}
+
+static int save_draft(app_t *app) {
+  if (app->draft.method[0] == '\0') {
+    snprintf(app->draft.method, sizeof(app->draft.method), "GET");
+  }
+  if (app->draft.name[0] == '\0') {
+    char guessed[TUIMAN_NAME_LEN];
+    guess_name(app->draft.method, app->draft.url, guessed, sizeof(guessed));
+    snprintf(app->draft.name, sizeof(app->draft.name), "%s", guessed);
+  }
+  if (app->draft.url[0] == '\0') {
+    set_status_error(app, "URL cannot be empty");
+    return -1;
+  }
+
+  request_set_updated_now(&app->draft);
+  int rc = store_request_and_patch(app, &app->draft);
+  if (rc == TUIMAN_STORE_CONFLICT) {
+    /* Take the newer version as the base, so saving again overwrites it knowingly. */
+    request_t current;
+    if (request_store_load_by_id(&app->store, app->draft.collection, app->draft.id, &current) == 0) {
+      app->draft.version = current.version;
+    }
+    set_status_error(app, "Request was changed by another instance; :w again to overwrite");
+    return -1;
+  }
+  if (rc != 0) {
+    set_status_error(app, "Failed to save request");
+    return -1;
+  }
+
+  set_status(app, "Request saved");
+  app->screen = SCREEN_MAIN;
+  app->main_mode = MAIN_MODE_NORMAL;
+  return 0;
+}
+
+static void draw_editor_status_line(app_t *app, int y, int w) {
+  move(y, 0);
+  clrtoeol();
+  curs_set(0);
+
+  if (app->new_mode == NEW_MODE_COMMAND) {
+    mvprintw(y, 0, ":%s", app->draft_cmdline);
+    move(y, 1 + (int)app->draft_cmdline_len);
+    curs_set(1);
+    return;
+  }
+
+  const char *mode = app->new_mode == NEW_MODE_INSERT ? "INSERT" : "NORMAL";
+  if (has_colors()) {
+    attron(COLOR_PAIR(COLOR_SECTION));
+  }
+  attron(A_BOLD);
+  mvprintw(y, 0, "%s", mode);
+  attroff(A_BOLD);
+  if (has_colors()) {
+    attroff(COLOR_PAIR(COLOR_SECTION));
+  }
+
+  int x = (int)strlen(mode);
+  if (x >= w - 1) {
+    return;
+  }
+
+  if (app->new_mode == NEW_MODE_INSERT) {
+    char prefix[64];
+    snprintf(prefix, sizeof(prefix), " | %s: ", draft_field_label(app->draft_field));
+    mvprintw(y, x, "%s", prefix);
+    x += (int)strlen(prefix);
+    if (x < w - 1) {
+      mvprintw(y, x, "%.*s", w - x - 1, app->draft_input);
+      move(y, x + (int)app->draft_input_len);
+      curs_set(1);
+    }
+    return;
+  }
+
+  if (app->status[0] != '\0') {
+    mvprintw(y, x, " | ");
+    x += 3;
+    if (x < w - 1) {
+      if (app->status_is_error && has_colors()) {
+        attron(COLOR_PAIR(COLOR_STATUS_5XX));
+      }
+      mvprintw(y, x, "%.*s", w - x - 1, app->status);
+      if (app->status_is_error && has_colors()) {
+        attroff(COLOR_PAIR(COLOR_STATUS_5XX));
+      }
+    }
+    return;
+  }
+
+  const char *hint = " | j/k field | i edit | h/l method | { } body | e body | :w save | :q cancel";
+  mvprintw(y, x, "%.*s", w - x - 1, hint);
+}
+
+static void draw_editor_form(app_t *app, WINDOW *win, const editor_layout_t *layout) {
+  werase(win);
+  win_add_section_title(win, 0, 0, app->draft_existing ? "Edit Request" : "New Request");
+  if (has_colors()) {
+    wattron(win, COLOR_PAIR(COLOR_SECTION));
+  }
+  mvwhline(win, 1, 0, ACS_HLINE, layout->left_w);
+  if (has_colors()) {
+    wattroff(win, COLOR_PAIR(COLOR_SECTION));
+  }
+
+  int row = 2;
+  int value_x = 16;
+  for (int i = 0; i < DRAFT_FIELD_COUNT && row < layout->content_h; i++) {
+    if (i == app->draft_field) {
+      wattron(win, A_REVERSE);
+      mvwhline(win, row, 0, ' ', layout->left_w);
+    }
+
+    char label[32];
+    snprintf(label, sizeof(label), "%s: ", draft_field_label(i));
+    if (i == DRAFT_FIELD_METHOD) {
+      if (has_colors()) {
+        wattron(win, COLOR_PAIR(COLOR_LABEL));
+      }
+      wattron(win, A_BOLD);
+      win_add_text(win, row, 1, label);
+      wattroff(win, A_BOLD);
+      if (has_colors()) {
+        wattroff(win, COLOR_PAIR(COLOR_LABEL));
+      }
+
+      int method_pair = method_color_pair(app->draft.method);
+      if (method_pair != 0 && has_colors()) {
+        wattron(win, COLOR_PAIR(method_pair));
+      }
+      win_add_text(win, row, value_x, app->draft.method);
+      if (method_pair != 0 && has_colors()) {
+        wattroff(win, COLOR_PAIR(method_pair));
+      }
+    } else if (i == DRAFT_FIELD_HEADERS) {
+      char summary[32];
+      size_t count = request_header_count(&app->draft);
+      snprintf(summary, sizeof(summary), count == 0 ? "(none)" : "%zu", count);
+      win_add_labeled_text(win, row, 1, label, summary);
+    } else {
+      win_add_labeled_text(win, row, 1, label, draft_field_value(app, i));
+    }
+
+    if (i == app->draft_field) {
+      wattroff(win, A_REVERSE);
+    }
+    row++;
+  }
+
+  if (row < layout->content_h) {
+    win_add_section_title(win, row, 1, "Notes");
+    row++;
+  }
+  if (row < layout->content_h) {
+    win_printf_text(win, row, 1, "Body bytes: %zu", strlen(app->draft.body));
+    row++;
+  }
+  if (row < layout->content_h) {
+    win_add_text(win, row, 1, "Method field uses h/l cycle only");
+  }
+  if (!layout->show_right && layout->content_h > 2) {
+    win_add_text(win, layout->content_h - 2, 1, "Preview hidden (window too narrow)");
+  }
+}
+
+static void draw_editor_preview(app_t *app, WINDOW *win, const editor_layout_t *layout) {
+  werase(win);
+  win_add_section_title(win, 0, 0, "Preview");
+  if (has_colors()) {
+    wattron(win, COLOR_PAIR(COLOR_SECTION));
+  }
+  mvwhline(win, 1, 0, ACS_HLINE, layout->right_w);
+  if (has_colors()) {
+    wattroff(win, COLOR_PAIR(COLOR_SECTION));
+  }
+
+  int row = 2;
+  if (app->draft.name[0] == '\0') {
+    win_add_labeled_text(win, row, 0, "name: ", "(unnamed)");
+  } else {
+    win_add_labeled_text(win, row, 0, "name: ", app->draft.name);
+  }
+  row++;
+
+  win_add_labeled_method(win, row, 0, "method: ", app->draft.method);
+  row++;
+
+  int show_auth_type = app->draft.auth_type[0] != '\0' && strcmp(app->draft.auth_type, "none") != 0;
+
+  int cfg_lines = 0;
+  if (show_auth_type) {
+    cfg_lines++;
+  }
+  if (app->draft.auth_secret_ref[0] != '\0') {
+    cfg_lines++;
+  }
+  if (app->draft.auth_key_name[0] != '\0') {
+    cfg_lines++;
+  }
+  if (app->draft.auth_location[0] != '\0') {
+    cfg_lines++;
+  }
+  if (app->draft.auth_username[0] != '\0') {
+    cfg_lines++;
+  }
+  cfg_lines += (int)request_header_count(&app->draft);
+
+  int reserve = 2;
+  if (cfg_lines > 0) {
+    reserve += 1 + cfg_lines;
+  }
+
+  const int url_label_w = 5;
+  win_add_labeled_text(win, row, 0, "url: ", "");
+  int url_w = layout->right_w - url_label_w;
+  if (url_w < 1) {
+    url_w = 1;
+  }
+  int url_lines_max = layout->content_h - row - reserve;
+  if (url_lines_max < 1) {
+    url_lines_max = 1;
+  }
+  if (url_lines_max > 5) {
+    url_lines_max = 5;
+  }
+  win_draw_wrapped_text(win, row, url_label_w, url_lines_max, url_w, app->draft.url);
+  int url_lines = wrapped_line_count(app->draft.url, url_w, url_lines_max);
+  if (url_lines < 1) {
+    url_lines = 1;
+  }
+  row += url_lines;
+
+  if (cfg_lines > 0 && row < layout->content_h) {
+    win_add_section_title(win, row, 0, "Config");
+    row++;
+  }
+  if (show_auth_type && row < layout->content_h) {
+    win_add_labeled_text(win, row, 0, "auth: ", app->draft.auth_type);
+    row++;
+  }
+  if (app->draft.auth_secret_ref[0] != '\0' && row < layout->content_h) {
+    win_add_labeled_text(win, row, 0, "secret: ", app->draft.auth_secret_ref);
+    row++;
+  }
+  if (app->draft.auth_key_name[0] != '\0' && row < layout->content_h) {
+    win_add_labeled_text(win, row, 0, "key: ", app->draft.auth_key_name);
+    row++;
+  }
+  if (app->draft.auth_location[0] != '\0' && row < layout->content_h) {
+    win_add_labeled_text(win, row, 0, "location: ", app->draft.auth_location);
+    row++;
+  }
+  if (app->draft.auth_username[0] != '\0' && row < layout->content_h) {
+    win_add_labeled_text(win, row, 0, "user: ", app->draft.auth_username);
+    row++;
+  }
+  const char *header_cursor = app->draft.headers;
+  char header_name[TUIMAN_HEADER_KEY_LEN];
+  char header_value[TUIMAN_HEADER_VAL_LEN];
+  while (row < layout->content_h && request_header_next(&header_cursor, header_name, sizeof(header_name),
+                                                       header_value, sizeof(header_value))) {
+    char header_line[TUIMAN_HEADER_KEY_LEN + TUIMAN_HEADER_VAL_LEN + 4];
+    snprintf(header_line, sizeof(header_line), "%s: %s", header_name, header_value);
+    win_add_labeled_text(win, row, 0, "header: ", header_line);
+    row++;
+  }
+
+  if (row < layout->content_h) {
+    win_add_section_title(win, row, 0, "Body");
+    row++;
+  }
+  int body_lines = layout->content_h - row;
+  if (body_lines > 0) {
+    highlighter_t highlight;
+    memset(&highlight, 0, sizeof(highlight));
+    win_draw_wrapped_body_preview(win, row, body_lines, layout->right_w, app->draft.body, &app->editor_body_scroll,
+                                  NULL, &highlight);
+    highlighter_free(&highlight);
+  }
+}
+
+static void draw_new_editor(app_t *app) {
+  int h = 0;
+  int w = 0;
+  getmaxyx(stdscr, h, w);
+
+  editor_layout_t layout;
+  compute_editor_layout(app, h, w, &layout);
+  if (!layout.valid) {
+    erase();
+    if (h > 0) {
+      mvprintw(h - 1, 0, "Window too small");
+    }
+    refresh();
+    app->chrome_dirty = true;
+    return;
+  }
+
+  WINDOW *left_win = pane_place(app, PANE_EDITOR_FORM, layout.content_h, layout.left_w, 0, 0);
+  WINDOW *right_win = NULL;
+  if (layout.show_right) {
+    right_win = pane_place(app, PANE_EDITOR_PREVIEW, layout.content_h, layout.right_w, 0, layout.right_x);
+  } else {
+    pane_drop(app, PANE_EDITOR_PREVIEW);
+    app->editor_body_scroll = 0;
+  }
+
+  if (left_win == NULL) {
+    erase();
+    mvprintw(h - 1, 0, "Failed to create editor pane");
+    refresh();
+    app->chrome_dirty = true;
+    return;
+  }
+
+  if (frame_needs_chrome(app, SCREEN_NEW)) {
+    if (layout.show_right) {
+      if (app->drag_mode == DRAG_VERTICAL) {
+        attron(A_REVERSE);
+      }
+      for (int y = 0; y < layout.content_h; y++) {
+        mvaddch(y, layout.separator_x, ACS_VLINE);
+      }
+      if (app->drag_mode == DRAG_VERTICAL) {
+        attroff(A_REVERSE);
+      }
+    }
+  }
+
+  if (app->panes[PANE_EDITOR_FORM].dirty) {
+    draw_editor_form(app, left_win, &layout);
+  }
+  if (right_win != NULL && app->panes[PANE_EDITOR_PREVIEW].dirty) {
+    draw_editor_preview(app, right_win, &layout);
+  }
+
+  draw_editor_status_line(app, h - 1, w);
+  static const pane_id_t panes[] = {PANE_EDITOR_FORM, PANE_EDITOR_PREVIEW};
+  flush_panes(app, panes, 2);
+  doupdate();
+}
+
+/*
+ * `variables` ("name=value" lines from environment_describe_variables) may be
+ * NULL. The run reads the body from `body` in place, taking a hold of its own
+ * while it is queued; NULL means the body could not be kept.
+ */
+static void record_run(app_t *app, const request_t *req, const http_response_t *response, response_body_t *body,
+                       const char *variables) {
+  run_entry_t run;
+  memset(&run, 0, sizeof(run));
+  snprintf(run.request_id, sizeof(run.request_id), "%s", req->id);
+  snprintf(run.request_name, sizeof(run.request_name), "%s", req->name);
+  snprintf(run.method, sizeof(run.method), "%s", req->method);
+  snprintf(run.url, sizeof(run.url), "%s", req->url);
+  run.status_code = (int)response->status_code;
+  run.duration_ms = response->duration_ms;
+  snprintf(run.error, sizeof(run.error), "%s", response->error);
+  run.request_snapshot = request_snapshot_encode(req, app->env.name, variables);
+  if (run.request_snapshot == NULL) {
+    const char *fallback = "(request snapshot unavailable: out of memory)";
+    run.request_snapshot = dup_text_n(fallback, strlen(fallback));
+  }
+  char *fallback_body = NULL;
+  if (body != NULL) {
+    run.response_body = body->response.body;
+    run.response_body_len = body->response.body_len;
+  } else {
+    const char *fallback = "(response body unavailable: out of memory)";
+    fallback_body = dup_text_n(fallback, strlen(fallback));
+    run.response_body = fallback_body;
+    run.response_body_len = strlen(fallback);
+  }
+  now_iso(run.created_at);
+  if (app->history_writer != NULL) {
+    if (fallback_body == NULL && run.response_body != NULL) {
+      run.body_release = response_body_release;
+      run.body_owner = response_body_hold(body);
+    }
+    history_writer_submit(app->history_writer, &run);
+    return;
+  }
+  history_store_add_run(&app->history, &run);
+  invalidate_request_latency(app, req->id);
+  free(run.request_snapshot);
+  free(fallback_body);
+}
+
+/* `in_catalog`: `stored` is the entry in app->requests, so its compiled templates can be kept. */
+static int send_request_and_record(app_t *app, const request_t *stored, bool in_catalog) {
+  /* Every field of one send sees the same generator values; history records what went on the wire. */
+  template_set_t *templates = in_catalog ? app->templates : NULL;
+  template_iteration_t iteration;
+  template_iteration_begin(&iteration, ++app->send_counter);
+  request_t resolved;
+  if (environment_resolve_request(&app->env, NULL, templates, stored, &iteration, &resolved) != 0) {
+    set_status_error(app, "Request too large after {{var}} expansion");
+    return -1;
+  }
+  request_t *req = &resolved;
+
+  http_response_t response;
+  int rc = http_send_request(req, &response);
+  char now[40];
+  now_iso(now);
+
+  snprintf(app->last_response_request_id, sizeof(app->last_response_request_id), "%s", req->id);
+  snprintf(app->last_response_request_name, sizeof(app->last_response_request_name), "%s", req->name);
+  snprintf(app->last_response_method, sizeof(app->last_response_method), "%s", req->method);
+  snprintf(app->last_response_url, sizeof(app->last_response_url), "%s", req->url);
+  snprintf(app->last_response_at, sizeof(app->last_response_at), "%s", now);
+  app->last_response_status = response.status_code;
+  app->last_response_ms = response.duration_ms;
+  snprintf(app->last_response_error, sizeof(app->last_response_error), "%s", response.error);
+
+  /* One body for both the response pane and the history run; neither copies it. */
+  response_body_t *body = response_body_take(&response);
+  char *variables = environment_describe_variables(&app->env, NULL, templates, stored);
+  record_run(app, req, &response, body, variables);
+  free(variables);
+  set_last_response(app, body);
+
+  if (rc == 0) {
+    set_status(app, "Request sent");
+  } else {
+    char msg[STATUS_MAX];
+    snprintf(msg, sizeof(msg), "Request failed: %s", response.error[0] ? response.error : "unknown error");
+    set_status(app, msg);
+  }
+
+  http_response_free(&response);
+  return rc;
+}
+
+static void record_workflow_attempt(void *ctx, const workflow_step_t *step, const request_t *sent,
+                                    const char *variables, http_response_t *response) {
+  (void)step;
+  response_body_t *body = response_body_take(response);
+  record_run((app_t *)ctx, sent, response, body, variables);
+  response_body_release(body);
+}
+
+/* Runs the whole DAG (blocking, like a single send) and shows the report in the pager. */
+static void run_workflow(app_t *app, const char *name) {
+  char msg[STATUS_MAX];
+  workflow_t wf;
+  char error[256];
+  if (workflow_load(&app->paths, name, &wf, error, sizeof(error)) != 0) {
+    set_status_error(app, error);
+    return;
+  }
+
+  /* Steps may reference requests in collections that were never expanded. */
+  request_list_t catalog = {0};
+  if (request_store_list(&app->store, &catalog) != 0) {
+    workflow_free(&wf);
+    set_status_error(app, "Failed to load requests");
+    return;
+  }
+
+  snprintf(msg, sizeof(msg), "Running workflow %s (%zu steps)...", name, wf.len);
+  set_status(app, msg);
+  draw_main(app);
+
+  workflow_report_t report;
+  int rc = workflow_run(&wf, &catalog, &app->env, &app->send_counter, record_workflow_attempt, app, &report);
+  request_list_free(&catalog);
+
+  /* The report gets its own view; the last response stays the last thing actually sent. */
+  char *text = workflow_format_report(&wf, &report);
+  if (text != NULL) {
+    char title[160];
+    snprintf(title, sizeof(title), "workflow %s report", name);
+    open_pager(app, text, strlen(text), text, -1, title);
+  }
+
+  snprintf(msg, sizeof(msg), "Workflow %s: %zu ok, %zu failed, %zu skipped in %ld ms", name, report.ok,
+           report.failed, report.skipped, report.wall_ms);
+  if (rc == 0) {
+    set_status(app, msg);
+  } else {
+    set_status_error(app, msg);
+  }
+  workflow_report_free(&report);
+  workflow_free(&wf);
+}
+
+static void format_size(long long bytes, char *out, size_t out_len) {
+  if (bytes >= 1024LL * 1024) {
+    snprintf(out, out_len, "%.1f MiB", (double)bytes / (1024.0 * 1024.0));
+  } else if (bytes >= 1024) {
+    snprintf(out, out_len, "%.1f KiB", (double)bytes / 1024.0);
+  } else {
+    snprintf(out, out_len, "%lld B", bytes);
+  }
+}
+
+/* Opens in the pager; runs still queued on the writer are not counted yet. */
+static void show_history_stats(app_t *app) {
+  history_stats_t stats;
+  if (history_store_stats(&app->history, &stats) != 0) {
+    set_status_error(app, "Failed to read history stats");
+    return;
+  }
+
+  char file[32], free_pages[32], reclaimed[32], body[32], stored[32];
+  format_size(stats.file_bytes, file, sizeof(file));
+  format_size(stats.free_bytes, free_pages, sizeof(free_pages));
+  format_size(stats.reclaimed_bytes, reclaimed, sizeof(reclaimed));
+  format_size(stats.body_bytes, body, sizeof(body));
+  format_size(stats.body_stored_bytes, stored, sizeof(stored));
+  char *text = malloc(1024);
+  if (text == NULL) {
+    set_status_error(app, "Out of memory");
+    return;
+  }
+  snprintf(text, 1024,
+           "runs:              %lld\n"
+           "distinct bodies:   %lld (%s, %s on disk)\n"
+           "database file:     %s (%s free)\n"
+           "reclaimed:         %s\n"
+           "retention deleted: %lld runs\n"
+           "auto_vacuum:       %s\n",
+           stats.runs, stats.bodies, body, stored, file, free_pages, reclaimed, stats.retention_deleted,
+           stats.incremental_vacuum ? "incremental" : "none (:history-vacuum converts)");
+  open_pager(app, text, strlen(text), text, -1, "history stats");
+}
+
+/* Blocks until the rebuild is done, so the notice goes on the bottom line first, on any screen. */
+static void vacuum_history(app_t *app) {
+  mvprintw(LINES - 1, 0, "%.*s", COLS - 1, "Vacuuming history (this can take a while on a large file)...");
+  clrtoeol();
+  refresh();
+  if (history_store_vacuum(&app->history) != 0) {
+    set_status_error(app, "History vacuum failed (database busy?)");
+    return;
+  }
+  history_stats_t stats;
+  char file[32] = "?";
+  if (history_store_stats(&app->history, &stats) == 0) {
+    format_size(stats.file_bytes, file, sizeof(file));
+  }
+  char msg[96];
+  snprintf(msg, sizeof(msg), "History vacuumed: %s, auto_vacuum incremental", file);
+  set_status(app, msg);
+}
+
+static void load_history_page(app_t *app) {
+  if (app->history_exhausted) {
+    return;
+  }
+  int before_id = app->runs.len > 0 ? app->runs.items[app->runs.len - 1].id : 0;
+  if (history_store_list_page(&app->history, before_id, HISTORY_PAGE, &app->runs) < HISTORY_PAGE) {
+    app->history_exhausted = true;
+  }
+}
+
+/* The selected run, with its snapshot and body read in; the previously selected run drops its copy. */
+static run_entry_t *selected_run(app_t *app) {
+  if (app->history_selected >= app->runs.len) {
+    return NULL;
+  }
+  run_entry_t *run = &app->runs.items[app->history_selected];
+  if (app->history_bodies_index != app->history_selected) {
+    if (app->history_bodies_index < app->runs.len) {
+      run_entry_free_bodies(&app->runs.items[app->history_bodies_index]);
+    }
+    history_store_load_bodies(&app->history, run);
+    app->history_bodies_index = app->history_selected;
+  }
+  return run;
+}
+
+/* The next older loaded run of the same request, if any. */
+static const run_entry_t *previous_run_of_request(const app_t *app, size_t index) {
+  for (size_t i = index + 1; i < app->runs.len; i++) {
+    if (strcmp(app->runs.items[i].request_id, app->runs.items[index].request_id) == 0) {
+      return &app->runs.items[i];
+    }
+  }
+  return NULL;
+}
+
+static void close_history_search(app_t *app) {
+  history_hit_list_free(&app->history_search.hits);
+  app->history_search.active = false;
+  app->history_search.selected = 0;
+  app->history_search.scroll = 0;
+}
+
+/* The selected run's detail text, rendered on first use and kept while it stays selected. */
+static const char *history_detail_text(app_t *app, const run_entry_t *run) {
+  if (app->history_detail_text == NULL || app->history_detail_run_id != run->id) {
+    wrap_cache_reset(&app->history_wrap);
+    free(app->history_detail_text);
+    app->history_detail_text = build_history_detail_text(run, &app->history_wrap.highlight);
+    app->history_detail_run_id = run->id;
+  }
+  return app->history_detail_text;
+}
+
+static void load_history(app_t *app) {
+  close_history_search(app);
+  wrap_cache_reset(&app->history_wrap);
+  free(app->history_detail_text);
+  app->history_detail_text = NULL;
+  run_list_free(&app->runs);
+  app->history_exhausted = false;
+  app->history_bodies_index = SIZE_MAX;
+  /* Committed runs only; queued ones are put in front when the writer reports them (history_runs_committed). */
+  load_history_page(app);
+  app->history_selected = 0;
+  app->history_scroll = 0;
+  app->history_detail_scroll = 0;
+  app->drag_mode = DRAG_NONE;
+}
+
+/*
+ * The writer committed a batch: runs newer than the loaded ones are read with
+ * the first page and put in front, so the selection (and its cached detail)
+ * stays on the run the user was looking at.
+ */
+static void history_runs_committed(app_t *app) {
+  if (app->screen != SCREEN_HISTORY) {
+    return;
+  }
+  if (app->runs.len == 0) {
+    app->history_exhausted = false;
+    load_history_page(app);
+    damage_pane(app, PANE_HISTORY_LIST);
+    damage_pane(app, PANE_HISTORY_DETAIL);
+    return;
+  }
+
+  run_list_t fresh = {0};
+  if (history_store_list_page(&app->history, 0, HISTORY_PAGE, &fresh) < 0) {
+    return;
+  }
+  size_t newer = 0;
+  while (newer < fresh.len && fresh.items[newer].id > app->runs.items[0].id) {
+    newer++;
+  }
+  if (newer == fresh.len && newer == HISTORY_PAGE) {
+    /* More than a page arrived at once; start over from the newest. */
+    run_list_free(&fresh);
+    load_history(app);
+    invalidate_panes(app);
+    return;
+  }
+  if (newer > 0 && app->runs.len + newer > app->runs.cap) {
+    run_entry_t *grown = realloc(app->runs.items, (app->runs.len + newer) * sizeof(run_entry_t));
+    if (grown == NULL) {
+      run_list_free(&fresh);
+      return;
+    }
+    app->runs.items = grown;
+    app->runs.cap = app->runs.len + newer;
+  }
+  if (newer > 0) {
+    memmove(&app->runs.items[newer], app->runs.items, app->runs.len * sizeof(run_entry_t));
+    memcpy(app->runs.items, fresh.items, newer * sizeof(run_entry_t));
+    app->runs.len += newer;
+    app->history_selected += newer;
+    /* At the top the new runs come into view; scrolled down, the view stays put. */
+    if (app->history_scroll > 0) {
+      app->history_scroll += newer;
+    }
+    if (app->history_bodies_index != SIZE_MAX) {
+      app->history_bodies_index += newer;
+    }
+    damage_pane(app, PANE_HISTORY_LIST);
+  }
+  /* The moved runs now belong to app->runs; only the overlap is freed. */
+  for (size_t i = newer; i < fresh.len; i++) {
+    run_entry_free_bodies(&fresh.items[i]);
+  }
+  free(fresh.items);
+}
+
+/* Searches committed runs; queued ones are found when their commit re-runs the query (history_search_committed). */
+static void run_history_search(app_t *app, const char *query) {
+  close_history_search(app);
+  snprintf(app->history_search.query, sizeof(app->history_search.query), "%s", query);
+  if (history_store_search(&app->history, query, HISTORY_SEARCH_LIMIT, &app->history_search.hits) != 0) {
+    set_status_error(app, "History search failed");
+    return;
+  }
+  app->history_search.active = true;
+}
+
+/* The writer committed while search results are shown: ranks again, keeping the selected hit's run. */
+static void history_search_committed(app_t *app) {
+  history_search_t *search = &app->history_search;
+  if (app->screen != SCREEN_HISTORY || !search->active) {
+    return;
+  }
+  int selected_id = search->selected < search->hits.len ? search->hits.items[search->selected].run.id : 0;
+  history_hit_list_t hits = {0};
+  if (history_store_search(&app->history, search->query, HISTORY_SEARCH_LIMIT, &hits) != 0) {
+    return;
+  }
+  history_hit_list_free(&search->hits);
+  search->hits = hits;
+  search->selected = 0;
+  for (size_t i = 0; i < hits.len; i++) {
+    if (hits.items[i].run.id == selected_id) {
+      search->selected = i;
+      break;
+    }
+  }
+  damage_pane(app, PANE_HISTORY_LIST);
+  damage_pane(app, PANE_HISTORY_DETAIL);
+}
+
+/* Leaves search on the hit's run, paging older runs in until it is loaded. */
+static void jump_to_history_run(app_t *app, int run_id) {
+  close_history_search(app);
+  size_t checked = 0;
+  for (;;) {
+    for (size_t i = checked; i < app->runs.len; i++) {
+      if (app->runs.items[i].id == run_id) {
+        app->history_selected = i;
+        app->history_detail_scroll = 0;
+        return;
+      }
+    }
+    checked = app->runs.len;
+    if (app->history_exhausted) {
+      return;
+    }
+    load_history_page(app);
+  }
+}
+
+static void draw_history_hits(app_t *app, WINDOW *left_win, WINDOW *right_win, const history_layout_t *layout) {
+  history_search_t *search = &app->history_search;
+  char title[CMDLINE_MAX + 32];
+  snprintf(title, sizeof(title), "History search: %s", search->query);
+  win_add_section_title(left_win, 0, 0, title);
+  if (has_colors()) {
+    wattron(left_win, COLOR_PAIR(COLOR_SECTION));
+  }
+  mvwhline(left_win, 1, 0, ACS_HLINE, layout->left_w);
+  if (has_colors()) {
+    wattroff(left_win, COLOR_PAIR(COLOR_SECTION));
+  }
+
+  int status_x = 21;
+  int match_x = status_x + 8;
+  if (match_x >= layout->left_w - 4) {
+    match_x = layout->left_w - 4;
+  }
+  int header_y = 2;
+  if (header_y < layout->content_h) {
+    if (has_colors()) {
+      wattron(left_win, COLOR_PAIR(COLOR_LABEL));
+    }
+    wattron(left_win, A_BOLD);
+    win_add_text(left_win, header_y, 1, "When");
+    win_add_text(left_win, header_y, status_x, "Status");
+    win_add_text(left_win, header_y, match_x, "Match");
+    wattroff(left_win, A_BOLD);
+    if (has_colors()) {
+      wattroff(left_win, COLOR_PAIR(COLOR_LABEL));
+    }
+  }
+
+  int rows = layout->content_h - (header_y + 1);
+  if (rows < 1) {
+    rows = 1;
+  }
+  if (search->selected < search->scroll) {
+    search->scroll = search->selected;
+  }
+  if (search->selected >= search->scroll + (size_t)rows) {
+    search->scroll = search->selected - (size_t)rows + 1;
+  }
+  for (int i = 0; i < rows; i++) {
+    size_t idx = search->scroll + (size_t)i;
+    if (idx >= search->hits.len) {
+      break;
+    }
+    const history_hit_t *hit = &search->hits.items[idx];
+    int y = i + header_y + 1;
+    if (idx == search->selected) {
+      wattron(left_win, A_REVERSE);
+      mvwhline(left_win, y, 0, ' ', layout->left_w);
+    }
+    win_printf_text(left_win, y, 1, "%-19.19s", hit->run.created_at);
+    int s_pair = status_color_pair(hit->run.status_code);
+    if (s_pair != 0 && has_colors()) {
+      wattron(left_win, COLOR_PAIR(s_pair));
+    }
+    win_printf_text(left_win, y, status_x, "%-7d", hit->run.status_code);
+    if (s_pair != 0 && has_colors()) {
+      wattroff(left_win, COLOR_PAIR(s_pair));
+    }
+    int match_w = layout->left_w - match_x - 1;
+    if (match_w > 0) {
+      win_printf_text(left_win, y, match_x, "%-*.*s", match_w, match_w, hit->snippet);
+    }
+    if (idx == search->selected) {
+      wattroff(left_win, A_REVERSE);
+    }
+  }
+  if (search->hits.len == 0 && header_y + 1 < layout->content_h) {
+    win_add_text(left_win, header_y + 1, 1, "No matching runs");
+  }
+
+  if (right_win == NULL) {
+    return;
+  }
+  win_add_section_title(right_win, 0, 0, "Match");
+  if (has_colors()) {
+    wattron(right_win, COLOR_PAIR(COLOR_SECTION));
+  }
+  mvwhline(right_win, 1, 0, ACS_HLINE, layout->right_w);
+  if (has_colors()) {
+    wattroff(right_win, COLOR_PAIR(COLOR_SECTION));
+  }
+  if (search->selected >= search->hits.len) {
+    return;
+  }
+  const history_hit_t *hit = &search->hits.items[search->selected];
+  int row = 2;
+  win_add_labeled_text(right_win, row++, 0, "name: ", hit->run.request_name[0] != '\0' ? hit->run.request_name : "(unnamed)");
+  win_add_labeled_method(right_win, row++, 0, "method: ", hit->run.method);
+  win_add_labeled_text(right_win, row++, 0, "url: ", hit->run.url);
+  win_add_labeled_text(right_win, row++, 0, "at: ", hit->run.created_at);
+  if (hit->run.error[0] != '\0') {
+    win_add_labeled_text(right_win, row++, 0, "error: ", hit->run.error);
+  }
+  row++;
+  if (row < layout->content_h) {
+    win_draw_wrapped_text(right_win, row, 0, layout->content_h - row, layout->right_w, hit->snippet);
+  }
+}
+
+static void history_columns(const history_layout_t *layout, int *method_x, int *status_x, int *duration_x,
+                            int *name_x) {
+  *method_x = 22;
+  if (*method_x >= layout->left_w - 8) {
+    *method_x = layout->left_w / 2;
+  }
+  *status_x = *method_x + 8;
+  *duration_x = *status_x + 8;
+  *name_x = *duration_x + 7;
+  if (*name_x >= layout->left_w - 4) {
+    *name_x = layout->left_w - 4;
+  }
+}
+
+static void draw_history_run_row(app_t *app, WINDOW *win, const history_layout_t *layout, size_t idx, int y) {
+  int method_x = 0;
+  int status_x = 0;
+  int duration_x = 0;
+  int name_x = 0;
+  history_columns(layout, &method_x, &status_x, &duration_x, &name_x);
+
+  run_entry_t *run = &app->runs.items[idx];
+  if (idx == app->history_selected) {
+    wattron(win, A_REVERSE);
+    mvwhline(win, y, 0, ' ', layout->left_w);
+  }
+
+  if (run->id == app->history_mark.id) {
+    win_add_text(win, y, 0, "*");
+  }
+  win_printf_text(win, y, 1, "%-19.19s", run->created_at);
+
+  int m_pair = method_color_pair(run->method);
+  if (m_pair != 0 && has_colors()) {
+    wattron(win, COLOR_PAIR(m_pair));
+  }
+  win_printf_text(win, y, method_x, "%-7.7s", run->method);
+  if (m_pair != 0 && has_colors()) {
+    wattroff(win, COLOR_PAIR(m_pair));
+  }
+
+  int s_pair = status_color_pair(run->status_code);
+  if (s_pair != 0 && has_colors()) {
+    wattron(win, COLOR_PAIR(s_pair));
+  }
+  win_printf_text(win, y, status_x, "%-7d", run->status_code);
+  if (s_pair != 0 && has_colors()) {
+    wattroff(win, COLOR_PAIR(s_pair));
+  }
+
+  win_printf_text(win, y, duration_x, "%-5ld", run->duration_ms);
+
+  int name_w = layout->left_w - name_x - 1;
+  if (name_w > 0) {
+    win_printf_text(win, y, name_x, "%-*.*s", name_w, name_w, run->request_name);
+  }
+
+  if (idx == app->history_selected) {
+    wattroff(win, A_REVERSE);
   }
-  index = (index + delta + 5) % 5;
-  snprintf(req->method, sizeof(req->method), "%s", methods[index]);
 }
 
-static int save_draft(app_t *app) {
-  if (app->draft.method[0] == '\0') {
-    snprintf(app->draft.method, sizeof(app->draft.method), "GET");
+/* As draw_main_list: a bare selection move repaints only the old and new rows. */
+static void draw_history_list(app_t *app, WINDOW *win, const history_layout_t *layout) {
+  pane_t *pane = &app->panes[PANE_HISTORY_LIST];
+  int header_y = 2;
+  int rows = layout->content_h - (header_y + 1);
+  if (rows < 1) {
+    rows = 1;
   }
-  if (app->draft.name[0] == '\0') {
-    char guessed[TUIMAN_NAME_LEN];
-    guess_name(app->draft.method, app->draft.url, guessed, sizeof(guessed));
-    snprintf(app->draft.name, sizeof(app->draft.name), "%s", guessed);
+  if (app->history_selected < app->history_scroll) {
+    app->history_scroll = app->history_selected;
   }
-  if (app->draft.url[0] == '\0') {
-    set_status_error(app, "URL cannot be empty");
-    return -1;
+  if (app->history_selected >= app->history_scroll + (size_t)rows) {
+    app->history_scroll = app->history_selected - (size_t)rows + 1;
   }
 
-  request_set_updated_now(&app->draft);
-  if (request_store_save(&app->paths, &app->draft) != 0) {
-    set_status_error(app, "Failed to save request");
-    return -1;
+  if (!pane->dirty && layout->show_right && pane->drawn_scroll == app->history_scroll) {
+    if (pane->drawn_selected != app->history_selected) {
+      size_t changed[2] = {pane->drawn_selected, app->history_selected};
+      for (int i = 0; i < 2; i++) {
+        if (changed[i] < app->runs.len && changed[i] - app->history_scroll < (size_t)rows) {
+          int y = (int)(changed[i] - app->history_scroll) + header_y + 1;
+          wmove(win, y, 0);
+          wclrtoeol(win);
+          draw_history_run_row(app, win, layout, changed[i], y);
+        }
+      }
+    }
+    pane->drawn_selected = app->history_selected;
+    return;
   }
 
-  char selected_id[TUIMAN_ID_LEN];
-  snprintf(selected_id, sizeof(selected_id), "%s", app->draft.id);
-  load_requests(app, selected_id);
+  werase(win);
+  win_add_section_title(win, 0, 0, "History");
+  if (has_colors()) {
+    wattron(win, COLOR_PAIR(COLOR_SECTION));
+  }
+  mvwhline(win, 1, 0, ACS_HLINE, layout->left_w);
+  if (has_colors()) {
+    wattroff(win, COLOR_PAIR(COLOR_SECTION));
+  }
 
-  set_status(app, "Request saved");
-  app->screen = SCREEN_MAIN;
-  app->main_mode = MAIN_MODE_NORMAL;
-  return 0;
-}
+  int method_x = 0;
+  int status_x = 0;
+  int duration_x = 0;
+  int name_x = 0;
+  history_columns(layout, &method_x, &status_x, &duration_x, &name_x);
+  if (header_y < layout->content_h) {
+    if (has_colors()) {
+      wattron(win, COLOR_PAIR(COLOR_LABEL));
+    }
+    wattron(win, A_BOLD);
+    win_add_text(win, header_y, 1, "When");
+    win_add_text(win, header_y, method_x, "Method");
+    win_add_text(win, header_y, status_x, "Status");
+    win_add_text(win, header_y, duration_x, "ms");
+    win_add_text(win, header_y, name_x, "Name");
+    wattroff(win, A_BOLD);
+    if (has_colors()) {
+      wattroff(win, COLOR_PAIR(COLOR_LABEL));
+    }
+  }
 
-static void draw_editor_status_line(app_t *app, int y, int w) {
-  move(y, 0);
-  clrtoeol();
-  curs_set(0);
+  for (int i = 0; i < rows && app->history_scroll + (size_t)i < app->runs.len; i++) {
+    draw_history_run_row(app, win, layout, app->history_scroll + (size_t)i, i + header_y + 1);
+  }
 
-  if (app->new_mode == NEW_MODE_COMMAND) {
-    mvprintw(y, 0, ":%s", app->draft_cmdline);
-    move(y, 1 + (int)app->draft_cmdline_len);
-    curs_set(1);
-    return;
+  if (app->runs.len == 0) {
+    win_add_text(win, 3, 1, "No history yet");
+    win_add_text(win, 4, 1, "Send requests from main to populate history");
+    app->history_detail_scroll = 0;
   }
+  if (!layout->show_right && layout->content_h > 2) {
+    win_add_text(win, layout->content_h - 2, 1, "Run detail hidden (window too narrow)");
+  }
+  pane->drawn_scroll = app->history_scroll;
+  pane->drawn_selected = app->history_selected;
+}
 
-  const char *mode = app->new_mode == NEW_MODE_INSERT ? "INSERT" : "NORMAL";
+static void draw_history_detail(app_t *app, WINDOW *win, const history_layout_t *layout) {
+  werase(win);
+  win_add_section_title(win, 0, 0, "Run Detail");
   if (has_colors()) {
-    attron(COLOR_PAIR(COLOR_SECTION));
+    wattron(win, COLOR_PAIR(COLOR_SECTION));
   }
-  attron(A_BOLD);
-  mvprintw(y, 0, "%s", mode);
-  attroff(A_BOLD);
+  mvwhline(win, 1, 0, ACS_HLINE, layout->right_w);
   if (has_colors()) {
-    attroff(COLOR_PAIR(COLOR_SECTION));
+    wattroff(win, COLOR_PAIR(COLOR_SECTION));
   }
 
-  int x = (int)strlen(mode);
-  if (x >= w - 1) {
-    return;
-  }
+  if (app->runs.len == 0) {
+    win_add_text(win, 2, 0, "No history yet.");
+  } else {
+    run_entry_t *run = selected_run(app);
+    int row = 2;
 
-  if (app->new_mode == NEW_MODE_INSERT) {
-    char prefix[64];
-    snprintf(prefix, sizeof(prefix), " | %s: ", draft_field_label(app->draft_field));
-    mvprintw(y, x, "%s", prefix);
-    x += (int)strlen(prefix);
-    if (x < w - 1) {
-      mvprintw(y, x, "%.*s", w - x - 1, app->draft_input);
-      move(y, x + (int)app->draft_input_len);
-      curs_set(1);
+    if (run->request_name[0] == '\0') {
+      win_add_labeled_text(win, row, 0, "name: ", "(unnamed)");
+    } else {
+      win_add_labeled_text(win, row, 0, "name: ", run->request_name);
     }
-    return;
-  }
+    row++;
 
-  if (app->status[0] != '\0') {
-    mvprintw(y, x, " | ");
-    x += 3;
-    if (x < w - 1) {
-      if (app->status_is_error && has_colors()) {
-        attron(COLOR_PAIR(COLOR_STATUS_5XX));
+    win_add_labeled_method(win, row, 0, "method: ", run->method);
+    row++;
+
+    wmove(win, row, 0);
+    if (has_colors()) {
+      wattron(win, COLOR_PAIR(COLOR_LABEL));
+    }
+    wattron(win, A_BOLD);
+    waddstr(win, "status: ");
+    wattroff(win, A_BOLD);
+    if (has_colors()) {
+      wattroff(win, COLOR_PAIR(COLOR_LABEL));
+    }
+    int s_pair = status_color_pair(run->status_code);
+    if (s_pair != 0 && has_colors()) {
+      wattron(win, COLOR_PAIR(s_pair));
+    }
+    wprintw(win, "%d", run->status_code);
+    if (s_pair != 0 && has_colors()) {
+      wattroff(win, COLOR_PAIR(s_pair));
+    }
+    wprintw(win, "  duration=%ldms", run->duration_ms);
+    row++;
+
+    win_add_labeled_text(win, row, 0, "at: ", run->created_at);
+    row++;
+    win_add_labeled_text(win, row, 0, "id: ", run->request_id);
+    row++;
+    if (run->body_hash[0] != '\0') {
+      const run_entry_t *previous = previous_run_of_request(app, app->history_selected);
+      char body_label[96];
+      snprintf(body_label, sizeof(body_label), "sha256 %.12s%s", run->body_hash,
+               previous != NULL && strcmp(previous->body_hash, run->body_hash) == 0 ? " (same as previous run)" : "");
+      win_add_labeled_text(win, row, 0, "body: ", body_label);
+      row++;
+    }
+
+    if (row < layout->content_h) {
+      if (has_colors()) {
+        wattron(win, COLOR_PAIR(COLOR_SECTION));
       }
-      mvprintw(y, x, "%.*s", w - x - 1, app->status);
-      if (app->status_is_error && has_colors()) {
-        attroff(COLOR_PAIR(COLOR_STATUS_5XX));
+      mvwhline(win, row, 0, ACS_HLINE, layout->right_w);
+      if (has_colors()) {
+        wattroff(win, COLOR_PAIR(COLOR_SECTION));
       }
+      row++;
     }
-    return;
-  }
 
-  const char *hint = " | j/k field | i edit | h/l method | { } body | e body | :w save | :q cancel";
-  mvprintw(y, x, "%.*s", w - x - 1, hint);
+    if (row < layout->content_h) {
+      win_add_section_title(win, row, 0, "Request + Response");
+      row++;
+    }
+
+    if (row < layout->content_h) {
+      const char *details = history_detail_text(app, run);
+      if (details == NULL) {
+        details = "(history detail unavailable: out of memory)";
+      }
+      win_draw_wrapped_body_preview(win, row, layout->content_h - row, layout->right_w, details,
+                                    &app->history_detail_scroll, &app->history_wrap, &app->history_wrap.highlight);
+    }
+  }
 }
 
-static void draw_new_editor(app_t *app) {
+static void draw_history(app_t *app) {
   int h = 0;
   int w = 0;
   getmaxyx(stdscr, h, w);
 
-  editor_layout_t layout;
-  compute_editor_layout(app, h, w, &layout);
+  history_layout_t layout;
+  compute_history_layout(app, h, w, &layout);
   if (!layout.valid) {
     erase();
     if (h > 0) {
       mvprintw(h - 1, 0, "Window too small");
     }
     refresh();
+    app->chrome_dirty = true;
     return;
   }
 
-  erase();
-
-  WINDOW *left_win = newwin(layout.content_h, layout.left_w, 0, 0);
+  WINDOW *left_win = pane_place(app, PANE_HISTORY_LIST, layout.content_h, layout.left_w, 0, 0);
   WINDOW *right_win = NULL;
   if (layout.show_right) {
-    right_win = newwin(layout.content_h, layout.right_w, 0, layout.right_x);
+    right_win = pane_place(app, PANE_HISTORY_DETAIL, layout.content_h, layout.right_w, 0, layout.right_x);
+  } else {
+    pane_drop(app, PANE_HISTORY_DETAIL);
   }
 
   if (left_win == NULL) {
-    mvprintw(h - 1, 0, "Failed to create editor pane");
+    erase();
+    mvprintw(h - 1, 0, "Failed to create history pane");
     refresh();
+    app->chrome_dirty = true;
     return;
   }
 
-  werase(left_win);
-  if (right_win != NULL) {
-    werase(right_win);
-  }
-
-  win_add_section_title(left_win, 0, 0, app->draft_existing ? "Edit Request" : "New Request");
-  if (has_colors()) {
-    wattron(left_win, COLOR_PAIR(COLOR_SECTION));
-  }
-  mvwhline(left_win, 1, 0, ACS_HLINE, layout.left_w);
-  if (has_colors()) {
-    wattroff(left_win, COLOR_PAIR(COLOR_SECTION));
-  }
-
-  int row = 2;
-  int value_x = 16;
-  for (int i = 0; i < DRAFT_FIELD_COUNT && row < layout.content_h; i++) {
-    if (i == app->draft_field) {
-      wattron(left_win, A_REVERSE);
-      mvwhline(left_win, row, 0, ' ', layout.left_w);
-    }
-
-    char label[32];
-    snprintf(label, sizeof(label), "%s: ", draft_field_label(i));
-    if (i == DRAFT_FIELD_METHOD) {
-      if (has_colors()) {
-        wattron(left_win, COLOR_PAIR(COLOR_LABEL));
-      }
-      wattron(left_win, A_BOLD);
-      win_add_text(left_win, row, 1, label);
-      wattroff(left_win, A_BOLD);
-      if (has_colors()) {
-        wattroff(left_win, COLOR_PAIR(COLOR_LABEL));
+  if (frame_needs_chrome(app, SCREEN_HISTORY)) {
+    if (layout.show_right) {
+      if (app->drag_mode == DRAG_VERTICAL) {
+        attron(A_REVERSE);
       }
-
-      int method_pair = method_color_pair(app->draft.method);
-      if (method_pair != 0 && has_colors()) {
-        wattron(left_win, COLOR_PAIR(method_pair));
+      for (int y = 0; y < layout.content_h; y++) {
+        mvaddch(y, layout.separator_x, ACS_VLINE);
       }
-      win_add_text(left_win, row, value_x, app->draft.method);
-      if (method_pair != 0 && has_colors()) {
-        wattroff(left_win, COLOR_PAIR(method_pair));
+      if (app->drag_mode == DRAG_VERTICAL) {
+        attroff(A_REVERSE);
       }
-    } else {
-      win_add_labeled_text(left_win, row, 1, label, draft_field_value(app, i));
     }
+  }
 
-    if (i == app->draft_field) {
-      wattroff(left_win, A_REVERSE);
+  if (app->history_search.active) {
+    if (app->panes[PANE_HISTORY_LIST].dirty || app->panes[PANE_HISTORY_DETAIL].dirty) {
+      werase(left_win);
+      if (right_win != NULL) {
+        werase(right_win);
+      }
+      draw_history_hits(app, left_win, right_win, &layout);
+      /* The list pane now shows hits; the next run list paint must be a full one. */
+      app->panes[PANE_HISTORY_LIST].drawn_scroll = SIZE_MAX;
+    }
+  } else {
+    draw_history_list(app, left_win, &layout);
+    if (right_win != NULL && app->panes[PANE_HISTORY_DETAIL].dirty) {
+      draw_history_detail(app, right_win, &layout);
     }
-    row++;
   }
 
-  if (row < layout.content_h) {
-    win_add_section_title(left_win, row, 1, "Notes");
-    row++;
-  }
-  if (row < layout.content_h) {
-    win_printf_text(left_win, row, 1, "Body bytes: %zu", strlen(app->draft.body));
-    row++;
+  move(h - 1, 0);
+  clrtoeol();
+  curs_set(0);
+  if (app->history_search.prompt) {
+    mvprintw(h - 1, 0, "/%s", app->cmdline);
+    curs_set(1);
+  } else if (app->history_search.active) {
+    mvprintw(h - 1, 0, "SEARCH: %s (%zu hits) | j/k move | Enter jump to run | Esc back", app->history_search.query,
+             app->history_search.hits.len);
+  } else if (app->history_mark.id != 0) {
+    mvprintw(h - 1, 0, "HISTORY | marked #%d | D diff marked vs selected | m unmark | j/k move | / search | r replay | Esc back",
+             app->history_mark.id);
+  } else {
+    mvprintw(h - 1, 0, "HISTORY | j/k move | / search | r replay | m mark | D diff%s | { } details | Esc back",
+             app->last_response_body != NULL ? " vs last response" : "");
   }
-  if (row < layout.content_h) {
-    win_add_text(left_win, row, 1, "Method field uses h/l cycle only");
+  if (app->history_search.prompt) {
+    move(h - 1, (int)app->cmdline_len + 1);
   }
+  static const pane_id_t panes[] = {PANE_HISTORY_LIST, PANE_HISTORY_DETAIL};
+  flush_panes(app, panes, 2);
+  doupdate();
+}
 
-  if (right_win != NULL) {
-    win_add_section_title(right_win, 0, 0, "Preview");
-    if (has_colors()) {
-      wattron(right_win, COLOR_PAIR(COLOR_SECTION));
-    }
-    mvwhline(right_win, 1, 0, ACS_HLINE, layout.right_w);
-    if (has_colors()) {
-      wattroff(right_win, COLOR_PAIR(COLOR_SECTION));
-    }
+static void close_diff(app_t *app) {
+  diff_screen_t *diff = &app->diff;
+  text_diff_free(diff->job);
+  text_diff_view_free(&diff->view);
+  free(diff->rows);
+  memset(diff, 0, sizeof(*diff));
+}
 
-    row = 2;
-    if (app->draft.name[0] == '\0') {
-      win_add_labeled_text(right_win, row, 0, "name: ", "(unnamed)");
-    } else {
-      win_add_labeled_text(right_win, row, 0, "name: ", app->draft.name);
+static int diff_push_row(diff_screen_t *diff, diff_row_kind_t kind, long a, long b) {
+  if (diff->rows_len == diff->rows_cap) {
+    size_t cap = diff->rows_cap > 0 ? diff->rows_cap * 2 : 256;
+    diff_row_t *grown = realloc(diff->rows, cap * sizeof(*grown));
+    if (grown == NULL) {
+      return -1;
     }
-    row++;
-
-    win_add_labeled_method(right_win, row, 0, "method: ", app->draft.method);
-    row++;
-
-    int show_auth_type = app->draft.auth_type[0] != '\0' && strcmp(app->draft.auth_type, "none") != 0;
+    diff->rows = grown;
+    diff->rows_cap = cap;
+  }
+  diff->rows[diff->rows_len++] = (diff_row_t){kind, a, b};
+  return 0;
+}
 
-    int cfg_lines = 0;
-    if (show_auth_type) {
-      cfg_lines++;
-    }
-    if (app->draft.auth_secret_ref[0] != '\0') {
-      cfg_lines++;
-    }
-    if (app->draft.auth_key_name[0] != '\0') {
-      cfg_lines++;
-    }
-    if (app->draft.auth_location[0] != '\0') {
-      cfg_lines++;
-    }
-    if (app->draft.auth_username[0] != '\0') {
-      cfg_lines++;
+static int diff_append_block_rows(diff_screen_t *diff, const text_diff_block_t *block, bool first, bool last) {
+  long a = (long)block->a_start;
+  long b = (long)block->b_start;
+  if (!block->changed) {
+    long count = (long)block->a_count;
+    long lead = first ? 0 : DIFF_CONTEXT;
+    long trail = last ? 0 : DIFF_CONTEXT;
+    if (count <= lead + trail + 1) {
+      lead = count;
+      trail = 0;
+    }
+    for (long i = 0; i < lead; i++) {
+      if (diff_push_row(diff, DIFF_ROW_SAME, a + i, b + i) != 0) {
+        return -1;
+      }
     }
-    if (app->draft.header_key[0] != '\0' || app->draft.header_value[0] != '\0') {
-      cfg_lines++;
+    if (lead < count && diff_push_row(diff, DIFF_ROW_FOLD, count - lead - trail, -1) != 0) {
+      return -1;
     }
-
-    int reserve = 2;
-    if (cfg_lines > 0) {
-      reserve += 1 + cfg_lines;
+    for (long i = count - trail; i < count && lead < count; i++) {
+      if (diff_push_row(diff, DIFF_ROW_SAME, a + i, b + i) != 0) {
+        return -1;
+      }
     }
+    return 0;
+  }
 
-    const int url_label_w = 5;
-    win_add_labeled_text(right_win, row, 0, "url: ", "");
-    int url_w = layout.right_w - url_label_w;
-    if (url_w < 1) {
-      url_w = 1;
-    }
-    int url_lines_max = layout.content_h - row - reserve;
-    if (url_lines_max < 1) {
-      url_lines_max = 1;
+  long removed = (long)block->a_count;
+  long added = (long)block->b_count;
+  if (diff->side_by_side) {
+    long rows = removed > added ? removed : added;
+    for (long i = 0; i < rows; i++) {
+      if (diff_push_row(diff, DIFF_ROW_CHANGED, i < removed ? a + i : -1, i < added ? b + i : -1) != 0) {
+        return -1;
+      }
     }
-    if (url_lines_max > 5) {
-      url_lines_max = 5;
+    return 0;
+  }
+  for (long i = 0; i < removed; i++) {
+    if (diff_push_row(diff, DIFF_ROW_REMOVED, a + i, -1) != 0) {
+      return -1;
     }
-    win_draw_wrapped_text(right_win, row, url_label_w, url_lines_max, url_w, app->draft.url);
-    int url_lines = wrapped_line_count(app->draft.url, url_w, url_lines_max);
-    if (url_lines < 1) {
-      url_lines = 1;
+  }
+  for (long i = 0; i < added; i++) {
+    if (diff_push_row(diff, DIFF_ROW_ADDED, -1, b + i) != 0) {
+      return -1;
     }
-    row += url_lines;
+  }
+  return 0;
+}
 
-    if (cfg_lines > 0 && row < layout.content_h) {
-      win_add_section_title(right_win, row, 0, "Config");
-      row++;
-    }
-    if (show_auth_type && row < layout.content_h) {
-      win_add_labeled_text(right_win, row, 0, "auth: ", app->draft.auth_type);
-      row++;
-    }
-    if (app->draft.auth_secret_ref[0] != '\0' && row < layout.content_h) {
-      win_add_labeled_text(right_win, row, 0, "secret: ", app->draft.auth_secret_ref);
-      row++;
-    }
-    if (app->draft.auth_key_name[0] != '\0' && row < layout.content_h) {
-      win_add_labeled_text(right_win, row, 0, "key: ", app->draft.auth_key_name);
-      row++;
-    }
-    if (app->draft.auth_location[0] != '\0' && row < layout.content_h) {
-      win_add_labeled_text(right_win, row, 0, "location: ", app->draft.auth_location);
-      row++;
-    }
-    if (app->draft.auth_username[0] != '\0' && row < layout.content_h) {
-      win_add_labeled_text(right_win, row, 0, "user: ", app->draft.auth_username);
-      row++;
+/* Lays out the blocks published since the last call; the still-growing last block is redone each time. */
+static void diff_extend_rows(diff_screen_t *diff) {
+  const text_diff_view_t *view = &diff->view;
+  diff->rows_len = diff->rows_final_len;
+  for (size_t i = diff->rows_blocks; i < view->blocks_len; i++) {
+    bool last = view->done && i + 1 == view->blocks_len;
+    if (diff_append_block_rows(diff, &view->blocks[i], i == 0, last) != 0) {
+      return;
     }
-    if ((app->draft.header_key[0] != '\0' || app->draft.header_value[0] != '\0') && row < layout.content_h) {
-      char header_line[384];
-      snprintf(header_line, sizeof(header_line), "%s: %s", app->draft.header_key, app->draft.header_value);
-      win_add_labeled_text(right_win, row, 0, "header: ", header_line);
-      row++;
+    if (i + 1 < view->blocks_len || view->done) {
+      diff->rows_blocks = i + 1;
+      diff->rows_final_len = diff->rows_len;
     }
+  }
+}
 
-    if (row < layout.content_h) {
-      win_add_section_title(right_win, row, 0, "Body");
-      row++;
-    }
-    int body_lines = layout.content_h - row;
-    if (body_lines > 0) {
-      win_draw_wrapped_body_preview(right_win, row, body_lines, layout.right_w, app->draft.body, &app->editor_body_scroll);
-    }
+static void diff_reset_rows(diff_screen_t *diff) {
+  diff->rows_len = 0;
+  diff->rows_blocks = 0;
+  diff->rows_final_len = 0;
+  diff->scroll = 0;
+}
+
+static char *load_run_body(app_t *app, const run_entry_t *run, size_t *len) {
+  run_entry_t copy = *run;
+  copy.request_snapshot = NULL;
+  copy.response_body = NULL;
+  if (history_store_load_bodies(&app->history, &copy) != 0) {
+    return NULL;
+  }
+  free(copy.request_snapshot);
+  char *body = copy.response_body != NULL ? copy.response_body : dup_text_n("", 0);
+  *len = copy.response_body != NULL ? copy.response_body_len : 0;
+  return body;
+}
+
+static void run_title(const run_entry_t *run, char *out, size_t out_len) {
+  snprintf(out, out_len, "run #%d  %s %s  %d  %s", run->id, run->method,
+           run->request_name[0] != '\0' ? run->request_name : run->url, run->status_code, run->created_at);
+}
+
+/* Screen titles are 160 bytes: a long URL is cut so the status and time still show. */
+static void last_response_title(const app_t *app, char *out, size_t out_len) {
+  snprintf(out, out_len, "last response  %s %.64s  %ld  %s", app->last_response_method, app->last_response_url,
+           app->last_response_status, app->last_response_at);
+}
+
+/* `D`: the marked run against the selected one, or the selected run against the last response. */
+static void open_history_diff(app_t *app) {
+  const run_entry_t *selected = app->history_selected < app->runs.len ? &app->runs.items[app->history_selected] : NULL;
+  const run_entry_t *base = app->history_mark.id != 0 ? &app->history_mark : selected;
+  bool against_last = base == selected || (selected != NULL && base->id == selected->id);
+  size_t last_len = 0;
+  const char *last = last_response_full(app, &last_len);
+  if (base == NULL || (against_last && last == NULL)) {
+    return;
+  }
+
+  size_t a_len = 0;
+  size_t b_len = 0;
+  char *a = load_run_body(app, base, &a_len);
+  char *b = NULL;
+  if (against_last) {
+    b_len = last_len;
+    b = dup_text_n(last, b_len);
+  } else {
+    b = load_run_body(app, selected, &b_len);
+  }
+  if (a == NULL || b == NULL) {
+    free(a);
+    free(b);
+    return;
+  }
+
+  close_diff(app);
+  diff_screen_t *diff = &app->diff;
+  run_title(base, diff->title_a, sizeof(diff->title_a));
+  if (against_last) {
+    last_response_title(app, diff->title_b, sizeof(diff->title_b));
   } else {
-    app->editor_body_scroll = 0;
-    if (layout.content_h > 2) {
-      win_add_text(left_win, layout.content_h - 2, 1, "Preview hidden (window too narrow)");
-    }
+    run_title(selected, diff->title_b, sizeof(diff->title_b));
+  }
+  if (text_diff_start(a, a_len, b, b_len, 1, &diff->job) != 0) {
+    return;
   }
+  app->screen = SCREEN_DIFF;
+}
 
-  if (layout.show_right) {
-    if (app->drag_mode == DRAG_VERTICAL) {
-      attron(A_REVERSE);
+static bool diff_row_is_change(const diff_row_t *row) {
+  return row->kind == DIFF_ROW_REMOVED || row->kind == DIFF_ROW_ADDED || row->kind == DIFF_ROW_CHANGED;
+}
+
+/* Scrolls to the first row of the next (dir > 0) or previous change. */
+static void diff_jump_change(diff_screen_t *diff, int dir) {
+  size_t i = diff->scroll;
+  while (dir > 0 ? i + 1 < diff->rows_len : i > 0) {
+    i = dir > 0 ? i + 1 : i - 1;
+    if (diff_row_is_change(&diff->rows[i]) && (i == 0 || !diff_row_is_change(&diff->rows[i - 1]))) {
+      diff->scroll = i;
+      return;
     }
-    for (int y = 0; y < layout.content_h; y++) {
-      mvaddch(y, layout.separator_x, ACS_VLINE);
+  }
+}
+
+/* One side's line clipped to `width` columns from `hscroll`; control characters show as spaces. */
+static void draw_diff_text(int y, int x, int width, const text_diff_side_t *side, long line, size_t hscroll) {
+  if (side == NULL || line < 0 || width <= 0) {
+    return;
+  }
+  size_t start = side->line_starts[line];
+  size_t len = side->line_starts[line + 1] - start - 1;
+  if (len > 0 && side->text[start + len - 1] == '\r') {
+    len--;
+  }
+  if (hscroll >= len) {
+    return;
+  }
+  char buf[1024];
+  size_t n = len - hscroll;
+  if (n > (size_t)width) {
+    n = (size_t)width;
+  }
+  if (n > sizeof(buf)) {
+    n = sizeof(buf);
+  }
+  for (size_t i = 0; i < n; i++) {
+    unsigned char c = (unsigned char)side->text[start + hscroll + i];
+    buf[i] = c < 0x20 || c == 0x7f ? ' ' : (char)c;
+  }
+  mvaddnstr(y, x, buf, (int)n);
+}
+
+static int digits(size_t n) {
+  int d = 1;
+  while (n >= 10) {
+    n /= 10;
+    d++;
+  }
+  return d;
+}
+
+static void draw_diff_row(const diff_screen_t *diff, const diff_row_t *row, int y, int w, int gutter) {
+  const text_diff_side_t *a = diff->view.a;
+  const text_diff_side_t *b = diff->view.b;
+  if (row->kind == DIFF_ROW_FOLD) {
+    if (has_colors()) {
+      attron(COLOR_PAIR(COLOR_SECTION));
     }
-    if (app->drag_mode == DRAG_VERTICAL) {
-      attroff(A_REVERSE);
+    mvprintw(y, 0, "%*s ... %ld unchanged lines ...", gutter, "", row->a);
+    if (has_colors()) {
+      attroff(COLOR_PAIR(COLOR_SECTION));
     }
+    return;
   }
 
-  wnoutrefresh(stdscr);
-  wnoutrefresh(left_win);
-  if (right_win != NULL) {
-    wnoutrefresh(right_win);
+  if (diff->side_by_side) {
+    int half = (w - 1) / 2;
+    int text_w = half - gutter - 3;
+    for (int side = 0; side < 2; side++) {
+      long line = side == 0 ? row->a : row->b;
+      int x = side == 0 ? 0 : half + 1;
+      int pair = row->kind != DIFF_ROW_CHANGED ? 0 : (side == 0 ? COLOR_DIFF_REMOVED : COLOR_DIFF_ADDED);
+      if (line < 0) {
+        continue;
+      }
+      if (pair != 0 && has_colors()) {
+        attron(COLOR_PAIR(pair));
+      }
+      mvprintw(y, x, "%*ld %c ", gutter, line + 1, pair == 0 ? ' ' : (side == 0 ? '-' : '+'));
+      draw_diff_text(y, x + gutter + 3, text_w, side == 0 ? a : b, line, diff->hscroll);
+      if (pair != 0 && has_colors()) {
+        attroff(COLOR_PAIR(pair));
+      }
+    }
+    mvaddch(y, half, ACS_VLINE);
+    return;
   }
 
-  draw_editor_status_line(app, h - 1, w);
-  doupdate();
-
-  delwin(left_win);
-  if (right_win != NULL) {
-    delwin(right_win);
+  int pair = row->kind == DIFF_ROW_REMOVED ? COLOR_DIFF_REMOVED : (row->kind == DIFF_ROW_ADDED ? COLOR_DIFF_ADDED : 0);
+  char marker = row->kind == DIFF_ROW_REMOVED ? '-' : (row->kind == DIFF_ROW_ADDED ? '+' : ' ');
+  if (pair != 0 && has_colors()) {
+    attron(COLOR_PAIR(pair));
+  }
+  move(y, 0);
+  if (row->a >= 0) {
+    printw("%*ld ", gutter, row->a + 1);
+  } else {
+    printw("%*s ", gutter, "");
+  }
+  if (row->b >= 0) {
+    printw("%*ld ", gutter, row->b + 1);
+  } else {
+    printw("%*s ", gutter, "");
+  }
+  addch((chtype)marker);
+  addch(' ');
+  int x = 2 * gutter + 4;
+  draw_diff_text(y, x, w - x, row->b >= 0 ? b : a, row->b >= 0 ? row->b : row->a, diff->hscroll);
+  if (pair != 0 && has_colors()) {
+    attroff(COLOR_PAIR(pair));
   }
 }
 
-static int send_request_and_record(app_t *app, request_t *req) {
-  http_response_t response;
-  int rc = http_send_request(req, &response);
-  char now[40];
-  now_iso(now);
+static int diff_content_height(void) {
+  int h = getmaxy(stdscr);
+  return h - 5 > 1 ? h - 5 : 1;
+}
 
-  snprintf(app->last_response_request_id, sizeof(app->last_response_request_id), "%s", req->id);
-  snprintf(app->last_response_request_name, sizeof(app->last_response_request_name), "%s", req->name);
-  snprintf(app->last_response_method, sizeof(app->last_response_method), "%s", req->method);
-  snprintf(app->last_response_url, sizeof(app->last_response_url), "%s", req->url);
-  snprintf(app->last_response_at, sizeof(app->last_response_at), "%s", now);
-  app->last_response_status = response.status_code;
-  app->last_response_ms = response.duration_ms;
-  snprintf(app->last_response_error, sizeof(app->last_response_error), "%s", response.error);
-  free(app->last_response_body);
-  app->last_response_body = NULL;
-  app->last_response_body_len = 0;
-  app->response_body_scroll = 0;
+static void draw_diff(app_t *app) {
+  diff_screen_t *diff = &app->diff;
+  text_diff_poll(diff->job, &diff->view);
+  diff_extend_rows(diff);
+  /* Drawn straight onto stdscr; whatever comes next starts from a clean frame. */
+  app->drawn_screen = SCREEN_DIFF;
 
-  const char *body = response.body != NULL ? response.body : "";
-  size_t body_len = response.body_len;
-  if (response.body == NULL) {
-    body_len = strlen(body);
+  int h = 0;
+  int w = 0;
+  getmaxyx(stdscr, h, w);
+  erase();
+  if (h < 6 || w < 20) {
+    mvprintw(h > 0 ? h - 1 : 0, 0, "Window too small");
+    refresh();
+    return;
   }
 
-  char *copied = dup_text_n(body, body_len);
-  if (copied != NULL) {
-    app->last_response_body = copied;
-    app->last_response_body_len = body_len;
+  const text_diff_view_t *view = &diff->view;
+  attron(A_BOLD);
+  mvprintw(0, 0, "A ");
+  attroff(A_BOLD);
+  addnstr(diff->title_a, w - 2);
+  attron(A_BOLD);
+  mvprintw(1, 0, "B ");
+  attroff(A_BOLD);
+  addnstr(diff->title_b, w - 2);
+
+  char stats[256];
+  if (view->failed) {
+    snprintf(stats, sizeof(stats), "diff failed (out of memory)");
+  } else if (view->a == NULL) {
+    snprintf(stats, sizeof(stats), "preparing...");
   } else {
-    const char *fallback = "(response body unavailable: out of memory)";
-    size_t fallback_len = strlen(fallback);
-    copied = dup_text_n(fallback, fallback_len);
-    if (copied != NULL) {
-      app->last_response_body = copied;
-      app->last_response_body_len = fallback_len;
+    snprintf(stats, sizeof(stats), "+%zu -%zu | %zu -> %zu lines%s%s%s | %s", view->lines_added, view->lines_removed,
+             view->a->line_count, view->b->line_count,
+             view->a->json && view->b->json ? " | JSON normalized" : (view->a->json || view->b->json ? " | JSON normalized (one side)" : ""),
+             view->approximate ? " | approximate" : "",
+             view->done && view->lines_added + view->lines_removed == 0 ? " | no differences" : "",
+             diff->side_by_side ? "side by side" : "unified");
+    if (!view->done) {
+      size_t len = strlen(stats);
+      snprintf(stats + len, sizeof(stats) - len, " | diffing %d.%d%%", view->permille / 10, view->permille % 10);
     }
   }
-
-  run_entry_t run;
-  memset(&run, 0, sizeof(run));
-  snprintf(run.request_id, sizeof(run.request_id), "%s", req->id);
-  snprintf(run.request_name, sizeof(run.request_name), "%s", req->name);
-  snprintf(run.method, sizeof(run.method), "%s", req->method);
-  snprintf(run.url, sizeof(run.url), "%s", req->url);
-  run.status_code = (int)response.status_code;
-  run.duration_ms = response.duration_ms;
-  snprintf(run.error, sizeof(run.error), "%s", response.error);
-  run.request_snapshot = build_request_snapshot(req);
-  if (run.request_snapshot == NULL) {
-    const char *fallback = "(request snapshot unavailable: out of memory)";
-    run.request_snapshot = dup_text_n(fallback, strlen(fallback));
+  if (has_colors()) {
+    attron(COLOR_PAIR(COLOR_LABEL));
   }
-  run.response_body = dup_text_n(body, body_len);
-  if (run.response_body == NULL) {
-    const char *fallback = "(response body unavailable: out of memory)";
-    run.response_body = dup_text_n(fallback, strlen(fallback));
+  mvaddnstr(2, 0, stats, w);
+  if (has_colors()) {
+    attroff(COLOR_PAIR(COLOR_LABEL));
+    attron(COLOR_PAIR(COLOR_SECTION));
+  }
+  mvhline(3, 0, ACS_HLINE, w);
+  if (has_colors()) {
+    attroff(COLOR_PAIR(COLOR_SECTION));
   }
-  now_iso(run.created_at);
-  history_store_add_run(app->db, &run);
-  free(run.request_snapshot);
-  free(run.response_body);
-  run.request_snapshot = NULL;
-  run.response_body = NULL;
 
-  if (rc == 0) {
-    set_status(app, "Request sent");
-  } else {
-    char msg[STATUS_MAX];
-    snprintf(msg, sizeof(msg), "Request failed: %s", response.error[0] ? response.error : "unknown error");
-    set_status(app, msg);
+  int rows = diff_content_height();
+  diff->scroll = clamp_scroll_offset(diff->scroll, diff->rows_len, rows);
+  if (view->a != NULL) {
+    size_t max_line = view->a->line_count > view->b->line_count ? view->a->line_count : view->b->line_count;
+    int gutter = digits(max_line);
+    for (int i = 0; i < rows && diff->scroll + (size_t)i < diff->rows_len; i++) {
+      draw_diff_row(diff, &diff->rows[diff->scroll + (size_t)i], 4 + i, w, gutter);
+    }
   }
 
-  http_response_free(&response);
-  return rc;
+  mvprintw(h - 1, 0, "DIFF | j/k scroll | space/b page | g/G | n/N next/prev change | s side by side | h/l pan | Esc back");
+  refresh();
 }
 
-static void load_history(app_t *app) {
-  run_list_free(&app->runs);
-  history_store_list_runs(app->db, 500, &app->runs);
-  app->history_selected = 0;
-  app->history_scroll = 0;
-  app->history_detail_scroll = 0;
-  app->drag_mode = DRAG_NONE;
+static void handle_diff_key(app_t *app, int ch) {
+  diff_screen_t *diff = &app->diff;
+  size_t page = (size_t)diff_content_height();
+  if (ch == 27 || ch == 'q') {
+    close_diff(app);
+    app->screen = SCREEN_HISTORY;
+  } else if (ch == 'j' || ch == KEY_DOWN) {
+    diff->scroll++;
+  } else if ((ch == 'k' || ch == KEY_UP) && diff->scroll > 0) {
+    diff->scroll--;
+  } else if (ch == ' ' || ch == KEY_NPAGE) {
+    diff->scroll += page;
+  } else if (ch == 'b' || ch == KEY_PPAGE) {
+    diff->scroll = diff->scroll > page ? diff->scroll - page : 0;
+  } else if (ch == 'g') {
+    diff->scroll = 0;
+  } else if (ch == 'G') {
+    diff->scroll = diff->rows_len;
+  } else if (ch == 'n') {
+    diff_jump_change(diff, 1);
+  } else if (ch == 'N') {
+    diff_jump_change(diff, -1);
+  } else if (ch == 's') {
+    diff->side_by_side = !diff->side_by_side;
+    diff_reset_rows(diff);
+  } else if (ch == 'h') {
+    diff->hscroll = diff->hscroll > DIFF_HSCROLL_STEP ? diff->hscroll - DIFF_HSCROLL_STEP : 0;
+  } else if (ch == 'l') {
+    diff->hscroll += DIFF_HSCROLL_STEP;
+  }
 }
 
-static void draw_history(app_t *app) {
-  int h = 0;
-  int w = 0;
-  getmaxyx(stdscr, h, w);
+static void close_pager(app_t *app) {
+  pager_free(&app->pager.pager);
+  free(app->pager.owned);
+  memset(&app->pager, 0, sizeof(app->pager));
+  app->pager.source_fd = -1;
+}
 
-  history_layout_t layout;
-  compute_history_layout(app, h, w, &layout);
-  if (!layout.valid) {
-    erase();
-    if (h > 0) {
-      mvprintw(h - 1, 0, "Window too small");
-    }
-    refresh();
+/* Takes ownership of `owned` when it is not NULL (it is then `data`). */
+static void open_pager(app_t *app, const char *data, size_t len, char *owned, int source_fd, const char *title) {
+  screen_t back = app->screen;
+  close_pager(app);
+  pager_screen_t *view = &app->pager;
+  pager_init(&view->pager, data, len);
+  view->owned = owned;
+  view->source_fd = source_fd;
+  view->back = back;
+  snprintf(view->title, sizeof(view->title), "%s", title);
+  app->screen = SCREEN_PAGER;
+}
+
+/* `P` on the main screen: the whole last response, in place. */
+static void open_last_response_pager(app_t *app) {
+  size_t len = 0;
+  const char *body = last_response_full(app, &len);
+  if (body == NULL || app->last_response_at[0] == '\0') {
+    set_status(app, "No response to page through yet");
     return;
   }
+  char title[160];
+  last_response_title(app, title, sizeof(title));
+  const response_body_t *shared = app->last_response_shared;
+  open_pager(app, body, len, NULL, shared != NULL && shared->response.body_spilled ? shared->response.body_fd : -1,
+             title);
+}
 
-  erase();
+static int pager_content_height(void) {
+  int h = getmaxy(stdscr);
+  return h - 3 > 1 ? h - 3 : 1;
+}
 
-  WINDOW *left_win = newwin(layout.content_h, layout.left_w, 0, 0);
-  WINDOW *right_win = NULL;
-  if (layout.show_right) {
-    right_win = newwin(layout.content_h, layout.right_w, 0, layout.right_x);
-  }
+static void draw_pager(app_t *app) {
+  pager_screen_t *view = &app->pager;
+  pager_t *pager = &view->pager;
+  /* Drawn straight onto stdscr like the diff screen. */
+  app->drawn_screen = SCREEN_PAGER;
 
-  if (left_win == NULL) {
-    mvprintw(h - 1, 0, "Failed to create history pane");
+  int h = 0;
+  int w = 0;
+  getmaxyx(stdscr, h, w);
+  erase();
+  if (h < 5 || w < 20) {
+    mvprintw(h > 0 ? h - 1 : 0, 0, "Window too small");
     refresh();
     return;
   }
 
-  werase(left_win);
-  if (right_win != NULL) {
-    werase(right_win);
+  attron(A_BOLD);
+  mvaddnstr(0, 0, view->title, w);
+  attroff(A_BOLD);
+
+  int rows = pager_content_height();
+  size_t pos = pager->top;
+  if (pager->len == 0) {
+    mvaddstr(1, 0, "(empty)");
+  }
+  for (int i = 0; i < rows && pos < pager->len; i++) {
+    if (pager->hex) {
+      char line[160];
+      pager_hex_row(pager, pos, line, sizeof(line));
+      mvaddnstr(1 + i, 0, line, w);
+      pos += PAGER_HEX_ROW;
+      continue;
+    }
+    size_t end = pager_line_end(pager, pos);
+    size_t from = pager_column_offset(pager, pos, end, pager->column);
+    size_t to = pager_column_offset(pager, from, end, (size_t)w - 1);
+    win_add_display_span(stdscr, 1 + i, 0, pager->data + from, to - from);
+    pos = pager_next_line(pager, pos);
   }
 
-  win_add_section_title(left_win, 0, 0, "History");
+  char stats[256];
+  size_t used = 0;
+  if (pager->hex) {
+    used = (size_t)snprintf(stats, sizeof(stats), "hex");
+  } else if (pager->line_known) {
+    used = (size_t)snprintf(stats, sizeof(stats), "line %zu", pager->top_line + 1);
+  } else {
+    used = (size_t)snprintf(stats, sizeof(stats), "line ?");
+  }
+  size_t total = 0;
+  if (!pager->hex && pager_line_count(pager, &total) == 0 && used < sizeof(stats)) {
+    used += (size_t)snprintf(stats + used, sizeof(stats) - used, " of %zu", total);
+  }
+  if (used < sizeof(stats)) {
+    used += (size_t)snprintf(stats + used, sizeof(stats) - used, " | byte %zu of %zu | %d%%", pager->top, pager->len,
+                             pager->len > 0 ? (int)((double)pager->top * 100.0 / (double)pager->len) : 100);
+  }
+  if (!pager->hex && pager->column > 0 && used < sizeof(stats)) {
+    snprintf(stats + used, sizeof(stats) - used, " | column %zu", pager->column + 1);
+  }
   if (has_colors()) {
-    wattron(left_win, COLOR_PAIR(COLOR_SECTION));
+    attron(COLOR_PAIR(COLOR_LABEL));
   }
-  mvwhline(left_win, 1, 0, ACS_HLINE, layout.left_w);
+  mvaddnstr(h - 2, 0, stats, w);
   if (has_colors()) {
-    wattroff(left_win, COLOR_PAIR(COLOR_SECTION));
+    attroff(COLOR_PAIR(COLOR_LABEL));
   }
 
-  int method_x = 22;
-  int status_x = method_x + 8;
-  int duration_x = status_x + 8;
-  int name_x = duration_x + 7;
-  if (method_x >= layout.left_w - 8) {
-    method_x = layout.left_w / 2;
-    status_x = method_x + 8;
-    duration_x = status_x + 8;
-    name_x = duration_x + 7;
-  }
-  if (name_x >= layout.left_w - 4) {
-    name_x = layout.left_w - 4;
+  if (view->prompt != 0) {
+    mvprintw(h - 1, 0, "%s%s", view->prompt == 's' ? "Save to: " : ":", app->cmdline);
+  } else if (view->message[0] != '\0') {
+    mvaddnstr(h - 1, 0, view->message, w);
+  } else {
+    mvaddnstr(h - 1, 0, "PAGER | j/k scroll | space/b page | g/G | :N line, :N% percent | h/l pan | x hex | s save | q back",
+              w);
   }
+  refresh();
+}
 
-  int header_y = 2;
-  if (header_y < layout.content_h) {
-    if (has_colors()) {
-      wattron(left_win, COLOR_PAIR(COLOR_LABEL));
-    }
-    wattron(left_win, A_BOLD);
-    win_add_text(left_win, header_y, 1, "When");
-    win_add_text(left_win, header_y, method_x, "Method");
-    win_add_text(left_win, header_y, status_x, "Status");
-    win_add_text(left_win, header_y, duration_x, "ms");
-    win_add_text(left_win, header_y, name_x, "Name");
-    wattroff(left_win, A_BOLD);
-    if (has_colors()) {
-      wattroff(left_win, COLOR_PAIR(COLOR_LABEL));
-    }
+/* `:` input: "N%" jumps to a percentage, otherwise N is a line (text) or a byte offset, decimal or 0x hex (hex). */
+static void pager_goto(pager_screen_t *view, const char *input) {
+  pager_t *pager = &view->pager;
+  char *end = NULL;
+  errno = 0;
+  unsigned long long n = strtoull(input, &end, pager->hex ? 0 : 10);
+  if (end == input || errno != 0 || (*end != '\0' && strcmp(end, "%") != 0)) {
+    snprintf(view->message, sizeof(view->message), "Not a line, offset or percentage: %s", input);
+    return;
   }
-
-  int rows = layout.content_h - (header_y + 1);
-  if (rows < 1) {
-    rows = 1;
+  if (*end == '%') {
+    pager_goto_percent(pager, n > 100 ? 100 : (unsigned)n);
+  } else if (pager->hex) {
+    pager_goto_offset(pager, n > SIZE_MAX ? SIZE_MAX : (size_t)n);
+  } else if (pager_goto_line(pager, n > 0 ? (size_t)(n - 1) : 0) != 0) {
+    snprintf(view->message, sizeof(view->message), "Past the end; the last line is %zu", pager->top_line + 1);
   }
-  if (app->history_selected < app->history_scroll) {
-    app->history_scroll = app->history_selected;
+}
+
+static void pager_save_to(pager_screen_t *view, const char *input) {
+  char path[4096];
+  const char *home = getenv("HOME");
+  int path_len = strncmp(input, "~/", 2) == 0 && home != NULL ? snprintf(path, sizeof(path), "%s/%s", home, input + 2)
+                                                              : snprintf(path, sizeof(path), "%s", input);
+  if (path_len < 0 || (size_t)path_len >= sizeof(path)) {
+    snprintf(view->message, sizeof(view->message), "Save failed: path too long");
+    return;
   }
-  if (app->history_selected >= app->history_scroll + (size_t)rows) {
-    app->history_scroll = app->history_selected - (size_t)rows + 1;
+  char error[256];
+  if (pager_save(view->pager.data, view->pager.len, view->source_fd, path, error, sizeof(error)) != 0) {
+    snprintf(view->message, sizeof(view->message), "Save failed: %s", error);
+    return;
   }
+  /* Only the head of a very long path fits the message line. */
+  snprintf(view->message, sizeof(view->message), "Saved %zu bytes to %.400s", view->pager.len, path);
+}
 
-  for (int i = 0; i < rows; i++) {
-    size_t idx = app->history_scroll + (size_t)i;
-    if (idx >= app->runs.len) {
-      break;
-    }
-    run_entry_t *run = &app->runs.items[idx];
-    int y = i + header_y + 1;
-    if (idx == app->history_selected) {
-      wattron(left_win, A_REVERSE);
-      mvwhline(left_win, y, 0, ' ', layout.left_w);
-    }
-
-    win_printf_text(left_win, y, 1, "%-19.19s", run->created_at);
-
-    int m_pair = method_color_pair(run->method);
-    if (m_pair != 0 && has_colors()) {
-      wattron(left_win, COLOR_PAIR(m_pair));
-    }
-    win_printf_text(left_win, y, method_x, "%-7.7s", run->method);
-    if (m_pair != 0 && has_colors()) {
-      wattroff(left_win, COLOR_PAIR(m_pair));
-    }
-
-    int s_pair = status_color_pair(run->status_code);
-    if (s_pair != 0 && has_colors()) {
-      wattron(left_win, COLOR_PAIR(s_pair));
-    }
-    win_printf_text(left_win, y, status_x, "%-7d", run->status_code);
-    if (s_pair != 0 && has_colors()) {
-      wattroff(left_win, COLOR_PAIR(s_pair));
-    }
-
-    win_printf_text(left_win, y, duration_x, "%-5ld", run->duration_ms);
-
-    int name_w = layout.left_w - name_x - 1;
-    if (name_w > 0) {
-      win_printf_text(left_win, y, name_x, "%-*.*s", name_w, name_w, run->request_name);
-    }
+static void handle_pager_key(app_t *app, int ch) {
+  pager_screen_t *view = &app->pager;
+  pager_t *pager = &view->pager;
+  long page = pager_content_height();
+  view->message[0] = '\0';
 
-    if (idx == app->history_selected) {
-      wattroff(left_win, A_REVERSE);
+  if (view->prompt != 0) {
+    if (ch == 27) {
+      view->prompt = 0;
+    } else if (ch == KEY_BACKSPACE || ch == 127 || ch == 8) {
+      line_backspace(app->cmdline, &app->cmdline_len);
+    } else if (ch == '\n' || ch == KEY_ENTER) {
+      if (app->cmdline_len > 0) {
+        if (view->prompt == 's') {
+          pager_save_to(view, app->cmdline);
+        } else {
+          pager_goto(view, app->cmdline);
+        }
+      }
+      view->prompt = 0;
+    } else if (isprint(ch)) {
+      line_append_char(app->cmdline, sizeof(app->cmdline), &app->cmdline_len, ch);
     }
+    return;
   }
 
-  if (app->runs.len == 0) {
-    win_add_text(left_win, 3, 1, "No history yet");
-    win_add_text(left_win, 4, 1, "Send requests from main to populate history");
-    app->history_detail_scroll = 0;
+  if (ch == 27 || ch == 'q') {
+    screen_t back = view->back;
+    close_pager(app);
+    app->screen = back;
+  } else if (ch == 'j' || ch == KEY_DOWN) {
+    pager_scroll(pager, 1);
+  } else if (ch == 'k' || ch == KEY_UP) {
+    pager_scroll(pager, -1);
+  } else if (ch == ' ' || ch == KEY_NPAGE) {
+    pager_scroll(pager, page);
+  } else if (ch == 'b' || ch == KEY_PPAGE) {
+    pager_scroll(pager, -page);
+  } else if (ch == 'g' || ch == KEY_HOME) {
+    pager_goto_offset(pager, 0);
+  } else if (ch == 'G' || ch == KEY_END) {
+    pager_goto_end(pager, (int)page);
+  } else if (ch == 'h' || ch == KEY_LEFT) {
+    pager->column = pager->column > DIFF_HSCROLL_STEP ? pager->column - DIFF_HSCROLL_STEP : 0;
+  } else if (ch == 'l' || ch == KEY_RIGHT) {
+    pager->column += DIFF_HSCROLL_STEP;
+  } else if (ch == 'x') {
+    pager_set_hex(pager, !pager->hex);
+  } else if (ch == ':' || ch == 's') {
+    view->prompt = (char)ch;
+    line_reset(app->cmdline, &app->cmdline_len);
   }
+}
 
-  if (right_win != NULL) {
-    win_add_section_title(right_win, 0, 0, "Run Detail");
-    if (has_colors()) {
-      wattron(right_win, COLOR_PAIR(COLOR_SECTION));
-    }
-    mvwhline(right_win, 1, 0, ACS_HLINE, layout.right_w);
-    if (has_colors()) {
-      wattroff(right_win, COLOR_PAIR(COLOR_SECTION));
-    }
-
-    if (app->runs.len == 0) {
-      win_add_text(right_win, 2, 0, "No history yet.");
-    } else {
-      run_entry_t *run = &app->runs.items[app->history_selected];
-      int row = 2;
+static void close_tree(app_t *app) {
+  json_tree_free(&app->tree.tree);
+  free(app->tree.owned);
+  memset(&app->tree, 0, sizeof(app->tree));
+}
 
-      if (run->request_name[0] == '\0') {
-        win_add_labeled_text(right_win, row, 0, "name: ", "(unnamed)");
-      } else {
-        win_add_labeled_text(right_win, row, 0, "name: ", run->request_name);
-      }
-      row++;
+/* Takes ownership of `owned` when it is not NULL (it is then `text`). Stays on the current screen if the body is not JSON. */
+static void open_tree(app_t *app, const char *text, size_t len, char *owned, const char *title) {
+  screen_t back = app->screen;
+  close_tree(app);
+  tree_screen_t *view = &app->tree;
+  char error[256];
+  if (json_tree_open(&view->tree, text, len, error, sizeof(error)) != 0) {
+    free(owned);
+    char msg[STATUS_MAX];
+    snprintf(msg, sizeof(msg), "Not JSON: %s", error);
+    set_status_error(app, msg);
+    return;
+  }
+  view->owned = owned;
+  view->back = back;
+  snprintf(view->title, sizeof(view->title), "%s", title);
+  app->screen = SCREEN_TREE;
+}
 
-      win_add_labeled_method(right_win, row, 0, "method: ", run->method);
-      row++;
+static void open_last_response_tree(app_t *app) {
+  size_t len = 0;
+  const char *body = last_response_full(app, &len);
+  if (body == NULL || app->last_response_at[0] == '\0') {
+    set_status(app, "No response to show as a tree yet");
+    return;
+  }
+  char title[160];
+  last_response_title(app, title, sizeof(title));
+  open_tree(app, body, len, NULL, title);
+}
 
-      wmove(right_win, row, 0);
-      if (has_colors()) {
-        wattron(right_win, COLOR_PAIR(COLOR_LABEL));
-      }
-      wattron(right_win, A_BOLD);
-      waddstr(right_win, "status: ");
-      wattroff(right_win, A_BOLD);
-      if (has_colors()) {
-        wattroff(right_win, COLOR_PAIR(COLOR_LABEL));
-      }
-      int s_pair = status_color_pair(run->status_code);
-      if (s_pair != 0 && has_colors()) {
-        wattron(right_win, COLOR_PAIR(s_pair));
-      }
-      wprintw(right_win, "%d", run->status_code);
-      if (s_pair != 0 && has_colors()) {
-        wattroff(right_win, COLOR_PAIR(s_pair));
-      }
-      wprintw(right_win, "  duration=%ldms", run->duration_ms);
-      row++;
+static int tree_content_height(void) {
+  int h = getmaxy(stdscr);
+  return h - 3 > 1 ? h - 3 : 1;
+}
 
-      win_add_labeled_text(right_win, row, 0, "at: ", run->created_at);
-      row++;
-      win_add_labeled_text(right_win, row, 0, "id: ", run->request_id);
-      row++;
+/* Draws up to `columns` columns of `text` at the cursor, in color `pair` (0 for none). */
+static void tree_add_span(const char *text, size_t len, int columns, int pair) {
+  if (columns <= 0) {
+    return;
+  }
+  size_t start = 0;
+  size_t fit = 0;
+  wrap_line_next(text, len, 0, columns, &start, &fit);
+  if (pair != 0 && has_colors()) {
+    attron(COLOR_PAIR(pair));
+  }
+  int y = 0;
+  int x = 0;
+  getyx(stdscr, y, x);
+  win_add_display_span(stdscr, y, x, text + start, fit);
+  if (pair != 0 && has_colors()) {
+    attroff(COLOR_PAIR(pair));
+  }
+}
 
-      if (row < layout.content_h) {
-        if (has_colors()) {
-          wattron(right_win, COLOR_PAIR(COLOR_SECTION));
-        }
-        mvwhline(right_win, row, 0, ACS_HLINE, layout.right_w);
-        if (has_colors()) {
-          wattroff(right_win, COLOR_PAIR(COLOR_SECTION));
-        }
-        row++;
-      }
+static void draw_tree_row(const json_tree_t *tree, size_t r, int y, int w, bool selected) {
+  const json_row_t *row = &tree->rows[r];
+  const char *text = tree->index.text;
+  int indent = (int)row->depth * 2;
+  if (indent > w / 2) {
+    indent = w / 2;
+  }
+  if (selected) {
+    attron(A_REVERSE);
+    mvhline(y, 0, ' ', w);
+  }
+  bool container = row->kind == JSON_NODE_OBJECT || row->kind == JSON_NODE_ARRAY;
+  mvprintw(y, indent, "%s", container ? (row->expanded ? "- " : "+ ") : "  ");
+
+  size_t start = 0;
+  size_t len = 0;
+  char label[32];
+  if (json_tree_key(tree, r, &start, &len) == 0) {
+    tree_add_span(text + start, len, w - getcurx(stdscr) - 2, COLOR_SYNTAX_KEY);
+    addstr(": ");
+  } else if (row->depth > 0) {
+    snprintf(label, sizeof(label), "[%u] ", row->index);
+    tree_add_span(label, strlen(label), w - getcurx(stdscr), COLOR_LABEL);
+  }
+
+  int room = w - getcurx(stdscr);
+  if (container) {
+    const char *noun = row->kind == JSON_NODE_OBJECT ? (row->children == 1 ? "key" : "keys")
+                                                     : (row->children == 1 ? "item" : "items");
+    snprintf(label, sizeof(label), "%s %u %s %s", row->kind == JSON_NODE_OBJECT ? "{" : "[", row->children, noun,
+             row->kind == JSON_NODE_OBJECT ? "}" : "]");
+    tree_add_span(label, strlen(label), room, COLOR_SECTION);
+  } else {
+    json_tree_value(tree, r, &start, &len);
+    int pair = row->kind == JSON_NODE_STRING   ? COLOR_SYNTAX_STRING
+               : row->kind == JSON_NODE_NUMBER ? COLOR_SYNTAX_NUMBER
+                                               : COLOR_SYNTAX_LITERAL;
+    tree_add_span(text + start, len, room, pair);
+  }
+  if (selected) {
+    attroff(A_REVERSE);
+  }
+}
 
-      if (row < layout.content_h) {
-        win_add_section_title(right_win, row, 0, "Request + Response");
-        row++;
-      }
+static void draw_tree(app_t *app) {
+  tree_screen_t *view = &app->tree;
+  json_tree_t *tree = &view->tree;
+  app->drawn_screen = SCREEN_TREE;
 
-      if (row < layout.content_h) {
-        char *details = build_history_detail_text(run);
-        if (details == NULL) {
-          const char *fallback = "(history detail unavailable: out of memory)";
-          details = dup_text_n(fallback, strlen(fallback));
-        }
+  int h = 0;
+  int w = 0;
+  getmaxyx(stdscr, h, w);
+  erase();
+  if (h < 5 || w < 20) {
+    mvprintw(h > 0 ? h - 1 : 0, 0, "Window too small");
+    refresh();
+    return;
+  }
 
-        if (details != NULL) {
-          win_draw_wrapped_body_preview(right_win, row, layout.content_h - row, layout.right_w, details,
-                                        &app->history_detail_scroll);
-          free(details);
-        }
-      }
-    }
-  } else {
-    if (layout.content_h > 2) {
-      win_add_text(left_win, layout.content_h - 2, 1, "Run detail hidden (window too narrow)");
-    }
+  attron(A_BOLD);
+  mvaddnstr(0, 0, view->title, w);
+  attroff(A_BOLD);
+
+  int rows = tree_content_height();
+  if (view->cursor >= tree->rows_len) {
+    view->cursor = tree->rows_len > 0 ? tree->rows_len - 1 : 0;
+  }
+  if (view->cursor < view->scroll) {
+    view->scroll = view->cursor;
+  } else if (view->cursor >= view->scroll + (size_t)rows) {
+    view->scroll = view->cursor - (size_t)rows + 1;
+  }
+  for (int i = 0; i < rows && view->scroll + (size_t)i < tree->rows_len; i++) {
+    size_t r = view->scroll + (size_t)i;
+    draw_tree_row(tree, r, 1 + i, w, r == view->cursor);
   }
 
-  if (layout.show_right) {
-    if (app->drag_mode == DRAG_VERTICAL) {
-      attron(A_REVERSE);
-    }
-    for (int y = 0; y < layout.content_h; y++) {
-      mvaddch(y, layout.separator_x, ACS_VLINE);
-    }
-    if (app->drag_mode == DRAG_VERTICAL) {
-      attroff(A_REVERSE);
-    }
+  /* Sized so the row counts always fit after it. */
+  char path[STATUS_MAX - 64];
+  json_tree_path(tree, view->cursor, path, sizeof(path));
+  char stats[STATUS_MAX];
+  snprintf(stats, sizeof(stats), "%s | row %zu of %zu", path, view->cursor + 1, tree->rows_len);
+  if (has_colors()) {
+    attron(COLOR_PAIR(COLOR_LABEL));
+  }
+  mvaddnstr(h - 2, 0, stats, w);
+  if (has_colors()) {
+    attroff(COLOR_PAIR(COLOR_LABEL));
   }
 
-  wnoutrefresh(stdscr);
-  wnoutrefresh(left_win);
-  if (right_win != NULL) {
-    wnoutrefresh(right_win);
+  if (view->prompt) {
+    mvprintw(h - 1, 0, "Go to path: %s", app->cmdline);
+  } else if (view->message[0] != '\0') {
+    mvaddnstr(h - 1, 0, view->message, w);
+  } else {
+    mvaddnstr(h - 1, 0, "TREE | j/k move | space/b page | g/G | l/h expand/collapse | Enter toggle | : go to path | q back",
+              w);
   }
+  refresh();
+}
 
-  move(h - 1, 0);
-  clrtoeol();
-  mvprintw(h - 1, 0, "HISTORY | j/k move | r replay | H/L resize | { } details | drag divider | Esc back");
-  doupdate();
+static void handle_tree_key(app_t *app, int ch) {
+  tree_screen_t *view = &app->tree;
+  json_tree_t *tree = &view->tree;
+  size_t page = (size_t)tree_content_height();
+  size_t last = tree->rows_len > 0 ? tree->rows_len - 1 : 0;
+  json_row_t *row = &tree->rows[view->cursor];
+  bool container = row->kind == JSON_NODE_OBJECT || row->kind == JSON_NODE_ARRAY;
+  view->message[0] = '\0';
+
+  if (view->prompt) {
+    if (ch == 27) {
+      view->prompt = false;
+    } else if (ch == KEY_BACKSPACE || ch == 127 || ch == 8) {
+      line_backspace(app->cmdline, &app->cmdline_len);
+    } else if (ch == '\n' || ch == KEY_ENTER) {
+      view->prompt = false;
+      if (app->cmdline_len > 0 && json_tree_find(tree, app->cmdline, &view->cursor) != 0) {
+        char path[STATUS_MAX - CMDLINE_MAX - 32];
+        json_tree_path(tree, view->cursor, path, sizeof(path));
+        snprintf(view->message, sizeof(view->message), "No %s; stopped at %s", app->cmdline, path);
+      }
+    } else if (isprint(ch)) {
+      line_append_char(app->cmdline, sizeof(app->cmdline), &app->cmdline_len, ch);
+    }
+    return;
+  }
 
-  delwin(left_win);
-  if (right_win != NULL) {
-    delwin(right_win);
+  if (ch == 27 || ch == 'q') {
+    screen_t back = view->back;
+    close_tree(app);
+    app->screen = back;
+  } else if (ch == 'j' || ch == KEY_DOWN) {
+    view->cursor = view->cursor < last ? view->cursor + 1 : last;
+  } else if (ch == 'k' || ch == KEY_UP) {
+    view->cursor = view->cursor > 0 ? view->cursor - 1 : 0;
+  } else if (ch == ' ' || ch == KEY_NPAGE) {
+    view->cursor = last - view->cursor > page ? view->cursor + page : last;
+    view->scroll = view->cursor;
+  } else if (ch == 'b' || ch == KEY_PPAGE) {
+    view->cursor = view->cursor > page ? view->cursor - page : 0;
+  } else if (ch == 'g' || ch == KEY_HOME) {
+    view->cursor = 0;
+  } else if (ch == 'G' || ch == KEY_END) {
+    view->cursor = last;
+  } else if (ch == 'l' || ch == KEY_RIGHT) {
+    if (container && !row->expanded) {
+      json_tree_expand(tree, view->cursor);
+    } else if (container && row->children > 0) {
+      view->cursor++;
+    }
+  } else if (ch == 'h' || ch == KEY_LEFT) {
+    if (container && row->expanded) {
+      json_tree_collapse(tree, view->cursor);
+    } else if (json_tree_parent(tree, view->cursor) != SIZE_MAX) {
+      view->cursor = json_tree_parent(tree, view->cursor);
+    }
+  } else if (ch == '\n' || ch == KEY_ENTER) {
+    if (container && row->expanded) {
+      json_tree_collapse(tree, view->cursor);
+    } else if (container) {
+      json_tree_expand(tree, view->cursor);
+    }
+  } else if (ch == ':') {
+    view->prompt = true;
+    line_reset(app->cmdline, &app->cmdline_len);
   }
 }
 
@@ -2581,6 +5118,145 @@ static void enter_new_screen(app_t *app, const request_t *from_request, int init
   app->screen = SCREEN_NEW;
 }
 
+/* Opens a config file (environment, workflow) in $EDITOR; `skeleton` seeds a new file. */
+static int edit_config_file(app_t *app, const char *path, const char *skeleton, const char *suffix) {
+  char text[TUIMAN_BODY_LEN];
+  text[0] = '\0';
+  FILE *fp = fopen(path, "rb");
+  if (fp != NULL) {
+    size_t used = fread(text, 1, sizeof(text) - 1, fp);
+    text[used] = '\0';
+    fclose(fp);
+  } else {
+    snprintf(text, sizeof(text), "%s", skeleton);
+  }
+
+  char edited[TUIMAN_BODY_LEN];
+  if (launch_editor_and_restore_tui(text, edited, sizeof(edited), suffix) != 0) {
+    set_status(app, "Edit cancelled or failed");
+    return -1;
+  }
+  fp = fopen(path, "wb");
+  if (fp == NULL || fwrite(edited, 1, strlen(edited), fp) != strlen(edited)) {
+    if (fp != NULL) {
+      fclose(fp);
+    }
+    set_status_error(app, "Failed to write file");
+    return -1;
+  }
+  fclose(fp);
+  return 0;
+}
+
+static void edit_environment_file(app_t *app, const char *name) {
+  char path[PATH_MAX];
+  if (environment_file_path(&app->paths, name, path, sizeof(path)) != 0) {
+    set_status_error(app, "Invalid environment name");
+    return;
+  }
+  if (edit_config_file(app, path, "# KEY=value, referenced as {{KEY}}\n", ".env") != 0) {
+    return;
+  }
+
+  if (strcmp(app->env.name, name) == 0) {
+    environment_t reloaded;
+    if (environment_load(&app->paths, name, &reloaded) == 0) {
+      environment_free(&app->env);
+      app->env = reloaded;
+    }
+  }
+  set_status(app, "Environment saved");
+}
+
+static void execute_workflow_command(app_t *app, const char *arg, const char *extra) {
+  char msg[STATUS_MAX];
+  if (arg == NULL) {
+    environment_names_t names;
+    if (workflow_list_names(&app->paths, &names) != 0) {
+      set_status_error(app, "Failed to list workflows");
+      return;
+    }
+    int used = snprintf(msg, sizeof(msg), "workflows:");
+    for (size_t i = 0; i < names.len && used > 0 && (size_t)used < sizeof(msg); i++) {
+      used += snprintf(msg + used, sizeof(msg) - (size_t)used, " %s", names.items[i]);
+    }
+    if (names.len == 0 && used > 0 && (size_t)used < sizeof(msg)) {
+      snprintf(msg + used, sizeof(msg) - (size_t)used, " (none, use :workflow edit NAME)");
+    }
+    environment_names_free(&names);
+    set_status(app, msg);
+    return;
+  }
+
+  if (strcmp(arg, "edit") == 0) {
+    char path[PATH_MAX];
+    if (extra == NULL || workflow_file_path(&app->paths, extra, path, sizeof(path)) != 0) {
+      set_status(app, "Usage: :workflow edit NAME");
+      return;
+    }
+    if (edit_config_file(app, path,
+                         "# step NAME REQUEST [after STEP,...]   (no 'after' = after the previous step, 'after -' = none)\n"
+                         "#   extract VAR = json /pointer | header Name | status\n"
+                         "#   until status CODE [tries N] [every MS]\n",
+                         ".flow") == 0) {
+      set_status(app, "Workflow saved");
+    }
+    return;
+  }
+
+  run_workflow(app, arg);
+}
+
+static void execute_env_command(app_t *app, const char *arg, const char *extra) {
+  char msg[STATUS_MAX];
+  if (arg == NULL) {
+    environment_names_t names;
+    if (environment_list_names(&app->paths, &names) != 0) {
+      set_status_error(app, "Failed to list environments");
+      return;
+    }
+    int used = snprintf(msg, sizeof(msg), "env: %s | available:", app->env.name[0] ? app->env.name : "none");
+    for (size_t i = 0; i < names.len && used > 0 && (size_t)used < sizeof(msg); i++) {
+      used += snprintf(msg + used, sizeof(msg) - (size_t)used, " %s", names.items[i]);
+    }
+    if (names.len == 0 && used > 0 && (size_t)used < sizeof(msg)) {
+      snprintf(msg + used, sizeof(msg) - (size_t)used, " (none, use :env edit NAME)");
+    }
+    environment_names_free(&names);
+    set_status(app, msg);
+    return;
+  }
+
+  if (strcmp(arg, "none") == 0) {
+    environment_free(&app->env);
+    set_status(app, "Environment cleared");
+    return;
+  }
+
+  if (strcmp(arg, "edit") == 0) {
+    const char *name = extra != NULL ? extra : app->env.name;
+    if (name[0] == '\0') {
+      set_status(app, "Usage: :env edit NAME");
+      return;
+    }
+    char copy[TUIMAN_ENV_NAME_LEN];
+    snprintf(copy, sizeof(copy), "%s", name);
+    edit_environment_file(app, copy);
+    return;
+  }
+
+  environment_t loaded;
+  if (environment_load(&app->paths, arg, &loaded) != 0) {
+    snprintf(msg, sizeof(msg), "Environment not found: %s", arg);
+    set_status_error(app, msg);
+    return;
+  }
+  environment_free(&app->env);
+  app->env = loaded;
+  snprintf(msg, sizeof(msg), "Environment %s active (%zu vars)", app->env.name, app->env.len);
+  set_status(app, msg);
+}
+
 static void execute_main_command(app_t *app, bool *running, const char *line) {
   char copy[CMDLINE_MAX];
   snprintf(copy, sizeof(copy), "%s", line);
@@ -2603,6 +5279,7 @@ static void execute_main_command(app_t *app, bool *running, const char *line) {
   if (strcmp(cmd, "new") == 0) {
     request_t draft;
     request_init_defaults(&draft);
+    snprintf(draft.collection, sizeof(draft.collection), "%s", selected_collection_path(app));
     char *method = strtok(NULL, " ");
     char *url = strtok(NULL, "");
     if (method != NULL) {
@@ -2636,6 +5313,16 @@ static void execute_main_command(app_t *app, bool *running, const char *line) {
     return;
   }
 
+  if (strcmp(cmd, "history-stats") == 0) {
+    show_history_stats(app);
+    return;
+  }
+
+  if (strcmp(cmd, "history-vacuum") == 0) {
+    vacuum_history(app);
+    return;
+  }
+
   if (strcmp(cmd, "export") == 0) {
     char destination[PATH_MAX];
     char *arg = strtok(NULL, "");
@@ -2651,8 +5338,13 @@ static void execute_main_command(app_t *app, bool *running, const char *line) {
       snprintf(destination, sizeof(destination), "%s", arg);
     }
 
+    /* The in-memory list only holds opened collections; export the whole catalog. */
+    request_list_t catalog = {0};
     export_report_t report;
-    if (export_requests(&app->paths, &app->requests, destination, &report) == 0) {
+    int rc = request_store_list(&app->store, &catalog) == 0 ? export_requests(&app->paths, &catalog, destination, &report)
+                                                             : -1;
+    request_list_free(&catalog);
+    if (rc == 0) {
       char msg[STATUS_MAX];
       snprintf(msg, sizeof(msg), "Exported %zu requests to %s (scrubbed %zu secret refs)", report.exported_count,
                destination, report.scrubbed_secret_refs);
@@ -2674,8 +5366,9 @@ static void execute_main_command(app_t *app, bool *running, const char *line) {
     }
 
     size_t imported = 0;
-    if (import_requests(&app->paths, arg, &imported) == 0) {
+    if (import_requests(&app->store, arg, &imported) == 0) {
       load_requests(app, NULL);
+      discard_request_changes(app);
       char msg[STATUS_MAX];
       snprintf(msg, sizeof(msg), "Imported %zu requests", imported);
       set_status(app, msg);
@@ -2685,6 +5378,20 @@ static void execute_main_command(app_t *app, bool *running, const char *line) {
     return;
   }
 
+  if (strcmp(cmd, "env") == 0) {
+    char *arg = strtok(NULL, " ");
+    char *extra = strtok(NULL, " ");
+    execute_env_command(app, arg, extra);
+    return;
+  }
+
+  if (strcmp(cmd, "workflow") == 0) {
+    char *arg = strtok(NULL, " ");
+    char *extra = strtok(NULL, " ");
+    execute_workflow_command(app, arg, extra);
+    return;
+  }
+
   set_status(app, "Unknown command");
 }
 
@@ -2707,19 +5414,51 @@ static void handle_main_key(app_t *app, bool *running, int ch) {
   if (app->main_mode == MAIN_MODE_SEARCH || app->main_mode == MAIN_MODE_REVERSE ||
       app->main_mode == MAIN_MODE_COMMAND) {
     app->pending_Z = false;
+    bool fuzzy_mode = app->main_mode == MAIN_MODE_REVERSE;
     if (ch == 27) {
+      if (fuzzy_mode) {
+        /* Cancelling `?` puts back whatever filter was active before it. */
+        snprintf(app->filter, sizeof(app->filter), "%s", app->fuzzy.saved_filter);
+        app->filter_fuzzy = app->fuzzy.saved_fuzzy;
+        apply_filter(app, NULL);
+      }
       app->main_mode = MAIN_MODE_NORMAL;
       line_reset(app->cmdline, &app->cmdline_len);
       set_default_main_status(app);
       return;
     }
+    if (fuzzy_mode && (ch == KEY_DOWN || ch == 14 || ch == KEY_UP || ch == 16)) {
+      /* Ctrl-N / Ctrl-P move through the ranked results without leaving the prompt. */
+      if ((ch == KEY_DOWN || ch == 14) && app->selected_visible + 1 < app->visible_len) {
+        app->selected_visible++;
+      } else if ((ch == KEY_UP || ch == 16) && app->selected_visible > 0) {
+        app->selected_visible--;
+      }
+      app->request_body_scroll = 0;
+      return;
+    }
     if (ch == KEY_BACKSPACE || ch == 127 || ch == 8) {
       line_backspace(app->cmdline, &app->cmdline_len);
+      if (fuzzy_mode) {
+        snprintf(app->filter, sizeof(app->filter), "%s", app->cmdline);
+        apply_filter(app, NULL);
+      }
       return;
     }
     if (ch == '\n' || ch == KEY_ENTER) {
-      if (app->main_mode == MAIN_MODE_SEARCH || app->main_mode == MAIN_MODE_REVERSE) {
+      if (fuzzy_mode) {
+        /* Results already follow the prompt; Enter just keeps them and the selection. */
+        if (app->filter[0] != '\0') {
+          char msg[STATUS_MAX];
+          snprintf(msg, sizeof(msg), "FUZZY: %s (%zu of %zu matches)", app->filter, app->visible_len,
+                   app->fuzzy.matches_len);
+          set_status(app, msg);
+        } else {
+          set_default_main_status(app);
+        }
+      } else if (app->main_mode == MAIN_MODE_SEARCH) {
         snprintf(app->filter, sizeof(app->filter), "%s", app->cmdline);
+        app->filter_fuzzy = false;
         apply_filter(app, NULL);
         if (app->filter[0] != '\0') {
           char msg[STATUS_MAX];
@@ -2739,6 +5478,11 @@ static void handle_main_key(app_t *app, bool *running, int ch) {
 
     if (isprint(ch)) {
       line_append_char(app->cmdline, sizeof(app->cmdline), &app->cmdline_len, ch);
+      if (fuzzy_mode) {
+        snprintf(app->filter, sizeof(app->filter), "%s", app->cmdline);
+        app->filter_fuzzy = true;
+        apply_filter(app, NULL);
+      }
     }
     return;
   }
@@ -2746,7 +5490,7 @@ static void handle_main_key(app_t *app, bool *running, int ch) {
   if (app->main_mode == MAIN_MODE_ACTION) {
     app->pending_Z = false;
     if (ch == 'y' && selected != NULL) {
-      send_request_and_record(app, selected);
+      send_request_and_record(app, selected, true);
       app->main_mode = MAIN_MODE_NORMAL;
       return;
     }
@@ -2754,9 +5498,12 @@ static void handle_main_key(app_t *app, bool *running, int ch) {
       char edited[TUIMAN_BODY_LEN];
       if (launch_editor_and_restore_tui(selected->body, edited, sizeof(edited), ".txt") == 0) {
         if (apply_body_edit_result(app, edited, selected->body, sizeof(selected->body), "Body updated",
-                                   "Body updated (JSON formatted)") == 0) {
-          request_store_save(&app->paths, selected);
-          load_requests(app, selected->id);
+                                   "Body updated (JSON formatted)") == 0 &&
+            store_request_and_patch(app, selected) == TUIMAN_STORE_CONFLICT) {
+          char keep_id[TUIMAN_ID_LEN];
+          snprintf(keep_id, sizeof(keep_id), "%s", selected->id);
+          load_requests(app, keep_id);
+          set_status_error(app, "Request was changed by another instance; reloaded, body edit not saved");
         }
       } else {
         set_status(app, "Body edit cancelled or failed");
@@ -2791,16 +5538,19 @@ static void handle_main_key(app_t *app, bool *running, int ch) {
           next_visible = old_visible - 1;
         }
 
-        size_t next_index = app->visible_indices[next_visible];
-        if (next_index < app->requests.len) {
-          snprintf(next_select_id, sizeof(next_select_id), "%s", app->requests.items[next_index].id);
+        const list_row_t *next_row = &app->visible_rows[next_visible];
+        if (next_row->kind == LIST_ROW_REQUEST && next_row->index < app->requests.len) {
+          snprintf(next_select_id, sizeof(next_select_id), "%s", app->requests.items[next_row->index].id);
         }
       }
 
-      if (request_store_delete(&app->paths, app->delete_confirm_id) == 0) {
+      if (request_store_delete(&app->store, app->delete_confirm_collection, app->delete_confirm_id) == 0) {
         char deleted_name[TUIMAN_NAME_LEN];
         snprintf(deleted_name, sizeof(deleted_name), "%s", app->delete_confirm_name);
-        load_requests(app, next_select_id[0] != '\0' ? next_select_id : NULL);
+        request_watch_note_self_write(&app->watch, app->delete_confirm_collection, app->delete_confirm_id);
+        http_client_forget_request(app->delete_confirm_id);
+        patch_request_remove(app, app->delete_confirm_collection, app->delete_confirm_id,
+                             next_select_id[0] != '\0' ? next_select_id : NULL);
         char msg[STATUS_MAX];
         snprintf(msg, sizeof(msg), "Deleted request: %s", deleted_name);
         set_status(app, msg);
@@ -2836,20 +5586,24 @@ static void handle_main_key(app_t *app, bool *running, int ch) {
     if (app->request_body_scroll > 0) {
       app->request_body_scroll--;
     }
+    damage_pane(app, PANE_MAIN_PREVIEW);
     return;
   }
   if (ch == '}') {
     app->request_body_scroll++;
+    damage_pane(app, PANE_MAIN_PREVIEW);
     return;
   }
   if (ch == '[') {
     if (app->response_body_scroll > 0) {
       app->response_body_scroll--;
     }
+    damage_pane(app, PANE_MAIN_RESPONSE);
     return;
   }
   if (ch == ']') {
     app->response_body_scroll++;
+    damage_pane(app, PANE_MAIN_RESPONSE);
     return;
   }
 
@@ -2870,6 +5624,7 @@ static void handle_main_key(app_t *app, bool *running, int ch) {
       app->selected_visible++;
       app->request_body_scroll = 0;
     }
+    damage_pane(app, PANE_MAIN_PREVIEW);
     return;
   }
 
@@ -2899,6 +5654,7 @@ static void handle_main_key(app_t *app, bool *running, int ch) {
       app->selected_visible--;
       app->request_body_scroll = 0;
     }
+    damage_pane(app, PANE_MAIN_PREVIEW);
     return;
   }
   if (ch == 'g') {
@@ -2922,9 +5678,18 @@ static void handle_main_key(app_t *app, bool *running, int ch) {
     return;
   }
 
+  if (ch == 'w') {
+    app->latency_window = (app->latency_window + 1) % (int)(sizeof(LATENCY_WINDOWS) / sizeof(LATENCY_WINDOWS[0]));
+    char msg[STATUS_MAX];
+    snprintf(msg, sizeof(msg), "Latency window: %s", LATENCY_WINDOWS[app->latency_window].label);
+    set_status(app, msg);
+    return;
+  }
+
   if (ch == 'd') {
     if (selected != NULL) {
       snprintf(app->delete_confirm_id, sizeof(app->delete_confirm_id), "%s", selected->id);
+      snprintf(app->delete_confirm_collection, sizeof(app->delete_confirm_collection), "%s", selected->collection);
       snprintf(app->delete_confirm_name, sizeof(app->delete_confirm_name), "%s", selected->name);
       app->main_mode = MAIN_MODE_DELETE_CONFIRM;
     }
@@ -2938,6 +5703,15 @@ static void handle_main_key(app_t *app, bool *running, int ch) {
     return;
   }
 
+  if (ch == 'P') {
+    open_last_response_pager(app);
+    return;
+  }
+  if (ch == 'T') {
+    open_last_response_tree(app);
+    return;
+  }
+
   if (ch == '/') {
     app->main_mode = MAIN_MODE_SEARCH;
     line_reset(app->cmdline, &app->cmdline_len);
@@ -2945,6 +5719,8 @@ static void handle_main_key(app_t *app, bool *running, int ch) {
   }
   if (ch == '?') {
     app->main_mode = MAIN_MODE_REVERSE;
+    snprintf(app->fuzzy.saved_filter, sizeof(app->fuzzy.saved_filter), "%s", app->filter);
+    app->fuzzy.saved_fuzzy = app->filter_fuzzy;
     line_reset(app->cmdline, &app->cmdline_len);
     return;
   }
@@ -2954,14 +5730,41 @@ static void handle_main_key(app_t *app, bool *running, int ch) {
     return;
   }
   if (ch == '\n' || ch == KEY_ENTER) {
+    collection_node_t *node = selected_collection(app);
     if (selected != NULL) {
       app->main_mode = MAIN_MODE_ACTION;
+    } else if (node != NULL) {
+      set_collection_expanded(app, node->path, !node->expanded);
     }
     return;
   }
+  if (ch == 'l') {
+    collection_node_t *node = selected_collection(app);
+    if (node != NULL) {
+      set_collection_expanded(app, node->path, true);
+    }
+    return;
+  }
+  if (ch == 'h') {
+    collection_node_t *node = selected_collection(app);
+    if (node != NULL && node->expanded) {
+      set_collection_expanded(app, node->path, false);
+      return;
+    }
+    char parent[TUIMAN_COLLECTION_LEN];
+    if (node != NULL) {
+      collection_parent(node->path, parent);
+    } else {
+      snprintf(parent, sizeof(parent), "%s", selected != NULL ? selected->collection : "");
+    }
+    select_collection_row(app, parent);
+    app->request_body_scroll = 0;
+    return;
+  }
   if (ch == 27) {
     if (app->filter[0] != '\0') {
       app->filter[0] = '\0';
+      app->filter_fuzzy = false;
       apply_filter(app, NULL);
       set_default_main_status(app);
     } else {
@@ -3064,6 +5867,22 @@ static void execute_new_command(app_t *app, const char *command_line) {
     app->screen = SCREEN_MAIN;
     return;
   }
+  if (strncmp(command_line, "header ", 7) == 0) {
+    const char *line = command_line + 7;
+    const char *cursor = line;
+    char name[TUIMAN_HEADER_KEY_LEN];
+    char value[TUIMAN_HEADER_VAL_LEN];
+    if (!request_header_next(&cursor, name, sizeof(name), value, sizeof(value))) {
+      set_status(app, "Usage: :header Name: value");
+      return;
+    }
+    if (request_header_append(&app->draft, name, value) != 0) {
+      set_status_error(app, "Header list is full");
+      return;
+    }
+    set_status(app, "Header added");
+    return;
+  }
   if (strncmp(command_line, "secret ", 7) == 0) {
     const char *value = command_line + 7;
     while (*value == ' ') {
@@ -3179,12 +5998,14 @@ static void handle_new_key(app_t *app, int ch) {
     if (app->draft_field + 1 < DRAFT_FIELD_COUNT) {
       app->draft_field++;
     }
+    damage_pane(app, PANE_EDITOR_FORM);
     return;
   }
   if (ch == 'k') {
     if (app->draft_field > 0) {
       app->draft_field--;
     }
+    damage_pane(app, PANE_EDITOR_FORM);
     return;
   }
   if (ch == 'h' && app->draft_field == DRAFT_FIELD_METHOD) {
@@ -3200,6 +6021,19 @@ static void handle_new_key(app_t *app, int ch) {
       set_status(app, "Method uses h/l cycle");
       return;
     }
+    if (app->draft_field == DRAFT_FIELD_HEADERS) {
+      char edited[TUIMAN_HEADERS_LEN];
+      if (launch_editor_and_restore_tui(app->draft.headers, edited, sizeof(edited), ".txt") == 0) {
+        if (request_headers_set_text(&app->draft, edited) == 0) {
+          set_status(app, "Headers updated");
+        } else {
+          set_status_error(app, "Header list too long; extra lines dropped");
+        }
+      } else {
+        set_status(app, "Header edit cancelled or failed");
+      }
+      return;
+    }
     snprintf(app->draft_input, sizeof(app->draft_input), "%s", draft_field_value(app, app->draft_field));
     app->draft_input_len = strlen(app->draft_input);
     app->new_mode = NEW_MODE_INSERT;
@@ -3310,14 +6144,52 @@ static void handle_history_key(app_t *app, int ch) {
     app->drag_mode = DRAG_NONE;
   }
 
+  history_search_t *search = &app->history_search;
+  if (search->prompt) {
+    if (ch == 27) {
+      search->prompt = false;
+      line_reset(app->cmdline, &app->cmdline_len);
+    } else if (ch == KEY_BACKSPACE || ch == 127 || ch == 8) {
+      line_backspace(app->cmdline, &app->cmdline_len);
+    } else if (ch == '\n' || ch == KEY_ENTER) {
+      search->prompt = false;
+      if (app->cmdline_len > 0) {
+        run_history_search(app, app->cmdline);
+      }
+      line_reset(app->cmdline, &app->cmdline_len);
+    } else if (isprint(ch)) {
+      line_append_char(app->cmdline, sizeof(app->cmdline), &app->cmdline_len, ch);
+    }
+    return;
+  }
+  if (ch == '/') {
+    search->prompt = true;
+    line_reset(app->cmdline, &app->cmdline_len);
+    return;
+  }
+  if (search->active) {
+    if (ch == 27) {
+      close_history_search(app);
+    } else if (ch == 'j' && search->selected + 1 < search->hits.len) {
+      search->selected++;
+    } else if (ch == 'k' && search->selected > 0) {
+      search->selected--;
+    } else if ((ch == '\n' || ch == KEY_ENTER) && search->selected < search->hits.len) {
+      jump_to_history_run(app, search->hits.items[search->selected].run.id);
+    }
+    return;
+  }
+
   if (ch == '{') {
     if (app->history_detail_scroll > 0) {
       app->history_detail_scroll--;
     }
+    damage_pane(app, PANE_HISTORY_DETAIL);
     return;
   }
   if (ch == '}') {
     app->history_detail_scroll++;
+    damage_pane(app, PANE_HISTORY_DETAIL);
     return;
   }
 
@@ -3335,10 +6207,14 @@ static void handle_history_key(app_t *app, int ch) {
     return;
   }
   if (ch == 'j') {
+    if (app->history_selected + HISTORY_PREFETCH >= app->runs.len) {
+      load_history_page(app);
+    }
     if (app->history_selected + 1 < app->runs.len) {
       app->history_selected++;
       app->history_detail_scroll = 0;
     }
+    damage_pane(app, PANE_HISTORY_DETAIL);
     return;
   }
   if (ch == 'k') {
@@ -3346,15 +6222,61 @@ static void handle_history_key(app_t *app, int ch) {
       app->history_selected--;
       app->history_detail_scroll = 0;
     }
+    damage_pane(app, PANE_HISTORY_DETAIL);
+    return;
+  }
+  if (ch == 'm' && app->runs.len > 0) {
+    const run_entry_t *run = &app->runs.items[app->history_selected];
+    if (app->history_mark.id == run->id) {
+      app->history_mark.id = 0;
+    } else {
+      app->history_mark = *run;
+      app->history_mark.request_snapshot = NULL;
+      app->history_mark.response_body = NULL;
+    }
+    return;
+  }
+  if (ch == 'D') {
+    open_history_diff(app);
+    return;
+  }
+  if (ch == 'P' && app->runs.len > 0) {
+    const run_entry_t *run = &app->runs.items[app->history_selected];
+    size_t len = 0;
+    char *body = load_run_body(app, run, &len);
+    if (body != NULL) {
+      char title[160];
+      run_title(run, title, sizeof(title));
+      open_pager(app, body, len, body, -1, title);
+    }
+    return;
+  }
+  if (ch == 'T' && app->runs.len > 0) {
+    const run_entry_t *run = &app->runs.items[app->history_selected];
+    size_t len = 0;
+    char *body = load_run_body(app, run, &len);
+    if (body != NULL) {
+      char title[160];
+      run_title(run, title, sizeof(title));
+      open_tree(app, body, len, body, title);
+    }
     return;
   }
   if (ch == 'r' && app->runs.len > 0) {
     run_entry_t *run = &app->runs.items[app->history_selected];
     request_t req;
-    if (request_store_load_by_id(&app->paths, run->request_id, &req) == 0) {
-      send_request_and_record(app, &req);
+    size_t index = 0;
+    bool in_catalog = request_list_find(&app->requests, run->request_id, &index) == 0;
+    int found = in_catalog;
+    if (found) {
+      req = app->requests.items[index];
+    } else {
+      found = request_store_load_by_id(&app->store, NULL, run->request_id, &req) == 0;
+    }
+    if (found) {
+      send_request_and_record(app, &req, in_catalog);
       app->screen = SCREEN_MAIN;
-      load_requests(app, req.id);
+      reselect_after_patch(app, req.id, NULL, app->selected_visible);
     } else {
       set_status(app, "Could not load request for replay");
     }
@@ -3378,6 +6300,14 @@ static void init_colors(void) {
   init_pair(COLOR_STATUS_5XX, COLOR_RED, COLOR_BLACK);
   init_pair(COLOR_LABEL, COLOR_CYAN, COLOR_BLACK);
   init_pair(COLOR_SECTION, COLOR_BLUE, COLOR_BLACK);
+  init_pair(COLOR_DIFF_ADDED, COLOR_GREEN, COLOR_BLACK);
+  init_pair(COLOR_DIFF_REMOVED, COLOR_RED, COLOR_BLACK);
+  init_pair(COLOR_SYNTAX_KEY, COLOR_CYAN, COLOR_BLACK);
+  init_pair(COLOR_SYNTAX_STRING, COLOR_GREEN, COLOR_BLACK);
+  init_pair(COLOR_SYNTAX_NUMBER, COLOR_MAGENTA, COLOR_BLACK);
+  init_pair(COLOR_SYNTAX_LITERAL, COLOR_YELLOW, COLOR_BLACK);
+  init_pair(COLOR_SYNTAX_TAG, COLOR_BLUE, COLOR_BLACK);
+  init_pair(COLOR_SYNTAX_COMMENT, COLOR_WHITE, COLOR_BLACK);
 }
 
 static void print_cli_help(FILE *out, const char *argv0) {
@@ -3389,6 +6319,174 @@ static void print_cli_help(FILE *out, const char *argv0) {
   fprintf(out, "  -v, --version  Show version and exit\n");
 }
 
+static long long monotonic_ms(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (long long)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+static void draw_screen(app_t *app) {
+  if (app->screen == SCREEN_MAIN) {
+    draw_main(app);
+  } else if (app->screen == SCREEN_NEW) {
+    draw_new_editor(app);
+  } else if (app->screen == SCREEN_HISTORY) {
+    draw_history(app);
+  } else if (app->screen == SCREEN_DIFF) {
+    draw_diff(app);
+  } else if (app->screen == SCREEN_PAGER) {
+    draw_pager(app);
+  } else if (app->screen == SCREEN_TREE) {
+    draw_tree(app);
+  } else if (app->screen == SCREEN_HELP) {
+    draw_help();
+    app->drawn_screen = SCREEN_HELP;
+  }
+}
+
+static void dispatch_key(app_t *app, bool *running, int ch) {
+  app->damage_known = false;
+  if (app->screen == SCREEN_MAIN) {
+    handle_main_key(app, running, ch);
+  } else if (app->screen == SCREEN_NEW) {
+    handle_new_key(app, ch);
+  } else if (app->screen == SCREEN_HISTORY) {
+    handle_history_key(app, ch);
+  } else if (app->screen == SCREEN_DIFF) {
+    handle_diff_key(app, ch);
+  } else if (app->screen == SCREEN_PAGER) {
+    handle_pager_key(app, ch);
+  } else if (app->screen == SCREEN_TREE) {
+    handle_tree_key(app, ch);
+  } else if (app->screen == SCREEN_HELP && ch == 27) {
+    app->screen = SCREEN_MAIN;
+  }
+  if (!app->damage_known) {
+    invalidate_panes(app);
+  }
+  app->frame_pending = true;
+}
+
+/* Handles every key ncurses has buffered, up to a burst limit. Returns true when keys may remain. */
+static bool drain_input(app_t *app, bool *running) {
+  for (int i = 0; i < INPUT_BURST_MAX; i++) {
+    if (!*running) {
+      return false;
+    }
+    int ch = getch();
+    if (ch == ERR) {
+      return false;
+    }
+    dispatch_key(app, running, ch);
+  }
+  return true;
+}
+
+/* Background work the visible screen is waiting on; while any runs the loop wakes every JOB_POLL_MS. */
+static bool background_jobs_active(const app_t *app) {
+  if (app->screen == SCREEN_DIFF) {
+    return app->diff.job != NULL && !app->diff.view.done;
+  }
+  if (app->screen == SCREEN_MAIN) {
+    return (app->response_wrap.index != NULL && !app->response_wrap.drawn_done) || app->response_wrap.highlight.behind;
+  }
+  if (app->screen == SCREEN_HISTORY) {
+    return (app->history_wrap.index != NULL && !app->history_wrap.drawn_done) || app->history_wrap.highlight.behind;
+  }
+  return false;
+}
+
+static void poll_background_jobs(app_t *app) {
+  if (app->screen == SCREEN_DIFF && text_diff_poll(app->diff.job, &app->diff.view)) {
+    app->frame_pending = true;
+  }
+  if (app->screen == SCREEN_MAIN && wrap_cache_progressed(&app->response_wrap)) {
+    damage_pane(app, PANE_MAIN_RESPONSE);
+    app->frame_pending = true;
+  }
+  if (app->screen == SCREEN_HISTORY && wrap_cache_progressed(&app->history_wrap)) {
+    damage_pane(app, PANE_HISTORY_DETAIL);
+    app->frame_pending = true;
+  }
+}
+
+/*
+ * One poll() over every descriptor the UI reacts to (terminal input, the
+ * request directory watch, history writer commits; further sources get a slot here). Input is drained
+ * in bursts and the screen is drawn at most once per FRAME_MS, and only after
+ * something changed.
+ */
+static void run_event_loop(app_t *app) {
+  bool running = true;
+  bool input_pending = false;
+  bool stdin_pollable = true;
+  long long last_frame = 0;
+  app->frame_pending = true;
+  invalidate_panes(app);
+
+  while (running) {
+    long long now = monotonic_ms();
+    if (app->frame_pending && now - last_frame >= FRAME_MS) {
+      draw_screen(app);
+      app->frame_pending = false;
+      last_frame = now;
+    }
+
+    int wait_ms = -1;
+    if (input_pending) {
+      wait_ms = 0;
+    } else if (app->frame_pending) {
+      wait_ms = (int)(FRAME_MS - (now - last_frame));
+    } else if (background_jobs_active(app)) {
+      wait_ms = JOB_POLL_MS;
+    }
+    if (!stdin_pollable && (wait_ms < 0 || wait_ms > FRAME_MS)) {
+      wait_ms = FRAME_MS;
+    }
+
+    struct pollfd fds[3];
+    nfds_t nfds = 0;
+    nfds_t stdin_slot = nfds;
+    if (stdin_pollable) {
+      fds[nfds++] = (struct pollfd){.fd = STDIN_FILENO, .events = POLLIN};
+    }
+    int watch_fd = request_watch_fd(&app->watch);
+    nfds_t watch_slot = nfds;
+    if (watch_fd >= 0) {
+      fds[nfds++] = (struct pollfd){.fd = watch_fd, .events = POLLIN};
+    }
+    int writer_fd = history_writer_notify_fd(app->history_writer);
+    nfds_t writer_slot = nfds;
+    if (writer_fd >= 0) {
+      fds[nfds++] = (struct pollfd){.fd = writer_fd, .events = POLLIN};
+    }
+
+    int ready = poll(fds, nfds, wait_ms);
+    if ((ready < 0 && errno != EINTR) || (ready > 0 && stdin_pollable && (fds[stdin_slot].revents & POLLNVAL) != 0)) {
+      /* Some platforms cannot poll a terminal device; wait in FRAME_MS steps and let getch() look instead. */
+      stdin_pollable = false;
+      ready = 0;
+    }
+
+    /* ncurses may hold keys it already read, and a resize arrives as EINTR; always try. */
+    input_pending = drain_input(app, &running);
+    if (watch_fd >= 0 && ready > 0 && (fds[watch_slot].revents & POLLIN) != 0 && sync_request_changes(app) > 0) {
+      invalidate_panes(app);
+      app->frame_pending = true;
+    }
+    if (writer_fd >= 0 && ready > 0 && (fds[writer_slot].revents & POLLIN) != 0 &&
+        history_writer_committed(app->history_writer)) {
+      /* Summaries that missed the new runs; the preview repaints with them. */
+      invalidate_request_latency(app, NULL);
+      damage_pane(app, PANE_MAIN_PREVIEW);
+      history_runs_committed(app);
+      history_search_committed(app);
+      app->frame_pending = true;
+    }
+    poll_background_jobs(app);
+  }
+}
+
 int main(int argc, char **argv) {
   if (argc > 1) {
     if (argc == 2 &&
@@ -3408,6 +6506,8 @@ int main(int argc, char **argv) {
 
   app_t app;
   memset(&app, 0, sizeof(app));
+  app.history_bodies_index = SIZE_MAX;
+  app.latency_window = LATENCY_WINDOW_DEFAULT;
   app.split_ratio = 0.66;
   app.response_ratio = 0.28;
   app.drag_mode = DRAG_NONE;
@@ -3418,23 +6518,90 @@ int main(int argc, char **argv) {
     return 1;
   }
 
-  if (history_store_open(app.paths.history_db, &app.db) != 0) {
+  /* Optional tuning: TUIMAN_HISTORY_MMAP_SIZE (bytes, -1 = off), TUIMAN_HISTORY_CACHE_KIB, TUIMAN_HISTORY_BUSY_TIMEOUT_MS. */
+  history_store_options_t history_options = {0};
+  const char *tuning = getenv("TUIMAN_HISTORY_MMAP_SIZE");
+  if (tuning != NULL) {
+    history_options.mmap_size = strtoll(tuning, NULL, 10);
+  }
+  tuning = getenv("TUIMAN_HISTORY_CACHE_KIB");
+  if (tuning != NULL) {
+    history_options.cache_size_kib = atoi(tuning);
+  }
+  tuning = getenv("TUIMAN_HISTORY_BUSY_TIMEOUT_MS");
+  if (tuning != NULL) {
+    history_options.busy_timeout_ms = atoi(tuning);
+  }
+  /* Retention: TUIMAN_HISTORY_MAX_RUNS, _MAX_BYTES, _MAX_AGE_DAYS, _KEEP_PER_REQUEST. */
+  tuning = getenv("TUIMAN_HISTORY_MAX_RUNS");
+  if (tuning != NULL) {
+    history_options.retention.max_runs = strtoll(tuning, NULL, 10);
+  }
+  tuning = getenv("TUIMAN_HISTORY_MAX_BYTES");
+  if (tuning != NULL) {
+    history_options.retention.max_bytes = strtoll(tuning, NULL, 10);
+  }
+  tuning = getenv("TUIMAN_HISTORY_MAX_AGE_DAYS");
+  if (tuning != NULL) {
+    history_options.retention.max_age_days = atoi(tuning);
+  }
+  tuning = getenv("TUIMAN_HISTORY_KEEP_PER_REQUEST");
+  if (tuning != NULL) {
+    history_options.retention.keep_per_request = atoi(tuning);
+  }
+  /* TUIMAN_HISTORY_INDEX_BODIES=1 adds response bodies to the history search index. */
+  tuning = getenv("TUIMAN_HISTORY_INDEX_BODIES");
+  if (tuning != NULL) {
+    history_options.index_bodies = atoi(tuning) != 0;
+  }
+  if (history_store_open(app.paths.history_db, &history_options, &app.history) != 0) {
     fprintf(stderr, "failed to open history db\n");
     return 1;
   }
 
+  const char *backend = getenv("TUIMAN_REQUEST_STORE");
+  if (request_store_open(&app.paths, backend, &app.store) != 0) {
+    fprintf(stderr, "failed to open request store (%s)\n", backend != NULL ? backend : TUIMAN_STORE_JSON);
+    history_store_close(&app.history);
+    return 1;
+  }
+
   if (http_client_global_init() != 0) {
     fprintf(stderr, "failed to initialize http client\n");
-    history_store_close(app.db);
+    request_store_close(&app.store);
+    history_store_close(&app.history);
+    return 1;
+  }
+
+  app.search = search_index_new();
+  app.templates = template_set_new();
+  if (app.search == NULL || app.templates == NULL) {
+    fprintf(stderr, "out of memory\n");
+    search_index_free(app.search);
+    template_set_free(app.templates);
+    http_client_global_cleanup();
+    request_store_close(&app.store);
+    history_store_close(&app.history);
     return 1;
   }
 
+  if (history_writer_start(app.paths.history_db, &history_options, &app.history_writer) != 0) {
+    app.history_writer = NULL;
+  }
+
+  app.watch.fd = -1;
+  if (!request_store_is_json(&app.store) || request_watch_open(app.paths.requests_dir, &app.watch) != 0) {
+    /* Live reload is best-effort; the catalog still follows tuiman's own edits. */
+    request_watch_close(&app.watch);
+  }
   load_requests(&app, NULL);
   set_default_main_status(&app);
   app.screen = SCREEN_MAIN;
   app.main_mode = MAIN_MODE_NORMAL;
 
   setenv("ESCDELAY", "25", 1);
+  /* Character classes only, so ncurses draws UTF-8; number formatting stays in the C locale. */
+  setlocale(LC_CTYPE, "");
   initscr();
   cbreak();
   noecho();
@@ -3443,38 +6610,38 @@ int main(int argc, char **argv) {
   mouseinterval(0);
   enable_extended_mouse_tracking();
   init_colors();
+  nodelay(stdscr, TRUE);
 
-  bool running = true;
-  while (running) {
-    if (app.screen == SCREEN_MAIN) {
-      draw_main(&app);
-      int ch = getch();
-      handle_main_key(&app, &running, ch);
-    } else if (app.screen == SCREEN_NEW) {
-      draw_new_editor(&app);
-      int ch = getch();
-      handle_new_key(&app, ch);
-    } else if (app.screen == SCREEN_HISTORY) {
-      draw_history(&app);
-      int ch = getch();
-      handle_history_key(&app, ch);
-    } else if (app.screen == SCREEN_HELP) {
-      draw_help();
-      int ch = getch();
-      if (ch == 27) {
-        app.screen = SCREEN_MAIN;
-      }
-    }
-  }
+  run_event_loop(&app);
 
   disable_extended_mouse_tracking();
   endwin();
 
   run_list_free(&app.runs);
+  history_hit_list_free(&app.history_search.hits);
+  wrap_cache_reset(&app.history_wrap);
+  free(app.history_detail_text);
+  wrap_cache_reset(&app.response_wrap);
+  close_diff(&app);
+  close_pager(&app);
+  close_tree(&app);
+  for (int i = 0; i < PANE_COUNT; i++) {
+    if (app.panes[i].win != NULL) {
+      delwin(app.panes[i].win);
+    }
+  }
   request_list_free(&app.requests);
-  free(app.visible_indices);
+  search_index_free(app.search);
+  template_set_free(app.templates);
+  free(app.fuzzy.matches);
+  free(app.visible_rows);
+  free(app.collections);
   clear_last_response(&app);
-  history_store_close(app.db);
+  request_watch_close(&app.watch);
+  request_store_close(&app.store);
+  history_writer_stop(app.history_writer);
+  history_store_close(&app.history);
   http_client_global_cleanup();
+  environment_free(&app.env);
   return 0;
 }
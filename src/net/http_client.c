@@ -1,16 +1,26 @@
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE /* mkstemp, mmap under -std=c11 */
+#endif
+
 #include "tuiman/http_client.h"
 
 #include <curl/curl.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <strings.h>
+#include <sys/mman.h>
+#include <unistd.h>
 
 #include "tuiman/keychain_macos.h"
 
 typedef struct {
   char *data;
   size_t len;
+  int fd; /* >= 0 once the body has been spilled; `data` is then NULL */
 } mem_buffer_t;
 
 static size_t write_callback(void *ptr, size_t size, size_t nmemb, void *userdata) {
@@ -30,6 +40,72 @@ static size_t write_callback(void *ptr, size_t size, size_t nmemb, void *userdat
   return chunk_size;
 }
 
+static int write_all(int fd, const char *data, size_t len) {
+  while (len > 0) {
+    ssize_t n = write(fd, data, len);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return -1;
+    }
+    data += n;
+    len -= (size_t)n;
+  }
+  return 0;
+}
+
+/* Moves what is buffered so far into an unlinked temp file; the rest of the body is appended there. */
+static int spill_start(mem_buffer_t *buffer) {
+  const char *dir = getenv("TMPDIR");
+  char path[4096];
+  snprintf(path, sizeof(path), "%s/tuiman-body-XXXXXX", dir != NULL && dir[0] != '\0' ? dir : "/tmp");
+  int fd = mkstemp(path);
+  if (fd < 0) {
+    return -1;
+  }
+  unlink(path);
+  fcntl(fd, F_SETFD, FD_CLOEXEC);
+  if (write_all(fd, buffer->data, buffer->len) != 0) {
+    close(fd);
+    return -1;
+  }
+  free(buffer->data);
+  buffer->data = NULL;
+  buffer->fd = fd;
+  return 0;
+}
+
+static size_t body_write_callback(void *ptr, size_t size, size_t nmemb, void *userdata) {
+  size_t chunk_size = size * nmemb;
+  mem_buffer_t *buffer = (mem_buffer_t *)userdata;
+  /* If the spill file cannot be created the body simply stays on the heap. */
+  if (buffer->fd < 0 && buffer->len + chunk_size > TUIMAN_HTTP_SPILL_BYTES) {
+    spill_start(buffer);
+  }
+  if (buffer->fd < 0) {
+    return write_callback(ptr, size, nmemb, userdata);
+  }
+  if (write_all(buffer->fd, ptr, chunk_size) != 0) {
+    return 0;
+  }
+  buffer->len += chunk_size;
+  return chunk_size;
+}
+
+/* Maps a finished spill file read-only, with one NUL written past the body so it stays a C string. */
+static int spill_map(mem_buffer_t *buffer, char **out) {
+  if (write_all(buffer->fd, "", 1) != 0) {
+    return -1;
+  }
+  void *map = mmap(NULL, buffer->len + 1, PROT_READ, MAP_PRIVATE, buffer->fd, 0);
+  if (map == MAP_FAILED) {
+    return -1;
+  }
+  *out = map;
+  return 0;
+}
+
 static int append_query_param(const char *url, const char *key, const char *value, char *out, size_t out_len) {
   const char *sep = strchr(url, '?') ? "&" : "?";
   char temp[TUIMAN_URL_LEN + TUIMAN_HEADER_KEY_LEN + TUIMAN_HEADER_VAL_LEN + 8];
@@ -52,11 +128,159 @@ static int is_jsonish_body(const char *body) {
   return *body == '{' || *body == '[';
 }
 
-static int has_content_type_header(const request_t *req) {
-  if (req->header_key[0] == '\0') {
+/*
+ * Prebuilt header chains. Formatting the header list and content-type lines
+ * happens once per request version; repeated sends reuse the same
+ * curl_slist. Secrets never go into it: the auth line is read from the
+ * Keychain on every send and linked in front of the chain (see auth_header).
+ * Chains are refcounted: the cache holds one reference and every transfer
+ * using the chain another, so replacing a slot never frees a list that an
+ * in-flight batch transfer still points at.
+ */
+#define HEADER_CACHE_SLOTS 64
+
+typedef struct {
+  struct curl_slist *list;
+  unsigned refs;
+} header_chain_t;
+
+typedef struct {
+  char request_id[TUIMAN_ID_LEN];
+  uint64_t fingerprint;
+  header_chain_t *chain;
+} header_cache_entry_t;
+
+static header_cache_entry_t header_cache[HEADER_CACHE_SLOTS];
+static size_t header_cache_next;
+
+static uint64_t fnv1a(uint64_t hash, const char *text) {
+  for (const unsigned char *p = (const unsigned char *)text; *p != '\0'; p++) {
+    hash ^= *p;
+    hash *= 1099511628211ULL;
+  }
+  /* Field separator so ("ab", "c") and ("a", "bc") differ. */
+  hash ^= 0xff;
+  hash *= 1099511628211ULL;
+  return hash;
+}
+
+static uint64_t header_fingerprint(const request_t *req) {
+  uint64_t hash = 1469598103934665603ULL;
+  hash = fnv1a(hash, req->headers);
+  hash = fnv1a(hash, req->updated_at);
+  hash = fnv1a(hash, req->body[0] != '\0' && is_jsonish_body(req->body) ? "json" : "");
+  return hash;
+}
+
+static struct curl_slist *build_header_chain(const request_t *req) {
+  struct curl_slist *headers = NULL;
+  const char *cursor = req->headers;
+  char name[TUIMAN_HEADER_KEY_LEN];
+  char value[TUIMAN_HEADER_VAL_LEN];
+  while (request_header_next(&cursor, name, sizeof(name), value, sizeof(value))) {
+    char line[TUIMAN_HEADER_KEY_LEN + TUIMAN_HEADER_VAL_LEN + 8];
+    snprintf(line, sizeof(line), "%s: %s", name, value);
+    headers = curl_slist_append(headers, line);
+  }
+
+  if (req->body[0] != '\0' && is_jsonish_body(req->body) && !request_header_has(req, "Content-Type")) {
+    headers = curl_slist_append(headers, "Content-Type: application/json");
+    headers = curl_slist_append(headers, "Accept: application/json");
+  }
+  return headers;
+}
+
+#define AUTH_LINE_LEN (TUIMAN_HEADER_KEY_LEN + 4096 + 16)
+
+/*
+ * The bearer or API-key header line of one send, in a heap buffer the
+ * transfer wipes when it is released (0 with *line NULL when there is none).
+ */
+static int auth_header(const request_t *req, char **line) {
+  *line = NULL;
+  const char *key_name = NULL;
+  const char *scheme = "";
+  if ((strcmp(req->auth_type, "bearer") == 0 || strcmp(req->auth_type, "jwt") == 0) &&
+      req->auth_secret_ref[0] != '\0') {
+    key_name = "Authorization";
+    scheme = "Bearer ";
+  } else if (strcmp(req->auth_type, "api_key") == 0 && req->auth_secret_ref[0] != '\0' &&
+             strcmp(req->auth_location[0] != '\0' ? req->auth_location : "header", "query") != 0) {
+    key_name = req->auth_key_name[0] != '\0' ? req->auth_key_name : "X-API-Key";
+  }
+  if (key_name == NULL) {
+    return 0;
+  }
+
+  char auth_secret[4096] = {0};
+  if (keychain_get_secret(req->auth_secret_ref, auth_secret, sizeof(auth_secret)) != 0) {
     return 0;
   }
-  return strcasecmp(req->header_key, "Content-Type") == 0;
+  *line = malloc(AUTH_LINE_LEN);
+  if (*line != NULL) {
+    snprintf(*line, AUTH_LINE_LEN, "%s: %s%s", key_name, scheme, auth_secret);
+  }
+  memset(auth_secret, 0, sizeof(auth_secret));
+  return *line != NULL ? 0 : -1;
+}
+
+static header_chain_t *chain_new(const request_t *req) {
+  header_chain_t *chain = calloc(1, sizeof(*chain));
+  if (chain != NULL) {
+    chain->list = build_header_chain(req);
+    chain->refs = 1;
+  }
+  return chain;
+}
+
+static void chain_release(header_chain_t *chain) {
+  if (chain != NULL && --chain->refs == 0) {
+    curl_slist_free_all(chain->list);
+    free(chain);
+  }
+}
+
+/* A reference to the chain for `req`, built only when its headers changed. NULL when out of memory. */
+static header_chain_t *acquire_header_chain(const request_t *req) {
+  if (req->id[0] == '\0') {
+    return chain_new(req);
+  }
+  uint64_t fingerprint = header_fingerprint(req);
+  header_cache_entry_t *slot = NULL;
+  for (size_t i = 0; i < HEADER_CACHE_SLOTS; i++) {
+    if (strcmp(header_cache[i].request_id, req->id) == 0) {
+      if (header_cache[i].fingerprint == fingerprint) {
+        header_cache[i].chain->refs++;
+        return header_cache[i].chain;
+      }
+      slot = &header_cache[i];
+      break;
+    }
+  }
+  if (slot == NULL) {
+    slot = &header_cache[header_cache_next];
+    header_cache_next = (header_cache_next + 1) % HEADER_CACHE_SLOTS;
+  }
+
+  header_chain_t *chain = chain_new(req);
+  if (chain == NULL) {
+    return NULL;
+  }
+  chain_release(slot->chain);
+  snprintf(slot->request_id, sizeof(slot->request_id), "%s", req->id);
+  slot->fingerprint = fingerprint;
+  slot->chain = chain;
+  chain->refs++;
+  return chain;
+}
+
+void http_client_forget_request(const char *request_id) {
+  for (size_t i = 0; i < HEADER_CACHE_SLOTS; i++) {
+    if (strcmp(header_cache[i].request_id, request_id) == 0) {
+      chain_release(header_cache[i].chain);
+      memset(&header_cache[i], 0, sizeof(header_cache[i]));
+    }
+  }
 }
 
 int http_client_global_init(void) {
@@ -64,112 +288,302 @@ int http_client_global_init(void) {
 }
 
 void http_client_global_cleanup(void) {
+  for (size_t i = 0; i < HEADER_CACHE_SLOTS; i++) {
+    chain_release(header_cache[i].chain);
+  }
+  memset(header_cache, 0, sizeof(header_cache));
   curl_global_cleanup();
 }
 
-int http_send_request(const request_t *req, http_response_t *out) {
-  memset(out, 0, sizeof(*out));
-  out->status_code = 0;
+/* One in-flight transfer. curl keeps pointers into `req` (POSTFIELDS), so it must outlive the handle. */
+typedef struct {
+  CURL *curl;
+  const request_t *req;
+  header_chain_t *headers; /* one reference, dropped on release */
+  struct curl_slist auth_node; /* this send's auth line, linked in front of `headers` */
+  char *auth_line;
+  mem_buffer_t body;
+  mem_buffer_t head;
+} transfer_t;
+
+/* Keeps only the final response's header block when redirects are followed. */
+static size_t header_callback(char *ptr, size_t size, size_t nmemb, void *userdata) {
+  mem_buffer_t *buffer = (mem_buffer_t *)userdata;
+  size_t chunk_size = size * nmemb;
+  if (chunk_size >= 5 && strncmp(ptr, "HTTP/", 5) == 0) {
+    buffer->len = 0;
+    buffer->data[0] = '\0';
+  }
+  return write_callback(ptr, size, nmemb, userdata);
+}
 
-  CURL *curl = curl_easy_init();
-  if (curl == NULL) {
-    snprintf(out->error, sizeof(out->error), "failed to initialize libcurl");
+static void transfer_release(transfer_t *t) {
+  if (t->curl != NULL) {
+    curl_easy_cleanup(t->curl);
+  }
+  chain_release(t->headers);
+  if (t->auth_line != NULL) {
+    memset(t->auth_line, 0, AUTH_LINE_LEN);
+    free(t->auth_line);
+  }
+  if (t->body.fd >= 0) {
+    close(t->body.fd);
+  }
+  free(t->body.data);
+  free(t->head.data);
+  memset(t, 0, sizeof(*t));
+  t->body.fd = -1;
+  t->head.fd = -1;
+}
+
+static int transfer_prepare(transfer_t *t, const request_t *req, char *error, size_t error_len) {
+  memset(t, 0, sizeof(*t));
+  t->body.fd = -1;
+  t->head.fd = -1;
+  t->req = req;
+  t->curl = curl_easy_init();
+  if (t->curl == NULL) {
+    snprintf(error, error_len, "failed to initialize libcurl");
     return -1;
   }
 
   char url_buffer[TUIMAN_URL_LEN + TUIMAN_HEADER_KEY_LEN + TUIMAN_HEADER_VAL_LEN + 8];
   snprintf(url_buffer, sizeof(url_buffer), "%s", req->url);
 
-  struct curl_slist *headers = NULL;
-  char auth_secret[4096] = {0};
-
-  if (req->header_key[0] != '\0') {
-    char line[TUIMAN_HEADER_KEY_LEN + TUIMAN_HEADER_VAL_LEN + 8];
-    snprintf(line, sizeof(line), "%s: %s", req->header_key, req->header_value);
-    headers = curl_slist_append(headers, line);
-  }
-
-  if (req->body[0] != '\0' && is_jsonish_body(req->body) && !has_content_type_header(req)) {
-    headers = curl_slist_append(headers, "Content-Type: application/json");
-    headers = curl_slist_append(headers, "Accept: application/json");
+  t->headers = acquire_header_chain(req);
+  if (t->headers == NULL || auth_header(req, &t->auth_line) != 0) {
+    transfer_release(t);
+    snprintf(error, error_len, "out of memory");
+    return -1;
   }
+  char auth_secret[4096] = {0};
 
-  if ((strcmp(req->auth_type, "bearer") == 0 || strcmp(req->auth_type, "jwt") == 0) &&
-      req->auth_secret_ref[0] != '\0') {
-    if (keychain_get_secret(req->auth_secret_ref, auth_secret, sizeof(auth_secret)) == 0) {
-      char auth_line[4200];
-      snprintf(auth_line, sizeof(auth_line), "Authorization: Bearer %s", auth_secret);
-      headers = curl_slist_append(headers, auth_line);
-    }
-  } else if (strcmp(req->auth_type, "api_key") == 0 && req->auth_secret_ref[0] != '\0') {
+  if (strcmp(req->auth_type, "api_key") == 0 && req->auth_secret_ref[0] != '\0' &&
+      strcmp(req->auth_location, "query") == 0) {
     if (keychain_get_secret(req->auth_secret_ref, auth_secret, sizeof(auth_secret)) == 0) {
       const char *key_name = req->auth_key_name[0] != '\0' ? req->auth_key_name : "X-API-Key";
-      const char *location = req->auth_location[0] != '\0' ? req->auth_location : "header";
-      if (strcmp(location, "query") == 0) {
-        append_query_param(url_buffer, key_name, auth_secret, url_buffer, sizeof(url_buffer));
-      } else {
-        char header_line[4200];
-        snprintf(header_line, sizeof(header_line), "%s: %s", key_name, auth_secret);
-        headers = curl_slist_append(headers, header_line);
-      }
+      append_query_param(url_buffer, key_name, auth_secret, url_buffer, sizeof(url_buffer));
     }
   } else if (strcmp(req->auth_type, "basic") == 0 && req->auth_secret_ref[0] != '\0') {
     if (keychain_get_secret(req->auth_secret_ref, auth_secret, sizeof(auth_secret)) == 0) {
-      curl_easy_setopt(curl, CURLOPT_HTTPAUTH, CURLAUTH_BASIC);
-      curl_easy_setopt(curl, CURLOPT_USERNAME, req->auth_username);
-      curl_easy_setopt(curl, CURLOPT_PASSWORD, auth_secret);
+      curl_easy_setopt(t->curl, CURLOPT_HTTPAUTH, CURLAUTH_BASIC);
+      curl_easy_setopt(t->curl, CURLOPT_USERNAME, req->auth_username);
+      curl_easy_setopt(t->curl, CURLOPT_PASSWORD, auth_secret);
     }
   }
 
-  mem_buffer_t response = {.data = malloc(1), .len = 0};
-  if (response.data == NULL) {
-    curl_easy_cleanup(curl);
-    curl_slist_free_all(headers);
-    snprintf(out->error, sizeof(out->error), "out of memory");
+  t->body.data = malloc(1);
+  t->head.data = malloc(1);
+  if (t->body.data == NULL || t->head.data == NULL) {
+    memset(auth_secret, 0, sizeof(auth_secret));
+    transfer_release(t);
+    snprintf(error, error_len, "out of memory");
     return -1;
   }
-  response.data[0] = '\0';
+  t->body.data[0] = '\0';
+  t->head.data[0] = '\0';
 
-  curl_easy_setopt(curl, CURLOPT_URL, url_buffer);
-  curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
-  curl_easy_setopt(curl, CURLOPT_TIMEOUT, 30L);
-  curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
-  curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
-  curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, req->method);
+  /* String options are copied by libcurl, so the stack buffers may go away after this. */
+  curl_easy_setopt(t->curl, CURLOPT_URL, url_buffer);
+  curl_easy_setopt(t->curl, CURLOPT_FOLLOWLOCATION, 1L);
+  curl_easy_setopt(t->curl, CURLOPT_TIMEOUT, 30L);
+  curl_easy_setopt(t->curl, CURLOPT_WRITEFUNCTION, body_write_callback);
+  curl_easy_setopt(t->curl, CURLOPT_WRITEDATA, &t->body);
+  curl_easy_setopt(t->curl, CURLOPT_HEADERFUNCTION, header_callback);
+  curl_easy_setopt(t->curl, CURLOPT_HEADERDATA, &t->head);
+  curl_easy_setopt(t->curl, CURLOPT_CUSTOMREQUEST, req->method);
+  curl_easy_setopt(t->curl, CURLOPT_PRIVATE, t);
+  memset(auth_secret, 0, sizeof(auth_secret));
 
-  if (headers != NULL) {
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+  if (t->auth_line != NULL) {
+    t->auth_node.data = t->auth_line;
+    t->auth_node.next = t->headers->list;
+    curl_easy_setopt(t->curl, CURLOPT_HTTPHEADER, &t->auth_node);
+  } else if (t->headers->list != NULL) {
+    curl_easy_setopt(t->curl, CURLOPT_HTTPHEADER, t->headers->list);
   }
 
   if (req->body[0] != '\0') {
-    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, req->body);
-    curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, (long)strlen(req->body));
+    curl_easy_setopt(t->curl, CURLOPT_POSTFIELDS, req->body);
+    curl_easy_setopt(t->curl, CURLOPT_POSTFIELDSIZE, (long)strlen(req->body));
   }
+  return 0;
+}
 
-  CURLcode rc = curl_easy_perform(curl);
+/* Moves the buffers into `out` and releases the handle. */
+static int transfer_finish(transfer_t *t, CURLcode rc, http_response_t *out) {
   if (rc != CURLE_OK) {
     snprintf(out->error, sizeof(out->error), "%s", curl_easy_strerror(rc));
   }
 
-  curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &out->status_code);
+  curl_easy_getinfo(t->curl, CURLINFO_RESPONSE_CODE, &out->status_code);
   double total_seconds = 0.0;
-  curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME, &total_seconds);
+  curl_easy_getinfo(t->curl, CURLINFO_TOTAL_TIME, &total_seconds);
   out->duration_ms = (long)(total_seconds * 1000.0);
 
-  out->body = response.data;
-  out->body_len = response.len;
-
-  curl_slist_free_all(headers);
-  curl_easy_cleanup(curl);
+  out->body = t->body.data;
+  out->body_len = t->body.len;
+  out->body_fd = -1;
+  if (t->body.fd >= 0) {
+    if (spill_map(&t->body, &out->body) == 0) {
+      out->body_spilled = 1;
+      out->body_fd = t->body.fd;
+      t->body.fd = -1;
+    } else {
+      out->body = calloc(1, 1);
+      out->body_len = 0;
+      snprintf(out->error, sizeof(out->error), "could not map spilled response body: %s", strerror(errno));
+      rc = rc == CURLE_OK ? CURLE_WRITE_ERROR : rc;
+    }
+  }
+  out->headers = t->head.data;
+  out->headers_len = t->head.len;
+  t->body.data = NULL;
+  t->head.data = NULL;
 
+  transfer_release(t);
   return rc == CURLE_OK ? 0 : -1;
 }
 
+int http_send_request(const request_t *req, http_response_t *out) {
+  memset(out, 0, sizeof(*out));
+  out->body_fd = -1;
+  out->status_code = 0;
+
+  transfer_t t;
+  if (transfer_prepare(&t, req, out->error, sizeof(out->error)) != 0) {
+    return -1;
+  }
+  CURLcode rc = curl_easy_perform(t.curl);
+  return transfer_finish(&t, rc, out);
+}
+
+typedef struct batch_item {
+  transfer_t transfer; /* first, so CURLINFO_PRIVATE maps back to the item */
+  request_t req;
+  void *tag;
+  struct batch_item *next;
+} batch_item_t;
+
+struct http_batch {
+  CURLM *multi;
+  batch_item_t *items;
+  size_t pending;
+};
+
+http_batch_t *http_batch_new(void) {
+  http_batch_t *batch = calloc(1, sizeof(*batch));
+  if (batch == NULL) {
+    return NULL;
+  }
+  batch->multi = curl_multi_init();
+  if (batch->multi == NULL) {
+    free(batch);
+    return NULL;
+  }
+  return batch;
+}
+
+int http_batch_add(http_batch_t *batch, const request_t *req, void *tag) {
+  batch_item_t *item = malloc(sizeof(*item));
+  if (item == NULL) {
+    return -1;
+  }
+  item->req = *req;
+  item->tag = tag;
+  char error[256];
+  if (transfer_prepare(&item->transfer, &item->req, error, sizeof(error)) != 0) {
+    free(item);
+    return -1;
+  }
+  if (curl_multi_add_handle(batch->multi, item->transfer.curl) != CURLM_OK) {
+    transfer_release(&item->transfer);
+    free(item);
+    return -1;
+  }
+  item->next = batch->items;
+  batch->items = item;
+  batch->pending++;
+  return 0;
+}
+
+size_t http_batch_pending(const http_batch_t *batch) {
+  return batch->pending;
+}
+
+int http_batch_next(http_batch_t *batch, long timeout_ms, http_response_t *out, void **tag) {
+  memset(out, 0, sizeof(*out));
+  out->body_fd = -1;
+  *tag = NULL;
+
+  for (int pass = 0; pass < 2; pass++) {
+    int running = 0;
+    if (curl_multi_perform(batch->multi, &running) != CURLM_OK) {
+      return -1;
+    }
+
+    int queued = 0;
+    CURLMsg *msg = NULL;
+    while ((msg = curl_multi_info_read(batch->multi, &queued)) != NULL) {
+      if (msg->msg != CURLMSG_DONE) {
+        continue;
+      }
+      CURL *easy = msg->easy_handle;
+      CURLcode rc = msg->data.result;
+      transfer_t *t = NULL;
+      curl_easy_getinfo(easy, CURLINFO_PRIVATE, (char **)&t);
+      curl_multi_remove_handle(batch->multi, easy);
+      batch_item_t *item = (batch_item_t *)t;
+      for (batch_item_t **link = &batch->items; *link != NULL; link = &(*link)->next) {
+        if (*link == item) {
+          *link = item->next;
+          break;
+        }
+      }
+      *tag = item->tag;
+      transfer_finish(t, rc, out);
+      free(item);
+      batch->pending--;
+      return 1;
+    }
+
+    if (pass == 0 && running > 0 && timeout_ms > 0) {
+      curl_multi_poll(batch->multi, NULL, 0, (int)timeout_ms, NULL);
+    }
+  }
+  return 0;
+}
+
+void http_batch_free(http_batch_t *batch) {
+  if (batch == NULL) {
+    return;
+  }
+  while (batch->items != NULL) {
+    batch_item_t *item = batch->items;
+    batch->items = item->next;
+    curl_multi_remove_handle(batch->multi, item->transfer.curl);
+    transfer_release(&item->transfer);
+    free(item);
+  }
+  curl_multi_cleanup(batch->multi);
+  free(batch);
+}
+
 void http_response_free(http_response_t *response) {
   if (response == NULL) {
     return;
   }
-  free(response->body);
+  if (response->body_spilled) {
+    munmap(response->body, response->body_len + 1);
+    close(response->body_fd);
+  } else {
+    free(response->body);
+  }
+  free(response->headers);
   response->body = NULL;
   response->body_len = 0;
+  response->body_spilled = 0;
+  response->body_fd = -1;
+  response->headers = NULL;
+  response->headers_len = 0;
 }
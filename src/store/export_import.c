@@ -72,6 +72,8 @@ int export_requests(const app_paths_t *paths, const request_list_t *requests, co
     return -1;
   }
 
+  /* Collections become subfolders; the list is in catalog order so each folder is created once. */
+  const char *made_collection = "";
   for (size_t i = 0; i < requests->len; i++) {
     request_t copy = requests->items[i];
     if (copy.auth_secret_ref[0] != '\0' && report != NULL) {
@@ -79,11 +81,24 @@ int export_requests(const app_paths_t *paths, const request_list_t *requests, co
     }
     copy.auth_secret_ref[0] = '\0';
 
+    char collection_dir[PATH_MAX];
+    if (copy.collection[0] == '\0') {
+      snprintf(collection_dir, sizeof(collection_dir), "%s", req_dir);
+    } else if (snprintf(collection_dir, sizeof(collection_dir), "%s/%s", req_dir, copy.collection) < 0) {
+      return -1;
+    }
+    if (strcmp(made_collection, requests->items[i].collection) != 0) {
+      if (ensure_dir(collection_dir) != 0) {
+        return -1;
+      }
+      made_collection = requests->items[i].collection;
+    }
+
     char file_path[PATH_MAX];
-    if (snprintf(file_path, sizeof(file_path), "%s/%s.json", req_dir, copy.id) < 0) {
+    if (snprintf(file_path, sizeof(file_path), "%s/%s.json", collection_dir, copy.id) < 0) {
       return -1;
     }
-    if (request_store_write_file(file_path, &copy) != 0) {
+    if (request_store_write_file(file_path, &copy, REQUEST_WRITE_PLAIN) != 0) {
       return -1;
     }
 
@@ -117,42 +132,102 @@ int export_requests(const app_paths_t *paths, const request_list_t *requests, co
   return 0;
 }
 
-int import_requests(const app_paths_t *paths, const char *source_dir, size_t *imported_count) {
-  if (imported_count != NULL) {
-    *imported_count = 0;
+#define IMPORT_BATCH 256
+
+typedef struct {
+  request_store_t *store;
+  request_t *batch;
+  size_t batch_len;
+  size_t imported;
+} import_state_t;
+
+static void import_flush(import_state_t *state) {
+  if (state->batch_len == 0) {
+    return;
   }
+  size_t saved = 0;
+  request_store_save_many(state->store, state->batch, state->batch_len, &saved);
+  state->imported += saved;
+  state->batch_len = 0;
+}
 
-  char req_dir[PATH_MAX];
-  if (snprintf(req_dir, sizeof(req_dir), "%s/requests", source_dir) < 0) {
+static int import_collection(import_state_t *state, const char *req_dir, const char *collection) {
+  char dir_path[PATH_MAX];
+  if (collection[0] == '\0') {
+    snprintf(dir_path, sizeof(dir_path), "%s", req_dir);
+  } else if (snprintf(dir_path, sizeof(dir_path), "%s/%s", req_dir, collection) < 0) {
     return -1;
   }
 
-  DIR *dir = opendir(req_dir);
+  DIR *dir = opendir(dir_path);
   if (dir == NULL) {
     return -1;
   }
 
   struct dirent *entry = NULL;
   while ((entry = readdir(dir)) != NULL) {
-    if (!has_json_suffix(entry->d_name)) {
+    if (entry->d_name[0] == '.') {
       continue;
     }
 
     char src_path[PATH_MAX];
-    if (snprintf(src_path, sizeof(src_path), "%s/%s", req_dir, entry->d_name) < 0) {
+    if (snprintf(src_path, sizeof(src_path), "%s/%s", dir_path, entry->d_name) < 0) {
       continue;
     }
 
-    request_t req;
-    if (request_store_read_file(src_path, &req) != 0) {
+    if (!has_json_suffix(entry->d_name)) {
+      struct stat st;
+      if (stat(src_path, &st) != 0 || !S_ISDIR(st.st_mode)) {
+        continue;
+      }
+      char child[TUIMAN_COLLECTION_LEN];
+      int wrote = collection[0] == '\0' ? snprintf(child, sizeof(child), "%s", entry->d_name)
+                                        : snprintf(child, sizeof(child), "%s/%s", collection, entry->d_name);
+      if (wrote > 0 && (size_t)wrote < sizeof(child)) {
+        import_collection(state, req_dir, child);
+      }
       continue;
     }
 
-    if (request_store_save(paths, &req) == 0 && imported_count != NULL) {
-      (*imported_count)++;
+    request_t *req = &state->batch[state->batch_len];
+    if (request_store_read_file(src_path, req) != 0) {
+      continue;
+    }
+    snprintf(req->collection, sizeof(req->collection), "%s", collection);
+
+    state->batch_len++;
+    if (state->batch_len == IMPORT_BATCH) {
+      import_flush(state);
     }
   }
 
   closedir(dir);
   return 0;
 }
+
+int import_requests(request_store_t *store, const char *source_dir, size_t *imported_count) {
+  if (imported_count != NULL) {
+    *imported_count = 0;
+  }
+
+  char req_dir[PATH_MAX];
+  if (snprintf(req_dir, sizeof(req_dir), "%s/requests", source_dir) < 0) {
+    return -1;
+  }
+
+  import_state_t state = {0};
+  state.store = store;
+  state.batch = malloc(IMPORT_BATCH * sizeof(request_t));
+  if (state.batch == NULL) {
+    return -1;
+  }
+
+  int rc = import_collection(&state, req_dir, "");
+  import_flush(&state);
+
+  free(state.batch);
+  if (imported_count != NULL) {
+    *imported_count = state.imported;
+  }
+  return rc;
+}
@@ -1,8 +1,18 @@
 #include "tuiman/history_store.h"
 
+#include <ctype.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include "tuiman/sha256.h"
+#include "tuiman/sqlite_setup.h"
 
 static const char *SCHEMA_SQL =
     "CREATE TABLE IF NOT EXISTS runs ("
@@ -17,8 +27,45 @@ static const char *SCHEMA_SQL =
     "created_at TEXT NOT NULL,"
     "request_snapshot TEXT,"
     "response_body TEXT"
+    ");"
+    /* Response bodies, one row per distinct content; runs point at them by hash. */
+    "CREATE TABLE IF NOT EXISTS bodies ("
+    "id INTEGER PRIMARY KEY,"
+    "hash TEXT NOT NULL UNIQUE,"
+    "size INTEGER NOT NULL,"
+    "codec INTEGER NOT NULL,"
+    "data BLOB NOT NULL"
+    ");"
+    "CREATE TABLE IF NOT EXISTS meta ("
+    "key TEXT PRIMARY KEY,"
+    "value INTEGER NOT NULL"
     ");";
 
+/*
+ * Search index: run metadata is kept in step with `runs` by triggers. Bodies
+ * go into a contentless table (no second, uncompressed copy) written by
+ * store_body; bodies.fts marks the rows it holds, since removing a row from a
+ * contentless index means replaying its exact text.
+ */
+static const char *SEARCH_SCHEMA_SQL =
+    "CREATE VIRTUAL TABLE IF NOT EXISTS runs_fts USING fts5(request_name, url, error);"
+    "CREATE TRIGGER IF NOT EXISTS runs_fts_insert AFTER INSERT ON runs BEGIN "
+    "INSERT INTO runs_fts (rowid, request_name, url, error) "
+    "VALUES (new.id, new.request_name, new.url, coalesce(new.error, '')); END;"
+    "CREATE TRIGGER IF NOT EXISTS runs_fts_delete AFTER DELETE ON runs BEGIN "
+    "DELETE FROM runs_fts WHERE rowid = old.id; END;"
+    "CREATE VIRTUAL TABLE IF NOT EXISTS bodies_fts USING fts5(body, content='');";
+
+/* Only the head of a body is indexed; the cap must be identical when a row is removed again. */
+#define FTS_BODY_MAX (64 * 1024)
+#define FTS_BACKFILL_BATCH 2000
+
+enum { BODY_CODEC_RAW = 0, BODY_CODEC_ZLIB = 1 };
+/* Below this, zlib's header overhead eats most of the gain. */
+#define BODY_COMPRESS_MIN 64
+/* Large bodies are deflated and written this many bytes at a time, never copied whole. */
+#define BODY_CHUNK (1024 * 1024)
+
 static int exec_sql_allow_duplicate_column(sqlite3 *db, const char *sql) {
   char *errmsg = NULL;
   int rc = sqlite3_exec(db, sql, NULL, NULL, &errmsg);
@@ -35,139 +82,1321 @@ static int exec_sql_allow_duplicate_column(sqlite3 *db, const char *sql) {
   return duplicate_column ? 0 : -1;
 }
 
-int history_store_open(const char *db_path, sqlite3 **out_db) {
-  if (sqlite3_open(db_path, out_db) != SQLITE_OK) {
-    return -1;
-  }
+/* created_epoch is derived from the ISO created_at (?8) so callers only supply one timestamp. */
+static const char *INSERT_SQL = "INSERT INTO runs "
+                                "(request_id, request_name, method, url, status_code, duration_ms, error, created_at, "
+                                "request_snapshot, body_hash, created_epoch)"
+                                " VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, CAST(strftime('%s', ?8) AS INTEGER));";
+/* Keyset page over the rowid: no OFFSET scan, and stable while new runs are appended. */
+static const char *LIST_SQL = "SELECT id, request_id, request_name, method, url, status_code, duration_ms, error, "
+                              "created_at, body_hash FROM runs WHERE id < ? ORDER BY id DESC LIMIT ?;";
+static const char *BODY_FIND_SQL = "SELECT id, codec, size FROM bodies WHERE hash = ?;";
+static const char *BODY_INSERT_SQL = "INSERT INTO bodies (hash, size, codec, data) VALUES (?, ?, ?, ?);";
+/* Runs recorded before content-addressed bodies still carry the text inline. */
+static const char *LEGACY_NEXT_SQL = "SELECT id, response_body FROM runs WHERE id > ? AND body_hash IS NULL "
+                                     "AND response_body IS NOT NULL ORDER BY id LIMIT 1;";
+static const char *LEGACY_UPDATE_SQL = "UPDATE runs SET body_hash = ?, response_body = NULL WHERE id = ?;";
+/* Served by the runs_request_time index: one range scan, already in time order. */
+static const char *LATENCY_SQL = "SELECT duration_ms, status_code, error FROM runs "
+                                 "WHERE request_id = ? AND created_epoch >= ? ORDER BY created_epoch, id;";
+
+#define RUN_COLUMNS                                                                                          \
+  "runs.id, runs.request_id, runs.request_name, runs.method, runs.url, runs.status_code, runs.duration_ms, " \
+  "runs.error, runs.created_at, runs.body_hash"
+
+/* Name and URL weigh more than error text. */
+static const char *SEARCH_RUNS_SQL = "SELECT " RUN_COLUMNS ", snippet(runs_fts, -1, '[', ']', '...', 12), "
+                                     "bm25(runs_fts, 4.0, 2.0, 1.0) AS score "
+                                     "FROM runs_fts JOIN runs ON runs.id = runs_fts.rowid WHERE runs_fts MATCH ? "
+                                     "ORDER BY score LIMIT ?;";
+static const char *SEARCH_BODIES_SQL = "SELECT " RUN_COLUMNS ", bm25(bodies_fts) AS score "
+                                       "FROM bodies_fts JOIN bodies ON bodies.id = bodies_fts.rowid "
+                                       "JOIN runs ON runs.body_hash = bodies.hash WHERE bodies_fts MATCH ? "
+                                       "ORDER BY score, runs.id DESC LIMIT ?;";
+
+static const char *FTS_ADD_SQL = "INSERT INTO bodies_fts (rowid, body) VALUES (?, ?);";
+static const char *FTS_REMOVE_SQL = "INSERT INTO bodies_fts (bodies_fts, rowid, body) VALUES ('delete', ?, ?);";
+static const char *FTS_MARK_SQL = "UPDATE bodies SET fts = ? WHERE id = ?;";
+static const char *BODY_DROP_SQL = "DELETE FROM bodies WHERE id = ?;";
+static const char *ORPHAN_INDEXED_SQL = "SELECT id, hash FROM bodies WHERE fts = 1 AND "
+                                        "NOT EXISTS (SELECT 1 FROM runs WHERE runs.body_hash = bodies.hash);";
+static const char *DELETE_AGED_SQL = "DELETE FROM runs WHERE id IN (SELECT id FROM runs WHERE created_epoch < "
+                                     "CAST(strftime('%s', 'now', ?) AS INTEGER) ORDER BY id LIMIT ?);";
+static const char *DELETE_OLDEST_SQL = "DELETE FROM runs WHERE id IN (SELECT id FROM runs ORDER BY id LIMIT ?);";
+static const char *CROWDED_REQUESTS_SQL = "SELECT request_id FROM runs GROUP BY request_id HAVING count(*) > ?;";
+static const char *TRIM_REQUEST_SQL = "DELETE FROM runs WHERE id IN (SELECT id FROM runs "
+                                      "WHERE request_id = ?1 AND id <= (SELECT id FROM runs WHERE request_id = ?1 "
+                                      "ORDER BY id DESC LIMIT -1 OFFSET ?2) "
+                                      "ORDER BY id LIMIT ?3);";
+static const char *META_ADD_SQL = "INSERT INTO meta (key, value) VALUES (?, ?) "
+                                  "ON CONFLICT(key) DO UPDATE SET value = value + excluded.value;";
+static const char *EPOCH_BACKFILL_SQL = "UPDATE runs SET created_epoch = CAST(strftime('%s', created_at) AS INTEGER) "
+                                        "WHERE id > ?1 AND id <= ?1 + ?2 AND created_epoch IS NULL;";
+static const char *FTS_BACKFILL_SQL = "INSERT INTO runs_fts (rowid, request_name, url, error) "
+                                      "SELECT id, request_name, url, coalesce(error, '') FROM runs "
+                                      "WHERE id > ?1 - ?2 AND id <= ?1;";
+
 
+static int exec_sql(sqlite3 *db, const char *sql) {
   char *errmsg = NULL;
-  if (sqlite3_exec(*out_db, SCHEMA_SQL, NULL, NULL, &errmsg) != SQLITE_OK) {
-    sqlite3_free(errmsg);
-    sqlite3_close(*out_db);
-    *out_db = NULL;
+  int rc = sqlite3_exec(db, sql, NULL, NULL, &errmsg);
+  sqlite3_free(errmsg);
+  return rc == SQLITE_OK ? 0 : -1;
+}
+
+static sqlite3_int64 query_int(sqlite3 *db, const char *sql) {
+  sqlite3_stmt *stmt = NULL;
+  sqlite3_int64 value = 0;
+  if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) == SQLITE_OK && sqlite3_step(stmt) == SQLITE_ROW) {
+    value = sqlite3_column_int64(stmt, 0);
+  }
+  sqlite3_finalize(stmt);
+  return value;
+}
+
+/* The shared WAL setup (sqlite_setup.h) plus history's own tuning. */
+static int configure_connection(sqlite3 *db, const history_store_options_t *options) {
+  long long mmap_size = TUIMAN_HISTORY_MMAP_SIZE_DEFAULT;
+  int cache_kib = TUIMAN_HISTORY_CACHE_KIB_DEFAULT;
+  int busy_ms = TUIMAN_HISTORY_BUSY_TIMEOUT_DEFAULT;
+  if (options != NULL) {
+    if (options->mmap_size != 0) {
+      mmap_size = options->mmap_size > 0 ? options->mmap_size : 0;
+    }
+    if (options->cache_size_kib > 0) {
+      cache_kib = options->cache_size_kib;
+    }
+    if (options->busy_timeout_ms > 0) {
+      busy_ms = options->busy_timeout_ms;
+    }
+  }
+
+  /* auto_vacuum only takes effect on a new file, so it goes before anything that could create one. */
+  if (exec_sql(db, "PRAGMA auto_vacuum = INCREMENTAL;") != 0 || sqlite_setup_connection(db, busy_ms) != 0) {
     return -1;
   }
+  char pragmas[128];
+  snprintf(pragmas, sizeof(pragmas),
+           "PRAGMA mmap_size = %lld;"
+           "PRAGMA cache_size = -%d;",
+           mmap_size, cache_kib);
+  return exec_sql(db, pragmas);
+}
 
-  if (exec_sql_allow_duplicate_column(*out_db, "ALTER TABLE runs ADD COLUMN request_snapshot TEXT;") != 0) {
-    sqlite3_close(*out_db);
-    *out_db = NULL;
+/* Creates the search index; runs recorded before it existed are queued for the writer to backfill. */
+static int ensure_search_index(sqlite3 *db) {
+  bool created = query_int(db, "SELECT count(*) FROM sqlite_master WHERE name = 'runs_fts';") == 0;
+  if (exec_sql(db, SEARCH_SCHEMA_SQL) != 0 ||
+      exec_sql_allow_duplicate_column(db, "ALTER TABLE bodies ADD COLUMN fts INTEGER NOT NULL DEFAULT 0;") != 0) {
     return -1;
   }
-  if (exec_sql_allow_duplicate_column(*out_db, "ALTER TABLE runs ADD COLUMN response_body TEXT;") != 0) {
-    sqlite3_close(*out_db);
-    *out_db = NULL;
+  if (created) {
+    return exec_sql(db, "INSERT OR REPLACE INTO meta (key, value) "
+                        "SELECT 'fts_backfill', max(id) FROM runs HAVING max(id) IS NOT NULL;");
+  }
+  return 0;
+}
+
+int history_store_open(const char *db_path, const history_store_options_t *options, history_store_t *out) {
+  memset(out, 0, sizeof(*out));
+  if (sqlite3_open(db_path, &out->db) != SQLITE_OK || configure_connection(out->db, options) != 0 ||
+      exec_sql(out->db, SCHEMA_SQL) != 0 || ensure_search_index(out->db) != 0 ||
+      exec_sql_allow_duplicate_column(out->db, "ALTER TABLE runs ADD COLUMN request_snapshot TEXT;") != 0 ||
+      exec_sql_allow_duplicate_column(out->db, "ALTER TABLE runs ADD COLUMN response_body TEXT;") != 0 ||
+      exec_sql_allow_duplicate_column(out->db, "ALTER TABLE runs ADD COLUMN body_hash TEXT;") != 0 ||
+      exec_sql_allow_duplicate_column(out->db, "ALTER TABLE runs ADD COLUMN created_epoch INTEGER;") != 0 ||
+      exec_sql(out->db, "CREATE INDEX IF NOT EXISTS runs_body_hash ON runs(body_hash);") != 0 ||
+      exec_sql(out->db, "CREATE INDEX IF NOT EXISTS runs_request ON runs(request_id, id);") != 0 ||
+      exec_sql(out->db, "CREATE INDEX IF NOT EXISTS runs_request_time ON runs(request_id, created_epoch);") != 0 ||
+      sqlite3_prepare_v2(out->db, INSERT_SQL, -1, &out->insert_stmt, NULL) != SQLITE_OK ||
+      sqlite3_prepare_v2(out->db, LIST_SQL, -1, &out->list_stmt, NULL) != SQLITE_OK ||
+      sqlite3_prepare_v2(out->db, BODY_FIND_SQL, -1, &out->body_find_stmt, NULL) != SQLITE_OK ||
+      sqlite3_prepare_v2(out->db, BODY_INSERT_SQL, -1, &out->body_insert_stmt, NULL) != SQLITE_OK ||
+      sqlite3_prepare_v2(out->db, LEGACY_NEXT_SQL, -1, &out->legacy_next_stmt, NULL) != SQLITE_OK ||
+      sqlite3_prepare_v2(out->db, LEGACY_UPDATE_SQL, -1, &out->legacy_update_stmt, NULL) != SQLITE_OK ||
+      sqlite3_prepare_v2(out->db, LATENCY_SQL, -1, &out->latency_stmt, NULL) != SQLITE_OK ||
+      sqlite3_prepare_v2(out->db, SEARCH_RUNS_SQL, -1, &out->search_runs_stmt, NULL) != SQLITE_OK ||
+      sqlite3_prepare_v2(out->db, SEARCH_BODIES_SQL, -1, &out->search_bodies_stmt, NULL) != SQLITE_OK ||
+      sqlite3_prepare_v2(out->db, FTS_ADD_SQL, -1, &out->fts_add_stmt, NULL) != SQLITE_OK ||
+      sqlite3_prepare_v2(out->db, FTS_REMOVE_SQL, -1, &out->fts_remove_stmt, NULL) != SQLITE_OK ||
+      sqlite3_prepare_v2(out->db, FTS_MARK_SQL, -1, &out->fts_mark_stmt, NULL) != SQLITE_OK ||
+      sqlite3_prepare_v2(out->db, BODY_DROP_SQL, -1, &out->body_drop_stmt, NULL) != SQLITE_OK ||
+      sqlite3_prepare_v2(out->db, ORPHAN_INDEXED_SQL, -1, &out->orphan_indexed_stmt, NULL) != SQLITE_OK ||
+      sqlite3_prepare_v2(out->db, DELETE_AGED_SQL, -1, &out->delete_aged_stmt, NULL) != SQLITE_OK ||
+      sqlite3_prepare_v2(out->db, DELETE_OLDEST_SQL, -1, &out->delete_oldest_stmt, NULL) != SQLITE_OK ||
+      sqlite3_prepare_v2(out->db, CROWDED_REQUESTS_SQL, -1, &out->crowded_requests_stmt, NULL) != SQLITE_OK ||
+      sqlite3_prepare_v2(out->db, TRIM_REQUEST_SQL, -1, &out->trim_request_stmt, NULL) != SQLITE_OK ||
+      sqlite3_prepare_v2(out->db, META_ADD_SQL, -1, &out->meta_add_stmt, NULL) != SQLITE_OK ||
+      sqlite3_prepare_v2(out->db, EPOCH_BACKFILL_SQL, -1, &out->epoch_backfill_stmt, NULL) != SQLITE_OK ||
+      sqlite3_prepare_v2(out->db, FTS_BACKFILL_SQL, -1, &out->fts_backfill_stmt, NULL) != SQLITE_OK) {
+    history_store_close(out);
     return -1;
   }
+  out->index_bodies = options != NULL && options->index_bodies;
+  return 0;
+}
 
+void history_store_close(history_store_t *store) {
+  if (store == NULL) {
+    return;
+  }
+  sqlite3_finalize(store->insert_stmt);
+  sqlite3_finalize(store->list_stmt);
+  sqlite3_finalize(store->body_find_stmt);
+  sqlite3_finalize(store->body_insert_stmt);
+  sqlite3_finalize(store->legacy_next_stmt);
+  sqlite3_finalize(store->legacy_update_stmt);
+  sqlite3_finalize(store->latency_stmt);
+  sqlite3_finalize(store->search_runs_stmt);
+  sqlite3_finalize(store->search_bodies_stmt);
+  sqlite3_finalize(store->fts_add_stmt);
+  sqlite3_finalize(store->fts_remove_stmt);
+  sqlite3_finalize(store->fts_mark_stmt);
+  sqlite3_finalize(store->body_drop_stmt);
+  sqlite3_finalize(store->orphan_indexed_stmt);
+  sqlite3_finalize(store->delete_aged_stmt);
+  sqlite3_finalize(store->delete_oldest_stmt);
+  sqlite3_finalize(store->crowded_requests_stmt);
+  sqlite3_finalize(store->trim_request_stmt);
+  sqlite3_finalize(store->meta_add_stmt);
+  sqlite3_finalize(store->epoch_backfill_stmt);
+  sqlite3_finalize(store->fts_backfill_stmt);
+  if (store->db != NULL) {
+    sqlite3_close(store->db);
+  }
+  memset(store, 0, sizeof(*store));
+}
+
+/* Adds a body to (or, with `remove`, takes it out of) the contentless body index. */
+static int index_body(history_store_t *store, sqlite3_int64 body_id, const char *text, size_t len, bool remove) {
+  sqlite3_stmt *stmt = remove ? store->fts_remove_stmt : store->fts_add_stmt;
+  sqlite3_bind_int64(stmt, 1, body_id);
+  sqlite3_bind_text(stmt, 2, text, (int)(len < FTS_BODY_MAX ? len : FTS_BODY_MAX), SQLITE_STATIC);
+  int rc = sqlite3_step(stmt);
+  sqlite3_reset(stmt);
+  sqlite3_clear_bindings(stmt);
+  if (rc != SQLITE_DONE) {
+    return -1;
+  }
+  sqlite3_stmt *mark = store->fts_mark_stmt;
+  sqlite3_bind_int(mark, 1, remove ? 0 : 1);
+  sqlite3_bind_int64(mark, 2, body_id);
+  sqlite3_step(mark);
+  sqlite3_reset(mark);
   return 0;
 }
 
-void history_store_close(sqlite3 *db) {
-  if (db != NULL) {
-    sqlite3_close(db);
+/*
+ * Deflates `data` in BODY_CHUNK steps into a buffer that grows with the
+ * output. NULL when that would not come out smaller than `len`.
+ */
+static Bytef *deflate_body(const char *data, size_t len, size_t *out_len) {
+  z_stream zs;
+  memset(&zs, 0, sizeof(zs));
+  if (len < 2 || deflateInit(&zs, Z_DEFAULT_COMPRESSION) != Z_OK) {
+    return NULL;
+  }
+  size_t cap = len / 4 + BODY_COMPRESS_MIN < len - 1 ? len / 4 + BODY_COMPRESS_MIN : len - 1;
+  Bytef *out = NULL;
+  size_t used = 0;
+  size_t fed = 0;
+  int rc = Z_OK;
+  while (rc == Z_OK) {
+    if (out == NULL || used == cap) {
+      if (out != NULL && cap == len - 1) {
+        break;
+      }
+      size_t next = out == NULL ? cap : (cap * 2 < len - 1 ? cap * 2 : len - 1);
+      Bytef *grown = realloc(out, next);
+      if (grown == NULL) {
+        break;
+      }
+      out = grown;
+      cap = next;
+    }
+    if (zs.avail_in == 0 && fed < len) {
+      size_t n = len - fed < BODY_CHUNK ? len - fed : BODY_CHUNK;
+      zs.next_in = (Bytef *)(data + fed);
+      zs.avail_in = (uInt)n;
+      fed += n;
+    }
+    size_t room = cap - used < BODY_CHUNK ? cap - used : BODY_CHUNK;
+    zs.next_out = out + used;
+    zs.avail_out = (uInt)room;
+    rc = deflate(&zs, fed == len && zs.avail_in == 0 ? Z_FINISH : Z_NO_FLUSH);
+    used += room - zs.avail_out;
+  }
+  deflateEnd(&zs);
+  if (rc != Z_STREAM_END) {
+    free(out);
+    return NULL;
   }
+  *out_len = used;
+  return out;
 }
 
-int history_store_add_run(sqlite3 *db, const run_entry_t *run) {
-  static const char *SQL = "INSERT INTO runs "
-                           "(request_id, request_name, method, url, status_code, duration_ms, error, created_at, "
-                           "request_snapshot, response_body)"
-                           " VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?);";
+/* Fills a zeroblob in BODY_CHUNK writes, so SQLite never builds the whole value in memory. */
+static int write_blob(sqlite3 *db, sqlite3_int64 rowid, const void *data, size_t len) {
+  sqlite3_blob *blob = NULL;
+  int rc = sqlite3_blob_open(db, "main", "bodies", "data", rowid, 1, &blob);
+  for (size_t off = 0; rc == SQLITE_OK && off < len; off += BODY_CHUNK) {
+    size_t n = len - off < BODY_CHUNK ? len - off : BODY_CHUNK;
+    rc = sqlite3_blob_write(blob, (const char *)data + off, (int)n, (int)off);
+  }
+  sqlite3_blob_close(blob);
+  return rc == SQLITE_OK ? 0 : -1;
+}
 
-  sqlite3_stmt *stmt = NULL;
-  if (sqlite3_prepare_v2(db, SQL, -1, &stmt, NULL) != SQLITE_OK) {
+/*
+ * Interns one body: hashed, compressed on first sight only, then shared by
+ * every run with the same bytes. `data` may be a mapped spill file; it is
+ * only ever read in place.
+ */
+static int store_body(history_store_t *store, const char *data, size_t len, char hash[TUIMAN_SHA256_HEX_LEN]) {
+  sha256_hex(data, len, hash);
+  sqlite3_stmt *find = store->body_find_stmt;
+  sqlite3_bind_text(find, 1, hash, -1, SQLITE_STATIC);
+  int rc = sqlite3_step(find);
+  sqlite3_reset(find);
+  if (rc == SQLITE_ROW) {
+    return 0;
+  }
+  if (rc != SQLITE_DONE) {
+    return -1;
+  }
+
+  int codec = BODY_CODEC_RAW;
+  const void *stored = data;
+  size_t stored_len = len;
+  Bytef *packed = NULL;
+  if (len >= BODY_COMPRESS_MIN) {
+    size_t packed_len = 0;
+    packed = deflate_body(data, len, &packed_len);
+    if (packed != NULL) {
+      codec = BODY_CODEC_ZLIB;
+      stored = packed;
+      stored_len = packed_len;
+    }
+  }
+
+  bool chunked = stored_len > BODY_CHUNK;
+  sqlite3_stmt *insert = store->body_insert_stmt;
+  sqlite3_bind_text(insert, 1, hash, -1, SQLITE_STATIC);
+  sqlite3_bind_int64(insert, 2, (sqlite3_int64)len);
+  sqlite3_bind_int(insert, 3, codec);
+  if (chunked) {
+    sqlite3_bind_zeroblob64(insert, 4, (sqlite3_uint64)stored_len);
+  } else {
+    sqlite3_bind_blob64(insert, 4, stored, (sqlite3_uint64)stored_len, SQLITE_STATIC);
+  }
+  rc = sqlite3_step(insert);
+  sqlite3_reset(insert);
+  sqlite3_clear_bindings(insert);
+  sqlite3_int64 body_id = sqlite3_last_insert_rowid(store->db);
+  if (rc == SQLITE_DONE && chunked && write_blob(store->db, body_id, stored, stored_len) != 0) {
+    /* A half-written row would be served for this hash from now on. */
+    sqlite3_bind_int64(store->body_drop_stmt, 1, body_id);
+    sqlite3_step(store->body_drop_stmt);
+    sqlite3_reset(store->body_drop_stmt);
+    rc = SQLITE_ERROR;
+  }
+  free(packed);
+  if (rc != SQLITE_DONE) {
+    return -1;
+  }
+  if (store->index_bodies) {
+    index_body(store, body_id, data, len, false);
+  }
+  return 0;
+}
+
+int history_store_add_run(history_store_t *store, const run_entry_t *run) {
+  char body_hash[TUIMAN_SHA256_HEX_LEN] = "";
+  if (run->response_body != NULL && run->response_body_len > 0 &&
+      store_body(store, run->response_body, run->response_body_len, body_hash) != 0) {
     return -1;
   }
 
-  sqlite3_bind_text(stmt, 1, run->request_id, -1, SQLITE_TRANSIENT);
-  sqlite3_bind_text(stmt, 2, run->request_name, -1, SQLITE_TRANSIENT);
-  sqlite3_bind_text(stmt, 3, run->method, -1, SQLITE_TRANSIENT);
-  sqlite3_bind_text(stmt, 4, run->url, -1, SQLITE_TRANSIENT);
+  sqlite3_stmt *stmt = store->insert_stmt;
+  /* Row values are only read during step, so no copies are needed. */
+  sqlite3_bind_text(stmt, 1, run->request_id, -1, SQLITE_STATIC);
+  sqlite3_bind_text(stmt, 2, run->request_name, -1, SQLITE_STATIC);
+  sqlite3_bind_text(stmt, 3, run->method, -1, SQLITE_STATIC);
+  sqlite3_bind_text(stmt, 4, run->url, -1, SQLITE_STATIC);
   sqlite3_bind_int(stmt, 5, run->status_code);
   sqlite3_bind_int64(stmt, 6, run->duration_ms);
-  sqlite3_bind_text(stmt, 7, run->error, -1, SQLITE_TRANSIENT);
-  sqlite3_bind_text(stmt, 8, run->created_at, -1, SQLITE_TRANSIENT);
-  sqlite3_bind_text(stmt, 9, run->request_snapshot != NULL ? run->request_snapshot : "", -1, SQLITE_TRANSIENT);
-  sqlite3_bind_text(stmt, 10, run->response_body != NULL ? run->response_body : "", -1, SQLITE_TRANSIENT);
+  sqlite3_bind_text(stmt, 7, run->error, -1, SQLITE_STATIC);
+  sqlite3_bind_text(stmt, 8, run->created_at, -1, SQLITE_STATIC);
+  sqlite3_bind_text(stmt, 9, run->request_snapshot != NULL ? run->request_snapshot : "", -1, SQLITE_STATIC);
+  if (body_hash[0] != '\0') {
+    sqlite3_bind_text(stmt, 10, body_hash, -1, SQLITE_STATIC);
+  } else {
+    sqlite3_bind_null(stmt, 10);
+  }
 
   int rc = sqlite3_step(stmt);
-  sqlite3_finalize(stmt);
+  sqlite3_reset(stmt);
+  sqlite3_clear_bindings(stmt);
 
   return rc == SQLITE_DONE ? 0 : -1;
 }
 
-int history_store_list_runs(sqlite3 *db, int limit, run_list_t *out) {
-  out->items = NULL;
-  out->len = 0;
+static void read_run_row(sqlite3_stmt *stmt, run_entry_t *row) {
+  memset(row, 0, sizeof(*row));
+  const unsigned char *request_id = sqlite3_column_text(stmt, 1);
+  const unsigned char *request_name = sqlite3_column_text(stmt, 2);
+  const unsigned char *method = sqlite3_column_text(stmt, 3);
+  const unsigned char *url = sqlite3_column_text(stmt, 4);
+  const unsigned char *err = sqlite3_column_text(stmt, 7);
+  const unsigned char *created = sqlite3_column_text(stmt, 8);
+  const unsigned char *body_hash = sqlite3_column_text(stmt, 9);
 
-  static const char *SQL = "SELECT id, request_id, request_name, method, url, status_code, duration_ms, error, "
-                           "created_at, request_snapshot, response_body FROM runs ORDER BY id DESC LIMIT ?;";
+  row->id = sqlite3_column_int(stmt, 0);
+  snprintf(row->request_id, sizeof(row->request_id), "%s", request_id ? (const char *)request_id : "");
+  snprintf(row->request_name, sizeof(row->request_name), "%s", request_name ? (const char *)request_name : "");
+  snprintf(row->method, sizeof(row->method), "%s", method ? (const char *)method : "");
+  snprintf(row->url, sizeof(row->url), "%s", url ? (const char *)url : "");
+  row->status_code = sqlite3_column_int(stmt, 5);
+  row->duration_ms = sqlite3_column_int64(stmt, 6);
+  snprintf(row->error, sizeof(row->error), "%s", err ? (const char *)err : "");
+  snprintf(row->created_at, sizeof(row->created_at), "%s", created ? (const char *)created : "");
+  snprintf(row->body_hash, sizeof(row->body_hash), "%s", body_hash ? (const char *)body_hash : "");
+}
 
-  sqlite3_stmt *stmt = NULL;
-  if (sqlite3_prepare_v2(db, SQL, -1, &stmt, NULL) != SQLITE_OK) {
-    return -1;
+int history_store_list_page(history_store_t *store, int before_id, int limit, run_list_t *out) {
+  sqlite3_stmt *stmt = store->list_stmt;
+  sqlite3_bind_int64(stmt, 1, before_id > 0 ? (sqlite3_int64)before_id : INT64_MAX);
+  sqlite3_bind_int(stmt, 2, limit);
+
+  int added = 0;
+  int rc = 0;
+  while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+    if (out->len == out->cap) {
+      size_t cap = out->cap > 0 ? out->cap * 2 : (size_t)limit;
+      run_entry_t *next = realloc(out->items, cap * sizeof(run_entry_t));
+      if (next == NULL) {
+        sqlite3_reset(stmt);
+        return -1;
+      }
+      out->items = next;
+      out->cap = cap;
+    }
+    read_run_row(stmt, &out->items[out->len]);
+    out->len++;
+    added++;
   }
 
-  sqlite3_bind_int(stmt, 1, limit);
+  sqlite3_reset(stmt);
+  return rc == SQLITE_DONE ? added : -1;
+}
 
-  while (sqlite3_step(stmt) == SQLITE_ROW) {
-    run_entry_t row;
-    memset(&row, 0, sizeof(row));
-
-    const unsigned char *request_id = sqlite3_column_text(stmt, 1);
-    const unsigned char *request_name = sqlite3_column_text(stmt, 2);
-    const unsigned char *method = sqlite3_column_text(stmt, 3);
-    const unsigned char *url = sqlite3_column_text(stmt, 4);
-
-    row.id = sqlite3_column_int(stmt, 0);
-    snprintf(row.request_id, sizeof(row.request_id), "%s", request_id ? (const char *)request_id : "");
-    snprintf(row.request_name, sizeof(row.request_name), "%s", request_name ? (const char *)request_name : "");
-    snprintf(row.method, sizeof(row.method), "%s", method ? (const char *)method : "");
-    snprintf(row.url, sizeof(row.url), "%s", url ? (const char *)url : "");
-    row.status_code = sqlite3_column_int(stmt, 5);
-    row.duration_ms = sqlite3_column_int64(stmt, 6);
-    const unsigned char *err = sqlite3_column_text(stmt, 7);
-    const unsigned char *created = sqlite3_column_text(stmt, 8);
-    const unsigned char *request_snapshot = sqlite3_column_text(stmt, 9);
-    const unsigned char *response_body = sqlite3_column_text(stmt, 10);
-    snprintf(row.error, sizeof(row.error), "%s", err ? (const char *)err : "");
-    snprintf(row.created_at, sizeof(row.created_at), "%s", created ? (const char *)created : "");
-    row.request_snapshot = strdup(request_snapshot ? (const char *)request_snapshot : "");
-    row.response_body = strdup(response_body ? (const char *)response_body : "");
-    if (row.request_snapshot == NULL || row.response_body == NULL) {
-      free(row.request_snapshot);
-      free(row.response_body);
-      sqlite3_finalize(stmt);
-      run_list_free(out);
-      return -1;
+/*
+ * Reads one value in fixed-size chunks through an incremental blob handle.
+ * The handle is closed straight away: an open one pins a WAL read snapshot,
+ * hiding the writer's later commits from this connection.
+ */
+static char *read_column(sqlite3 *db, const char *table, const char *column, sqlite3_int64 rowid, size_t *out_len) {
+  enum { CHUNK = 64 * 1024 };
+  sqlite3_blob *blob = NULL;
+  if (out_len != NULL) {
+    *out_len = 0;
+  }
+  if (sqlite3_blob_open(db, "main", table, column, rowid, 0, &blob) != SQLITE_OK) {
+    /* NULL (and therefore unopenable) values read as empty. */
+    sqlite3_blob_close(blob);
+    return strdup("");
+  }
+
+  int size = sqlite3_blob_bytes(blob);
+  char *text = malloc((size_t)size + 1);
+  if (text == NULL) {
+    sqlite3_blob_close(blob);
+    return NULL;
+  }
+  for (int off = 0; off < size; off += CHUNK) {
+    int n = size - off < CHUNK ? size - off : CHUNK;
+    if (sqlite3_blob_read(blob, text + off, n, off) != SQLITE_OK) {
+      size = off;
+      break;
     }
+  }
+  text[size] = '\0';
+  sqlite3_blob_close(blob);
+  if (out_len != NULL) {
+    *out_len = (size_t)size;
+  }
+  return text;
+}
 
-    run_entry_t *next = realloc(out->items, (out->len + 1) * sizeof(run_entry_t));
-    if (next == NULL) {
-      sqlite3_finalize(stmt);
-      run_list_free(out);
-      return -1;
+/* Placeholder text for a body that cannot be shown; `out_len` gets its length. */
+static char *body_note(const char *note, size_t *out_len) {
+  *out_len = strlen(note);
+  return strdup(note);
+}
+
+static char *read_body(history_store_t *store, const char *hash, size_t *out_len) {
+  sqlite3_stmt *find = store->body_find_stmt;
+  sqlite3_bind_text(find, 1, hash, -1, SQLITE_STATIC);
+  if (sqlite3_step(find) != SQLITE_ROW) {
+    sqlite3_reset(find);
+    return body_note("(response body missing from history)", out_len);
+  }
+  sqlite3_int64 body_id = sqlite3_column_int64(find, 0);
+  int codec = sqlite3_column_int(find, 1);
+  sqlite3_int64 size = sqlite3_column_int64(find, 2);
+  sqlite3_reset(find);
+
+  size_t stored_len = 0;
+  char *stored = read_column(store->db, "bodies", "data", body_id, &stored_len);
+  if (stored == NULL || codec == BODY_CODEC_RAW) {
+    *out_len = stored_len;
+    return stored;
+  }
+
+  char *text = malloc((size_t)size + 1);
+  uLongf text_len = (uLongf)size;
+  if (text != NULL && uncompress((Bytef *)text, &text_len, (const Bytef *)stored, (uLong)stored_len) != Z_OK) {
+    free(text);
+    text = body_note("(response body could not be decompressed)", out_len);
+  } else if (text != NULL) {
+    text[text_len] = '\0';
+    *out_len = text_len;
+  }
+  free(stored);
+  return text;
+}
+
+/*
+ * The first `cap` bytes of a body into `out` (NUL-terminated, so `out` holds
+ * cap + 1), inflating only as much of the stored blob as that takes.
+ */
+static size_t read_body_head(history_store_t *store, const char *hash, char *out, size_t cap) {
+  enum { CHUNK = 16 * 1024 };
+  out[0] = '\0';
+  sqlite3_stmt *find = store->body_find_stmt;
+  sqlite3_bind_text(find, 1, hash, -1, SQLITE_STATIC);
+  if (sqlite3_step(find) != SQLITE_ROW) {
+    sqlite3_reset(find);
+    return 0;
+  }
+  sqlite3_int64 body_id = sqlite3_column_int64(find, 0);
+  int codec = sqlite3_column_int(find, 1);
+  sqlite3_reset(find);
+
+  sqlite3_blob *blob = NULL;
+  if (sqlite3_blob_open(store->db, "main", "bodies", "data", body_id, 0, &blob) != SQLITE_OK) {
+    sqlite3_blob_close(blob);
+    return 0;
+  }
+  int size = sqlite3_blob_bytes(blob);
+  size_t used = 0;
+  if (codec == BODY_CODEC_RAW) {
+    used = (size_t)size < cap ? (size_t)size : cap;
+    if (sqlite3_blob_read(blob, out, (int)used, 0) != SQLITE_OK) {
+      used = 0;
+    }
+  } else {
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    Bytef in[CHUNK];
+    if (inflateInit(&zs) == Z_OK) {
+      zs.next_out = (Bytef *)out;
+      zs.avail_out = (uInt)cap;
+      int rc = Z_OK;
+      for (int off = 0; rc == Z_OK && zs.avail_out > 0 && off < size; off += CHUNK) {
+        int n = size - off < CHUNK ? size - off : CHUNK;
+        if (sqlite3_blob_read(blob, in, n, off) != SQLITE_OK) {
+          break;
+        }
+        zs.next_in = in;
+        zs.avail_in = (uInt)n;
+        while (rc == Z_OK && zs.avail_in > 0 && zs.avail_out > 0) {
+          rc = inflate(&zs, Z_NO_FLUSH);
+        }
+      }
+      used = cap - zs.avail_out;
+      inflateEnd(&zs);
     }
-    out->items = next;
-    out->items[out->len] = row;
-    out->len++;
   }
+  sqlite3_blob_close(blob);
+  out[used] = '\0';
+  return used;
+}
 
-  sqlite3_finalize(stmt);
+int history_store_load_bodies(history_store_t *store, run_entry_t *run) {
+  run_entry_free_bodies(run);
+  run->request_snapshot = read_column(store->db, "runs", "request_snapshot", run->id, NULL);
+  run->response_body = run->body_hash[0] != '\0'
+                           ? read_body(store, run->body_hash, &run->response_body_len)
+                           : read_column(store->db, "runs", "response_body", run->id, &run->response_body_len);
+  if (run->request_snapshot == NULL || run->response_body == NULL) {
+    run_entry_free_bodies(run);
+    return -1;
+  }
   return 0;
 }
 
+void run_entry_free_bodies(run_entry_t *run) {
+  free(run->request_snapshot);
+  free(run->response_body);
+  run->request_snapshot = NULL;
+  run->response_body = NULL;
+  run->response_body_len = 0;
+}
+
 void run_list_free(run_list_t *list) {
   if (list == NULL) {
     return;
   }
   for (size_t i = 0; i < list->len; i++) {
-    free(list->items[i].request_snapshot);
-    free(list->items[i].response_body);
-    list->items[i].request_snapshot = NULL;
-    list->items[i].response_body = NULL;
+    run_entry_free_bodies(&list->items[i]);
   }
   free(list->items);
   list->items = NULL;
   list->len = 0;
+  list->cap = 0;
+}
+
+int history_store_stats(history_store_t *store, history_stats_t *out) {
+  sqlite3 *db = store->db;
+  memset(out, 0, sizeof(*out));
+  sqlite3_stmt *stmt = NULL;
+  if (sqlite3_prepare_v2(db,
+                         "SELECT (SELECT count(*) FROM runs), count(*), coalesce(sum(size), 0), "
+                         "coalesce(sum(length(data)), 0) FROM bodies;",
+                         -1, &stmt, NULL) != SQLITE_OK) {
+    return -1;
+  }
+  if (sqlite3_step(stmt) == SQLITE_ROW) {
+    out->runs = sqlite3_column_int64(stmt, 0);
+    out->bodies = sqlite3_column_int64(stmt, 1);
+    out->body_bytes = sqlite3_column_int64(stmt, 2);
+    out->body_stored_bytes = sqlite3_column_int64(stmt, 3);
+  }
+  sqlite3_finalize(stmt);
+
+  sqlite3_int64 page_size = query_int(db, "PRAGMA page_size;");
+  out->file_bytes = query_int(db, "PRAGMA page_count;") * page_size;
+  out->free_bytes = query_int(db, "PRAGMA freelist_count;") * page_size;
+  out->reclaimed_bytes = query_int(db, "SELECT value FROM meta WHERE key = 'reclaimed_bytes';");
+  out->retention_deleted = query_int(db, "SELECT value FROM meta WHERE key = 'retention_deleted';");
+  out->incremental_vacuum = query_int(db, "PRAGMA auto_vacuum;") == 2;
+  return 0;
+}
+
+int history_store_vacuum(history_store_t *store) {
+  if (exec_sql(store->db, "PRAGMA auto_vacuum = INCREMENTAL;") != 0 || exec_sql(store->db, "VACUUM;") != 0) {
+    return -1;
+  }
+  return query_int(store->db, "PRAGMA auto_vacuum;") == 2 ? 0 : -1;
+}
+
+static int compare_long(const void *lhs, const void *rhs) {
+  long a = *(const long *)lhs;
+  long b = *(const long *)rhs;
+  return (a > b) - (a < b);
+}
+
+/* Nearest-rank percentile of an ascending array. */
+static long percentile(const long *sorted, size_t len, int pct) {
+  size_t rank = (len * (size_t)pct + 99) / 100;
+  return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+int history_store_latency(history_store_t *store, const char *request_id, long long since_epoch,
+                          history_latency_t *out) {
+  memset(out, 0, sizeof(*out));
+  sqlite3_stmt *stmt = store->latency_stmt;
+  sqlite3_bind_text(stmt, 1, request_id, -1, SQLITE_STATIC);
+  sqlite3_bind_int64(stmt, 2, since_epoch);
+
+  long *durations = NULL;
+  size_t cap = 0;
+  size_t len = 0;
+  int rc;
+  while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+    if (len == cap) {
+      size_t next_cap = cap == 0 ? 64 : cap * 2;
+      long *next = realloc(durations, next_cap * sizeof(long));
+      if (next == NULL) {
+        rc = SQLITE_NOMEM;
+        break;
+      }
+      durations = next;
+      cap = next_cap;
+    }
+    long ms = (long)sqlite3_column_int64(stmt, 0);
+    int status = sqlite3_column_int(stmt, 1);
+    const unsigned char *error = sqlite3_column_text(stmt, 2);
+    if ((error != NULL && error[0] != '\0') || status >= 400) {
+      out->errors++;
+    }
+    durations[len++] = ms;
+  }
+  sqlite3_reset(stmt);
+  sqlite3_clear_bindings(stmt);
+  if (rc != SQLITE_DONE) {
+    free(durations);
+    return -1;
+  }
+
+  out->runs = (long long)len;
+  size_t spark_from = len > TUIMAN_LATENCY_SPARK_LEN ? len - TUIMAN_LATENCY_SPARK_LEN : 0;
+  for (size_t i = spark_from; i < len; i++) {
+    out->spark_ms[out->spark_len++] = durations[i];
+  }
+  if (len > 0) {
+    qsort(durations, len, sizeof(long), compare_long);
+    out->p50_ms = percentile(durations, len, 50);
+    out->p95_ms = percentile(durations, len, 95);
+    out->p99_ms = percentile(durations, len, 99);
+  }
+  free(durations);
+  return 0;
+}
+
+/*
+ * Turns free text into an FTS5 query: every word becomes a quoted prefix
+ * term ("word"*), so punctuation such as '.', '/' or ':' in URLs is never
+ * parsed as query syntax.
+ */
+static int build_match_query(const char *query, char *out, size_t out_len) {
+  size_t len = 0;
+  int terms = 0;
+  const char *p = query;
+  while (*p != '\0') {
+    while (*p == ' ' || *p == '\t') {
+      p++;
+    }
+    if (*p == '\0') {
+      break;
+    }
+    if (len + 4 >= out_len) {
+      return -1;
+    }
+    if (terms > 0) {
+      out[len++] = ' ';
+    }
+    out[len++] = '"';
+    while (*p != '\0' && *p != ' ' && *p != '\t') {
+      if (len + 4 >= out_len) {
+        return -1;
+      }
+      if (*p == '"') {
+        out[len++] = '"';
+      }
+      out[len++] = *p++;
+    }
+    out[len++] = '"';
+    out[len++] = '*';
+    terms++;
+  }
+  out[len] = '\0';
+  return terms > 0 ? 0 : -1;
+}
+
+static const char *find_ci(const char *text, const char *word, size_t word_len) {
+  for (const char *p = text; *p != '\0'; p++) {
+    size_t i = 0;
+    while (i < word_len && p[i] != '\0' && tolower((unsigned char)p[i]) == tolower((unsigned char)word[i])) {
+      i++;
+    }
+    if (i == word_len) {
+      return p;
+    }
+  }
+  return NULL;
+}
+
+/* First query word found in `text` (ASCII case-insensitive), with some context, on one line. */
+static void body_snippet(const char *text, const char *query, char *out, size_t out_len) {
+  char word[64];
+  size_t word_len = 0;
+  while (*query == ' ') {
+    query++;
+  }
+  while (query[word_len] != '\0' && query[word_len] != ' ' && word_len + 1 < sizeof(word)) {
+    word[word_len] = query[word_len];
+    word_len++;
+  }
+  word[word_len] = '\0';
+
+  const char *hit = word_len > 0 ? find_ci(text, word, word_len) : NULL;
+  size_t text_len = strlen(text);
+  size_t at = hit != NULL ? (size_t)(hit - text) : 0;
+  size_t from = at > 40 ? at - 40 : 0;
+  size_t len = 0;
+  if (from > 0) {
+    len += (size_t)snprintf(out, out_len, "...");
+  }
+  for (size_t i = from; i < text_len && len + 2 < out_len; i++) {
+    if (hit != NULL && i == at) {
+      out[len++] = '[';
+    }
+    char c = text[i];
+    out[len++] = c == '\n' || c == '\r' || c == '\t' ? ' ' : c;
+    if (hit != NULL && i + 1 == at + word_len && len + 2 < out_len) {
+      out[len++] = ']';
+    }
+  }
+  out[len < out_len ? len : out_len - 1] = '\0';
+}
+
+static int append_hit(history_hit_list_t *out, size_t *cap, sqlite3_stmt *stmt, double rank) {
+  int id = sqlite3_column_int(stmt, 0);
+  for (size_t i = 0; i < out->len; i++) {
+    if (out->items[i].run.id == id) {
+      return 0;
+    }
+  }
+  if (out->len == *cap) {
+    size_t next_cap = *cap > 0 ? *cap * 2 : 32;
+    history_hit_t *next = realloc(out->items, next_cap * sizeof(history_hit_t));
+    if (next == NULL) {
+      return -1;
+    }
+    out->items = next;
+    *cap = next_cap;
+  }
+  history_hit_t *hit = &out->items[out->len++];
+  read_run_row(stmt, &hit->run);
+  hit->snippet[0] = '\0';
+  hit->rank = rank;
+  return 1;
+}
+
+int history_store_search(history_store_t *store, const char *query, int limit, history_hit_list_t *out) {
+  memset(out, 0, sizeof(*out));
+  char match[512];
+  if (build_match_query(query, match, sizeof(match)) != 0) {
+    return -1;
+  }
+  size_t cap = 0;
+
+  sqlite3_stmt *stmt = store->search_runs_stmt;
+  sqlite3_bind_text(stmt, 1, match, -1, SQLITE_STATIC);
+  sqlite3_bind_int(stmt, 2, limit);
+  int rc;
+  while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+    if (append_hit(out, &cap, stmt, sqlite3_column_double(stmt, 11)) < 0) {
+      rc = SQLITE_NOMEM;
+      break;
+    }
+    const unsigned char *snippet = sqlite3_column_text(stmt, 10);
+    history_hit_t *hit = &out->items[out->len - 1];
+    snprintf(hit->snippet, sizeof(hit->snippet), "%s", snippet != NULL ? (const char *)snippet : "");
+  }
+  sqlite3_reset(stmt);
+  sqlite3_clear_bindings(stmt);
+  if (rc != SQLITE_DONE) {
+    history_hit_list_free(out);
+    return -1;
+  }
+
+  /*
+   * Body hits follow the metadata hits, each list in its own bm25 order:
+   * scores from the two indexes come from different corpora and do not
+   * compare. The index is contentless, so there is no snippet(); excerpts
+   * come from the indexed head of the body, inflated up to FTS_BODY_MAX.
+   */
+  stmt = store->search_bodies_stmt;
+  sqlite3_bind_text(stmt, 1, match, -1, SQLITE_STATIC);
+  sqlite3_bind_int(stmt, 2, limit);
+  char last_hash[TUIMAN_SHA256_HEX_LEN] = "";
+  char last_snippet[TUIMAN_HISTORY_SNIPPET_LEN] = "";
+  char *head = NULL;
+  while (out->len < (size_t)limit && (rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+    int added = append_hit(out, &cap, stmt, sqlite3_column_double(stmt, 10));
+    if (added < 0) {
+      rc = SQLITE_NOMEM;
+      break;
+    }
+    if (added == 0) {
+      continue;
+    }
+    history_hit_t *hit = &out->items[out->len - 1];
+    if (strcmp(hit->run.body_hash, last_hash) != 0) {
+      if (head == NULL && (head = malloc(FTS_BODY_MAX + 1)) == NULL) {
+        rc = SQLITE_NOMEM;
+        break;
+      }
+      read_body_head(store, hit->run.body_hash, head, FTS_BODY_MAX);
+      body_snippet(head, query, last_snippet, sizeof(last_snippet));
+      snprintf(last_hash, sizeof(last_hash), "%s", hit->run.body_hash);
+    }
+    snprintf(hit->snippet, sizeof(hit->snippet), "%s", last_snippet);
+  }
+  free(head);
+  sqlite3_reset(stmt);
+  sqlite3_clear_bindings(stmt);
+  if (rc != SQLITE_DONE && rc != SQLITE_ROW) {
+    history_hit_list_free(out);
+    return -1;
+  }
+  return 0;
+}
+
+void history_hit_list_free(history_hit_list_t *list) {
+  free(list->items);
+  list->items = NULL;
+  list->len = 0;
+}
+
+typedef struct history_writer_item {
+  run_entry_t run;
+  struct history_writer_item *next;
+} history_writer_item_t;
+
+struct history_writer {
+  history_store_t store;
+  pthread_t thread;
+  pthread_mutex_t lock;
+  pthread_cond_t wake;    /* queue non-empty, or stopping */
+  pthread_cond_t drained; /* `committed` moved */
+  history_writer_item_t *head;
+  history_writer_item_t *tail;
+  unsigned long long queued;
+  unsigned long long committed;
+  unsigned long failures;
+  bool stopping;
+  int notify[2]; /* pipe: the worker writes a byte per committed batch */
+
+  /* Background maintenance state, touched only by the worker. */
+  history_retention_t retention;
+  sqlite3_int64 legacy_cursor;
+  bool legacy_left;
+  sqlite3_int64 epoch_cursor; /* runs up to epoch_end may predate created_epoch */
+  sqlite3_int64 epoch_end;
+  bool search_backfill_left;
+  bool retention_due;
+  unsigned long long inserted_since_retention;
+};
+
+#define RETENTION_BATCH 256
+/* Runs inserted between two retention checks. */
+#define RETENTION_EVERY 256
+
+static void release_bodies(run_entry_t *run) {
+  free(run->request_snapshot);
+  if (run->body_release != NULL) {
+    run->body_release(run->body_owner);
+  } else {
+    free(run->response_body);
+  }
+  run->request_snapshot = NULL;
+  run->response_body = NULL;
+  run->response_body_len = 0;
+  run->body_release = NULL;
+  run->body_owner = NULL;
+}
+
+static void free_item(history_writer_item_t *item) {
+  release_bodies(&item->run);
+  free(item);
+}
+
+/* Returns how many runs of the batch failed to land. */
+static size_t write_batch(history_store_t *store, history_writer_item_t *batch, size_t *count) {
+  size_t failed = 0;
+  *count = 0;
+  int in_txn = exec_sql(store->db, "BEGIN IMMEDIATE;") == 0;
+  for (history_writer_item_t *item = batch; item != NULL; item = item->next) {
+    if (history_store_add_run(store, &item->run) != 0) {
+      failed++;
+    }
+    (*count)++;
+  }
+  if (in_txn && exec_sql(store->db, "COMMIT;") != 0) {
+    exec_sql(store->db, "ROLLBACK;");
+    failed = *count;
+  }
+  return failed;
+}
+
+/* Moves up to `limit` inline legacy bodies into the bodies table; returns how many, 0 once none are left. */
+static int migrate_legacy_bodies(history_store_t *store, sqlite3_int64 *cursor, int limit) {
+  if (exec_sql(store->db, "BEGIN IMMEDIATE;") != 0) {
+    return 0;
+  }
+  int moved = 0;
+  while (moved < limit) {
+    sqlite3_stmt *next = store->legacy_next_stmt;
+    sqlite3_bind_int64(next, 1, *cursor);
+    if (sqlite3_step(next) != SQLITE_ROW) {
+      sqlite3_reset(next);
+      break;
+    }
+    sqlite3_int64 id = sqlite3_column_int64(next, 0);
+    const char *body = (const char *)sqlite3_column_text(next, 1);
+    size_t body_len = (size_t)sqlite3_column_bytes(next, 1);
+    char hash[TUIMAN_SHA256_HEX_LEN] = "";
+    int rc = body_len > 0 ? store_body(store, body, body_len, hash) : 0;
+    sqlite3_reset(next);
+    *cursor = id;
+    if (rc != 0) {
+      continue;
+    }
+
+    sqlite3_stmt *update = store->legacy_update_stmt;
+    if (hash[0] != '\0') {
+      sqlite3_bind_text(update, 1, hash, -1, SQLITE_STATIC);
+    } else {
+      sqlite3_bind_null(update, 1);
+    }
+    sqlite3_bind_int64(update, 2, id);
+    sqlite3_step(update);
+    sqlite3_reset(update);
+    moved++;
+  }
+  exec_sql(store->db, "COMMIT;");
+  return moved;
+}
+
+/* Runs a cached delete with up to two integer/text bindings and returns sqlite3_changes. */
+static int delete_runs(sqlite3_stmt *stmt, const char *text, sqlite3_int64 a, sqlite3_int64 b) {
+  int index = 1;
+  if (text != NULL) {
+    sqlite3_bind_text(stmt, index++, text, -1, SQLITE_STATIC);
+  }
+  sqlite3_bind_int64(stmt, index++, a);
+  if (index <= sqlite3_bind_parameter_count(stmt)) {
+    sqlite3_bind_int64(stmt, index, b);
+  }
+  int changed = sqlite3_step(stmt) == SQLITE_DONE ? sqlite3_changes(sqlite3_db_handle(stmt)) : 0;
+  sqlite3_reset(stmt);
+  sqlite3_clear_bindings(stmt);
+  return changed;
+}
+
+/*
+ * Deletes up to `limit` runs beyond the newest `keep` of each request. Both
+ * lookups walk runs_request, so each request costs a seek, not a sort.
+ */
+static int trim_requests(history_store_t *store, int keep, int limit) {
+  char (*ids)[sizeof(((run_entry_t *)0)->request_id)] = malloc((size_t)limit * sizeof(*ids));
+  if (ids == NULL) {
+    return 0;
+  }
+  size_t len = 0;
+  sqlite3_stmt *stmt = store->crowded_requests_stmt;
+  sqlite3_bind_int(stmt, 1, keep);
+  while (len < (size_t)limit && sqlite3_step(stmt) == SQLITE_ROW) {
+    const unsigned char *id = sqlite3_column_text(stmt, 0);
+    snprintf(ids[len++], sizeof(ids[0]), "%s", id != NULL ? (const char *)id : "");
+  }
+  sqlite3_reset(stmt);
+
+  int deleted = 0;
+  for (size_t i = 0; i < len && deleted < limit; i++) {
+    deleted += delete_runs(store->trim_request_stmt, ids[i], keep, limit - deleted);
+  }
+  free(ids);
+  return deleted;
+}
+
+static void add_meta(history_store_t *store, const char *key, sqlite3_int64 delta) {
+  sqlite3_stmt *stmt = store->meta_add_stmt;
+  sqlite3_bind_text(stmt, 1, key, -1, SQLITE_STATIC);
+  sqlite3_bind_int64(stmt, 2, delta);
+  sqlite3_step(stmt);
+  sqlite3_reset(stmt);
+  sqlite3_clear_bindings(stmt);
+}
+
+/* Drops bodies no run points at; indexed ones are first replayed out of the contentless index. */
+static void sweep_orphan_bodies(history_store_t *store) {
+  sqlite3_stmt *stmt = store->orphan_indexed_stmt;
+  while (sqlite3_step(stmt) == SQLITE_ROW) {
+    sqlite3_int64 body_id = sqlite3_column_int64(stmt, 0);
+    size_t len = 0;
+    char *text = read_body(store, (const char *)sqlite3_column_text(stmt, 1), &len);
+    if (text != NULL) {
+      index_body(store, body_id, text, len, true);
+    }
+    free(text);
+  }
+  sqlite3_reset(stmt);
+  exec_sql(store->db, "DELETE FROM bodies WHERE NOT EXISTS (SELECT 1 FROM runs WHERE runs.body_hash = bodies.hash);");
+}
+
+/*
+ * Deletes at most RETENTION_BATCH runs that fall outside any limit (oldest
+ * first), drops bodies no run points at any more and hands the freed pages
+ * back with an incremental vacuum. Returns how many runs went.
+ */
+static int retention_pass(history_store_t *store, const history_retention_t *policy) {
+  sqlite3 *db = store->db;
+  if (exec_sql(db, "BEGIN IMMEDIATE;") != 0) {
+    return 0;
+  }
+
+  int deleted = 0;
+  if (policy->max_age_days > 0) {
+    char modifier[32];
+    snprintf(modifier, sizeof(modifier), "-%d days", policy->max_age_days);
+    deleted += delete_runs(store->delete_aged_stmt, modifier, RETENTION_BATCH, 0);
+  }
+  if (deleted < RETENTION_BATCH && policy->keep_per_request > 0) {
+    deleted += trim_requests(store, policy->keep_per_request, RETENTION_BATCH - deleted);
+  }
+  if (deleted < RETENTION_BATCH && policy->max_runs > 0) {
+    sqlite3_int64 excess = query_int(db, "SELECT count(*) FROM runs;") - policy->max_runs;
+    if (excess > 0) {
+      deleted += delete_runs(store->delete_oldest_stmt, NULL,
+                             excess < RETENTION_BATCH - deleted ? excess : RETENTION_BATCH - deleted, 0);
+    }
+  }
+  if (deleted < RETENTION_BATCH && policy->max_bytes > 0) {
+    sqlite3_int64 page_size = query_int(db, "PRAGMA page_size;");
+    sqlite3_int64 live = (query_int(db, "PRAGMA page_count;") - query_int(db, "PRAGMA freelist_count;")) * page_size;
+    sqlite3_int64 runs = query_int(db, "SELECT count(*) FROM runs;");
+    if (live > policy->max_bytes && runs > 0) {
+      /* Estimate from the average run size; the next pass corrects any shortfall. */
+      sqlite3_int64 per_run = live / runs > 0 ? live / runs : 1;
+      sqlite3_int64 count = (live - policy->max_bytes) / per_run + 1;
+      deleted += delete_runs(store->delete_oldest_stmt, NULL,
+                             count < RETENTION_BATCH - deleted ? count : RETENTION_BATCH - deleted, 0);
+    }
+  }
+  if (deleted > 0) {
+    sweep_orphan_bodies(store);
+    add_meta(store, "retention_deleted", deleted);
+  }
+  if (exec_sql(db, "COMMIT;") != 0) {
+    exec_sql(db, "ROLLBACK;");
+    return 0;
+  }
+
+  sqlite3_int64 free_pages = query_int(db, "PRAGMA freelist_count;");
+  if (free_pages > 0 && query_int(db, "PRAGMA auto_vacuum;") == 2 && exec_sql(db, "PRAGMA incremental_vacuum;") == 0) {
+    sqlite3_int64 reclaimed = (free_pages - query_int(db, "PRAGMA freelist_count;")) * query_int(db, "PRAGMA page_size;");
+    add_meta(store, "reclaimed_bytes", reclaimed);
+  }
+  return deleted;
+}
+
+/* Fills created_epoch for runs recorded before the column existed, one id range per call. */
+static void backfill_epochs(history_store_t *store, sqlite3_int64 *cursor, sqlite3_int64 span) {
+  sqlite3_stmt *stmt = store->epoch_backfill_stmt;
+  sqlite3_bind_int64(stmt, 1, *cursor);
+  sqlite3_bind_int64(stmt, 2, span);
+  sqlite3_step(stmt);
+  sqlite3_reset(stmt);
+  *cursor += span;
+}
+
+/* Indexes one id range of runs that predate the search index, newest first; false once done. */
+static bool backfill_search_index(history_store_t *store) {
+  sqlite3 *db = store->db;
+  sqlite3_int64 upto = query_int(db, "SELECT value FROM meta WHERE key = 'fts_backfill';");
+  if (upto <= 0) {
+    exec_sql(db, "DELETE FROM meta WHERE key = 'fts_backfill';");
+    return false;
+  }
+  if (exec_sql(db, "BEGIN IMMEDIATE;") != 0) {
+    return true;
+  }
+  sqlite3_stmt *stmt = store->fts_backfill_stmt;
+  sqlite3_bind_int64(stmt, 1, upto);
+  sqlite3_bind_int(stmt, 2, FTS_BACKFILL_BATCH);
+  int rc = sqlite3_step(stmt);
+  sqlite3_reset(stmt);
+  add_meta(store, "fts_backfill", -FTS_BACKFILL_BATCH);
+  if (rc != SQLITE_DONE || exec_sql(db, "COMMIT;") != 0) {
+    exec_sql(db, "ROLLBACK;");
+    return false;
+  }
+  return true;
+}
+
+/* One slice of idle work; returns false when nothing is left. */
+static bool maintenance_step(history_writer_t *writer) {
+  history_store_t *store = &writer->store;
+  if (writer->epoch_cursor < writer->epoch_end) {
+    backfill_epochs(store, &writer->epoch_cursor, 2000);
+    return true;
+  }
+  if (writer->search_backfill_left) {
+    writer->search_backfill_left = backfill_search_index(store);
+    return true;
+  }
+  if (writer->legacy_left) {
+    int moved = migrate_legacy_bodies(store, &writer->legacy_cursor, 32);
+    writer->legacy_left = moved > 0;
+    return true;
+  }
+  if (writer->retention_due) {
+    writer->retention_due = retention_pass(store, &writer->retention) > 0;
+    return writer->retention_due;
+  }
+  return false;
+}
+
+static void *writer_main(void *arg) {
+  history_writer_t *writer = arg;
+  bool maintaining = true;
+  pthread_mutex_lock(&writer->lock);
+  for (;;) {
+    while (writer->head == NULL && !writer->stopping && !maintaining) {
+      pthread_cond_wait(&writer->wake, &writer->lock);
+    }
+    if (writer->head == NULL) {
+      if (writer->stopping) {
+        break;
+      }
+      /* Idle: do a small slice of maintenance, then look at the queue again. */
+      pthread_mutex_unlock(&writer->lock);
+      maintaining = maintenance_step(writer);
+      pthread_mutex_lock(&writer->lock);
+      continue;
+    }
+    history_writer_item_t *batch = writer->head;
+    writer->head = NULL;
+    writer->tail = NULL;
+    pthread_mutex_unlock(&writer->lock);
+
+    size_t count = 0;
+    size_t failed = write_batch(&writer->store, batch, &count);
+    while (batch != NULL) {
+      history_writer_item_t *next = batch->next;
+      free_item(batch);
+      batch = next;
+    }
+    writer->inserted_since_retention += count;
+    if (writer->inserted_since_retention >= RETENTION_EVERY) {
+      writer->inserted_since_retention = 0;
+      writer->retention_due = true;
+      maintaining = true;
+    }
+
+    pthread_mutex_lock(&writer->lock);
+    writer->committed += count;
+    writer->failures += failed;
+    pthread_cond_broadcast(&writer->drained);
+    /* A full pipe already holds a wakeup, so a failed write loses nothing. */
+    ssize_t woke = write(writer->notify[1], "c", 1);
+    (void)woke;
+  }
+  pthread_mutex_unlock(&writer->lock);
+  return NULL;
+}
+
+int history_writer_start(const char *db_path, const history_store_options_t *options, history_writer_t **out) {
+  *out = NULL;
+  history_writer_t *writer = calloc(1, sizeof(*writer));
+  if (writer == NULL) {
+    return -1;
+  }
+  if (pipe(writer->notify) != 0) {
+    free(writer);
+    return -1;
+  }
+  for (int i = 0; i < 2; i++) {
+    fcntl(writer->notify[i], F_SETFL, fcntl(writer->notify[i], F_GETFL) | O_NONBLOCK);
+    fcntl(writer->notify[i], F_SETFD, FD_CLOEXEC);
+  }
+  if (history_store_open(db_path, options, &writer->store) != 0) {
+    close(writer->notify[0]);
+    close(writer->notify[1]);
+    free(writer);
+    return -1;
+  }
+  if (options != NULL) {
+    writer->retention = options->retention;
+  }
+  writer->legacy_left = true;
+  writer->search_backfill_left = true;
+  writer->epoch_end = query_int(writer->store.db, "SELECT max(id) FROM runs WHERE created_epoch IS NULL;");
+  writer->retention_due = true;
+  pthread_mutex_init(&writer->lock, NULL);
+  pthread_cond_init(&writer->wake, NULL);
+  pthread_cond_init(&writer->drained, NULL);
+  if (pthread_create(&writer->thread, NULL, writer_main, writer) != 0) {
+    pthread_cond_destroy(&writer->drained);
+    pthread_cond_destroy(&writer->wake);
+    pthread_mutex_destroy(&writer->lock);
+    history_store_close(&writer->store);
+    close(writer->notify[0]);
+    close(writer->notify[1]);
+    free(writer);
+    return -1;
+  }
+  *out = writer;
+  return 0;
+}
+
+int history_writer_submit(history_writer_t *writer, run_entry_t *run) {
+  history_writer_item_t *item = malloc(sizeof(*item));
+  if (item == NULL) {
+    release_bodies(run);
+    return -1;
+  }
+  item->run = *run;
+  item->next = NULL;
+  run->request_snapshot = NULL;
+  run->response_body = NULL;
+  run->response_body_len = 0;
+  run->body_release = NULL;
+  run->body_owner = NULL;
+
+  pthread_mutex_lock(&writer->lock);
+  if (writer->tail != NULL) {
+    writer->tail->next = item;
+  } else {
+    writer->head = item;
+  }
+  writer->tail = item;
+  writer->queued++;
+  pthread_cond_signal(&writer->wake);
+  pthread_mutex_unlock(&writer->lock);
+  return 0;
+}
+
+int history_writer_notify_fd(const history_writer_t *writer) {
+  return writer != NULL ? writer->notify[0] : -1;
+}
+
+int history_writer_committed(history_writer_t *writer) {
+  char drain[64];
+  int seen = 0;
+  while (read(writer->notify[0], drain, sizeof(drain)) > 0) {
+    seen = 1;
+  }
+  return seen;
+}
+
+void history_writer_flush(history_writer_t *writer) {
+  pthread_mutex_lock(&writer->lock);
+  unsigned long long target = writer->queued;
+  while (writer->committed < target) {
+    pthread_cond_wait(&writer->drained, &writer->lock);
+  }
+  pthread_mutex_unlock(&writer->lock);
+}
+
+unsigned long history_writer_failures(history_writer_t *writer) {
+  pthread_mutex_lock(&writer->lock);
+  unsigned long failures = writer->failures;
+  pthread_mutex_unlock(&writer->lock);
+  return failures;
+}
+
+void history_writer_stop(history_writer_t *writer) {
+  if (writer == NULL) {
+    return;
+  }
+  pthread_mutex_lock(&writer->lock);
+  writer->stopping = true;
+  pthread_cond_signal(&writer->wake);
+  pthread_mutex_unlock(&writer->lock);
+  /* The worker drains the queue before it sees `stopping` with nothing left. */
+  pthread_join(writer->thread, NULL);
+
+  pthread_cond_destroy(&writer->drained);
+  pthread_cond_destroy(&writer->wake);
+  pthread_mutex_destroy(&writer->lock);
+  history_store_close(&writer->store);
+  close(writer->notify[0]);
+  close(writer->notify[1]);
+  free(writer);
 }
@@ -1,12 +1,18 @@
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE /* syncfs */
+#endif
+
 #include "tuiman/request_store.h"
 
 #include <ctype.h>
 #include <dirent.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <strings.h>
+#include <sys/stat.h>
 #include <time.h>
 #include <unistd.h>
 #include <limits.h>
@@ -53,103 +59,177 @@ static int read_file_to_buffer(const char *path, char **out_buffer) {
   return 0;
 }
 
-static void json_escape(const char *in, char *out, size_t out_len) {
-  size_t oi = 0;
-  for (size_t i = 0; in[i] != '\0' && oi + 1 < out_len; i++) {
-    unsigned char c = (unsigned char)in[i];
-    if (c == '"' || c == '\\') {
-      if (oi + 2 >= out_len) {
-        break;
-      }
-      out[oi++] = '\\';
-      out[oi++] = (char)c;
+/* Escapes straight into the stream; unprintable bytes are dropped as before. */
+static int json_write_escaped(FILE *fp, const char *in) {
+  const char *run = in;
+  for (const char *p = in;; p++) {
+    unsigned char c = (unsigned char)*p;
+    if (c != '\0' && c != '"' && c != '\\' && isprint(c)) {
+      continue;
+    }
+    if (p > run && fwrite(run, 1, (size_t)(p - run), fp) != (size_t)(p - run)) {
+      return -1;
+    }
+    run = p + 1;
+    if (c == '\0') {
+      return 0;
+    }
+
+    const char *escape = NULL;
+    if (c == '"') {
+      escape = "\\\"";
+    } else if (c == '\\') {
+      escape = "\\\\";
     } else if (c == '\n') {
-      if (oi + 2 >= out_len) {
-        break;
-      }
-      out[oi++] = '\\';
-      out[oi++] = 'n';
+      escape = "\\n";
     } else if (c == '\r') {
-      if (oi + 2 >= out_len) {
-        break;
-      }
-      out[oi++] = '\\';
-      out[oi++] = 'r';
+      escape = "\\r";
     } else if (c == '\t') {
-      if (oi + 2 >= out_len) {
-        break;
-      }
-      out[oi++] = '\\';
-      out[oi++] = 't';
-    } else if (isprint(c)) {
-      out[oi++] = (char)c;
+      escape = "\\t";
+    }
+    if (escape != NULL && fputs(escape, fp) == EOF) {
+      return -1;
     }
   }
-  out[oi] = '\0';
 }
 
-static int json_extract_string(const char *json, const char *key, char *out, size_t out_len) {
-  char needle[96];
-  if (snprintf(needle, sizeof(needle), "\"%s\"", key) < 0) {
-    return -1;
-  }
-
-  const char *p = strstr(json, needle);
-  if (p == NULL) {
-    return -1;
-  }
-
-  p = strchr(p, ':');
-  if (p == NULL) {
+static int json_write_field(FILE *fp, const char *key, const char *value, int last) {
+  if (fprintf(fp, "  \"%s\": \"", key) < 0 || json_write_escaped(fp, value) != 0) {
     return -1;
   }
-  p++;
-  while (*p != '\0' && isspace((unsigned char)*p)) {
-    p++;
-  }
+  return fputs(last ? "\"\n" : "\",\n", fp) == EOF ? -1 : 0;
+}
 
+/* Parses the string literal at *p (on its opening quote) and leaves *p after the closing quote. */
+static int json_parse_string(const char **cursor, char *out, size_t out_len) {
+  const char *p = *cursor;
   if (*p != '"') {
     return -1;
   }
   p++;
 
   size_t oi = 0;
-  while (*p != '\0' && *p != '"' && oi + 1 < out_len) {
-    if (*p == '\\') {
+  while (*p != '\0' && *p != '"') {
+    char c = *p;
+    if (c == '\\') {
       p++;
       if (*p == '\0') {
         break;
       }
       switch (*p) {
       case 'n':
-        out[oi++] = '\n';
+        c = '\n';
         break;
       case 'r':
-        out[oi++] = '\r';
+        c = '\r';
         break;
       case 't':
-        out[oi++] = '\t';
-        break;
-      case '\\':
-      case '"':
-        out[oi++] = *p;
+        c = '\t';
         break;
       default:
-        out[oi++] = *p;
+        c = *p;
         break;
       }
-      p++;
-      continue;
     }
-
-    out[oi++] = *p;
+    if (oi + 1 < out_len) {
+      out[oi++] = c;
+    }
     p++;
   }
 
   out[oi] = '\0';
+  *cursor = *p == '"' ? p + 1 : p;
   return 0;
 }
 
+static const char *json_find_value(const char *json, const char *key) {
+  char needle[96];
+  if (snprintf(needle, sizeof(needle), "\"%s\"", key) < 0) {
+    return NULL;
+  }
+
+  const char *p = strstr(json, needle);
+  if (p == NULL) {
+    return NULL;
+  }
+
+  p = strchr(p + strlen(needle), ':');
+  if (p == NULL) {
+    return NULL;
+  }
+  p++;
+  while (*p != '\0' && isspace((unsigned char)*p)) {
+    p++;
+  }
+  return p;
+}
+
+static int json_extract_string(const char *json, const char *key, char *out, size_t out_len) {
+  const char *p = json_find_value(json, key);
+  if (p == NULL || *p != '"') {
+    return -1;
+  }
+  return json_parse_string(&p, out, out_len);
+}
+
+static const char *skip_space(const char *p) {
+  while (*p != '\0' && isspace((unsigned char)*p)) {
+    p++;
+  }
+  return p;
+}
+
+/* "headers": [{"name": "...", "value": "..."}, ...] */
+static int json_extract_headers(const char *json, request_t *out) {
+  const char *p = json_find_value(json, "headers");
+  if (p == NULL || *p != '[') {
+    return -1;
+  }
+  p = skip_space(p + 1);
+
+  while (*p == '{') {
+    char name[TUIMAN_HEADER_KEY_LEN] = {0};
+    char value[TUIMAN_HEADER_VAL_LEN] = {0};
+    p = skip_space(p + 1);
+    while (*p == '"') {
+      char key[16];
+      if (json_parse_string(&p, key, sizeof(key)) != 0) {
+        return -1;
+      }
+      p = skip_space(p);
+      if (*p != ':') {
+        return -1;
+      }
+      p = skip_space(p + 1);
+      if (strcmp(key, "name") == 0) {
+        json_parse_string(&p, name, sizeof(name));
+      } else if (strcmp(key, "value") == 0) {
+        json_parse_string(&p, value, sizeof(value));
+      } else {
+        char ignored[TUIMAN_HEADER_VAL_LEN];
+        if (json_parse_string(&p, ignored, sizeof(ignored)) != 0) {
+          return -1;
+        }
+      }
+      p = skip_space(p);
+      if (*p == ',') {
+        p = skip_space(p + 1);
+      }
+    }
+    if (*p != '}') {
+      return -1;
+    }
+    if (name[0] != '\0') {
+      request_header_append(out, name, value);
+    }
+    p = skip_space(p + 1);
+    if (*p == ',') {
+      p = skip_space(p + 1);
+    }
+  }
+  return *p == ']' ? 0 : -1;
+}
+
 void request_generate_id(char out[TUIMAN_ID_LEN]) {
   uuid_t uuid;
   uuid_generate_random(uuid);
@@ -172,68 +252,198 @@ void request_init_defaults(request_t *req) {
   request_set_updated_now(req);
 }
 
-int request_store_write_file(const char *file_path, const request_t *req) {
-  char id_esc[TUIMAN_ID_LEN * 2] = {0};
-  char name_esc[TUIMAN_NAME_LEN * 2] = {0};
-  char method_esc[TUIMAN_METHOD_LEN * 2] = {0};
-  char url_esc[TUIMAN_URL_LEN * 2] = {0};
-  char header_key_esc[TUIMAN_HEADER_KEY_LEN * 2] = {0};
-  char header_value_esc[TUIMAN_HEADER_VAL_LEN * 2] = {0};
-  char auth_type_esc[TUIMAN_AUTH_TYPE_LEN * 2] = {0};
-  char auth_secret_ref_esc[TUIMAN_SECRET_REF_LEN * 2] = {0};
-  char auth_key_name_esc[TUIMAN_HEADER_KEY_LEN * 2] = {0};
-  char auth_location_esc[TUIMAN_AUTH_LOC_LEN * 2] = {0};
-  char auth_username_esc[TUIMAN_AUTH_USER_LEN * 2] = {0};
-  char updated_esc[TUIMAN_UPDATED_AT_LEN * 2] = {0};
-  char body_esc[TUIMAN_BODY_LEN * 2] = {0};
-
-  json_escape(req->id, id_esc, sizeof(id_esc));
-  json_escape(req->name, name_esc, sizeof(name_esc));
-  json_escape(req->method, method_esc, sizeof(method_esc));
-  json_escape(req->url, url_esc, sizeof(url_esc));
-  json_escape(req->header_key, header_key_esc, sizeof(header_key_esc));
-  json_escape(req->header_value, header_value_esc, sizeof(header_value_esc));
-  json_escape(req->auth_type, auth_type_esc, sizeof(auth_type_esc));
-  json_escape(req->auth_secret_ref, auth_secret_ref_esc, sizeof(auth_secret_ref_esc));
-  json_escape(req->auth_key_name, auth_key_name_esc, sizeof(auth_key_name_esc));
-  json_escape(req->auth_location, auth_location_esc, sizeof(auth_location_esc));
-  json_escape(req->auth_username, auth_username_esc, sizeof(auth_username_esc));
-  json_escape(req->updated_at, updated_esc, sizeof(updated_esc));
-  json_escape(req->body, body_esc, sizeof(body_esc));
+static void trim_copy(const char *start, size_t len, char *out, size_t out_len) {
+  while (len > 0 && isspace((unsigned char)*start)) {
+    start++;
+    len--;
+  }
+  while (len > 0 && isspace((unsigned char)start[len - 1])) {
+    len--;
+  }
+  if (len >= out_len) {
+    len = out_len - 1;
+  }
+  memcpy(out, start, len);
+  out[len] = '\0';
+}
 
-  char tmp_path[PATH_MAX];
-  if (snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", file_path) < 0) {
+int request_header_next(const char **cursor, char *name, size_t name_len, char *value, size_t value_len) {
+  const char *p = *cursor;
+  while (*p != '\0') {
+    const char *end = strchr(p, '\n');
+    if (end == NULL) {
+      end = p + strlen(p);
+    }
+    const char *colon = memchr(p, ':', (size_t)(end - p));
+    const char *line = p;
+    p = *end == '\n' ? end + 1 : end;
+    if (colon == NULL) {
+      continue;
+    }
+
+    trim_copy(line, (size_t)(colon - line), name, name_len);
+    if (name[0] == '\0') {
+      continue;
+    }
+    trim_copy(colon + 1, (size_t)(end - colon - 1), value, value_len);
+    *cursor = p;
+    return 1;
+  }
+  *cursor = p;
+  return 0;
+}
+
+size_t request_header_count(const request_t *req) {
+  size_t count = 0;
+  const char *cursor = req->headers;
+  char name[TUIMAN_HEADER_KEY_LEN];
+  char value[TUIMAN_HEADER_VAL_LEN];
+  while (request_header_next(&cursor, name, sizeof(name), value, sizeof(value))) {
+    count++;
+  }
+  return count;
+}
+
+int request_header_append(request_t *req, const char *name, const char *value) {
+  size_t len = strlen(req->headers);
+  int wrote = snprintf(req->headers + len, sizeof(req->headers) - len, "%s%s: %s", len > 0 ? "\n" : "", name,
+                       value != NULL ? value : "");
+  if (wrote < 0 || (size_t)wrote >= sizeof(req->headers) - len) {
+    req->headers[len] = '\0';
+    return -1;
+  }
+  return 0;
+}
+
+int request_header_has(const request_t *req, const char *name) {
+  const char *cursor = req->headers;
+  char found[TUIMAN_HEADER_KEY_LEN];
+  char value[TUIMAN_HEADER_VAL_LEN];
+  while (request_header_next(&cursor, found, sizeof(found), value, sizeof(value))) {
+    if (strcasecmp(found, name) == 0) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+int request_headers_set_text(request_t *req, const char *text) {
+  request_t parsed;
+  parsed.headers[0] = '\0';
+  const char *cursor = text;
+  char name[TUIMAN_HEADER_KEY_LEN];
+  char value[TUIMAN_HEADER_VAL_LEN];
+  int rc = 0;
+  while (request_header_next(&cursor, name, sizeof(name), value, sizeof(value))) {
+    if (request_header_append(&parsed, name, value) != 0) {
+      rc = -1;
+      break;
+    }
+  }
+  memcpy(req->headers, parsed.headers, sizeof(req->headers));
+  return rc;
+}
+
+static int json_write_headers(FILE *fp, const request_t *req) {
+  if (fputs("  \"headers\": [", fp) == EOF) {
     return -1;
   }
+  const char *cursor = req->headers;
+  char name[TUIMAN_HEADER_KEY_LEN];
+  char value[TUIMAN_HEADER_VAL_LEN];
+  int first = 1;
+  while (request_header_next(&cursor, name, sizeof(name), value, sizeof(value))) {
+    if (fputs(first ? "\n    {\"name\": \"" : ",\n    {\"name\": \"", fp) == EOF ||
+        json_write_escaped(fp, name) != 0 || fputs("\", \"value\": \"", fp) == EOF ||
+        json_write_escaped(fp, value) != 0 || fputs("\"}", fp) == EOF) {
+      return -1;
+    }
+    first = 0;
+  }
+  return fputs(first ? "],\n" : "\n  ],\n", fp) == EOF ? -1 : 0;
+}
 
+static int write_request_json(FILE *fp, const request_t *req) {
+  if (fputs("{\n", fp) == EOF || json_write_field(fp, "id", req->id, 0) != 0 ||
+      json_write_field(fp, "name", req->name, 0) != 0 || json_write_field(fp, "method", req->method, 0) != 0 ||
+      json_write_field(fp, "url", req->url, 0) != 0 || json_write_headers(fp, req) != 0 ||
+      json_write_field(fp, "body", req->body, 0) != 0 || json_write_field(fp, "auth_type", req->auth_type, 0) != 0 ||
+      json_write_field(fp, "auth_secret_ref", req->auth_secret_ref, 0) != 0 ||
+      json_write_field(fp, "auth_key_name", req->auth_key_name, 0) != 0 ||
+      json_write_field(fp, "auth_location", req->auth_location, 0) != 0 ||
+      json_write_field(fp, "auth_username", req->auth_username, 0) != 0 ||
+      json_write_field(fp, "updated_at", req->updated_at, 1) != 0 || fputs("}\n", fp) == EOF) {
+    return -1;
+  }
+  return 0;
+}
+
+static int sync_fd(int fd) {
+#if defined(F_FULLFSYNC)
+  /* fsync on macOS stops at the drive cache; F_FULLFSYNC is the real barrier. */
+  if (fcntl(fd, F_FULLFSYNC) == 0) {
+    return 0;
+  }
+#endif
+  return fsync(fd);
+}
+
+static int sync_dir_of(const char *file_path) {
+  char dir_path[PATH_MAX];
+  snprintf(dir_path, sizeof(dir_path), "%s", file_path);
+  char *slash = strrchr(dir_path, '/');
+  if (slash == NULL) {
+    snprintf(dir_path, sizeof(dir_path), ".");
+  } else if (slash == dir_path) {
+    slash[1] = '\0';
+  } else {
+    *slash = '\0';
+  }
+
+  int fd = open(dir_path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (fd < 0) {
+    return -1;
+  }
+  int rc = sync_fd(fd);
+  close(fd);
+  return rc;
+}
+
+static int tmp_path_for(const char *file_path, char out[PATH_MAX]) {
+  int wrote = snprintf(out, PATH_MAX, "%s.tmp", file_path);
+  return (wrote < 0 || wrote >= PATH_MAX) ? -1 : 0;
+}
+
+static int write_tmp_file(const char *tmp_path, const request_t *req, int sync) {
   FILE *fp = fopen(tmp_path, "wb");
   if (fp == NULL) {
     return -1;
   }
 
-  int wrote = fprintf(fp,
-                      "{\n"
-                      "  \"id\": \"%s\",\n"
-                      "  \"name\": \"%s\",\n"
-                      "  \"method\": \"%s\",\n"
-                      "  \"url\": \"%s\",\n"
-                      "  \"header_key\": \"%s\",\n"
-                      "  \"header_value\": \"%s\",\n"
-                      "  \"body\": \"%s\",\n"
-                      "  \"auth_type\": \"%s\",\n"
-                      "  \"auth_secret_ref\": \"%s\",\n"
-                      "  \"auth_key_name\": \"%s\",\n"
-                      "  \"auth_location\": \"%s\",\n"
-                      "  \"auth_username\": \"%s\",\n"
-                      "  \"updated_at\": \"%s\"\n"
-                      "}\n",
-                      id_esc, name_esc, method_esc, url_esc, header_key_esc, header_value_esc, body_esc,
-                      auth_type_esc, auth_secret_ref_esc, auth_key_name_esc, auth_location_esc, auth_username_esc,
-                      updated_esc);
-  fclose(fp);
-
-  if (wrote < 0) {
+  int rc = write_request_json(fp, req);
+  if (rc == 0 && fflush(fp) != 0) {
+    rc = -1;
+  }
+  if (rc == 0 && sync && sync_fd(fileno(fp)) != 0) {
+    rc = -1;
+  }
+  if (fclose(fp) != 0) {
+    rc = -1;
+  }
+  if (rc != 0) {
     unlink(tmp_path);
+  }
+  return rc;
+}
+
+int request_store_write_file(const char *file_path, const request_t *req, request_write_mode_t mode) {
+  char tmp_path[PATH_MAX];
+  if (tmp_path_for(file_path, tmp_path) != 0) {
+    return -1;
+  }
+
+  int durable = mode == REQUEST_WRITE_DURABLE;
+  if (write_tmp_file(tmp_path, req, durable) != 0) {
     return -1;
   }
 
@@ -242,9 +452,133 @@ int request_store_write_file(const char *file_path, const request_t *req) {
     return -1;
   }
 
+  /* The rename itself is only durable once the directory entry is on disk. */
+  if (durable && sync_dir_of(file_path) != 0) {
+    return -1;
+  }
+  return 0;
+}
+
+int request_write_batch_add(request_write_batch_t *batch, const char *file_path, const request_t *req) {
+  char tmp_path[PATH_MAX];
+  if (tmp_path_for(file_path, tmp_path) != 0) {
+    return -1;
+  }
+
+  if (batch->len == batch->cap) {
+    size_t next_cap = batch->cap == 0 ? 64 : batch->cap * 2;
+    request_write_batch_entry_t *next = realloc(batch->items, next_cap * sizeof(request_write_batch_entry_t));
+    if (next == NULL) {
+      return -1;
+    }
+    batch->items = next;
+    batch->cap = next_cap;
+  }
+
+  if (write_tmp_file(tmp_path, req, 0) != 0) {
+    return -1;
+  }
+  snprintf(batch->items[batch->len].path, sizeof(batch->items[batch->len].path), "%s", file_path);
+  batch->len++;
   return 0;
 }
 
+static int flush_staged_files(const request_write_batch_t *batch) {
+#if defined(__linux__)
+  /* One syncfs covers every staged file on the filesystem. */
+  char tmp_path[PATH_MAX];
+  if (tmp_path_for(batch->items[0].path, tmp_path) != 0) {
+    return -1;
+  }
+  int fd = open(tmp_path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return -1;
+  }
+  int rc = syncfs(fd);
+  close(fd);
+  return rc;
+#else
+  /* Push each file to the device, then one full barrier drains the drive cache for all of them. */
+  int last_fd = -1;
+  for (size_t i = 0; i < batch->len; i++) {
+    char tmp_path[PATH_MAX];
+    if (tmp_path_for(batch->items[i].path, tmp_path) != 0) {
+      continue;
+    }
+    int fd = open(tmp_path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+      continue;
+    }
+    fsync(fd);
+    if (last_fd >= 0) {
+      close(last_fd);
+    }
+    last_fd = fd;
+  }
+  if (last_fd < 0) {
+    return -1;
+  }
+  int rc = sync_fd(last_fd);
+  close(last_fd);
+  return rc;
+#endif
+}
+
+int request_write_batch_commit(request_write_batch_t *batch, size_t *committed) {
+  size_t done = 0;
+  int rc = 0;
+  if (batch->len > 0) {
+    if (batch->durable && flush_staged_files(batch) != 0) {
+      rc = -1;
+    }
+
+    for (size_t i = 0; i < batch->len; i++) {
+      char tmp_path[PATH_MAX];
+      if (tmp_path_for(batch->items[i].path, tmp_path) != 0) {
+        continue;
+      }
+      if (rc != 0 || rename(tmp_path, batch->items[i].path) != 0) {
+        unlink(tmp_path);
+        continue;
+      }
+      done++;
+
+      /* One directory fsync per distinct folder; batches are mostly one folder. */
+      const char *path = batch->items[i].path;
+      const char *next = i + 1 < batch->len ? batch->items[i + 1].path : NULL;
+      const char *slash = strrchr(path, '/');
+      size_t dir_len = slash != NULL ? (size_t)(slash - path) : 0;
+      int same_dir_next = next != NULL && strncmp(path, next, dir_len) == 0 && next[dir_len] == '/' &&
+                          strchr(next + dir_len + 1, '/') == NULL;
+      if (batch->durable && !same_dir_next && sync_dir_of(path) != 0) {
+        rc = -1;
+      }
+    }
+  }
+
+  batch->len = 0;
+  if (committed != NULL) {
+    *committed = done;
+  }
+  return rc;
+}
+
+void request_write_batch_free(request_write_batch_t *batch) {
+  if (batch == NULL) {
+    return;
+  }
+  for (size_t i = 0; i < batch->len; i++) {
+    char tmp_path[PATH_MAX];
+    if (tmp_path_for(batch->items[i].path, tmp_path) == 0) {
+      unlink(tmp_path);
+    }
+  }
+  free(batch->items);
+  batch->items = NULL;
+  batch->len = 0;
+  batch->cap = 0;
+}
+
 int request_store_read_file(const char *file_path, request_t *out) {
   char *json = NULL;
   if (read_file_to_buffer(file_path, &json) != 0) {
@@ -256,8 +590,17 @@ int request_store_read_file(const char *file_path, request_t *out) {
   json_extract_string(json, "name", out->name, sizeof(out->name));
   json_extract_string(json, "method", out->method, sizeof(out->method));
   json_extract_string(json, "url", out->url, sizeof(out->url));
-  json_extract_string(json, "header_key", out->header_key, sizeof(out->header_key));
-  json_extract_string(json, "header_value", out->header_value, sizeof(out->header_value));
+  if (json_extract_headers(json, out) != 0) {
+    /* Files from before header lists carry a single header_key/header_value pair. */
+    char header_key[TUIMAN_HEADER_KEY_LEN] = {0};
+    char header_value[TUIMAN_HEADER_VAL_LEN] = {0};
+    json_extract_string(json, "header_key", header_key, sizeof(header_key));
+    json_extract_string(json, "header_value", header_value, sizeof(header_value));
+    out->headers[0] = '\0';
+    if (header_key[0] != '\0') {
+      request_header_append(out, header_key, header_value);
+    }
+  }
   json_extract_string(json, "body", out->body, sizeof(out->body));
   json_extract_string(json, "auth_type", out->auth_type, sizeof(out->auth_type));
   json_extract_string(json, "auth_secret_ref", out->auth_secret_ref, sizeof(out->auth_secret_ref));
@@ -274,17 +617,132 @@ int request_store_read_file(const char *file_path, request_t *out) {
   return 0;
 }
 
-static int request_compare_name(const void *lhs, const void *rhs) {
-  const request_t *a = (const request_t *)lhs;
-  const request_t *b = (const request_t *)rhs;
+int request_collection_compare(const char *a, const char *b) {
+  for (;;) {
+    unsigned char ca = (unsigned char)*a;
+    unsigned char cb = (unsigned char)*b;
+    /* Treat the separator as lower than any other byte so a folder's subtree stays contiguous. */
+    int ka = ca == '/' ? 1 : (ca == '\0' ? 0 : ca + 1);
+    int kb = cb == '/' ? 1 : (cb == '\0' ? 0 : cb + 1);
+    if (ka != kb) {
+      return ka < kb ? -1 : 1;
+    }
+    if (ca == '\0') {
+      return 0;
+    }
+    a++;
+    b++;
+  }
+}
+
+const char *request_collection_basename(const char *collection) {
+  const char *slash = strrchr(collection, '/');
+  return slash != NULL ? slash + 1 : collection;
+}
+
+int request_collection_depth(const char *collection) {
+  if (collection == NULL || collection[0] == '\0') {
+    return 0;
+  }
+  int depth = 1;
+  for (const char *p = collection; *p != '\0'; p++) {
+    if (*p == '/') {
+      depth++;
+    }
+  }
+  return depth;
+}
+
+int request_compare_key(const request_t *a, const request_t *b) {
+  int by_collection = request_collection_compare(a->collection, b->collection);
+  if (by_collection != 0) {
+    return by_collection;
+  }
   return strcasecmp(a->name, b->name);
 }
 
-int request_store_list(const app_paths_t *paths, request_list_t *out) {
-  out->items = NULL;
-  out->len = 0;
+static int request_compare_key_qsort(const void *lhs, const void *rhs) {
+  return request_compare_key((const request_t *)lhs, (const request_t *)rhs);
+}
+
+static int json_collection_dir(const request_store_t *store, const char *collection, char *out, size_t out_len) {
+  int wrote = 0;
+  if (collection == NULL || collection[0] == '\0') {
+    wrote = snprintf(out, out_len, "%s", store->location);
+  } else {
+    wrote = snprintf(out, out_len, "%s/%s", store->location, collection);
+  }
+  return (wrote < 0 || (size_t)wrote >= out_len) ? -1 : 0;
+}
+
+static int json_request_path(const request_store_t *store, const char *collection, const char *request_id, char *out,
+                             size_t out_len) {
+  char dir[PATH_MAX];
+  if (json_collection_dir(store, collection, dir, sizeof(dir)) != 0) {
+    return -1;
+  }
+  int wrote = snprintf(out, out_len, "%s/%s.json", dir, request_id);
+  return (wrote < 0 || (size_t)wrote >= out_len) ? -1 : 0;
+}
+
+static int is_collection_entry(const char *dir_path, const struct dirent *entry) {
+  if (entry->d_name[0] == '.') {
+    return 0;
+  }
+#ifdef DT_DIR
+  if (entry->d_type == DT_DIR) {
+    return 1;
+  }
+  if (entry->d_type != DT_UNKNOWN && entry->d_type != DT_LNK) {
+    return 0;
+  }
+#endif
+  char path[PATH_MAX];
+  if (snprintf(path, sizeof(path), "%s/%s", dir_path, entry->d_name) < 0) {
+    return 0;
+  }
+  struct stat st;
+  return stat(path, &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+static int append_collection(collection_list_t *out, const char *path, long count) {
+  collection_info_t *next = realloc(out->items, (out->len + 1) * sizeof(collection_info_t));
+  if (next == NULL) {
+    return -1;
+  }
+  out->items = next;
+  snprintf(out->items[out->len].path, sizeof(out->items[out->len].path), "%s", path);
+  out->items[out->len].count = count;
+  out->len++;
+  return 0;
+}
+
+static int append_request(request_list_t *out, const request_t *req) {
+  request_t *next = realloc(out->items, (out->len + 1) * sizeof(request_t));
+  if (next == NULL) {
+    return -1;
+  }
+  out->items = next;
+  out->items[out->len] = *req;
+  out->len++;
+  return 0;
+}
+
+static int json_store_scan_collection(request_store_t *store, const char *collection, request_list_t *requests_out,
+                                      collection_list_t *children_out) {
+  requests_out->items = NULL;
+  requests_out->len = 0;
+  if (children_out != NULL) {
+    children_out->items = NULL;
+    children_out->len = 0;
+  }
+
+  char dir_path[PATH_MAX];
+  if (json_collection_dir(store, collection, dir_path, sizeof(dir_path)) != 0) {
+    return -1;
+  }
 
-  DIR *dir = opendir(paths->requests_dir);
+  DIR *dir = opendir(dir_path);
   if (dir == NULL) {
     return -1;
   }
@@ -292,11 +750,22 @@ int request_store_list(const app_paths_t *paths, request_list_t *out) {
   struct dirent *entry = NULL;
   while ((entry = readdir(dir)) != NULL) {
     if (!has_json_suffix(entry->d_name)) {
+      if (children_out != NULL && is_collection_entry(dir_path, entry)) {
+        char child[TUIMAN_COLLECTION_LEN];
+        int wrote = collection[0] == '\0' ? snprintf(child, sizeof(child), "%s", entry->d_name)
+                                          : snprintf(child, sizeof(child), "%s/%s", collection, entry->d_name);
+        if (wrote > 0 && (size_t)wrote < sizeof(child) && append_collection(children_out, child, -1) != 0) {
+          closedir(dir);
+          request_list_free(requests_out);
+          collection_list_free(children_out);
+          return -1;
+        }
+      }
       continue;
     }
 
     char path[PATH_MAX];
-    if (snprintf(path, sizeof(path), "%s/%s", paths->requests_dir, entry->d_name) < 0) {
+    if (snprintf(path, sizeof(path), "%s/%s", dir_path, entry->d_name) < 0) {
       continue;
     }
 
@@ -304,63 +773,332 @@ int request_store_list(const app_paths_t *paths, request_list_t *out) {
     if (request_store_read_file(path, &item) != 0) {
       continue;
     }
+    snprintf(item.collection, sizeof(item.collection), "%s", collection);
 
-    request_t *next = realloc(out->items, (out->len + 1) * sizeof(request_t));
-    if (next == NULL) {
+    if (append_request(requests_out, &item) != 0) {
       closedir(dir);
-      request_list_free(out);
+      request_list_free(requests_out);
+      if (children_out != NULL) {
+        collection_list_free(children_out);
+      }
       return -1;
     }
-
-    out->items = next;
-    out->items[out->len] = item;
-    out->len++;
   }
 
   closedir(dir);
 
+  if (requests_out->len > 1) {
+    qsort(requests_out->items, requests_out->len, sizeof(request_t), request_compare_key_qsort);
+  }
+
+  return 0;
+}
+
+static int json_store_list_into(request_store_t *store, const char *collection, request_list_t *out) {
+  request_list_t found;
+  collection_list_t children;
+  if (json_store_scan_collection(store, collection, &found, &children) != 0) {
+    return -1;
+  }
+
+  int rc = 0;
+  for (size_t i = 0; i < found.len && rc == 0; i++) {
+    rc = append_request(out, &found.items[i]);
+  }
+  request_list_free(&found);
+
+  for (size_t i = 0; i < children.len && rc == 0; i++) {
+    rc = json_store_list_into(store, children.items[i].path, out);
+  }
+  collection_list_free(&children);
+  return rc;
+}
+
+static int json_store_list(request_store_t *store, request_list_t *out) {
+  out->items = NULL;
+  out->len = 0;
+
+  if (json_store_list_into(store, "", out) != 0) {
+    request_list_free(out);
+    return -1;
+  }
+
   if (out->len > 1) {
-    qsort(out->items, out->len, sizeof(request_t), request_compare_name);
+    qsort(out->items, out->len, sizeof(request_t), request_compare_key_qsort);
+  }
+
+  return 0;
+}
+
+static int json_store_find_collection(request_store_t *store, const char *collection, const char *request_id,
+                                      char *out, size_t out_len) {
+  char path[PATH_MAX];
+  if (json_request_path(store, collection, request_id, path, sizeof(path)) == 0 && access(path, F_OK) == 0) {
+    snprintf(out, out_len, "%s", collection);
+    return 0;
+  }
+
+  char dir_path[PATH_MAX];
+  if (json_collection_dir(store, collection, dir_path, sizeof(dir_path)) != 0) {
+    return -1;
+  }
+  DIR *dir = opendir(dir_path);
+  if (dir == NULL) {
+    return -1;
+  }
+
+  int rc = -1;
+  struct dirent *entry = NULL;
+  while (rc != 0 && (entry = readdir(dir)) != NULL) {
+    if (has_json_suffix(entry->d_name) || !is_collection_entry(dir_path, entry)) {
+      continue;
+    }
+    char child[TUIMAN_COLLECTION_LEN];
+    int wrote = collection[0] == '\0' ? snprintf(child, sizeof(child), "%s", entry->d_name)
+                                      : snprintf(child, sizeof(child), "%s/%s", collection, entry->d_name);
+    if (wrote > 0 && (size_t)wrote < sizeof(child)) {
+      rc = json_store_find_collection(store, child, request_id, out, out_len);
+    }
+  }
+  closedir(dir);
+  return rc;
+}
+
+static int json_store_load_by_id(request_store_t *store, const char *collection, const char *request_id,
+                                 request_t *out) {
+  char found[TUIMAN_COLLECTION_LEN];
+  if (collection != NULL) {
+    snprintf(found, sizeof(found), "%s", collection);
+  } else if (json_store_find_collection(store, "", request_id, found, sizeof(found)) != 0) {
+    return -1;
   }
 
+  char path[PATH_MAX];
+  if (json_request_path(store, found, request_id, path, sizeof(path)) != 0) {
+    return -1;
+  }
+  if (request_store_read_file(path, out) != 0) {
+    return -1;
+  }
+  snprintf(out->collection, sizeof(out->collection), "%s", found);
   return 0;
 }
 
-int request_store_load_by_id(const app_paths_t *paths, const char *request_id, request_t *out) {
+static int json_store_save(request_store_t *store, const request_t *req) {
   char path[PATH_MAX];
-  if (snprintf(path, sizeof(path), "%s/%s.json", paths->requests_dir, request_id) < 0) {
+  if (json_request_path(store, req->collection, req->id, path, sizeof(path)) != 0) {
     return -1;
   }
-  return request_store_read_file(path, out);
+  return request_store_write_file(path, req, REQUEST_WRITE_DURABLE);
+}
+
+static int json_store_save_many(request_store_t *store, const request_t *reqs, size_t count, size_t *saved_count) {
+  /* Group commit: stage every file, then pay for one flush and one directory fsync per folder. */
+  request_write_batch_t batch = {0};
+  batch.durable = 1;
+  const char *made_collection = "";
+  for (size_t i = 0; i < count; i++) {
+    if (reqs[i].collection[0] != '\0' && strcmp(made_collection, reqs[i].collection) != 0) {
+      char dir_path[PATH_MAX];
+      if (json_collection_dir(store, reqs[i].collection, dir_path, sizeof(dir_path)) != 0 ||
+          paths_ensure_dir(dir_path) != 0) {
+        continue;
+      }
+      made_collection = reqs[i].collection;
+    }
+
+    char path[PATH_MAX];
+    if (json_request_path(store, reqs[i].collection, reqs[i].id, path, sizeof(path)) != 0) {
+      continue;
+    }
+    request_write_batch_add(&batch, path, &reqs[i]);
+  }
+
+  int rc = request_write_batch_commit(&batch, saved_count);
+  request_write_batch_free(&batch);
+  return rc;
+}
+
+static int json_store_remove(request_store_t *store, const char *collection, const char *request_id) {
+  char path[PATH_MAX];
+  if (json_request_path(store, collection, request_id, path, sizeof(path)) != 0) {
+    return -1;
+  }
+
+  if (unlink(path) != 0 && errno != ENOENT) {
+    return -1;
+  }
+
+  return 0;
+}
+
+static void json_store_close(request_store_t *store) {
+  (void)store;
+}
+
+static const request_store_ops_t JSON_STORE_OPS = {
+    .name = TUIMAN_STORE_JSON,
+    .list = json_store_list,
+    .scan_collection = json_store_scan_collection,
+    .load_by_id = json_store_load_by_id,
+    .save = json_store_save,
+    .save_many = json_store_save_many,
+    .remove = json_store_remove,
+    .close = json_store_close,
+};
+
+int request_store_open_json(const char *requests_dir, request_store_t *out) {
+  memset(out, 0, sizeof(*out));
+  if (snprintf(out->location, sizeof(out->location), "%s", requests_dir) < 0) {
+    return -1;
+  }
+  out->ops = &JSON_STORE_OPS;
+  return 0;
+}
+
+int request_store_open(const app_paths_t *paths, const char *backend, request_store_t *out) {
+  if (backend == NULL || backend[0] == '\0' || strcmp(backend, TUIMAN_STORE_JSON) == 0) {
+    return request_store_open_json(paths->requests_dir, out);
+  }
+  if (strcmp(backend, TUIMAN_STORE_SQLITE) == 0) {
+    return request_store_open_sqlite(paths->requests_db, out);
+  }
+  return -1;
+}
+
+void request_store_close(request_store_t *store) {
+  if (store == NULL || store->ops == NULL) {
+    return;
+  }
+  store->ops->close(store);
+  store->ops = NULL;
+  store->impl = NULL;
 }
 
-int request_store_save(const app_paths_t *paths, const request_t *req) {
+int request_store_is_json(const request_store_t *store) {
+  return store != NULL && store->ops == &JSON_STORE_OPS;
+}
+
+int request_store_list(request_store_t *store, request_list_t *out) {
+  return store->ops->list(store, out);
+}
+
+int request_store_scan_collection(request_store_t *store, const char *collection, request_list_t *requests_out,
+                                  collection_list_t *children_out) {
+  return store->ops->scan_collection(store, collection != NULL ? collection : "", requests_out, children_out);
+}
+
+int request_store_load_by_id(request_store_t *store, const char *collection, const char *request_id,
+                             request_t *out) {
+  return store->ops->load_by_id(store, collection, request_id, out);
+}
+
+int request_store_save(request_store_t *store, const request_t *req) {
   request_t copy = *req;
   if (copy.id[0] == '\0') {
     request_generate_id(copy.id);
+    copy.version = 0;
   }
   request_set_updated_now(&copy);
+  return store->ops->save(store, &copy);
+}
 
-  char path[PATH_MAX];
-  if (snprintf(path, sizeof(path), "%s/%s.json", paths->requests_dir, copy.id) < 0) {
+int request_store_save_many(request_store_t *store, request_t *reqs, size_t count, size_t *saved_count) {
+  size_t saved = 0;
+  for (size_t i = 0; i < count; i++) {
+    if (reqs[i].id[0] == '\0') {
+      request_generate_id(reqs[i].id);
+    }
+    request_set_updated_now(&reqs[i]);
+  }
+
+  int rc = count > 0 ? store->ops->save_many(store, reqs, count, &saved) : 0;
+  if (saved_count != NULL) {
+    *saved_count = saved;
+  }
+  return rc;
+}
+
+int request_store_delete(request_store_t *store, const char *collection, const char *request_id) {
+  return store->ops->remove(store, collection != NULL ? collection : "", request_id);
+}
+
+int request_list_find(const request_list_t *list, const char *request_id, size_t *out_index) {
+  if (list == NULL || request_id == NULL) {
     return -1;
   }
-  return request_store_write_file(path, &copy);
+  for (size_t i = 0; i < list->len; i++) {
+    if (strcmp(list->items[i].id, request_id) == 0) {
+      if (out_index != NULL) {
+        *out_index = i;
+      }
+      return 0;
+    }
+  }
+  return -1;
 }
 
-int request_store_delete(const app_paths_t *paths, const char *request_id) {
-  char path[PATH_MAX];
-  if (snprintf(path, sizeof(path), "%s/%s.json", paths->requests_dir, request_id) < 0) {
+int request_list_insert_sorted(request_list_t *list, const request_t *req, size_t *out_index) {
+  size_t lo = 0;
+  size_t hi = list->len;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (request_compare_key(&list->items[mid], req) <= 0) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+
+  request_t *next = realloc(list->items, (list->len + 1) * sizeof(request_t));
+  if (next == NULL) {
     return -1;
   }
+  list->items = next;
+  memmove(&list->items[lo + 1], &list->items[lo], (list->len - lo) * sizeof(request_t));
+  list->items[lo] = *req;
+  list->len++;
 
-  if (unlink(path) != 0 && errno != ENOENT) {
+  if (out_index != NULL) {
+    *out_index = lo;
+  }
+  return 0;
+}
+
+int request_list_merge_sorted(request_list_t *list, const request_list_t *more) {
+  if (more == NULL || more->len == 0) {
+    return 0;
+  }
+
+  request_t *merged = malloc((list->len + more->len) * sizeof(request_t));
+  if (merged == NULL) {
     return -1;
   }
+  size_t i = 0;
+  size_t j = 0;
+  size_t out = 0;
+  while (i < list->len || j < more->len) {
+    if (j >= more->len || (i < list->len && request_compare_key(&list->items[i], &more->items[j]) <= 0)) {
+      merged[out++] = list->items[i++];
+    } else {
+      merged[out++] = more->items[j++];
+    }
+  }
 
+  free(list->items);
+  list->items = merged;
+  list->len = out;
   return 0;
 }
 
+void request_list_remove_at(request_list_t *list, size_t index) {
+  if (list == NULL || index >= list->len) {
+    return;
+  }
+  memmove(&list->items[index], &list->items[index + 1], (list->len - index - 1) * sizeof(request_t));
+  list->len--;
+}
+
 void request_list_free(request_list_t *list) {
   if (list == NULL) {
     return;
@@ -369,3 +1107,12 @@ void request_list_free(request_list_t *list) {
   list->items = NULL;
   list->len = 0;
 }
+
+void collection_list_free(collection_list_t *list) {
+  if (list == NULL) {
+    return;
+  }
+  free(list->items);
+  list->items = NULL;
+  list->len = 0;
+}
@@ -0,0 +1,450 @@
+#include "tuiman/request_store.h"
+
+#include <sqlite3.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tuiman/sqlite_setup.h"
+
+static const char *SCHEMA_SQL =
+    "CREATE TABLE IF NOT EXISTS requests ("
+    "id TEXT PRIMARY KEY,"
+    "name TEXT NOT NULL,"
+    "method TEXT NOT NULL,"
+    "url TEXT NOT NULL,"
+    "headers TEXT NOT NULL DEFAULT '',"
+    "body TEXT NOT NULL DEFAULT '',"
+    "auth_type TEXT NOT NULL DEFAULT 'none',"
+    "auth_secret_ref TEXT NOT NULL DEFAULT '',"
+    "auth_key_name TEXT NOT NULL DEFAULT '',"
+    "auth_location TEXT NOT NULL DEFAULT '',"
+    "auth_username TEXT NOT NULL DEFAULT '',"
+    "updated_at TEXT NOT NULL,"
+    "collection TEXT NOT NULL DEFAULT '',"
+    "version INTEGER NOT NULL DEFAULT 1"
+    ");"
+    "CREATE INDEX IF NOT EXISTS requests_name_idx ON requests(name COLLATE NOCASE);"
+    "CREATE INDEX IF NOT EXISTS requests_url_idx ON requests(url COLLATE NOCASE);";
+
+/*
+ * user_version 1: the single header_key/header_value pair of files from
+ * before header lists, folded into `headers`. New files never have them.
+ */
+static const char *HEADERS_MIGRATION_SQL =
+    "UPDATE requests SET headers = header_key || ': ' || header_value, header_key = '', header_value = '' "
+    "WHERE header_key <> '' AND headers = '';"
+    "PRAGMA user_version = 1;";
+
+static const char *COLLECTION_INDEX_SQL =
+    "CREATE INDEX IF NOT EXISTS requests_collection_idx ON requests(collection, name COLLATE NOCASE);";
+
+/* As long as the history database's default: another instance's save is a short write. */
+#define REQUEST_DB_BUSY_TIMEOUT_MS 5000
+
+#define REQUEST_COLUMNS                                                                                             \
+  "id, name, method, url, headers, body, auth_type, auth_secret_ref, auth_key_name, auth_location, "                \
+  "auth_username, updated_at, collection"
+/* What reads select: the bound columns plus the row version. */
+#define REQUEST_ROW REQUEST_COLUMNS ", version"
+
+typedef struct {
+  sqlite3 *db;
+  sqlite3_stmt *list_stmt;
+  sqlite3_stmt *scan_stmt;
+  sqlite3_stmt *children_stmt;
+  sqlite3_stmt *load_stmt;
+  sqlite3_stmt *upsert_stmt;
+  sqlite3_stmt *insert_stmt;
+  sqlite3_stmt *update_stmt;
+  sqlite3_stmt *delete_stmt;
+} sqlite_store_t;
+
+static void copy_column(sqlite3_stmt *stmt, int col, char *out, size_t out_len) {
+  const unsigned char *text = sqlite3_column_text(stmt, col);
+  snprintf(out, out_len, "%s", text ? (const char *)text : "");
+}
+
+static void read_row(sqlite3_stmt *stmt, request_t *out) {
+  memset(out, 0, sizeof(*out));
+  copy_column(stmt, 0, out->id, sizeof(out->id));
+  copy_column(stmt, 1, out->name, sizeof(out->name));
+  copy_column(stmt, 2, out->method, sizeof(out->method));
+  copy_column(stmt, 3, out->url, sizeof(out->url));
+  copy_column(stmt, 4, out->headers, sizeof(out->headers));
+  copy_column(stmt, 5, out->body, sizeof(out->body));
+  copy_column(stmt, 6, out->auth_type, sizeof(out->auth_type));
+  copy_column(stmt, 7, out->auth_secret_ref, sizeof(out->auth_secret_ref));
+  copy_column(stmt, 8, out->auth_key_name, sizeof(out->auth_key_name));
+  copy_column(stmt, 9, out->auth_location, sizeof(out->auth_location));
+  copy_column(stmt, 10, out->auth_username, sizeof(out->auth_username));
+  copy_column(stmt, 11, out->updated_at, sizeof(out->updated_at));
+  copy_column(stmt, 12, out->collection, sizeof(out->collection));
+  out->version = sqlite3_column_int64(stmt, 13);
+}
+
+/* request_collection_compare as a collation: '/' sorts below every other byte, so subtrees stay together. */
+static int collection_collate(void *ctx, int a_len, const void *a, int b_len, const void *b) {
+  (void)ctx;
+  const unsigned char *pa = a;
+  const unsigned char *pb = b;
+  for (int i = 0;; i++) {
+    int ka = i < a_len ? (pa[i] == '/' ? 1 : pa[i] + 1) : 0;
+    int kb = i < b_len ? (pb[i] == '/' ? 1 : pb[i] + 1) : 0;
+    if (ka != kb) {
+      return ka < kb ? -1 : 1;
+    }
+    if (ka == 0) {
+      return 0;
+    }
+  }
+}
+
+static int exec_sql(sqlite3 *db, const char *sql) {
+  char *errmsg = NULL;
+  int rc = sqlite3_exec(db, sql, NULL, NULL, &errmsg);
+  sqlite3_free(errmsg);
+  return rc == SQLITE_OK ? 0 : -1;
+}
+
+static int exec_sql_allow_duplicate_column(sqlite3 *db, const char *sql) {
+  char *errmsg = NULL;
+  int rc = sqlite3_exec(db, sql, NULL, NULL, &errmsg);
+  if (rc == SQLITE_OK) {
+    return 0;
+  }
+
+  int duplicate_column = 0;
+  if (errmsg != NULL && strstr(errmsg, "duplicate column name") != NULL) {
+    duplicate_column = 1;
+  }
+  sqlite3_free(errmsg);
+
+  return duplicate_column ? 0 : -1;
+}
+
+static int migrate_schema(sqlite3 *db) {
+  sqlite3_stmt *stmt = NULL;
+  if (sqlite3_prepare_v2(db, "PRAGMA user_version;", -1, &stmt, NULL) != SQLITE_OK) {
+    return -1;
+  }
+  int version = sqlite3_step(stmt) == SQLITE_ROW ? sqlite3_column_int(stmt, 0) : 0;
+  sqlite3_finalize(stmt);
+  if (version >= 1) {
+    return 0;
+  }
+
+  if (sqlite3_prepare_v2(db, "SELECT 1 FROM pragma_table_info('requests') WHERE name = 'header_key';", -1, &stmt,
+                         NULL) != SQLITE_OK) {
+    return -1;
+  }
+  bool legacy = sqlite3_step(stmt) == SQLITE_ROW;
+  sqlite3_finalize(stmt);
+  return exec_sql(db, legacy ? HEADERS_MIGRATION_SQL : "PRAGMA user_version = 1;");
+}
+
+static int read_rows(sqlite3_stmt *stmt, request_list_t *out) {
+  size_t cap = 0;
+  while (sqlite3_step(stmt) == SQLITE_ROW) {
+    if (out->len == cap) {
+      size_t next_cap = cap == 0 ? 64 : cap * 2;
+      request_t *next = realloc(out->items, next_cap * sizeof(request_t));
+      if (next == NULL) {
+        sqlite3_reset(stmt);
+        request_list_free(out);
+        return -1;
+      }
+      out->items = next;
+      cap = next_cap;
+    }
+    read_row(stmt, &out->items[out->len]);
+    out->len++;
+  }
+  sqlite3_reset(stmt);
+  return 0;
+}
+
+static int sqlite_store_list(request_store_t *store, request_list_t *out) {
+  sqlite_store_t *impl = (sqlite_store_t *)store->impl;
+  out->items = NULL;
+  out->len = 0;
+
+  sqlite3_reset(impl->list_stmt);
+  return read_rows(impl->list_stmt, out);
+}
+
+static int add_child_collection(collection_list_t *out, const char *parent, const char *path, long count) {
+  size_t parent_len = strlen(parent);
+  const char *rest = path + (parent_len > 0 ? parent_len + 1 : 0);
+  const char *slash = strchr(rest, '/');
+  size_t child_len = (size_t)(rest - path) + (slash != NULL ? (size_t)(slash - rest) : strlen(rest));
+  if (child_len == 0 || child_len >= TUIMAN_COLLECTION_LEN) {
+    return 0;
+  }
+
+  for (size_t i = 0; i < out->len; i++) {
+    if (strncmp(out->items[i].path, path, child_len) == 0 && out->items[i].path[child_len] == '\0') {
+      if (slash == NULL) {
+        out->items[i].count = count;
+      }
+      return 0;
+    }
+  }
+
+  collection_info_t *next = realloc(out->items, (out->len + 1) * sizeof(collection_info_t));
+  if (next == NULL) {
+    return -1;
+  }
+  out->items = next;
+  memcpy(out->items[out->len].path, path, child_len);
+  out->items[out->len].path[child_len] = '\0';
+  out->items[out->len].count = slash == NULL ? count : 0;
+  out->len++;
+  return 0;
+}
+
+static int sqlite_store_scan_collection(request_store_t *store, const char *collection, request_list_t *requests_out,
+                                        collection_list_t *children_out) {
+  sqlite_store_t *impl = (sqlite_store_t *)store->impl;
+  requests_out->items = NULL;
+  requests_out->len = 0;
+
+  sqlite3_reset(impl->scan_stmt);
+  sqlite3_bind_text(impl->scan_stmt, 1, collection, -1, SQLITE_STATIC);
+  int rc = read_rows(impl->scan_stmt, requests_out);
+  sqlite3_clear_bindings(impl->scan_stmt);
+  if (rc != 0 || children_out == NULL) {
+    return rc;
+  }
+
+  children_out->items = NULL;
+  children_out->len = 0;
+
+  /* Descendants of `collection` form one index range: [prefix + "/", prefix + "0"). */
+  char lower[TUIMAN_COLLECTION_LEN + 2];
+  char upper[TUIMAN_COLLECTION_LEN + 2];
+  if (collection[0] == '\0') {
+    snprintf(lower, sizeof(lower), "%s", "");
+    snprintf(upper, sizeof(upper), "%s", "\xff");
+  } else {
+    snprintf(lower, sizeof(lower), "%s/", collection);
+    snprintf(upper, sizeof(upper), "%s0", collection);
+  }
+
+  sqlite3_reset(impl->children_stmt);
+  sqlite3_bind_text(impl->children_stmt, 1, lower, -1, SQLITE_STATIC);
+  sqlite3_bind_text(impl->children_stmt, 2, upper, -1, SQLITE_STATIC);
+  while (sqlite3_step(impl->children_stmt) == SQLITE_ROW) {
+    const unsigned char *path = sqlite3_column_text(impl->children_stmt, 0);
+    long count = (long)sqlite3_column_int64(impl->children_stmt, 1);
+    if (path == NULL || path[0] == '\0') {
+      continue;
+    }
+    if (add_child_collection(children_out, collection, (const char *)path, count) != 0) {
+      rc = -1;
+      break;
+    }
+  }
+  sqlite3_reset(impl->children_stmt);
+  sqlite3_clear_bindings(impl->children_stmt);
+
+  if (rc != 0) {
+    request_list_free(requests_out);
+    collection_list_free(children_out);
+  }
+  return rc;
+}
+
+static int sqlite_store_load_by_id(request_store_t *store, const char *collection, const char *request_id,
+                                   request_t *out) {
+  (void)collection;
+  sqlite_store_t *impl = (sqlite_store_t *)store->impl;
+  sqlite3_reset(impl->load_stmt);
+  sqlite3_bind_text(impl->load_stmt, 1, request_id, -1, SQLITE_STATIC);
+
+  int rc = -1;
+  if (sqlite3_step(impl->load_stmt) == SQLITE_ROW) {
+    read_row(impl->load_stmt, out);
+    rc = 0;
+  }
+  sqlite3_reset(impl->load_stmt);
+  sqlite3_clear_bindings(impl->load_stmt);
+  return rc;
+}
+
+/* Binds ?1..?13 in REQUEST_COLUMNS order. */
+static void bind_request(sqlite3_stmt *stmt, const request_t *req) {
+  sqlite3_reset(stmt);
+  sqlite3_bind_text(stmt, 1, req->id, -1, SQLITE_STATIC);
+  sqlite3_bind_text(stmt, 2, req->name, -1, SQLITE_STATIC);
+  sqlite3_bind_text(stmt, 3, req->method, -1, SQLITE_STATIC);
+  sqlite3_bind_text(stmt, 4, req->url, -1, SQLITE_STATIC);
+  sqlite3_bind_text(stmt, 5, req->headers, -1, SQLITE_STATIC);
+  sqlite3_bind_text(stmt, 6, req->body, -1, SQLITE_STATIC);
+  sqlite3_bind_text(stmt, 7, req->auth_type, -1, SQLITE_STATIC);
+  sqlite3_bind_text(stmt, 8, req->auth_secret_ref, -1, SQLITE_STATIC);
+  sqlite3_bind_text(stmt, 9, req->auth_key_name, -1, SQLITE_STATIC);
+  sqlite3_bind_text(stmt, 10, req->auth_location, -1, SQLITE_STATIC);
+  sqlite3_bind_text(stmt, 11, req->auth_username, -1, SQLITE_STATIC);
+  sqlite3_bind_text(stmt, 12, req->updated_at, -1, SQLITE_STATIC);
+  sqlite3_bind_text(stmt, 13, req->collection, -1, SQLITE_STATIC);
+}
+
+/* Returns sqlite3_changes, or -1. */
+static int step_request(sqlite_store_t *impl, sqlite3_stmt *stmt) {
+  int rc = sqlite3_step(stmt);
+  sqlite3_reset(stmt);
+  sqlite3_clear_bindings(stmt);
+  return rc == SQLITE_DONE ? sqlite3_changes(impl->db) : -1;
+}
+
+/* Bulk saves (import) overwrite whatever is stored. */
+static int upsert_one(sqlite_store_t *impl, const request_t *req) {
+  bind_request(impl->upsert_stmt, req);
+  return step_request(impl, impl->upsert_stmt) >= 0 ? 0 : -1;
+}
+
+/*
+ * Optimistic concurrency: a row is only replaced at the version it was read
+ * at, so a second instance sharing the file cannot silently overwrite it.
+ */
+static int sqlite_store_save(request_store_t *store, const request_t *req) {
+  sqlite_store_t *impl = (sqlite_store_t *)store->impl;
+  sqlite3_stmt *stmt = req->version == 0 ? impl->insert_stmt : impl->update_stmt;
+  bind_request(stmt, req);
+  if (req->version != 0) {
+    sqlite3_bind_int64(stmt, 14, req->version);
+  }
+  int changed = step_request(impl, stmt);
+  if (changed < 0) {
+    return -1;
+  }
+  return changed == 0 ? TUIMAN_STORE_CONFLICT : 0;
+}
+
+static int sqlite_store_save_many(request_store_t *store, const request_t *reqs, size_t count, size_t *saved_count) {
+  sqlite_store_t *impl = (sqlite_store_t *)store->impl;
+  if (exec_sql(impl->db, "BEGIN IMMEDIATE;") != 0) {
+    return -1;
+  }
+
+  size_t saved = 0;
+  for (size_t i = 0; i < count; i++) {
+    if (upsert_one(impl, &reqs[i]) == 0) {
+      saved++;
+    }
+  }
+
+  if (exec_sql(impl->db, "COMMIT;") != 0) {
+    exec_sql(impl->db, "ROLLBACK;");
+    return -1;
+  }
+  *saved_count += saved;
+  return 0;
+}
+
+static int sqlite_store_remove(request_store_t *store, const char *collection, const char *request_id) {
+  (void)collection;
+  sqlite_store_t *impl = (sqlite_store_t *)store->impl;
+  sqlite3_reset(impl->delete_stmt);
+  sqlite3_bind_text(impl->delete_stmt, 1, request_id, -1, SQLITE_STATIC);
+  int rc = sqlite3_step(impl->delete_stmt);
+  sqlite3_reset(impl->delete_stmt);
+  sqlite3_clear_bindings(impl->delete_stmt);
+  return rc == SQLITE_DONE ? 0 : -1;
+}
+
+static void sqlite_store_close(request_store_t *store) {
+  sqlite_store_t *impl = (sqlite_store_t *)store->impl;
+  if (impl == NULL) {
+    return;
+  }
+  sqlite3_finalize(impl->list_stmt);
+  sqlite3_finalize(impl->scan_stmt);
+  sqlite3_finalize(impl->children_stmt);
+  sqlite3_finalize(impl->load_stmt);
+  sqlite3_finalize(impl->upsert_stmt);
+  sqlite3_finalize(impl->insert_stmt);
+  sqlite3_finalize(impl->update_stmt);
+  sqlite3_finalize(impl->delete_stmt);
+  sqlite3_close(impl->db);
+  free(impl);
+  store->impl = NULL;
+}
+
+static const request_store_ops_t SQLITE_STORE_OPS = {
+    .name = TUIMAN_STORE_SQLITE,
+    .list = sqlite_store_list,
+    .scan_collection = sqlite_store_scan_collection,
+    .load_by_id = sqlite_store_load_by_id,
+    .save = sqlite_store_save,
+    .save_many = sqlite_store_save_many,
+    .remove = sqlite_store_remove,
+    .close = sqlite_store_close,
+};
+
+int request_store_open_sqlite(const char *db_path, request_store_t *out) {
+  /* Catalog order, as the JSON backend returns it (request_compare_key). */
+  static const char *LIST_SQL =
+      "SELECT " REQUEST_ROW " FROM requests ORDER BY collection COLLATE tuiman_collection, name COLLATE NOCASE;";
+  static const char *SCAN_SQL =
+      "SELECT " REQUEST_ROW " FROM requests WHERE collection = ? ORDER BY name COLLATE NOCASE;";
+  static const char *CHILDREN_SQL = "SELECT collection, COUNT(*) FROM requests "
+                                    "WHERE collection >= ? AND collection < ? AND collection <> '' "
+                                    "GROUP BY collection;";
+  static const char *LOAD_SQL = "SELECT " REQUEST_ROW " FROM requests WHERE id = ?;";
+  static const char *UPSERT_SQL =
+      "INSERT INTO requests (" REQUEST_COLUMNS ") VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?) "
+      "ON CONFLICT(id) DO UPDATE SET name = excluded.name, method = excluded.method, url = excluded.url, "
+      "headers = excluded.headers, body = excluded.body, "
+      "auth_type = excluded.auth_type, auth_secret_ref = excluded.auth_secret_ref, "
+      "auth_key_name = excluded.auth_key_name, auth_location = excluded.auth_location, "
+      "auth_username = excluded.auth_username, updated_at = excluded.updated_at, "
+      "collection = excluded.collection, version = version + 1;";
+  static const char *INSERT_SQL = "INSERT INTO requests (" REQUEST_COLUMNS ") VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?) "
+                                  "ON CONFLICT(id) DO NOTHING;";
+  static const char *UPDATE_SQL =
+      "UPDATE requests SET name = ?2, method = ?3, url = ?4, headers = ?5, body = ?6, auth_type = ?7, "
+      "auth_secret_ref = ?8, auth_key_name = ?9, auth_location = ?10, auth_username = ?11, updated_at = ?12, "
+      "collection = ?13, version = version + 1 WHERE id = ?1 AND version = ?14;";
+  static const char *DELETE_SQL = "DELETE FROM requests WHERE id = ?;";
+
+  memset(out, 0, sizeof(*out));
+  if (snprintf(out->location, sizeof(out->location), "%s", db_path) < 0) {
+    return -1;
+  }
+
+  sqlite_store_t *impl = calloc(1, sizeof(*impl));
+  if (impl == NULL) {
+    return -1;
+  }
+  out->impl = impl;
+  out->ops = &SQLITE_STORE_OPS;
+
+  /* Older files lack the columns added since; "duplicate column" means they are already there. */
+  if (sqlite3_open(db_path, &impl->db) != SQLITE_OK ||
+      sqlite3_create_collation(impl->db, "tuiman_collection", SQLITE_UTF8, NULL, collection_collate) != SQLITE_OK ||
+      sqlite_setup_connection(impl->db, REQUEST_DB_BUSY_TIMEOUT_MS) != 0 || exec_sql(impl->db, SCHEMA_SQL) != 0 ||
+      exec_sql_allow_duplicate_column(impl->db,
+                                      "ALTER TABLE requests ADD COLUMN collection TEXT NOT NULL DEFAULT '';") != 0 ||
+      exec_sql(impl->db, COLLECTION_INDEX_SQL) != 0 ||
+      exec_sql_allow_duplicate_column(impl->db,
+                                      "ALTER TABLE requests ADD COLUMN headers TEXT NOT NULL DEFAULT '';") != 0 ||
+      exec_sql_allow_duplicate_column(impl->db,
+                                      "ALTER TABLE requests ADD COLUMN version INTEGER NOT NULL DEFAULT 1;") != 0 ||
+      migrate_schema(impl->db) != 0 ||
+      sqlite3_prepare_v2(impl->db, LIST_SQL, -1, &impl->list_stmt, NULL) != SQLITE_OK ||
+      sqlite3_prepare_v2(impl->db, SCAN_SQL, -1, &impl->scan_stmt, NULL) != SQLITE_OK ||
+      sqlite3_prepare_v2(impl->db, CHILDREN_SQL, -1, &impl->children_stmt, NULL) != SQLITE_OK ||
+      sqlite3_prepare_v2(impl->db, LOAD_SQL, -1, &impl->load_stmt, NULL) != SQLITE_OK ||
+      sqlite3_prepare_v2(impl->db, UPSERT_SQL, -1, &impl->upsert_stmt, NULL) != SQLITE_OK ||
+      sqlite3_prepare_v2(impl->db, INSERT_SQL, -1, &impl->insert_stmt, NULL) != SQLITE_OK ||
+      sqlite3_prepare_v2(impl->db, UPDATE_SQL, -1, &impl->update_stmt, NULL) != SQLITE_OK ||
+      sqlite3_prepare_v2(impl->db, DELETE_SQL, -1, &impl->delete_stmt, NULL) != SQLITE_OK) {
+    request_store_close(out);
+    return -1;
+  }
+
+  return 0;
+}
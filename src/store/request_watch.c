@@ -0,0 +1,443 @@
+#include "tuiman/request_watch.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <sys/inotify.h>
+#elif defined(__APPLE__)
+#include <sys/event.h>
+#endif
+
+static int has_json_suffix(const char *name) {
+  size_t len = strlen(name);
+  return len > 5 && strcmp(name + len - 5, ".json") == 0;
+}
+
+static int name_to_request_id(const char *name, char out[TUIMAN_ID_LEN]) {
+  size_t stem_len = strlen(name) - 5;
+  if (stem_len == 0 || stem_len >= TUIMAN_ID_LEN) {
+    return -1;
+  }
+  memcpy(out, name, stem_len);
+  out[stem_len] = '\0';
+  return 0;
+}
+
+static int collection_path(const request_watch_t *watch, const char *collection, const char *name, char *out,
+                           size_t out_len) {
+  int wrote = 0;
+  if (collection[0] == '\0') {
+    wrote = name != NULL ? snprintf(out, out_len, "%s/%s", watch->root, name) : snprintf(out, out_len, "%s", watch->root);
+  } else {
+    wrote = name != NULL ? snprintf(out, out_len, "%s/%s/%s", watch->root, collection, name)
+                         : snprintf(out, out_len, "%s/%s", watch->root, collection);
+  }
+  return (wrote < 0 || (size_t)wrote >= out_len) ? -1 : 0;
+}
+
+static void stamp_file(const request_watch_t *watch, const char *collection, const char *name,
+                       request_watch_stamp_t *out) {
+  memset(out, 0, sizeof(*out));
+  snprintf(out->name, sizeof(out->name), "%s", name);
+
+  char path[PATH_MAX];
+  struct stat st;
+  if (collection_path(watch, collection, name, path, sizeof(path)) != 0 || stat(path, &st) != 0) {
+    return;
+  }
+  out->exists = 1;
+  out->is_dir = S_ISDIR(st.st_mode) ? 1 : 0;
+  out->ino = st.st_ino;
+  out->size = st.st_size;
+  out->mtime = st.st_mtime;
+}
+
+static int stamp_equal(const request_watch_stamp_t *a, const request_watch_stamp_t *b) {
+  if (a->exists != b->exists) {
+    return 0;
+  }
+  if (!a->exists) {
+    return 1;
+  }
+  return a->ino == b->ino && a->size == b->size && a->mtime == b->mtime;
+}
+
+static int consume_self_write(request_watch_t *watch, const char *collection, const request_watch_stamp_t *current) {
+  for (size_t i = 0; i < TUIMAN_WATCH_SELF_WRITES; i++) {
+    request_watch_self_write_t *self = &watch->self_writes[i];
+    if (self->name[0] == '\0' || strcmp(self->name, current->name) != 0 ||
+        strcmp(self->collection, collection) != 0) {
+      continue;
+    }
+    int same = stamp_equal(&self->stamp, current);
+    self->name[0] = '\0';
+    return same;
+  }
+  return 0;
+}
+
+static size_t push_event(request_watch_event_t *events, size_t cap, size_t len, request_watch_kind_t kind,
+                         const char *collection, const char *request_id) {
+  if (cap == 0) {
+    return 0;
+  }
+  if (len >= cap) {
+    /* Out of room: collapse the tail into a rescan so nothing is lost. */
+    memset(&events[cap - 1], 0, sizeof(events[cap - 1]));
+    events[cap - 1].kind = REQUEST_WATCH_RESCAN;
+    return cap;
+  }
+  events[len].kind = kind;
+  snprintf(events[len].collection, sizeof(events[len].collection), "%s", collection != NULL ? collection : "");
+  snprintf(events[len].request_id, sizeof(events[len].request_id), "%s", request_id != NULL ? request_id : "");
+  return len + 1;
+}
+
+static size_t push_file_event(request_watch_t *watch, const char *collection, const char *name,
+                              request_watch_event_t *events, size_t cap, size_t len) {
+  if (!has_json_suffix(name)) {
+    return len;
+  }
+
+  request_watch_stamp_t current;
+  stamp_file(watch, collection, name, &current);
+  if (consume_self_write(watch, collection, &current)) {
+    return len;
+  }
+
+  char request_id[TUIMAN_ID_LEN];
+  if (name_to_request_id(name, request_id) != 0) {
+    return push_event(events, cap, len, REQUEST_WATCH_RESCAN, NULL, NULL);
+  }
+  return push_event(events, cap, len, current.exists ? REQUEST_WATCH_UPSERT : REQUEST_WATCH_REMOVE, collection,
+                    request_id);
+}
+
+static request_watch_dir_t *find_dir_by_wd(request_watch_t *watch, int wd) {
+  for (size_t i = 0; i < watch->dirs_len; i++) {
+    if (watch->dirs[i].wd == wd) {
+      return &watch->dirs[i];
+    }
+  }
+  return NULL;
+}
+
+static void drop_dir(request_watch_t *watch, request_watch_dir_t *dir) {
+  size_t index = (size_t)(dir - watch->dirs);
+  free(dir->snapshot);
+  memmove(&watch->dirs[index], &watch->dirs[index + 1], (watch->dirs_len - index - 1) * sizeof(request_watch_dir_t));
+  watch->dirs_len--;
+}
+
+#if defined(__APPLE__)
+static int stamp_compare_name(const void *lhs, const void *rhs) {
+  const request_watch_stamp_t *a = (const request_watch_stamp_t *)lhs;
+  const request_watch_stamp_t *b = (const request_watch_stamp_t *)rhs;
+  return strcmp(a->name, b->name);
+}
+
+static int scan_snapshot(const request_watch_t *watch, const char *collection, request_watch_stamp_t **out,
+                         size_t *out_len) {
+  *out = NULL;
+  *out_len = 0;
+
+  char dir_path[PATH_MAX];
+  if (collection_path(watch, collection, NULL, dir_path, sizeof(dir_path)) != 0) {
+    return -1;
+  }
+  DIR *dir = opendir(dir_path);
+  if (dir == NULL) {
+    return -1;
+  }
+
+  struct dirent *entry = NULL;
+  while ((entry = readdir(dir)) != NULL) {
+    if (entry->d_name[0] == '.') {
+      continue;
+    }
+    int is_json = has_json_suffix(entry->d_name);
+    if (!is_json && entry->d_type != DT_DIR) {
+      continue;
+    }
+    if (strlen(entry->d_name) >= sizeof((*out)->name)) {
+      continue;
+    }
+    request_watch_stamp_t *next = realloc(*out, (*out_len + 1) * sizeof(request_watch_stamp_t));
+    if (next == NULL) {
+      closedir(dir);
+      free(*out);
+      *out = NULL;
+      *out_len = 0;
+      return -1;
+    }
+    *out = next;
+    stamp_file(watch, collection, entry->d_name, &(*out)[*out_len]);
+    (*out)[*out_len].is_dir = is_json ? 0 : 1;
+    (*out_len)++;
+  }
+  closedir(dir);
+
+  if (*out_len > 1) {
+    qsort(*out, *out_len, sizeof(request_watch_stamp_t), stamp_compare_name);
+  }
+  return 0;
+}
+
+static size_t diff_snapshot(request_watch_t *watch, request_watch_dir_t *dir, request_watch_event_t *events,
+                            size_t cap, size_t len) {
+  request_watch_stamp_t *next = NULL;
+  size_t next_len = 0;
+  if (scan_snapshot(watch, dir->collection, &next, &next_len) != 0) {
+    return push_event(events, cap, len, REQUEST_WATCH_RESCAN, NULL, NULL);
+  }
+
+  int rescan = 0;
+  size_t i = 0;
+  size_t j = 0;
+  while (i < dir->snapshot_len || j < next_len) {
+    int cmp = 0;
+    if (i >= dir->snapshot_len) {
+      cmp = 1;
+    } else if (j >= next_len) {
+      cmp = -1;
+    } else {
+      cmp = strcmp(dir->snapshot[i].name, next[j].name);
+    }
+
+    const request_watch_stamp_t *changed = NULL;
+    if (cmp < 0) {
+      changed = &dir->snapshot[i++];
+    } else if (cmp > 0) {
+      changed = &next[j++];
+    } else {
+      if (!dir->snapshot[i].is_dir && !stamp_equal(&dir->snapshot[i], &next[j])) {
+        changed = &next[j];
+      }
+      i++;
+      j++;
+    }
+
+    if (changed == NULL) {
+      continue;
+    }
+    if (changed->is_dir) {
+      rescan = 1;
+    } else {
+      len = push_file_event(watch, dir->collection, changed->name, events, cap, len);
+    }
+  }
+
+  free(dir->snapshot);
+  dir->snapshot = next;
+  dir->snapshot_len = next_len;
+  return rescan ? push_event(events, cap, len, REQUEST_WATCH_RESCAN, NULL, NULL) : len;
+}
+#endif
+
+int request_watch_open(const char *requests_dir, request_watch_t *out) {
+  memset(out, 0, sizeof(*out));
+  out->fd = -1;
+  snprintf(out->root, sizeof(out->root), "%s", requests_dir);
+
+#if defined(__linux__)
+  out->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#elif defined(__APPLE__)
+  out->fd = kqueue();
+#endif
+  if (out->fd < 0) {
+    return -1;
+  }
+  if (request_watch_add_collection(out, "") != 0) {
+    request_watch_close(out);
+    return -1;
+  }
+  return 0;
+}
+
+void request_watch_close(request_watch_t *watch) {
+  if (watch == NULL) {
+    return;
+  }
+  for (size_t i = 0; i < watch->dirs_len; i++) {
+#if defined(__APPLE__)
+    close(watch->dirs[i].wd);
+#endif
+    free(watch->dirs[i].snapshot);
+  }
+  free(watch->dirs);
+  watch->dirs = NULL;
+  watch->dirs_len = 0;
+  if (watch->fd >= 0) {
+    close(watch->fd);
+  }
+  watch->fd = -1;
+}
+
+int request_watch_add_collection(request_watch_t *watch, const char *collection) {
+  if (watch == NULL || watch->fd < 0) {
+    return -1;
+  }
+  for (size_t i = 0; i < watch->dirs_len; i++) {
+    if (strcmp(watch->dirs[i].collection, collection) == 0) {
+      return 0;
+    }
+  }
+
+  char dir_path[PATH_MAX];
+  if (collection_path(watch, collection, NULL, dir_path, sizeof(dir_path)) != 0) {
+    return -1;
+  }
+
+  request_watch_dir_t dir;
+  memset(&dir, 0, sizeof(dir));
+  snprintf(dir.collection, sizeof(dir.collection), "%s", collection);
+
+#if defined(__linux__)
+  uint32_t mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE | IN_DELETE_SELF |
+                  IN_MOVE_SELF | IN_ONLYDIR;
+  dir.wd = inotify_add_watch(watch->fd, dir_path, mask);
+  if (dir.wd < 0) {
+    return -1;
+  }
+#elif defined(__APPLE__)
+  dir.wd = open(dir_path, O_EVTONLY | O_CLOEXEC);
+  if (dir.wd < 0) {
+    return -1;
+  }
+  struct kevent change;
+  EV_SET(&change, dir.wd, EVFILT_VNODE, EV_ADD | EV_CLEAR, NOTE_WRITE | NOTE_DELETE | NOTE_RENAME, 0, NULL);
+  if (kevent(watch->fd, &change, 1, NULL, 0, NULL) != 0 ||
+      scan_snapshot(watch, collection, &dir.snapshot, &dir.snapshot_len) != 0) {
+    close(dir.wd);
+    return -1;
+  }
+#else
+  return -1;
+#endif
+
+  request_watch_dir_t *next = realloc(watch->dirs, (watch->dirs_len + 1) * sizeof(request_watch_dir_t));
+  if (next == NULL) {
+    free(dir.snapshot);
+    return -1;
+  }
+  watch->dirs = next;
+  watch->dirs[watch->dirs_len++] = dir;
+  return 0;
+}
+
+int request_watch_fd(const request_watch_t *watch) {
+  return watch != NULL ? watch->fd : -1;
+}
+
+void request_watch_note_self_write(request_watch_t *watch, const char *collection, const char *request_id) {
+  if (watch == NULL || watch->fd < 0 || request_id == NULL || request_id[0] == '\0') {
+    return;
+  }
+  if (collection == NULL) {
+    collection = "";
+  }
+
+  char name[TUIMAN_ID_LEN + 8];
+  snprintf(name, sizeof(name), "%s.json", request_id);
+
+  request_watch_self_write_t *slot = &watch->self_writes[watch->self_write_next];
+  for (size_t i = 0; i < TUIMAN_WATCH_SELF_WRITES; i++) {
+    if (strcmp(watch->self_writes[i].name, name) == 0 && strcmp(watch->self_writes[i].collection, collection) == 0) {
+      slot = &watch->self_writes[i];
+      break;
+    }
+  }
+  if (slot == &watch->self_writes[watch->self_write_next]) {
+    watch->self_write_next = (watch->self_write_next + 1) % TUIMAN_WATCH_SELF_WRITES;
+  }
+  snprintf(slot->collection, sizeof(slot->collection), "%s", collection);
+  snprintf(slot->name, sizeof(slot->name), "%s", name);
+  stamp_file(watch, collection, name, &slot->stamp);
+
+#if defined(__APPLE__)
+  /* Keep the snapshot in step so the next diff does not report our own write. */
+  for (size_t d = 0; d < watch->dirs_len; d++) {
+    request_watch_dir_t *dir = &watch->dirs[d];
+    if (strcmp(dir->collection, collection) != 0) {
+      continue;
+    }
+    for (size_t i = 0; i < dir->snapshot_len; i++) {
+      if (strcmp(dir->snapshot[i].name, name) == 0) {
+        dir->snapshot[i] = slot->stamp;
+        break;
+      }
+    }
+  }
+#endif
+}
+
+size_t request_watch_read(request_watch_t *watch, request_watch_event_t *events, size_t cap) {
+  if (watch == NULL || watch->fd < 0 || events == NULL || cap == 0) {
+    return 0;
+  }
+
+  size_t len = 0;
+#if defined(__linux__)
+  char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+  for (;;) {
+    ssize_t n = read(watch->fd, buffer, sizeof(buffer));
+    if (n <= 0) {
+      break;
+    }
+
+    for (char *p = buffer; p < buffer + n;) {
+      const struct inotify_event *ev = (const struct inotify_event *)p;
+      p += sizeof(struct inotify_event) + ev->len;
+
+      request_watch_dir_t *dir = find_dir_by_wd(watch, ev->wd);
+      if (ev->mask & IN_IGNORED) {
+        if (dir != NULL) {
+          drop_dir(watch, dir);
+        }
+        len = push_event(events, cap, len, REQUEST_WATCH_RESCAN, NULL, NULL);
+        continue;
+      }
+      if (dir == NULL || (ev->mask & (IN_Q_OVERFLOW | IN_DELETE_SELF | IN_MOVE_SELF | IN_ISDIR))) {
+        /* Folders appearing/disappearing reshape the tree; let the caller rescan. */
+        len = push_event(events, cap, len, REQUEST_WATCH_RESCAN, NULL, NULL);
+        continue;
+      }
+      if (ev->len == 0 || (ev->mask & IN_CREATE)) {
+        continue;
+      }
+      len = push_file_event(watch, dir->collection, ev->name, events, cap, len);
+    }
+  }
+#elif defined(__APPLE__)
+  struct kevent triggered[16];
+  struct timespec zero = {0, 0};
+  int n = 0;
+  while ((n = kevent(watch->fd, NULL, 0, triggered, 16, &zero)) > 0) {
+    for (int i = 0; i < n; i++) {
+      request_watch_dir_t *dir = find_dir_by_wd(watch, (int)triggered[i].ident);
+      if (dir == NULL || (triggered[i].fflags & (NOTE_DELETE | NOTE_RENAME))) {
+        if (dir != NULL) {
+          close(dir->wd);
+          drop_dir(watch, dir);
+        }
+        len = push_event(events, cap, len, REQUEST_WATCH_RESCAN, NULL, NULL);
+        continue;
+      }
+      len = diff_snapshot(watch, dir, events, cap, len);
+    }
+  }
+#else
+  (void)find_dir_by_wd;
+  (void)drop_dir;
+  (void)push_file_event;
+#endif
+  return len;
+}
@@ -0,0 +1,12 @@
+#include "tuiman/sqlite_setup.h"
+
+#include <stddef.h>
+
+int sqlite_setup_connection(sqlite3 *db, int busy_timeout_ms) {
+  if (sqlite3_busy_timeout(db, busy_timeout_ms) != SQLITE_OK) {
+    return -1;
+  }
+  return sqlite3_exec(db, "PRAGMA journal_mode = WAL; PRAGMA synchronous = NORMAL;", NULL, NULL, NULL) == SQLITE_OK
+             ? 0
+             : -1;
+}